@@ -25,6 +25,12 @@ test_linux: deps_linux
 	make -j8
 	cd test && /usr/bin/python test-run.py -j -1
 
+# Memtx indexes with 32-bit tuple handles
+test_compact_handles: deps_linux
+	cmake . -DCMAKE_BUILD_TYPE=RelWithDebInfo -DENABLE_MEMTX_COMPACT_HANDLES=ON
+	make -j8
+	cd test && /usr/bin/python test-run.py -j -1 unit/ box/ box-tap/ engine/
+
 deps_osx:
 	brew install openssl readline --force
 	sudo pip install python-daemon PyYAML
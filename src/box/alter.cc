@@ -364,6 +364,13 @@ index_opts_create(struct index_opts *opts, const char *map)
 	if (opts->run_size_ratio <= 1)
 		tnt_raise(ClientError, ER_WRONG_SPACE_OPTIONS, INDEX_OPTS,
 			  "run_size_ratio must be > 1");
+	/* A path of the buffer size may have been truncated. */
+	if (strlen(opts->path) >= sizeof(opts->path) - 1)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS, INDEX_OPTS,
+			  "path is too long");
+	if (opts->path[0] != '\0' && key_path_validate(opts->path) != 0)
+		tnt_raise(ClientError, ER_WRONG_INDEX_OPTIONS, INDEX_OPTS,
+			  "invalid path");
 	return map;
 }
 
@@ -45,11 +45,25 @@
 #include "version.h"
 #include "trigger.h"
 #include "xrow_io.h"
+#include "txn.h"
+#include "cfg.h"
+#include "histogram.h"
 #include "error.h"
+#include "errinj.h"
 
 /* TODO: add configuration options */
 static const int RECONNECT_DELAY = 1;
 
+enum {
+	/**
+	 * Max number of rows received ahead and applied in a
+	 * single local transaction.
+	 */
+	APPLIER_BATCH_MAX = 128,
+	/** Max number of fibers looking up rows of a batch. */
+	APPLIER_LANES_MAX = 64
+};
+
 STRS(applier_state, applier_STATE);
 
 static inline void
@@ -190,6 +204,138 @@ done:
 	applier_set_state(applier, APPLIER_READY);
 }
 
+/** Rows of a compressed block received from the master. */
+struct applier_tx {
+	/** Rows unpacked from the last block. */
+	struct ibuf rows;
+	/** zstd context, created on the first block. */
+	ZSTD_DStream *zdctx;
+};
+
+static void
+applier_tx_create(struct applier_tx *tx)
+{
+	ibuf_create(&tx->rows, &cord()->slabc, 16 * 1024);
+	tx->zdctx = NULL;
+}
+
+static void
+applier_tx_destroy(struct applier_tx *tx)
+{
+	ibuf_destroy(&tx->rows);
+	if (tx->zdctx != NULL)
+		ZSTD_freeDStream(tx->zdctx);
+}
+
+/** Unpack a block of rows for applier_read_row(). */
+static void
+applier_tx_decode(struct applier *applier, struct applier_tx *tx,
+		  struct xrow_header *packet)
+{
+	const char *block;
+	uint32_t size, len;
+	xrow_decode_tx_block(packet, &block, &size, &len);
+	if (tx->zdctx == NULL) {
+		tx->zdctx = ZSTD_createDStream();
+		if (tx->zdctx == NULL) {
+			tnt_raise(OutOfMemory, sizeof(ZSTD_DStream *),
+				  "ZSTD_createDStream", "applier zdctx");
+		}
+	}
+	ibuf_reset(&tx->rows);
+	char *rows = (char *) ibuf_alloc(&tx->rows, len);
+	if (rows == NULL)
+		tnt_raise(OutOfMemory, len, "ibuf_alloc", "applier rows");
+	if (xlog_tx_decode(block, block + size, rows, rows + len,
+			   tx->zdctx) != 0)
+		diag_raise();
+	applier->tx_size += size;
+	applier->tx_len += len;
+}
+
+/**
+ * Read the next row sent in reply to JOIN or SUBSCRIBE, either
+ * as is or packed into a compressed block.
+ *
+ * Rows of a batch may point to unpacked rows of a block, so
+ * a new block is unpacked only if no rows of the current batch
+ * came from the previous one.
+ *
+ * @param is_blocking false to take only a row already read
+ *                    into the input buffer, true to start a
+ *                    new batch and wait for a row
+ * @retval false no row is available without blocking
+ */
+static bool
+applier_read_row(struct applier *applier, struct applier_tx *tx,
+		 struct xrow_header *row, bool is_blocking)
+{
+	struct iobuf *iobuf = applier->iobuf;
+	if (ibuf_used(&tx->rows) == 0) {
+		if (is_blocking) {
+			ibuf_reset(&tx->rows);
+			coio_read_xrow(&applier->io, &iobuf->in, row);
+		} else if (tx->rows.rpos != tx->rows.buf ||
+			   ! xrow_read_buffered(&iobuf->in, row)) {
+			return false;
+		}
+		if (row->type != IPROTO_TX_BLOCK)
+			return true;
+		applier_tx_decode(applier, tx, row);
+	}
+	xrow_header_decode_xc(row, (const char **) &tx->rows.rpos,
+			      tx->rows.wpos);
+	return true;
+}
+
+/**
+ * Load initial JOIN rows from a snapshot of the master copied
+ * to the replica out of band, e.g. with box.backup. Snapshot
+ * rows go first in initial JOIN and in the same order, so the
+ * JOIN is then resumed from the checkpoint of the snapshot as
+ * if the rows were received from the master.
+ */
+static void
+applier_seed(struct applier *applier, const char *filename)
+{
+	say_info("seeding from `%s'", filename);
+	struct xlog_cursor cursor;
+	xlog_cursor_open_xc(&cursor, filename);
+	auto reader_guard = make_scoped_guard([&]{
+		xlog_cursor_close(&cursor, false);
+	});
+	if (strcmp(cursor.meta.filetype, "SNAP") != 0) {
+		tnt_raise(ClientError, ER_INVALID_XLOG_TYPE, "SNAP",
+			  cursor.meta.filetype);
+	}
+	/* Only the master has the checkpoint of its snapshot. */
+	if (! tt_uuid_is_equal(&cursor.meta.instance_uuid, &applier->uuid)) {
+		tnt_raise(ClientError, ER_CFG, "replication_seed_snapshot",
+			  "the snapshot is not made by the bootstrap master");
+	}
+	vclock_copy(&applier->join_vclock, &cursor.meta.vclock);
+	vclock_copy(&replicaset_vclock, &cursor.meta.vclock);
+
+	struct xrow_header row;
+	while (xlog_cursor_next_xc(&cursor, &row, false) == 0) {
+		xstream_write_xc(applier->join_stream, &row);
+		applier->join_rows++;
+		for (int i = 0; i < row.bodycnt; i++)
+			applier->join_bytes += row.body[i].iov_len;
+		if (applier->join_rows % 100000 == 0) {
+			say_info("%.1fM rows seeded",
+				 applier->join_rows / 1000000.);
+			fiber_yield_timeout(0);
+		}
+	}
+	/* See memtx_initial_join_f(). */
+	if (cursor.state != XLOG_CURSOR_EOF)
+		tnt_raise(XlogError, "snapshot `%s' has no EOF marker",
+			  filename);
+	say_info("seeded %llu rows, resuming join from the master",
+		 (unsigned long long) applier->join_rows);
+}
+
 /**
  * Execute and process JOIN request (bootstrap the instance).
  */
@@ -200,8 +346,24 @@ applier_join(struct applier *applier)
 	struct ev_io *coio = &applier->io;
 	struct iobuf *iobuf = applier->iobuf;
 	struct xrow_header row;
-	xrow_encode_join(&row, &INSTANCE_UUID);
+	/*
+	 * If the connection was lost during JOIN, ask the master
+	 * to resume it from the same checkpoint, skipping the
+	 * initial rows which have already been applied.
+	 */
+	bool is_resumed = applier->join_rows > 0;
+	const char *seed = cfg_gets("replication_seed_snapshot");
+	if (! is_resumed && seed != NULL) {
+		applier->is_joining = true;
+		applier_set_state(applier, APPLIER_INITIAL_JOIN);
+		applier_seed(applier, seed);
+		is_resumed = true;
+	}
+	xrow_encode_join(&row, &INSTANCE_UUID, &applier->join_vclock,
+			 applier->join_rows,
+			 cfg_geti("replication_compression"));
 	coio_write_xrow(coio, &row);
+	applier->is_joining = true;
 
 	/**
 	 * Tarantool < 1.7.0: if JOIN is successful, there is no "OK"
@@ -222,20 +384,48 @@ applier_join(struct applier *applier)
 		 * Used to initialize the replica's initial
 		 * vclock in bootstrap_from_master()
 		 */
-		xrow_decode_vclock(&row, &replicaset_vclock);
+		if (! is_resumed) {
+			xrow_decode_vclock(&row, &replicaset_vclock);
+			vclock_copy(&applier->join_vclock,
+				    &replicaset_vclock);
+		} else {
+			struct vclock vclock;
+			vclock_create(&vclock);
+			xrow_decode_vclock(&row, &vclock);
+			if (vclock_compare(&vclock,
+					   &applier->join_vclock) != 0) {
+				tnt_raise(ClientError, ER_PROTOCOL,
+					  "Invalid response to resumed JOIN");
+			}
+		}
 	}
 
 	applier_set_state(applier, APPLIER_INITIAL_JOIN);
 
+	struct applier_tx tx;
+	applier_tx_create(&tx);
+	auto tx_guard = make_scoped_guard([&]{
+		applier_tx_destroy(&tx);
+	});
 	/*
 	 * Receive initial data.
 	 */
 	assert(applier->join_stream != NULL);
 	while (true) {
-		coio_read_xrow(coio, &iobuf->in, &row);
+		applier_read_row(applier, &tx, &row, true);
 		applier->last_row_time = ev_now(loop());
 		if (iproto_type_is_dml(row.type)) {
 			xstream_write_xc(applier->join_stream, &row);
+			applier->join_rows++;
+			for (int i = 0; i < row.bodycnt; i++)
+				applier->join_bytes += row.body[i].iov_len;
+			struct errinj *inj = errinj(ERRINJ_APPLIER_JOIN_BREAK,
+						    ERRINJ_INT);
+			if (inj != NULL &&
+			    inj->iparam == (int) applier->join_rows) {
+				tnt_raise(SocketError, applier->io.fd,
+					  "initial join");
+			}
 		} else if (row.type == IPROTO_OK) {
 			if (applier->version_id < version_id(1, 7, 0)) {
 				/*
@@ -269,9 +459,13 @@ applier_join(struct applier *applier)
 	 * Receive final data.
 	 */
 	while (true) {
-		coio_read_xrow(coio, &iobuf->in, &row);
+		applier_read_row(applier, &tx, &row, true);
 		applier->last_row_time = ev_now(loop());
 		if (iproto_type_is_dml(row.type)) {
+			/* Applied before the connection was lost. */
+			if (row.lsn <= vclock_get(&replicaset_vclock,
+						  row.replica_id))
+				continue;
 			vclock_follow(&replicaset_vclock, row.replica_id,
 				      row.lsn);
 			xstream_write_xc(applier->subscribe_stream, &row);
@@ -290,11 +484,203 @@ applier_join(struct applier *applier)
 	}
 finish:
 	say_info("final data received");
+	applier->is_joining = false;
 
 	applier_set_state(applier, APPLIER_JOINED);
 	applier_set_state(applier, APPLIER_READY);
 }
 
+/**
+ * Promote the replica set vclock past an applied row, unless
+ * it is already there, e.g. because of a local write.
+ */
+static inline void
+applier_promote_vclock(uint32_t replica_id, int64_t lsn)
+{
+	if (lsn > vclock_get(&replicaset_vclock, replica_id))
+		vclock_follow(&replicaset_vclock, replica_id, lsn);
+}
+
+/**
+ * Apply rows from the same replica. Rows which have already been
+ * applied, e.g. received from another master, are skipped.
+ *
+ * The rows are applied under the latch of the replica, so that
+ * another applier waits instead of applying them once again,
+ * and the replica set vclock is promoted only when they are
+ * committed. It thus never moves backwards.
+ *
+ * If the rows can't be applied in one transaction, they are
+ * applied one per transaction up to the first failed row. As
+ * with a row applied alone, the vclock is promoted past the
+ * failed row, so it is skipped when the replication is
+ * resumed, and rows after it are received once again.
+ */
+static void
+applier_apply_rows(struct applier *applier, struct xrow_header *rows,
+		   int count)
+{
+	uint32_t replica_id = rows[0].replica_id;
+	struct latch *latch = &replicaset_apply_latch[replica_id];
+	latch_lock(latch);
+	auto latch_guard = make_scoped_guard([&]{
+		latch_unlock(latch);
+	});
+	int64_t lsn = vclock_get(&replicaset_vclock, replica_id);
+	while (count > 0 && rows[0].lsn <= lsn) {
+		rows++;
+		count--;
+	}
+	if (count == 0)
+		return;
+	if (count > 1) {
+		/*
+		 * Apply all rows in one transaction to write them
+		 * to WAL at once.
+		 */
+		try {
+			struct txn *txn = txn_begin(false);
+			for (int i = 0; i < count; i++)
+				xstream_write_xc(applier->subscribe_stream,
+						 &rows[i]);
+			txn_commit(txn);
+			applier_promote_vclock(replica_id,
+					       rows[count - 1].lsn);
+			return;
+		} catch (Exception *e) {
+			/*
+			 * Some rows can't be applied in a
+			 * multi-statement transaction (DDL, spaces
+			 * of different engines) or there is a
+			 * conflict. Fall back to a transaction per
+			 * row to find out which row fails.
+			 */
+			txn_rollback();
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		try {
+			xstream_write_xc(applier->subscribe_stream, &rows[i]);
+		} catch (Exception *e) {
+			applier_promote_vclock(replica_id, rows[i].lsn);
+			throw;
+		}
+		applier_promote_vclock(replica_id, rows[i].lsn);
+	}
+}
+
+/**
+ * Apply lanes look up tuples changed by rows of a batch before
+ * the batch is applied. Lookups in a disk engine yield, so a few
+ * lanes make a few reads at once, while the batch is applied by
+ * the applier fiber in order and mostly hits the cache.
+ */
+struct applier_lanes {
+	/** Lane fibers. */
+	struct fiber *fibers[APPLIER_LANES_MAX];
+	/** Number of lane fibers, 0 if lookups are disabled. */
+	int count;
+	/** xstream to look up a row. */
+	struct xstream *stream;
+	/** Rows of the current batch. */
+	struct xrow_header *rows;
+	/** Number of rows in the current batch. */
+	int row_count;
+	/** The next row of the batch to look up. */
+	int next;
+	/** Number of lanes still working on the batch. */
+	int busy;
+	/** Incremented for every batch. */
+	uint64_t generation;
+	/** Signaled when a new batch is posted. */
+	struct ipc_cond start;
+	/** Signaled when all lanes are done with the batch. */
+	struct ipc_cond done;
+};
+
+static int
+applier_lane_f(va_list ap)
+{
+	struct applier_lanes *lanes = va_arg(ap, struct applier_lanes *);
+	uint64_t generation = lanes->generation;
+	while (! fiber_is_cancelled()) {
+		if (generation == lanes->generation) {
+			ipc_cond_wait(&lanes->start);
+			continue;
+		}
+		generation = lanes->generation;
+		while (lanes->next < lanes->row_count) {
+			struct xrow_header *row = &lanes->rows[lanes->next++];
+			if (row->lsn <= vclock_get(&replicaset_vclock,
+						   row->replica_id))
+				continue;
+			/*
+			 * A failed lookup is not an error: the
+			 * row is checked again when it is applied.
+			 */
+			if (xstream_write(lanes->stream, row) != 0)
+				diag_clear(diag_get());
+			fiber_gc();
+		}
+		if (--lanes->busy == 0)
+			ipc_cond_signal(&lanes->done);
+	}
+	return 0;
+}
+
+static void
+applier_lanes_create(struct applier_lanes *lanes, struct xstream *stream,
+		     int count)
+{
+	memset(lanes, 0, sizeof(*lanes));
+	lanes->stream = stream;
+	ipc_cond_create(&lanes->start);
+	ipc_cond_create(&lanes->done);
+	/* A single lane gives no concurrency. */
+	if (stream == NULL || count <= 1)
+		return;
+	count = MIN(count, (int) APPLIER_LANES_MAX);
+	for (int i = 0; i < count; i++) {
+		struct fiber *f = fiber_new("applier_lane", applier_lane_f);
+		if (f == NULL) {
+			/* Do with as many lanes as there are. */
+			error_log(diag_last_error(diag_get()));
+			break;
+		}
+		fiber_set_joinable(f, true);
+		lanes->fibers[lanes->count++] = f;
+		fiber_start(f, lanes);
+	}
+}
+
+static void
+applier_lanes_destroy(struct applier_lanes *lanes)
+{
+	for (int i = 0; i < lanes->count; i++)
+		fiber_cancel(lanes->fibers[i]);
+	for (int i = 0; i < lanes->count; i++)
+		fiber_join(lanes->fibers[i]);
+	ipc_cond_destroy(&lanes->start);
+	ipc_cond_destroy(&lanes->done);
+}
+
+/** Look up the rows using all lanes and wait until it's done. */
+static void
+applier_lanes_prefetch(struct applier_lanes *lanes, struct xrow_header *rows,
+		       int count)
+{
+	lanes->rows = rows;
+	lanes->row_count = count;
+	lanes->next = 0;
+	lanes->busy = lanes->count;
+	lanes->generation++;
+	ipc_cond_broadcast(&lanes->start);
+	while (lanes->busy > 0) {
+		ipc_cond_wait(&lanes->done);
+		fiber_testcancel();
+	}
+}
+
 /**
  * Execute and process SUBSCRIBE request (follow updates from a master).
  */
@@ -309,13 +695,15 @@ applier_subscribe(struct applier *applier)
 	struct xrow_header row;
 
 	xrow_encode_subscribe(&row, &REPLICASET_UUID, &INSTANCE_UUID,
-			      &replicaset_vclock);
+			      &replicaset_vclock,
+			      cfg_geti("replication_compression"));
 	coio_write_xrow(coio, &row);
 	applier_set_state(applier, APPLIER_FOLLOW);
 
 	/*
 	 * Read SUBSCRIBE response
 	 */
+	bool replica_ack = false;
 	if (applier->version_id >= version_id(1, 6, 7)) {
 		coio_read_xrow(coio, &iobuf->in, &row);
 		if (iproto_type_is_error(row.type)) {
@@ -330,7 +718,7 @@ applier_subscribe(struct applier *applier)
 		 */
 		struct vclock vclock;
 		vclock_create(&vclock);
-		xrow_decode_vclock(&row, &vclock);
+		xrow_decode_subscribe_response(&row, &vclock, &replica_ack);
 	}
 	/**
 	 * Tarantool < 1.6.7:
@@ -343,38 +731,101 @@ applier_subscribe(struct applier *applier)
 	/* Re-enable warnings after successful execution of SUBSCRIBE */
 	applier->last_logged_errcode = 0;
 
+	/*
+	 * The number of lanes is picked up on (re)subscribe.
+	 */
+	struct applier_lanes lanes;
+	applier_lanes_create(&lanes, applier->prefetch_stream,
+			     cfg_geti("replication_apply_lanes"));
+	auto lanes_guard = make_scoped_guard([&]{
+		applier_lanes_destroy(&lanes);
+	});
+
+	struct applier_tx tx;
+	applier_tx_create(&tx);
+	auto tx_guard = make_scoped_guard([&]{
+		applier_tx_destroy(&tx);
+	});
+
+	/* The vclock last acknowledged to the master. */
+	struct vclock ack_vclock;
+	vclock_copy(&ack_vclock, &replicaset_vclock);
+
 	/*
 	 * Process a stream of rows from the binary log.
 	 */
+	struct xrow_header *rows = applier->batch;
 	while (true) {
-		coio_read_xrow(coio, &iobuf->in, &row);
-		applier->lag = ev_now(loop()) - row.tm;
-		applier->last_row_time = ev_now(loop());
+		/*
+		 * Wait for a row, then take all rows which have
+		 * already been read into the buffer, so that the
+		 * socket is read ahead of the apply.
+		 */
+		applier_read_row(applier, &tx, &rows[0], true);
+		int count = 1;
+		while (count < APPLIER_BATCH_MAX &&
+		       applier_read_row(applier, &tx, &rows[count], false))
+			count++;
+		ev_tstamp receive_time = ev_now(loop());
+		applier->lag = receive_time - rows[count - 1].tm;
+		applier->last_row_time = receive_time;
+		for (int i = 0; i < count; i++) {
+			if (rows[i].tm == 0)
+				continue;
+			replication_lag_collect(
+				applier->lag_hist[APPLIER_STAGE_RECEIVE],
+				receive_time - rows[i].tm);
+		}
 
-		if (iproto_type_is_error(row.type))
-			xrow_decode_error(&row);  /* error */
-		/* Replication request. */
-		if (row.replica_id == REPLICA_ID_NIL ||
-		    row.replica_id >= VCLOCK_MAX) {
-			/*
-			 * A safety net, this can only occur
-			 * if we're fed a strangely broken xlog.
-			 */
-			tnt_raise(ClientError, ER_UNKNOWN_REPLICA,
-				  int2str(row.replica_id),
-				  tt_uuid_str(&REPLICASET_UUID));
+		for (int i = 0; i < count; i++) {
+			struct xrow_header *row = &rows[i];
+			if (iproto_type_is_error(row->type))
+				xrow_decode_error(row);  /* error */
+			/* Replication request. */
+			if (row->replica_id == REPLICA_ID_NIL ||
+			    row->replica_id >= VCLOCK_MAX) {
+				/*
+				 * A safety net, this can only occur
+				 * if we're fed a strangely broken xlog.
+				 */
+				tnt_raise(ClientError, ER_UNKNOWN_REPLICA,
+					  int2str(row->replica_id),
+					  tt_uuid_str(&REPLICASET_UUID));
+			}
 		}
-		if (vclock_get(&replicaset_vclock, row.replica_id) < row.lsn) {
-			/**
-			 * Promote the replica set vclock before
-			 * applying the row. If there is an
-			 * exception (conflict) applying the row,
-			 * the row is skipped when the replication
-			 * is resumed.
-			 */
-			vclock_follow(&replicaset_vclock, row.replica_id,
-				      row.lsn);
-			xstream_write_xc(applier->subscribe_stream, &row);
+		if (lanes.count > 0 && count > 1)
+			applier_lanes_prefetch(&lanes, rows, count);
+		/*
+		 * Rows of a transaction must have the same
+		 * replica id, apply each run of rows from the
+		 * same replica separately.
+		 */
+		for (int begin = 0, end; begin < count; begin = end) {
+			end = begin + 1;
+			while (end < count &&
+			       rows[end].replica_id == rows[begin].replica_id)
+				end++;
+			applier_apply_rows(applier, rows + begin, end - begin);
+		}
+		/*
+		 * Includes the wait for the lanes and the WAL.
+		 * Rows of a batch are applied together, so the
+		 * batch is one sample.
+		 */
+		replication_lag_collect(applier->lag_hist[APPLIER_STAGE_APPLY],
+					ev_now(loop()) - receive_time);
+		/*
+		 * The batch is in WAL, acknowledge it at once, so
+		 * that synchronous transactions on the master are
+		 * not held for longer than the write. Rows read
+		 * while the batch was applied go to the next batch
+		 * and the next ack.
+		 */
+		if (replica_ack &&
+		    vclock_compare(&ack_vclock, &replicaset_vclock) != 0) {
+			vclock_copy(&ack_vclock, &replicaset_vclock);
+			xrow_encode_vclock(&row, &ack_vclock);
+			coio_write_xrow(coio, &row);
 		}
 		iobuf_reset(iobuf);
 		fiber_gc();
@@ -399,12 +850,14 @@ applier_f(va_list ap)
 	while (!fiber_is_cancelled()) {
 		try {
 			applier_connect(applier);
-			if (tt_uuid_is_nil(&REPLICASET_UUID)) {
+			if (tt_uuid_is_nil(&REPLICASET_UUID) ||
+			    applier->is_joining) {
 				/*
 				 * Execute JOIN if this is a bootstrap,
-				 * and there is no snapshot. The
-				 * join will pause the applier
-				 * until WAL is created.
+				 * and there is no snapshot, or resume
+				 * the JOIN interrupted by a network
+				 * error. The join will pause the
+				 * applier until WAL is created.
 				 */
 				applier_join(applier);
 			}
@@ -492,9 +945,18 @@ applier_stop(struct applier *applier)
 	applier->reader = NULL;
 }
 
+static void
+applier_delete_lag_hist(struct applier *applier)
+{
+	for (int i = 0; i < APPLIER_STAGE_MAX; i++) {
+		if (applier->lag_hist[i] != NULL)
+			histogram_delete(applier->lag_hist[i]);
+	}
+}
+
 struct applier *
 applier_new(const char *uri, struct xstream *join_stream,
-	    struct xstream *subscribe_stream)
+	    struct xstream *subscribe_stream, struct xstream *prefetch_stream)
 {
 	struct applier *applier = (struct applier *)
 		calloc(1, sizeof(struct applier));
@@ -503,8 +965,26 @@ applier_new(const char *uri, struct xstream *join_stream,
 			 "struct applier");
 		return NULL;
 	}
+	applier->batch = (struct xrow_header *)
+		calloc(APPLIER_BATCH_MAX, sizeof(*applier->batch));
+	if (applier->batch == NULL) {
+		diag_set(OutOfMemory, APPLIER_BATCH_MAX *
+			 sizeof(*applier->batch), "malloc", "applier batch");
+		free(applier);
+		return NULL;
+	}
+	for (int i = 0; i < APPLIER_STAGE_MAX; i++) {
+		applier->lag_hist[i] = replication_lag_histogram_new();
+		if (applier->lag_hist[i] == NULL) {
+			applier_delete_lag_hist(applier);
+			free(applier->batch);
+			free(applier);
+			return NULL;
+		}
+	}
 	coio_init(&applier->io, -1);
 	applier->iobuf = iobuf_new();
+	vclock_create(&applier->join_vclock);
 
 	/* uri_parse() sets pointers to applier->source buffer */
 	snprintf(applier->source, sizeof(applier->source), "%s", uri);
@@ -515,6 +995,7 @@ applier_new(const char *uri, struct xstream *join_stream,
 
 	applier->join_stream = join_stream;
 	applier->subscribe_stream = subscribe_stream;
+	applier->prefetch_stream = prefetch_stream;
 	applier->last_row_time = ev_now(loop());
 	rlist_create(&applier->on_state);
 	ipc_channel_create(&applier->pause, 0);
@@ -530,6 +1011,8 @@ applier_delete(struct applier *applier)
 	assert(applier->io.fd == -1);
 	ipc_channel_destroy(&applier->pause);
 	trigger_destroy(&applier->on_state);
+	applier_delete_lag_hist(applier);
+	free(applier->batch);
 	free(applier);
 }
 
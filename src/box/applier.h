@@ -43,6 +43,8 @@
 #include "ipc.h"
 
 struct xstream;
+struct histogram;
+struct xrow_header;
 
 enum { APPLIER_SOURCE_MAXLEN = 1024 }; /* enough to fit URI with passwords */
 
@@ -63,6 +65,15 @@ enum { APPLIER_SOURCE_MAXLEN = 1024 }; /* enough to fit URI with passwords */
 ENUM(applier_state, applier_STATE);
 extern const char *applier_state_strs[];
 
+/** Stages of replication lag measured by the applier */
+enum applier_stage {
+	/** From WAL commit on the master to receipt of the row */
+	APPLIER_STAGE_RECEIVE,
+	/** From receipt of the row to its commit, incl. local WAL */
+	APPLIER_STAGE_APPLY,
+	APPLIER_STAGE_MAX
+};
+
 /**
  * State of a replication connection to the master
  */
@@ -104,6 +115,27 @@ struct applier {
 	struct xstream *join_stream;
 	/** xstream to process rows during final JOIN and SUBSCRIBE */
 	struct xstream *subscribe_stream;
+	/**
+	 * xstream to look up data affected by a row before the
+	 * row is applied, used by apply lanes during SUBSCRIBE
+	 */
+	struct xstream *prefetch_stream;
+	/** Rows received ahead during SUBSCRIBE and applied at once. */
+	struct xrow_header *batch;
+	/** True from the start of JOIN till its end, across reconnects */
+	bool is_joining;
+	/** Initial JOIN rows received, the offset to resume JOIN from */
+	uint64_t join_rows;
+	/** Size of initial JOIN rows received */
+	uint64_t join_bytes;
+	/** Vclock of the checkpoint the master sends in JOIN */
+	struct vclock join_vclock;
+	/** Lag histograms of SUBSCRIBE rows, per applier_stage */
+	struct histogram *lag_hist[APPLIER_STAGE_MAX];
+	/** Size of compressed blocks of rows received */
+	uint64_t tx_size;
+	/** Size of rows received in compressed blocks, unpacked */
+	uint64_t tx_len;
 };
 
 /**
@@ -136,7 +168,7 @@ applier_stop(struct applier *applier);
  */
 struct applier *
 applier_new(const char *uri, struct xstream *join_stream,
-	    struct xstream *subscribe_stream);
+	    struct xstream *subscribe_stream, struct xstream *prefetch_stream);
 
 /**
  * Destroy and delete a applier.
@@ -108,6 +108,7 @@ static const int REPLICATION_CFG_TIMEOUT = 10; /* seconds */
 /* Use the shared instance of xstream for all appliers */
 static struct xstream join_stream;
 static struct xstream subscribe_stream;
+static struct xstream prefetch_stream;
 
 /**
  * The pool of fibers in the transaction processor thread
@@ -293,6 +294,52 @@ apply_row(struct xstream *stream, struct xrow_header *row)
 	process_rw(request, space, NULL);
 }
 
+/**
+ * Look up the tuple a replicated row is going to change, so
+ * that a disk read, if any, is done before the row is applied.
+ * Nothing is changed, the transaction order stays intact.
+ */
+static void
+prefetch_row(struct xstream *stream, struct xrow_header *row)
+{
+	(void) stream;
+	struct request *request = xrow_decode_request(row);
+	struct space *space = space_by_id(request->space_id);
+	if (space == NULL ||
+	    ! engine_reads_from_disk(space->handler->engine->flags))
+		return;
+	Index *index;
+	const char *key;
+	switch (request->type) {
+	case IPROTO_INSERT:
+	case IPROTO_REPLACE:
+	case IPROTO_UPSERT:
+		index = space_index(space, 0);
+		if (index == NULL ||
+		    tuple_validate_raw(space->format, request->tuple) != 0)
+			return;
+		key = tuple_extract_key_raw(request->tuple, request->tuple_end,
+					    &index->index_def->key_def, NULL);
+		if (key == NULL)
+			diag_raise();
+		break;
+	case IPROTO_UPDATE:
+	case IPROTO_DELETE:
+		index = space_index(space, request->index_id);
+		if (index == NULL || ! index->index_def->opts.is_unique)
+			return;
+		key = request->key;
+		break;
+	default:
+		return;
+	}
+	uint32_t part_count = mp_decode_array(&key);
+	if (primary_key_validate(&index->index_def->key_def, key,
+				 part_count) != 0)
+		return;
+	index->findByKey(key, part_count);
+}
+
 static void
 apply_wal_row(struct xstream *stream, struct xrow_header *row)
 {
@@ -391,6 +438,44 @@ box_check_readahead(int readahead)
 	}
 }
 
+static void
+box_check_replication_compression(int level)
+{
+	if (level < 0 || level > ZSTD_maxCLevel()) {
+		tnt_raise(ClientError, ER_CFG, "replication_compression",
+			  "the value must be 0 or a zstd compression level");
+	}
+}
+
+static void
+box_check_replication_apply_lanes(int lanes)
+{
+	if (lanes < 1) {
+		tnt_raise(ClientError, ER_CFG, "replication_apply_lanes",
+			  "the value must be greater than zero");
+	}
+}
+
+static int
+box_check_replication_synchro_quorum(int quorum)
+{
+	if (quorum < 1 || quorum >= VCLOCK_MAX) {
+		tnt_raise(ClientError, ER_CFG, "replication_synchro_quorum",
+			  "the value must be in range [1, 31]");
+	}
+	return quorum;
+}
+
+static double
+box_check_replication_synchro_timeout(double timeout)
+{
+	if (timeout <= 0) {
+		tnt_raise(ClientError, ER_CFG, "replication_synchro_timeout",
+			  "the value must be greater than zero");
+	}
+	return timeout;
+}
+
 static int64_t
 box_check_wal_max_rows(int64_t wal_max_rows)
 {
@@ -413,6 +498,50 @@ box_check_wal_max_size(int64_t wal_max_size)
 	return wal_max_size;
 }
 
+static double
+box_check_memtx_defrag_threshold(double threshold)
+{
+	if (threshold < 0 || threshold > 1) {
+		tnt_raise(ClientError, ER_CFG, "memtx_defrag_threshold",
+			  "the value must be in range [0, 1]");
+	}
+	return threshold;
+}
+
+static double
+box_check_memtx_evict_threshold(double threshold)
+{
+	if (threshold < 0 || threshold > 1) {
+		tnt_raise(ClientError, ER_CFG, "memtx_evict_threshold",
+			  "the value must be in range [0, 1]");
+	}
+	return threshold;
+}
+
+static uint32_t
+box_check_memtx_huge_page_size(int64_t size)
+{
+	if (size != 0 && size != 2 * 1024 * 1024 &&
+	    size != 1024 * 1024 * 1024) {
+		tnt_raise(ClientError, ER_CFG, "memtx_huge_page_size",
+			  "the value must be 0, 2097152 or 1073741824");
+	}
+	return size;
+}
+
+static int
+box_check_memtx_numa_node(void)
+{
+	if (cfg_gets("memtx_numa_node") == NULL)
+		return -1;
+	int node = cfg_geti("memtx_numa_node");
+	if (node < 0) {
+		tnt_raise(ClientError, ER_CFG, "memtx_numa_node",
+			  "the value must not be negative");
+	}
+	return node;
+}
+
 void
 box_check_config()
 {
@@ -420,15 +549,29 @@ box_check_config()
 	box_check_uri(cfg_gets("listen"), "listen");
 	box_check_replication();
 	box_check_readahead(cfg_geti("readahead"));
+	box_check_replication_apply_lanes(cfg_geti("replication_apply_lanes"));
+	box_check_replication_compression(cfg_geti("replication_compression"));
+	box_check_replication_synchro_quorum(
+		cfg_geti("replication_synchro_quorum"));
+	box_check_replication_synchro_timeout(
+		cfg_getd("replication_synchro_timeout"));
 	box_check_wal_max_rows(cfg_geti64("rows_per_wal"));
 	box_check_wal_max_size(cfg_geti64("wal_max_size"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
 	box_check_memtx_min_tuple_size(cfg_geti64("memtx_min_tuple_size"));
+	box_check_memtx_defrag_threshold(cfg_getd("memtx_defrag_threshold"));
+	box_check_memtx_evict_threshold(cfg_getd("memtx_evict_threshold"));
+	box_check_memtx_huge_page_size(cfg_geti64("memtx_huge_page_size"));
+	box_check_memtx_numa_node();
 	if (cfg_geti64("vinyl_page_size") > cfg_geti64("vinyl_range_size"))
 		tnt_raise(ClientError, ER_CFG, "vinyl_page_size",
 			  "can't be greater than vinyl_range_size");
 	if (cfg_geti("vinyl_threads") < 2)
 		tnt_raise(ClientError, ER_CFG, "vinyl_threads", "must be >= 2");
+	if (cfg_geti("replication_relay_threads") < 1) {
+		tnt_raise(ClientError, ER_CFG, "replication_relay_threads",
+			  "must be >= 1");
+	}
 }
 
 /*
@@ -451,7 +594,8 @@ cfg_get_replication(int *p_count)
 		const char *source = cfg_getarr_elem("replication", i);
 		struct applier *applier = applier_new(source,
 						      &join_stream,
-						      &subscribe_stream);
+						      &subscribe_stream,
+						      &prefetch_stream);
 		if (applier == NULL) {
 			/* Delete created appliers */
 			while (--i >= 0)
@@ -544,12 +688,48 @@ box_set_snap_io_rate_limit(void)
 		memtx->setSnapIoRateLimit(cfg_getd("snap_io_rate_limit"));
 }
 
+void
+box_set_memtx_defrag_threshold(void)
+{
+	double threshold = box_check_memtx_defrag_threshold(
+		cfg_getd("memtx_defrag_threshold"));
+	MemtxEngine *memtx = (MemtxEngine *) engine_find("memtx");
+	if (memtx)
+		memtx->setDefragThreshold(threshold);
+}
+
+void
+box_set_memtx_evict_threshold(void)
+{
+	double threshold = box_check_memtx_evict_threshold(
+		cfg_getd("memtx_evict_threshold"));
+	MemtxEngine *memtx = (MemtxEngine *) engine_find("memtx");
+	if (memtx)
+		memtx->setEvictThreshold(threshold);
+}
+
 void
 box_set_too_long_threshold(void)
 {
 	too_long_threshold = cfg_getd("too_long_threshold");
 }
 
+void
+box_set_replication_synchro_quorum(void)
+{
+	replication_synchro_quorum = box_check_replication_synchro_quorum(
+		cfg_geti("replication_synchro_quorum"));
+	/* A lower quorum may be reached already. */
+	replication_synchro_update();
+}
+
+void
+box_set_replication_synchro_timeout(void)
+{
+	replication_synchro_timeout = box_check_replication_synchro_timeout(
+		cfg_getd("replication_synchro_timeout"));
+}
+
 void
 box_set_readahead(void)
 {
@@ -1140,10 +1320,16 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	 *
 	 * Replica => Master
 	 *
-	 * => JOIN { INSTANCE_UUID: replica_uuid }
+	 * => JOIN { INSTANCE_UUID: replica_uuid,
+	 *           [JOIN_OFFSET: offset, VCLOCK: start_vclock],
+	 *           [COMPRESSION: level] }
 	 * <= OK { VCLOCK: start_vclock }
 	 *    Replica has enough permissions and master is ready for JOIN.
-	 *     - start_vclock - vclock of the latest master's checkpoint.
+	 *     - start_vclock - vclock of the latest master's checkpoint,
+	 *     or of the checkpoint asked for by the replica resuming
+	 *     an interrupted JOIN. In the latter case the first
+	 *     `offset` initial rows, which the replica already has,
+	 *     are not sent.
 	 *
 	 * <= INSERT
 	 *    ...
@@ -1167,6 +1353,9 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	 * <= OK { VCLOCK: current_vclock } - end of final JOIN stage.
 	 *      - `current_vclock` - master's vclock after final stage.
 	 *
+	 * If the replica asks for compression, rows of both stages are
+	 * sent in TX_BLOCK packets (see SUBSCRIBE).
+	 *
 	 * All packets must have the same SYNC value as initial JOIN request.
 	 * Master can send ERROR at any time. Replica doesn't confirm rows
 	 * by OKs. Either initial or final stream includes:
@@ -1179,7 +1368,12 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 
 	/* Decode JOIN request */
 	struct tt_uuid instance_uuid = uuid_nil;
-	xrow_decode_join(header, &instance_uuid);
+	struct vclock resume_vclock;
+	vclock_create(&resume_vclock);
+	uint64_t offset = 0;
+	uint32_t compression = 0;
+	xrow_decode_join(header, &instance_uuid, &resume_vclock, &offset,
+			 &compression);
 
 	/* Check that bootstrap has been finished */
 	if (!is_box_configured)
@@ -1202,16 +1396,35 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 			  "wal_mode = 'none'");
 	}
 
-	/* Remember start vclock. */
-	struct vclock start_vclock;
 	/*
-	 * The only case when the directory index is empty is
-	 * when someone has deleted a snapshot and tries to join
-	 * as a replica. Our best effort is to not crash in such
-	 * case: raise ER_MISSING_SNAPSHOT.
+	 * Remember start vclock and pin the checkpoint so that
+	 * a replica which loses the connection can resume from
+	 * it while it's being sent.
 	 */
-	if (gc_last_checkpoint(&start_vclock) < 0)
+	struct vclock start_vclock;
+	if (offset > 0) {
+		/*
+		 * The checkpoint the replica started to join from
+		 * must still be there, otherwise it has to start
+		 * over.
+		 */
+		if (gc_ref_checkpoint(&resume_vclock) < 0)
+			tnt_raise(ClientError, ER_MISSING_SNAPSHOT);
+		vclock_copy(&start_vclock, &resume_vclock);
+		say_info("resuming join after %llu rows",
+			 (unsigned long long) offset);
+	} else if (gc_ref_last_checkpoint(&start_vclock) < 0) {
+		/*
+		 * The only case when the directory index is empty
+		 * is when someone has deleted a snapshot and tries
+		 * to join as a replica. Our best effort is to not
+		 * crash in such case: raise ER_MISSING_SNAPSHOT.
+		 */
 		tnt_raise(ClientError, ER_MISSING_SNAPSHOT);
+	}
+	auto gc_guard = make_scoped_guard([&]{
+		gc_unref_checkpoint(&start_vclock);
+	});
 
 	/* Respond to JOIN request with start_vclock. */
 	struct xrow_header row;
@@ -1222,7 +1435,8 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	/*
 	 * Initial stream: feed replica with dirty data from engines.
 	 */
-	relay_initial_join(io->fd, header->sync, &start_vclock);
+	relay_initial_join(io->fd, header->sync, &start_vclock, offset,
+			   compression);
 	say_info("initial data sent.");
 
 	/**
@@ -1246,7 +1460,8 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	 * Final stage: feed replica with WALs in range
 	 * (start_vclock, stop_vclock).
 	 */
-	relay_final_join(io->fd, header->sync, &start_vclock, &stop_vclock);
+	relay_final_join(io->fd, header->sync, &start_vclock, &stop_vclock,
+			 compression);
 	say_info("final data sent.");
 
 	/* Send end of WAL stream marker */
@@ -1269,8 +1484,9 @@ box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 	struct tt_uuid replicaset_uuid = uuid_nil, replica_uuid = uuid_nil;
 	struct vclock replica_clock;
 	vclock_create(&replica_clock);
+	uint32_t compression = 0;
 	xrow_decode_subscribe(header, &replicaset_uuid, &replica_uuid,
-			      &replica_clock);
+			      &replica_clock, &compression);
 
 	/* Forbid connection to itself */
 	if (tt_uuid_is_equal(&replica_uuid, &INSTANCE_UUID))
@@ -1309,11 +1525,14 @@ box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 	 * Send a response to SUBSCRIBE request, tell
 	 * the replica how many rows we have in stock for it,
 	 * and identify ourselves with our own replica id.
+	 * The response also asks the replica to acknowledge
+	 * the rows it has written to its WAL, which synchronous
+	 * spaces wait for.
 	 */
 	struct xrow_header row;
 	struct vclock current_vclock;
 	wal_checkpoint(&current_vclock, true);
-	xrow_encode_vclock(&row, &current_vclock);
+	xrow_encode_subscribe_response(&row, &current_vclock);
 	/*
 	 * Identify the message with the replica id of this
 	 * instance, this is the only way for a replica to find
@@ -1337,7 +1556,8 @@ box_process_subscribe(struct ev_io *io, struct xrow_header *header)
 	 * a stall in updates (in this case replica may hang
 	 * indefinitely).
 	 */
-	relay_subscribe(io->fd, header->sync, replica, &replica_clock);
+	relay_subscribe(io->fd, header->sync, replica, &replica_clock,
+			compression);
 }
 
 /** Insert a new cluster into _schema */
@@ -1370,6 +1590,7 @@ box_free(void)
 		tuple_free();
 		port_free();
 #endif
+		relay_free();
 		gc_free();
 		engine_shutdown();
 		wal_thread_stop();
@@ -1390,7 +1611,10 @@ engine_init()
 					     cfg_getd("memtx_memory"),
 					     cfg_geti("memtx_min_tuple_size"),
 					     cfg_geti("memtx_max_tuple_size"),
-					     cfg_getd("slab_alloc_factor"));
+					     cfg_getd("slab_alloc_factor"),
+					     box_check_memtx_huge_page_size(
+						cfg_geti64("memtx_huge_page_size")),
+					     box_check_memtx_numa_node());
 	engine_register(memtx);
 
 	SysviewEngine *sysview = new SysviewEngine();
@@ -1454,6 +1678,10 @@ bootstrap_from_master(struct replica *master)
 	/*
 	 * Send JOIN request to master
 	 * See box_process_join().
+	 *
+	 * If replication_seed_snapshot is set, the applier
+	 * loads the snapshot first and resumes JOIN after its
+	 * rows, see applier_seed().
 	 */
 
 	assert(!tt_uuid_is_nil(&INSTANCE_UUID));
@@ -1568,8 +1796,11 @@ box_cfg_xc(void)
 	title("loading");
 
 	box_set_too_long_threshold();
+	box_set_replication_synchro_quorum();
+	box_set_replication_synchro_timeout();
 	xstream_create(&join_stream, apply_initial_join_row);
 	xstream_create(&subscribe_stream, apply_row);
+	xstream_create(&prefetch_stream, prefetch_row);
 
 	struct vclock checkpoint_vclock;
 	vclock_create(&checkpoint_vclock);
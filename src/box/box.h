@@ -152,7 +152,11 @@ void box_set_replication(void);
 void box_set_log_level(void);
 void box_set_io_collect_interval(void);
 void box_set_snap_io_rate_limit(void);
+void box_set_memtx_defrag_threshold(void);
+void box_set_memtx_evict_threshold(void);
 void box_set_too_long_threshold(void);
+void box_set_replication_synchro_quorum(void);
+void box_set_replication_synchro_timeout(void);
 void box_set_readahead(void);
 void box_set_force_recovery(void);
 void box_update_vinyl_options(void);
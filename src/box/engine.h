@@ -40,6 +40,26 @@ struct relay;
 
 enum engine_flags {
 	ENGINE_CAN_BE_TEMPORARY = 1,
+	/**
+	 * Tuples of the engine are not accessed concurrently
+	 * and so can cache field offsets lazily.
+	 */
+	ENGINE_CAN_CACHE_FIELD_OFFSETS = 2,
+	/**
+	 * Indexes of the engine can compare tuples by values
+	 * stored in native byte order in the field map.
+	 */
+	ENGINE_CAN_USE_FIXED_LAYOUT = 4,
+	/**
+	 * A lookup in an index of the engine may yield to wait
+	 * for a disk read, so it pays to issue lookups ahead.
+	 */
+	ENGINE_READS_FROM_DISK = 8,
+	/**
+	 * Bodies of cold tuples of the engine can be moved to
+	 * disk, @sa space_opts::tiered.
+	 */
+	ENGINE_CAN_EVICT_TUPLES = 16,
 };
 
 extern struct rlist engines;
@@ -269,6 +289,30 @@ engine_can_be_temporary(uint32_t flags)
 	return flags & ENGINE_CAN_BE_TEMPORARY;
 }
 
+static inline bool
+engine_can_cache_field_offsets(uint32_t flags)
+{
+	return flags & ENGINE_CAN_CACHE_FIELD_OFFSETS;
+}
+
+static inline bool
+engine_can_use_fixed_layout(uint32_t flags)
+{
+	return flags & ENGINE_CAN_USE_FIXED_LAYOUT;
+}
+
+static inline bool
+engine_reads_from_disk(uint32_t flags)
+{
+	return flags & ENGINE_READS_FROM_DISK;
+}
+
+static inline bool
+engine_can_evict_tuples(uint32_t flags)
+{
+	return flags & ENGINE_CAN_EVICT_TUPLES;
+}
+
 static inline uint32_t
 engine_id(Handler *space)
 {
@@ -302,11 +302,12 @@ check_index(uint32_t space_id, uint32_t index_id, struct space **space)
 	return index_find_xc(*space, index_id);
 }
 
+/** Load the body of an evicted tuple and bless it. */
 static inline box_tuple_t *
 tuple_bless_null_xc(struct tuple *tuple)
 {
 	if (tuple != NULL)
-		return tuple_bless_xc(tuple);
+		return tuple_bless_xc(tuple_fetch_xc(tuple));
 	return NULL;
 }
 
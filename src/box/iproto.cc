@@ -57,6 +57,7 @@
 #include "schema.h" /* schema_version */
 #include "replication.h" /* instance_uuid */
 #include "iproto_constants.h"
+#include "request.h"
 #include "rmean.h"
 
 /* The number of iproto messages in flight */
@@ -551,6 +552,47 @@ iproto_connection_input_iobuf(struct iproto_connection *con)
 	return newbuf;
 }
 
+/**
+ * A copy of the schema used by the network thread to check
+ * DML requests before they are put into the queue to tx.
+ * Owned by the network thread.
+ *
+ * The copy is only advisory. It lags behind the tx schema:
+ * a new copy is sent after a DDL, and a DDL may also yield
+ * for a long time before its effect becomes visible (e.g. an
+ * online index build). The check only stamps a request with
+ * the version of the copy, and tx skips its own validation
+ * only if that version is still current, see
+ * request_is_checked(). A stale copy thus can neither make
+ * tx accept an invalid request nor reject a valid one.
+ */
+static struct request_schema *net_request_schema;
+
+/**
+ * Schema version of the last copy sent to the network
+ * thread. Owned by tx.
+ */
+static uint32_t tx_request_schema_version;
+
+struct request_schema_msg: public cmsg
+{
+	struct request_schema *schema;
+};
+
+static void
+net_set_request_schema(struct cmsg *m)
+{
+	struct request_schema_msg *msg = (struct request_schema_msg *) m;
+	if (net_request_schema != NULL)
+		request_schema_delete(net_request_schema);
+	net_request_schema = msg->schema;
+	free(msg);
+}
+
+static const struct cmsg_hop request_schema_route[] = {
+	{ net_set_request_schema, NULL },
+};
+
 static void
 iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input)
@@ -586,6 +628,8 @@ iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 				 (const char *) msg->header.body[0].iov_base,
 				 msg->header.body[0].iov_len,
 				 request_key_map(msg->header.type));
+		if (net_request_schema != NULL)
+			request_check(&msg->request, net_request_schema);
 		assert(msg->header.type < sizeof(dml_route)/sizeof(*dml_route));
 		cmsg_init(msg, dml_route[msg->header.type]);
 		break;
@@ -862,6 +906,31 @@ tx_check_schema(uint32_t new_schema_version)
 	return 0;
 }
 
+/**
+ * Send a fresh copy of the schema to the network thread if
+ * the schema has changed since the last one was sent.
+ */
+static void
+tx_update_request_schema()
+{
+	if (tx_request_schema_version == schema_version)
+		return;
+	struct request_schema_msg *msg = (struct request_schema_msg *)
+		malloc(sizeof(*msg));
+	if (msg == NULL)
+		return;
+	msg->schema = request_schema_new();
+	if (msg->schema == NULL) {
+		/* Requests are checked by tx anyway, try later. */
+		diag_clear(&fiber()->diag);
+		free(msg);
+		return;
+	}
+	tx_request_schema_version = schema_version;
+	cmsg_init(msg, request_schema_route);
+	cpipe_push(&net_pipe, msg);
+}
+
 static void
 tx_process1(struct cmsg *m)
 {
@@ -869,6 +938,7 @@ tx_process1(struct cmsg *m)
 	struct obuf *out = &msg->iobuf->out;
 
 	tx_fiber_init(msg->connection->session, msg->header.sync);
+	tx_update_request_schema();
 	if (tx_check_schema(msg->header.schema_version))
 		goto error;
 
@@ -1190,6 +1260,10 @@ net_cord_f(va_list /* ap */)
 	if (evio_service_is_active(&binary))
 		evio_service_stop(&binary);
 
+	if (net_request_schema != NULL) {
+		request_schema_delete(net_request_schema);
+		net_request_schema = NULL;
+	}
 	rmean_delete(rmean_net);
 	return 0;
 }
@@ -86,6 +86,11 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 	/* 0x26 */	MP_MAP, /* IPROTO_VCLOCK */
 	/* 0x27 */	MP_STR, /* IPROTO_EXPR */
 	/* 0x28 */	MP_ARRAY, /* IPROTO_OPS */
+	/* 0x29 */	MP_UINT, /* IPROTO_COMPRESSION */
+	/* 0x2a */	MP_UINT, /* IPROTO_TX_LEN */
+	/* 0x2b */	MP_BIN, /* IPROTO_TX_DATA */
+	/* 0x2c */	MP_UINT, /* IPROTO_JOIN_OFFSET */
+	/* 0x2d */	MP_UINT, /* IPROTO_REPLICA_ACK */
 	/* }}} */
 };
 
@@ -162,7 +167,13 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"vector clock",     /* 0x26 */
 	"expression",       /* 0x27 */
 	"operations",       /* 0x28 */
-	NULL,               /* 0x29 */
+	"compression",      /* 0x29 */
+	"tx length",        /* 0x2a */
+	"tx data",          /* 0x2b */
+	"join offset",      /* 0x2c */
+	"replica ack",      /* 0x2d */
+	NULL,               /* 0x2e */
+	NULL,               /* 0x2f */
 	"data",             /* 0x30 */
 	"error"             /* 0x31 */
 };
@@ -43,6 +43,8 @@ extern "C" {
 enum {
 	/** Maximal iproto package body length (2GiB) */
 	IPROTO_BODY_LEN_MAX = 2147483648UL,
+	/** Maximal size of the rows packed into a TX_BLOCK (64MiB) */
+	IPROTO_TX_LEN_MAX = 64 * 1024 * 1024,
 	/* Maximal length of text handshake (greeting) */
 	IPROTO_GREETING_SIZE = 128,
 	/** marker + len + prev crc32 + cur crc32 + (padding) */
@@ -75,6 +77,12 @@ enum iproto_key {
 	IPROTO_VCLOCK = 0x26,
 	IPROTO_EXPR = 0x27, /* EVAL */
 	IPROTO_OPS = 0x28, /* UPSERT but not UPDATE ops, because of legacy */
+	/* Compressed replication stream keys (body) */
+	IPROTO_COMPRESSION = 0x29, /* zstd level asked for in SUBSCRIBE/JOIN */
+	IPROTO_TX_LEN = 0x2a, /* size of rows packed into TX_DATA */
+	IPROTO_TX_DATA = 0x2b, /* rows in the xlog tx format */
+	IPROTO_JOIN_OFFSET = 0x2c, /* initial JOIN rows to skip on resume */
+	IPROTO_REPLICA_ACK = 0x2d, /* the master reads acks (SUBSCRIBE) */
 	/* Leave a gap between request keys and response keys */
 	IPROTO_DATA = 0x30,
 	IPROTO_ERROR = 0x31,
@@ -150,6 +158,8 @@ enum iproto_type {
 	IPROTO_JOIN = 65,
 	/** Replication SUBSCRIBE command */
 	IPROTO_SUBSCRIBE = 66,
+	/** A compressed block of rows sent in reply to SUBSCRIBE */
+	IPROTO_TX_BLOCK = 67,
 
 	/** General information about Vinyl's runs stored in .index file */
 	VY_INDEX_RUN_INFO = 100,
@@ -114,6 +114,8 @@ const char *opt_type_strs[] = {
 
 const struct index_opts index_opts_default = {
 	/* .unique              = */ true,
+	/* .multikey            = */ false,
+	/* .path                = */ { '\0' },
 	/* .dimension           = */ 2,
 	/* .distancebuf         = */ { '\0' },
 	/* .distance            = */ RTREE_INDEX_DISTANCE_TYPE_EUCLID,
@@ -128,6 +130,8 @@ const struct index_opts index_opts_default = {
 
 const struct opt_def index_opts_reg[] = {
 	OPT_DEF("unique", OPT_BOOL, struct index_opts, is_unique),
+	OPT_DEF("multikey", OPT_BOOL, struct index_opts, is_multikey),
+	OPT_DEF("path", OPT_STR, struct index_opts, path),
 	OPT_DEF("dimension", OPT_INT, struct index_opts, dimension),
 	OPT_DEF("distance", OPT_STR, struct index_opts, distancebuf),
 	OPT_DEF("range_size", OPT_INT, struct index_opts, range_size),
@@ -195,6 +199,25 @@ key_def_set_cmp(struct key_def *def)
 	def->tuple_compare_with_key = tuple_compare_with_key_create(def);
 	tuple_hash_func_set(def);
 	tuple_extract_key_set(def);
+	if (key_def_is_nested(def)) {
+		def->tuple_compare_multikey =
+			tuple_compare_multikey_create(def);
+		def->tuple_compare_with_key_multikey =
+			tuple_compare_with_key_multikey_create(def);
+	}
+}
+
+void
+key_def_set_fixed_layout_cmp(struct key_def *def)
+{
+	tuple_compare_t cmp = tuple_compare_fixed_layout_create(def);
+	if (cmp != NULL)
+		def->tuple_compare = cmp;
+	tuple_compare_with_key_t cmp_wk =
+		tuple_compare_with_key_fixed_layout_create(def);
+	if (cmp_wk != NULL)
+		def->tuple_compare_with_key = cmp_wk;
+	tuple_hash_func_set_fixed_layout(def);
 }
 
 static size_t
@@ -217,6 +240,8 @@ box_key_def_new(uint32_t *fields, uint32_t *types, uint32_t part_count)
 		key_def->parts[item].fieldno = fields[item];
 		key_def->parts[item].type = (enum field_type)types[item];
 	}
+	key_def->is_multikey = false;
+	key_def->path[0] = '\0';
 	key_def->part_count = part_count;
 	key_def_set_cmp(key_def);
 	return key_def;
@@ -261,6 +286,8 @@ index_def_new(uint32_t space_id, uint32_t iid, const char *name,
 	def->space_id = space_id;
 	def->iid = iid;
 	def->opts = *opts;
+	def->key_def.is_multikey = opts->is_multikey;
+	memcpy(def->key_def.path, opts->path, sizeof(def->key_def.path));
 	def->key_def.part_count = part_count;
 	return def;
 }
@@ -306,6 +333,8 @@ index_def_change_requires_rebuild(struct index_def *old_index_def,
 	if (old_index_def->iid != new_index_def->iid ||
 	    old_index_def->type != new_index_def->type ||
 	    old_index_def->opts.is_unique != new_index_def->opts.is_unique ||
+	    old_index_def->opts.is_multikey != new_index_def->opts.is_multikey ||
+	    strcmp(old_index_def->opts.path, new_index_def->opts.path) != 0 ||
 	    key_part_cmp(old_index_def->key_def.parts,
 			 old_index_def->key_def.part_count,
 			 new_index_def->key_def.parts,
@@ -371,6 +400,18 @@ index_def_check(struct index_def *index_def)
 			  space_name(space),
 			  "primary key must be unique");
 	}
+	if (index_def->iid == 0 && index_def->opts.is_multikey) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "primary key can not be multikey");
+	}
+	if (index_def->iid == 0 && index_def->opts.path[0] != '\0') {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "primary key can not have a path");
+	}
 	if (index_def->key_def.part_count == 0) {
 		tnt_raise(ClientError, ER_MODIFY_INDEX,
 			  index_def->name,
@@ -600,6 +641,38 @@ key_def_merge(const struct key_def *first, const struct key_def *second)
 	return new_def;
 }
 
+int
+key_path_validate(const char *path)
+{
+	const char *p = path;
+	if (*p == '\0')
+		return -1;
+	while (*p != '\0') {
+		if (*p == '[') {
+			/* A 1-based array index, no leading zeros. */
+			const char *digits = ++p;
+			while (*p >= '0' && *p <= '9')
+				p++;
+			if (p == digits || p - digits > 9 || *digits == '0' ||
+			    *p != ']')
+				return -1;
+			p++;
+			continue;
+		}
+		/* A map key, the first one has no dot. */
+		if (*p == '.' && p != path)
+			p++;
+		else if (p != path)
+			return -1;
+		const char *name = p;
+		while (*p != '\0' && *p != '.' && *p != '[' && *p != ']')
+			p++;
+		if (p == name)
+			return -1;
+	}
+	return 0;
+}
+
 int
 key_validate_parts(struct key_def *key_def, const char *key,
 		   uint32_t part_count)
@@ -618,11 +691,20 @@ key_validate_parts(struct key_def *key_def, const char *key,
 const struct space_opts space_opts_default = {
 	/* .temporary  = */ false,
 	/* .sql        = */ NULL,
+	/* .field_offset_stride = */ 0,
+	/* .fixed_layout = */ false,
+	/* .is_sync    = */ false,
+	/* .tiered     = */ false,
 };
 
 const struct opt_def space_opts_reg[] = {
 	OPT_DEF("temporary", OPT_BOOL, struct space_opts, temporary),
 	OPT_DEF("sql", OPT_STRPTR, struct space_opts, sql),
+	OPT_DEF("field_offset_stride", OPT_INT, struct space_opts,
+		field_offset_stride),
+	OPT_DEF("fixed_layout", OPT_BOOL, struct space_opts, fixed_layout),
+	OPT_DEF("is_sync", OPT_BOOL, struct space_opts, is_sync),
+	OPT_DEF("tiered", OPT_BOOL, struct space_opts, tiered),
 	{ NULL, opt_type_MAX, 0, 0 }
 };
 
@@ -655,6 +737,33 @@ space_def_check(struct space_def *def, uint32_t namelen, uint32_t engine_namelen
 				  def->name,
 			         "space does not support temporary flag");
 	}
+	if (def->opts.field_offset_stride < 0 ||
+	    def->opts.field_offset_stride > UINT16_MAX) {
+		tnt_raise(ClientError, errcode, def->name,
+			  "field_offset_stride must be in range [0, 65535]");
+	}
+	if (def->opts.field_offset_stride != 0) {
+		Engine *engine = engine_find(def->engine_name);
+		if (! engine_can_cache_field_offsets(engine->flags))
+			tnt_raise(ClientError, errcode, def->name,
+				  "space does not support field_offset_stride");
+	}
+	if (def->opts.fixed_layout) {
+		Engine *engine = engine_find(def->engine_name);
+		if (! engine_can_use_fixed_layout(engine->flags))
+			tnt_raise(ClientError, errcode, def->name,
+				  "space does not support fixed_layout");
+	}
+	if (def->opts.tiered) {
+		Engine *engine = engine_find(def->engine_name);
+		if (! engine_can_evict_tuples(engine->flags))
+			tnt_raise(ClientError, errcode, def->name,
+				  "space does not support tiered");
+	}
+	if (def->opts.is_sync && def->opts.temporary) {
+		tnt_raise(ClientError, errcode, def->name,
+			  "temporary space can't be synchronous");
+	}
 }
 
 bool
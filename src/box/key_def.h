@@ -61,7 +61,9 @@ enum {
 	/** Yet another arbitrary limit which simply needs to
 	 * exist.
 	 */
-	BOX_INDEX_PART_MAX = UINT8_MAX
+	BOX_INDEX_PART_MAX = UINT8_MAX,
+	/** Maximal length of an index path, with the nul. */
+	BOX_INDEX_PATH_MAX = 64
 };
 
 /*
@@ -181,6 +183,20 @@ struct index_opts {
 	 * index
 	 */
 	bool is_unique;
+	/**
+	 * TREE index on the elements of an array field: the
+	 * first key part is taken from each element of the
+	 * field, so a tuple has as many entries in the index
+	 * as distinct elements in the array.
+	 */
+	bool is_multikey;
+	/**
+	 * TREE index on a value nested in the first key part
+	 * field: map keys separated by dots and 1-based array
+	 * indexes in brackets, e.g. "info.tags" or "points[1].x".
+	 * With is_multikey the value is the indexed array.
+	 */
+	char path[BOX_INDEX_PATH_MAX];
 	/**
 	 * RTREE index dimension.
 	 */
@@ -226,6 +242,10 @@ index_opts_cmp(const struct index_opts *o1, const struct index_opts *o2)
 {
 	if (o1->is_unique != o2->is_unique)
 		return o1->is_unique < o2->is_unique ? -1 : 1;
+	if (o1->is_multikey != o2->is_multikey)
+		return o1->is_multikey < o2->is_multikey ? -1 : 1;
+	if (strcmp(o1->path, o2->path) != 0)
+		return strcmp(o1->path, o2->path);
 	if (o1->dimension != o2->dimension)
 		return o1->dimension < o2->dimension ? -1 : 1;
 	if (o1->distance != o2->distance)
@@ -256,6 +276,18 @@ typedef int (*tuple_compare_with_key_t)(const struct tuple *tuple_a,
 typedef int (*tuple_compare_t)(const struct tuple *tuple_a,
 			       const struct tuple *tuple_b,
 			       const struct key_def *key_def);
+/** @copydoc tuple_compare_multikey() */
+typedef int (*tuple_compare_multikey_t)(const struct tuple *tuple_a,
+					uint32_t offset_a,
+					const struct tuple *tuple_b,
+					uint32_t offset_b,
+					const struct key_def *key_def);
+/** @copydoc tuple_compare_with_key_multikey() */
+typedef int (*tuple_compare_with_key_multikey_t)(const struct tuple *tuple,
+						 uint32_t offset,
+						 const char *key,
+						 uint32_t part_count,
+						 const struct key_def *key_def);
 /** @copydoc tuple_extract_key() */
 typedef char *(*tuple_extract_key_t)(const struct tuple *tuple,
 				     const struct key_def *key_def,
@@ -286,6 +318,20 @@ struct key_def {
 	tuple_hash_t tuple_hash;
 	/** @see key_hash() */
 	key_hash_t key_hash;
+	/** @see tuple_compare_multikey() */
+	tuple_compare_multikey_t tuple_compare_multikey;
+	/** @see tuple_compare_with_key_multikey() */
+	tuple_compare_with_key_multikey_t tuple_compare_with_key_multikey;
+	/**
+	 * The first part is an array field whose elements are
+	 * of the part type, @sa index_opts::is_multikey.
+	 */
+	bool is_multikey;
+	/**
+	 * The first part is found at this path inside the field,
+	 * @sa index_opts::path. Empty if the part is the field.
+	 */
+	char path[BOX_INDEX_PATH_MAX];
 	/** The size of the 'parts' array. */
 	uint32_t part_count;
 	/** Description of parts of a multipart index. */
@@ -461,6 +507,30 @@ struct space_opts {
 	 * SQL statement that produced this space.
 	 */
 	const char *sql;
+	/**
+	 * If not 0, tuples of the space cache offsets of every
+	 * field_offset_stride-th field.
+	 * \sa tuple_format::offset_stride
+	 */
+	int64_t field_offset_stride;
+	/**
+	 * Tuples of the space store unsigned indexed fields in
+	 * native byte order next to the field map.
+	 * \sa tuple_format::native_field_count
+	 */
+	bool fixed_layout;
+	/**
+	 * Commits of transactions changing the space wait until
+	 * box.cfg.replication_synchro_quorum instances have
+	 * written them to WAL.
+	 */
+	bool is_sync;
+	/**
+	 * Bodies of tuples not read for a while are moved to
+	 * disk when memory is short, indexes stay in memory.
+	 * \sa box.cfg.memtx_evict_threshold
+	 */
+	bool tiered;
 };
 
 extern const struct space_opts space_opts_default;
@@ -598,6 +668,15 @@ key_def_find(const struct key_def *key_def, uint32_t fieldno);
 struct key_def *
 key_def_merge(const struct key_def *first, const struct key_def *second);
 
+/**
+ * Switch comparators and the hash function of @a def to ones
+ * that read unsigned fields from native slots of the field map,
+ * if all key parts allow it.
+ * \sa tuple_format_set_fixed_layout()
+ */
+void
+key_def_set_fixed_layout_cmp(struct key_def *def);
+
 /*
  * Check that parts of the key match with the key definition.
  * @param key_def Key definition.
@@ -629,6 +708,26 @@ key_def_is_sequential(const struct key_def *key_def)
 	return true;
 }
 
+/**
+ * Return true if the first part of @a key_def is not a tuple
+ * field itself but a value inside it: an array element or a
+ * value at a path. Such keys are compared by the multikey
+ * comparators, which get the offset of the value.
+ */
+static inline bool
+key_def_is_nested(const struct key_def *key_def)
+{
+	return key_def->is_multikey || key_def->path[0] != '\0';
+}
+
+/**
+ * Check the syntax of an index path, @sa index_opts::path.
+ * @retval 0 the path is valid
+ * @retval -1 the path is empty or malformed
+ */
+int
+key_path_validate(const char *path);
+
 /** A helper table for key_mp_type_validate */
 extern const uint32_t key_mp_type[];
 
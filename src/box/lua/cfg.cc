@@ -131,6 +131,28 @@ lbox_cfg_set_too_long_threshold(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_replication_synchro_quorum(struct lua_State *L)
+{
+	try {
+		box_set_replication_synchro_quorum();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_replication_synchro_timeout(struct lua_State *L)
+{
+	try {
+		box_set_replication_synchro_timeout();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 {
@@ -142,6 +164,28 @@ lbox_cfg_set_snap_io_rate_limit(struct lua_State *L)
 	return 0;
 }
 
+static int
+lbox_cfg_set_memtx_defrag_threshold(struct lua_State *L)
+{
+	try {
+		box_set_memtx_defrag_threshold();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
+static int
+lbox_cfg_set_memtx_evict_threshold(struct lua_State *L)
+{
+	try {
+		box_set_memtx_evict_threshold();
+	} catch (Exception *) {
+		luaT_error(L);
+	}
+	return 0;
+}
+
 static int
 lbox_cfg_set_read_only(struct lua_State *L)
 {
@@ -179,6 +223,14 @@ box_lua_cfg_init(struct lua_State *L)
 		{"cfg_set_io_collect_interval", lbox_cfg_set_io_collect_interval},
 		{"cfg_set_too_long_threshold", lbox_cfg_set_too_long_threshold},
 		{"cfg_set_snap_io_rate_limit", lbox_cfg_set_snap_io_rate_limit},
+		{"cfg_set_memtx_defrag_threshold",
+			lbox_cfg_set_memtx_defrag_threshold},
+		{"cfg_set_memtx_evict_threshold",
+			lbox_cfg_set_memtx_evict_threshold},
+		{"cfg_set_replication_synchro_quorum",
+			lbox_cfg_set_replication_synchro_quorum},
+		{"cfg_set_replication_synchro_timeout",
+			lbox_cfg_set_replication_synchro_timeout},
 		{"cfg_set_read_only", lbox_cfg_set_read_only},
 		{"cfg_update_vinyl_options", lbox_cfg_update_vinyl_options},
 		{NULL, NULL}
@@ -49,6 +49,7 @@
 #include "box/box.h"
 #include "lua/utils.h"
 #include "fiber.h"
+#include "histogram.h"
 
 #include "box/vinyl.h"
 
@@ -66,6 +67,25 @@ lbox_pushvclock(struct lua_State *L, const struct vclock *vclock)
 	luaL_setmaphint(L, -1); /* compact flow */
 }
 
+/** Push {p50, p90, p99} of a lag histogram, in seconds. */
+static void
+lbox_pushlag(struct lua_State *L, const char *name,
+	     const struct histogram *hist)
+{
+	static const int percentiles[] = { 50, 90, 99 };
+	lua_pushstring(L, name);
+	lua_createtable(L, 0, lengthof(percentiles));
+	for (unsigned i = 0; i < lengthof(percentiles); i++) {
+		char key[8];
+		snprintf(key, sizeof(key), "p%d", percentiles[i]);
+		lua_pushstring(L, key);
+		lua_pushnumber(L, histogram_percentile(hist,
+						       percentiles[i]) / 1e6);
+		lua_settable(L, -3);
+	}
+	lua_settable(L, -3);
+}
+
 static void
 lbox_pushapplier(lua_State *L, struct applier *applier)
 {
@@ -90,6 +110,44 @@ lbox_pushapplier(lua_State *L, struct applier *applier)
 		lua_pushnumber(L, ev_now(loop()) - applier->last_row_time);
 		lua_settable(L, -3);
 
+		if (applier->is_joining) {
+			/* Initial JOIN rows applied so far */
+			lua_pushstring(L, "join");
+			lua_newtable(L);
+			lua_pushstring(L, "rows");
+			luaL_pushuint64(L, applier->join_rows);
+			lua_settable(L, -3);
+			lua_pushstring(L, "bytes");
+			luaL_pushuint64(L, applier->join_bytes);
+			lua_settable(L, -3);
+			lua_settable(L, -3);
+		}
+
+		if (applier->lag_hist[APPLIER_STAGE_RECEIVE] != NULL) {
+			/* Lag percentiles per stage */
+			lua_pushstring(L, "stages");
+			lua_newtable(L);
+			lbox_pushlag(L, "receive",
+				     applier->lag_hist[APPLIER_STAGE_RECEIVE]);
+			lbox_pushlag(L, "apply",
+				     applier->lag_hist[APPLIER_STAGE_APPLY]);
+			lua_settable(L, -3);
+		}
+
+		if (applier->tx_size > 0) {
+			lua_pushstring(L, "compression");
+			lua_newtable(L);
+			lua_pushstring(L, "ratio");
+			lua_pushnumber(L, (double) applier->tx_len /
+					  applier->tx_size);
+			lua_settable(L, -3);
+			lua_pushstring(L, "bytes_saved");
+			luaL_pushint64(L, (int64_t) applier->tx_len -
+					  (int64_t) applier->tx_size);
+			lua_settable(L, -3);
+			lua_settable(L, -3);
+		}
+
 		struct error *e = diag_last_error(&applier->reader->diag);
 		if (e != NULL) {
 			lua_pushstring(L, "message");
@@ -106,6 +164,12 @@ lbox_pushrelay(lua_State *L, struct relay *relay)
 	lua_pushstring(L, "vclock");
 	lbox_pushvclock(L, relay_vclock(relay));
 	lua_settable(L, -3);
+
+	lua_pushstring(L, "stages");
+	lua_newtable(L);
+	lbox_pushlag(L, "read", relay_lag_hist(relay, RELAY_STAGE_READ));
+	lbox_pushlag(L, "send", relay_lag_hist(relay, RELAY_STAGE_SEND));
+	lua_settable(L, -3);
 }
 
 static void
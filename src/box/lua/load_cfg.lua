@@ -13,6 +13,9 @@ local default_cfg = {
     memtx_min_tuple_size = 16,
     memtx_max_tuple_size = 1024 * 1024,
     slab_alloc_factor   = 1.1,
+    memtx_defrag_threshold = 0, -- off
+    memtx_evict_threshold = 0.9,
+    memtx_huge_page_size = 0, -- off
     work_dir            = nil,
     memtx_dir           = ".",
     wal_dir             = ".",
@@ -40,6 +43,13 @@ local default_cfg = {
     wal_dir_rescan_delay= 2,
     force_recovery      = false,
     replication         = nil,
+    replication_apply_lanes = 1,
+    replication_compression = 0,
+    replication_join_rate_limit = nil, -- no limit
+    replication_seed_snapshot = nil,
+    replication_relay_threads = 2,
+    replication_synchro_quorum = 1,
+    replication_synchro_timeout = 5,
     custom_proc_title   = nil,
     pid_file            = nil,
     background          = false,
@@ -60,6 +70,10 @@ local template_cfg = {
     memtx_memory        = 'number',
     memtx_min_tuple_size  = 'number',
     memtx_max_tuple_size  = 'number',
+    memtx_defrag_threshold = 'number',
+    memtx_evict_threshold = 'number',
+    memtx_huge_page_size = 'number',
+    memtx_numa_node     = 'number',
     slab_alloc_factor   = 'number',
     work_dir            = 'string',
     memtx_dir            = 'string',
@@ -88,6 +102,13 @@ local template_cfg = {
     wal_dir_rescan_delay= 'number',
     force_recovery      = 'boolean',
     replication         = 'string, number, table',
+    replication_apply_lanes = 'number',
+    replication_compression = 'number',
+    replication_join_rate_limit = 'number',
+    replication_seed_snapshot = 'string',
+    replication_relay_threads = 'number',
+    replication_synchro_quorum = 'number',
+    replication_synchro_timeout = 'number',
     custom_proc_title   = 'string',
     pid_file            = 'string',
     background          = 'boolean',
@@ -140,13 +161,22 @@ local dynamic_cfg = {
     readahead               = private.cfg_set_readahead,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
+    memtx_defrag_threshold  = private.cfg_set_memtx_defrag_threshold,
+    memtx_evict_threshold   = private.cfg_set_memtx_evict_threshold,
     read_only               = private.cfg_set_read_only,
+    replication_synchro_quorum = private.cfg_set_replication_synchro_quorum,
+    replication_synchro_timeout = private.cfg_set_replication_synchro_timeout,
     vinyl_timeout           = private.cfg_update_vinyl_options,
     -- snapshot_daemon
     checkpoint_interval     = box.internal.snapshot_daemon.set_checkpoint_interval,
     checkpoint_count        = box.internal.snapshot_daemon.set_checkpoint_count,
     -- do nothing, affects new replicas, which query this value on start
     wal_dir_rescan_delay    = function() end,
+    -- do nothing, affects appliers, which query these values on subscribe
+    replication_apply_lanes = function() end,
+    replication_compression = function() end,
+    -- do nothing, affects relays, which query this value on join
+    replication_join_rate_limit = function() end,
     custom_proc_title       = function()
         require('title').update(box.cfg.custom_proc_title)
     end,
@@ -158,6 +188,9 @@ local dynamic_cfg_skip_at_load = {
     listen                  = true,
     replication             = true,
     wal_dir_rescan_delay    = true,
+    replication_apply_lanes = true,
+    replication_compression = true,
+    replication_join_rate_limit = true,
     custom_proc_title       = true,
     force_recovery          = true,
 }
@@ -242,6 +242,10 @@ box.schema.space.create = function(name, options)
         user = 'string, number',
         format = 'table',
         temporary = 'boolean',
+        field_offset_stride = 'number',
+        fixed_layout = 'boolean',
+        is_sync = 'boolean',
+        tiered = 'boolean',
     }
     local options_defaults = {
         engine = 'memtx',
@@ -283,6 +287,10 @@ box.schema.space.create = function(name, options)
     -- filter out global parameters from the options array
     local space_options = setmetatable({
         temporary = options.temporary and true or nil,
+        field_offset_stride = options.field_offset_stride,
+        fixed_layout = options.fixed_layout and true or nil,
+        is_sync = options.is_sync and true or nil,
+        tiered = options.tiered and true or nil,
     }, { __serialize = 'map' })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -386,6 +394,8 @@ end
 -- This is the map.
 local index_options = {
     unique = 'boolean',
+    multikey = 'boolean',
+    path = 'string',
     dimension = 'number',
     distance = 'string',
     run_count_per_level = 'number',
@@ -425,6 +435,9 @@ box.schema.index.create = function(space_id, name, options)
         type = 'tree',
     }
     options = update_param_table(options, options_defaults)
+    if (options.multikey or options.path) and options.unique == nil then
+        options.unique = false
+    end
     local type_dependent_defaults = {
         rtree = {parts = { 2, 'array' }, unique = false},
         bitset = {parts = { 2, 'unsigned' }, unique = false},
@@ -482,6 +495,8 @@ box.schema.index.create = function(space_id, name, options)
     local index_opts = {
             dimension = options.dimension,
             unique = options.unique,
+            multikey = options.multikey,
+            path = options.path,
             distance = options.distance,
             page_size = options.page_size,
             range_size = options.range_size,
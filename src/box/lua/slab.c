@@ -41,6 +41,8 @@
 #include "small/small.h"
 #include "small/quota.h"
 #include "memory.h"
+#include "box/memtx_tuple.h"
+#include "box/memtx_spill.h"
 
 extern struct small_alloc memtx_alloc;
 extern struct mempool memtx_index_extent_pool;
@@ -218,6 +220,89 @@ lbox_slab_info(struct lua_State *L)
 	return 1;
 }
 
+static int
+lbox_slab_defrag_info(struct lua_State *L)
+{
+	lua_newtable(L);
+
+	/** Passes of the defragmenter over all memtx spaces */
+	lua_pushstring(L, "pass_count");
+	luaL_pushuint64(L, memtx_defrag_stat.pass_count);
+	lua_settable(L, -3);
+
+	/** Tuples moved to lower slabs of their size class */
+	lua_pushstring(L, "moved_count");
+	luaL_pushuint64(L, memtx_defrag_stat.moved_count);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "moved_size");
+	luaL_pushuint64(L, memtx_defrag_stat.moved_size);
+	lua_settable(L, -3);
+
+	return 1;
+}
+
+static int
+lbox_slab_checkpoint_info(struct lua_State *L)
+{
+	lua_newtable(L);
+
+	/** Freed tuples kept for the running checkpoint */
+	lua_pushstring(L, "garbage_size");
+	luaL_pushuint64(L, memtx_snapshot_stat.garbage_size);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "garbage_size_max");
+	luaL_pushuint64(L, memtx_snapshot_stat.garbage_size_max);
+	lua_settable(L, -3);
+
+	/** Freed before the end, after their space was written */
+	lua_pushstring(L, "released_size");
+	luaL_pushuint64(L, memtx_snapshot_stat.released_size);
+	lua_settable(L, -3);
+
+	return 1;
+}
+
+static int
+lbox_slab_evict_info(struct lua_State *L)
+{
+	lua_newtable(L);
+
+	/** Passes of the eviction clock over tiered spaces */
+	lua_pushstring(L, "pass_count");
+	luaL_pushuint64(L, memtx_spill_stat.pass_count);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "evicted_count");
+	luaL_pushuint64(L, memtx_spill_stat.evicted_count);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "evicted_size");
+	luaL_pushuint64(L, memtx_spill_stat.evicted_size);
+	lua_settable(L, -3);
+
+	/** Evicted tuples read back */
+	lua_pushstring(L, "loaded_count");
+	luaL_pushuint64(L, memtx_spill_stat.loaded_count);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "loaded_size");
+	luaL_pushuint64(L, memtx_spill_stat.loaded_size);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "file_size");
+	luaL_pushuint64(L, memtx_spill_stat.file_size);
+	lua_settable(L, -3);
+
+	/** Bodies of loaded and deleted tuples in the files */
+	lua_pushstring(L, "garbage_size");
+	luaL_pushuint64(L, memtx_spill_stat.garbage_size);
+	lua_settable(L, -3);
+
+	return 1;
+}
+
 static int
 lbox_runtime_info(struct lua_State *L)
 {
@@ -268,6 +353,18 @@ box_lua_slab_init(struct lua_State *L)
 	lua_pushcfunction(L, lbox_slab_check);
 	lua_settable(L, -3);
 
+	lua_pushstring(L, "defrag_info");
+	lua_pushcfunction(L, lbox_slab_defrag_info);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "checkpoint_info");
+	lua_pushcfunction(L, lbox_slab_checkpoint_info);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "evict_info");
+	lua_pushcfunction(L, lbox_slab_evict_info);
+	lua_settable(L, -3);
+
 	lua_settable(L, -3); /* box.slab */
 
 	lua_pushstring(L, "runtime");
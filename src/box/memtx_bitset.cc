@@ -323,6 +323,50 @@ MemtxBitset::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	return ret;
 }
 
+void
+MemtxBitset::reserveRelocate()
+{
+#ifndef OLD_GOOD_BITSET
+	/*
+	 * A put resizes the hash if it's full of dirty slots.
+	 * Make sure the put of a relocation and the put of its
+	 * rollback fit.
+	 */
+	struct mh_bitset_index_t *h = m_tuple_to_id;
+	while (h->resize_position > 0)
+		mh_bitset_index_resize(h, 0);
+	while (h->n_dirty + 2 > h->upper_bound) {
+		/* Rehash at once, the batch is the whole hash. */
+		if (mh_bitset_index_start_resize(h, h->n_buckets + 1,
+						 h->n_buckets, 0) != 0) {
+			tnt_raise(OutOfMemory, (ssize_t) h->n_buckets,
+				  "hash", "key");
+		}
+		assert(h->resize_position == 0);
+	}
+#endif /* #ifndef OLD_GOOD_BITSET */
+}
+
+void
+MemtxBitset::relocate(struct tuple *old_tuple, struct tuple *new_tuple)
+{
+#ifndef OLD_GOOD_BITSET
+	/* Keep the value, so that the bitsets are not changed. */
+	uint32_t value = tupleToValue(old_tuple);
+	struct bitset_hash_entry entry;
+	entry.id = value;
+	entry.tuple = new_tuple;
+	uint32_t pos = mh_bitset_index_put(m_tuple_to_id, &entry, 0, 0);
+	if (pos == mh_end(m_tuple_to_id))
+		tnt_raise(OutOfMemory, (ssize_t) pos, "hash", "key");
+	uint32_t k = mh_bitset_index_find(m_tuple_to_id, old_tuple, 0);
+	mh_bitset_index_del(m_tuple_to_id, k, 0);
+	*(struct tuple **) matras_get(m_id_to_tuple, value) = new_tuple;
+#else /* #ifndef OLD_GOOD_BITSET */
+	replace(old_tuple, new_tuple, DUP_REPLACE);
+#endif /* #ifndef OLD_GOOD_BITSET */
+}
+
 void
 MemtxBitset::initIterator(struct iterator *iterator, enum iterator_type type,
 			  const char *key, uint32_t part_count) const
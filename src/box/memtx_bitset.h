@@ -50,6 +50,9 @@ public:
 	virtual size_t size() const override;
 	virtual size_t count(enum iterator_type type, const char *key,
 			     uint32_t part_count) const override;
+	virtual void reserveRelocate() override;
+	virtual void relocate(struct tuple *old_tuple,
+			      struct tuple *new_tuple) override;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode) override;
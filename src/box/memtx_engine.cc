@@ -31,12 +31,15 @@
 #include "memtx_engine.h"
 #include "memtx_space.h"
 #include "memtx_tuple.h"
+#include "memtx_spill.h"
 
 #include "coeio_file.h"
 #include "scoped_guard.h"
 
 #include "tuple.h"
+#include "tuple_compare.h"
 #include "txn.h"
+#include "info.h"
 #include "memtx_tree.h"
 #include "iproto_constants.h"
 #include "xrow.h"
@@ -46,6 +49,9 @@
 #include "schema.h"
 
 #include "gc.h"
+#include <pmatomic.h>
+#include "small/small.h"
+#include "small/quota.h"
 
 /** For all memory used by all indexes.
  * If you decide to use memtx_index_arena or
@@ -56,6 +62,7 @@
 extern struct quota memtx_quota;
 static bool memtx_index_arena_initialized = false;
 struct slab_arena memtx_arena; /* used by memtx_tuple.cc */
+extern struct small_alloc memtx_alloc; /* defined in memtx_tuple.cc */
 static struct slab_cache memtx_index_slab_cache;
 struct mempool memtx_index_extent_pool;
 /**
@@ -121,17 +128,30 @@ memtx_build_secondary_keys(struct space *space, void *param)
 
 MemtxEngine::MemtxEngine(const char *snap_dirname, bool force_recovery,
 			 uint64_t tuple_arena_max_size, uint32_t objsize_min,
-			 uint32_t objsize_max, float alloc_factor)
+			 uint32_t objsize_max, float alloc_factor,
+			 uint32_t huge_page_size, int numa_node)
 	:Engine("memtx", &memtx_tuple_format_vtab),
 	m_checkpoint(0),
 	m_state(MEMTX_INITIALIZED),
 	m_snap_io_rate_limit(0),
-	m_force_recovery(force_recovery)
+	m_force_recovery(force_recovery),
+	m_defrag_threshold(0),
+	m_defrag_fiber(NULL),
+	m_defrag_space_id(0),
+	m_defrag_schema_version(0),
+	m_defrag_key(NULL),
+	m_evict_threshold(1),
+	m_evict_fiber(NULL),
+	m_evict_space_id(0),
+	m_evict_schema_version(0),
+	m_evict_key(NULL)
 {
 	memtx_tuple_init(tuple_arena_max_size, objsize_min, objsize_max,
-			 alloc_factor);
+			 alloc_factor, huge_page_size, numa_node);
+	memtx_spill_init(snap_dirname);
 
-	flags = ENGINE_CAN_BE_TEMPORARY;
+	flags = ENGINE_CAN_BE_TEMPORARY | ENGINE_CAN_CACHE_FIELD_OFFSETS |
+		ENGINE_CAN_USE_FIXED_LAYOUT | ENGINE_CAN_EVICT_TUPLES;
 	xdir_create(&m_snap_dir, snap_dirname, SNAP, &INSTANCE_UUID);
 }
 
@@ -139,6 +159,9 @@ MemtxEngine::~MemtxEngine()
 {
 	xdir_destroy(&m_snap_dir);
 
+	free(m_defrag_key);
+	free(m_evict_key);
+	memtx_spill_free();
 	memtx_tuple_free();
 }
 
@@ -334,6 +357,319 @@ MemtxEngine::initSystemSpace(struct space *space)
 	memtx_add_primary_key(space, MEMTX_OK);
 }
 
+/**
+ * Position an iterator of the primary key after the key saved
+ * by memtx_scan_save(), or at the first tuple if it's NULL.
+ */
+static void
+memtx_scan_restore(MemtxIndex *pk, struct iterator *it, const char *key)
+{
+	if (key == NULL) {
+		pk->initIterator(it, ITER_ALL, NULL, 0);
+	} else {
+		uint32_t part_count = mp_decode_array(&key);
+		pk->initIterator(it, ITER_GT, key, part_count);
+	}
+}
+
+/**
+ * Remember the primary key of the last visited tuple to
+ * continue a scan of a space after a yield.
+ * @retval false out of memory, the key is not changed
+ */
+static bool
+memtx_scan_save(MemtxIndex *pk, struct tuple *tuple, char **key)
+{
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	uint32_t key_size;
+	const char *tuple_key = tuple_extract_key(tuple,
+						  &pk->index_def->key_def,
+						  &key_size);
+	char *copy = tuple_key == NULL ? NULL :
+		     (char *) realloc(*key, key_size);
+	if (copy != NULL) {
+		memcpy(copy, tuple_key, key_size);
+		*key = copy;
+	}
+	region_truncate(region, used);
+	diag_clear(diag_get());
+	return copy != NULL;
+}
+
+/* {{{ Online secondary index build */
+
+enum {
+	/** Tuples put into a new index without a yield. */
+	MEMTX_BUILD_BATCH = 1000,
+};
+
+/**
+ * A secondary index being built on a populated space. The
+ * build scans the primary key in batches and yields between
+ * them; writes to the space made meanwhile are applied to
+ * the part of the index which is built already. There is at
+ * most one build at a time, since DDL holds the schema lock.
+ */
+static struct memtx_build {
+	/** Incremented by each build. */
+	uint64_t id;
+	/**
+	 * The index being built, NULL if the build failed or
+	 * the alter which has built the index is over.
+	 */
+	Index *index;
+	/** The scanned primary key of the old space. */
+	MemtxIndex *pk;
+	/** Format of the new space. */
+	struct tuple_format *format;
+	/**
+	 * Primary key of the last tuple put into the index by
+	 * the scan, NULL before the first yield.
+	 */
+	char *key;
+	/** Set when the scan is over. */
+	bool is_done;
+	/** The number of tuples put into the index by the scan. */
+	uint64_t processed;
+	/** The number of tuples in the space at the start. */
+	uint64_t total;
+} memtx_build;
+
+/** A rollback trigger of a transaction written during a build. */
+struct memtx_build_trigger {
+	struct trigger base;
+	/** memtx_build::id of the build. */
+	uint64_t build_id;
+};
+
+/**
+ * True if the tuple, or the tuple with the same primary key
+ * which it replaces, has been passed by the scan, so changes
+ * to it must go to the new index.
+ */
+static bool
+memtx_build_is_passed(struct memtx_build *build, struct tuple *tuple)
+{
+	if (build->is_done)
+		return true;
+	if (build->key == NULL)
+		return false;
+	const char *key = build->key;
+	uint32_t part_count = mp_decode_array(&key);
+	return tuple_compare_with_key(tuple, key, part_count,
+				      &build->pk->index_def->key_def) <= 0;
+}
+
+/**
+ * Undo the changes of a rolled back transaction in the new
+ * index, newest first. The transaction yields on WAL write,
+ * and the scan may pass a tuple after its change is made in
+ * the primary key, putting the changed tuple into the new
+ * index. So a change is undone if the scan has passed its
+ * tuple by now, no matter if it had when the change was
+ * made. Must not throw.
+ */
+static void
+memtx_build_on_rollback(struct trigger *trigger, void *event)
+{
+	struct txn *txn = (struct txn *) event;
+	struct memtx_build *build = (struct memtx_build *) trigger->data;
+	struct memtx_build_trigger *build_trigger =
+		container_of(trigger, struct memtx_build_trigger, base);
+	if (build->id != build_trigger->build_id || build->index == NULL)
+		return;
+	uint32_t space_id = build->index->index_def->space_id;
+	struct txn_stmt *stmt;
+	stailq_reverse(&txn->stmts);
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		if (stmt->space->def.id != space_id)
+			continue;
+		struct tuple *tuple = stmt->new_tuple != NULL ?
+				      stmt->new_tuple : stmt->old_tuple;
+		if (tuple == NULL || !memtx_build_is_passed(build, tuple))
+			continue;
+		try {
+			build->index->replace(stmt->new_tuple,
+					      stmt->old_tuple, DUP_INSERT);
+		} catch (Exception *e) {
+			e->log();
+			diag_clear(diag_get());
+		}
+	}
+	stailq_reverse(&txn->stmts);
+}
+
+/**
+ * An on_replace trigger of the old space: apply a write to
+ * the new index, if the scan has passed the tuple. The rest
+ * is put into the index by the scan itself. Either way the
+ * write is undone in the new index on rollback.
+ */
+static void
+memtx_build_on_replace(struct trigger *trigger, void *event)
+{
+	struct txn *txn = (struct txn *) event;
+	struct txn_stmt *stmt = txn_current_stmt(txn);
+	struct memtx_build *build = (struct memtx_build *) trigger->data;
+	/*
+	 * Create a rollback trigger before the replace, which
+	 * can't be undone if that fails, but set it after, so
+	 * that it doesn't undo a failed replace. A failed
+	 * statement is rolled back before the transaction.
+	 */
+	struct memtx_build_trigger *on_rollback =
+		region_calloc_object_xc(&fiber()->gc,
+					struct memtx_build_trigger);
+	trigger_create(&on_rollback->base, memtx_build_on_rollback,
+		       build, NULL);
+	on_rollback->build_id = build->id;
+	struct tuple *tuple = stmt->new_tuple != NULL ?
+			      stmt->new_tuple : stmt->old_tuple;
+	if (memtx_build_is_passed(build, tuple)) {
+		if (stmt->new_tuple != NULL &&
+		    tuple_validate(build->format, stmt->new_tuple) != 0)
+			diag_raise();
+		build->index->replace(stmt->old_tuple, stmt->new_tuple,
+				      DUP_INSERT);
+	}
+	/* One trigger undoes all statements of the transaction. */
+	txn_init_triggers(txn);
+	trigger_add_unique(&txn->on_rollback, &on_rollback->base);
+}
+
+/** True if an index is being built on the space. */
+static bool
+memtx_build_is_running(struct space *space)
+{
+	struct memtx_build *build = &memtx_build;
+	return build->index != NULL && build->pk == space_index(space, 0);
+}
+
+MemtxIndex *
+memtx_build_index(struct space *space, struct tuple *tuple)
+{
+	struct memtx_build *build = &memtx_build;
+	if (!memtx_build_is_running(space) ||
+	    !memtx_build_is_passed(build, tuple))
+		return NULL;
+	return (MemtxIndex *) build->index;
+}
+
+void
+memtx_build_end(const Index *index)
+{
+	if (memtx_build.index == index)
+		memtx_build.index = NULL;
+}
+
+void
+memtx_build_info(const Index *pk, struct info_handler *info)
+{
+	struct memtx_build *build = &memtx_build;
+	if (build->index == NULL || build->is_done || build->pk != pk)
+		return;
+	info_table_begin(info, "build");
+	info_append_str(info, "index", build->index->index_def->name);
+	info_append_u32(info, "index_id", build->index->index_def->iid);
+	info_append_u64(info, "processed", build->processed);
+	info_append_u64(info, "total", build->total);
+	info_table_end(info);
+}
+
+/**
+ * Build a secondary index in batches, yielding between them,
+ * so that the space stays available for reads and writes.
+ * Tuples moved by the defragmenter meanwhile are moved in the
+ * new index too, see memtx_relocate_tuple().
+ */
+static void
+memtx_build_online(struct space *old_space, struct space *new_space,
+		   Index *new_index)
+{
+	struct memtx_build *build = &memtx_build;
+	MemtxIndex *pk = (MemtxIndex *) index_find_xc(old_space, 0);
+	build->id++;
+	build->index = new_index;
+	build->pk = pk;
+	build->format = new_space->format;
+	build->key = NULL;
+	build->is_done = false;
+	build->processed = 0;
+	build->total = pk->size();
+
+	struct trigger on_replace;
+	trigger_create(&on_replace, memtx_build_on_replace, build, NULL);
+	trigger_add(&old_space->on_replace, &on_replace);
+	auto build_guard = make_scoped_guard([=, &on_replace]{
+		trigger_clear(&on_replace);
+		free(build->key);
+		build->key = NULL;
+		/* The index is deleted along with the failed alter. */
+		build->index = NULL;
+	});
+
+	struct iterator *it = pk->allocIterator();
+	IteratorGuard guard(it);
+	memtx_scan_restore(pk, it, NULL);
+	struct tuple *tuple;
+	/* The last tuple put into the index since a yield. */
+	struct tuple *last = NULL;
+	int batch_size = 0;
+	while ((tuple = it->next(it)) != NULL) {
+		/*
+		 * A stub of an evicted tuple may lack fields of
+		 * the new index. Its body is loaded with a yield,
+		 * after which the scan goes on from the last tuple
+		 * put into the index, so that the loaded tuple or
+		 * the one which has replaced it comes next.
+		 */
+		if (!memtx_tuple_has_fields(tuple, build->format)) {
+			if (last == NULL ||
+			    memtx_scan_save(pk, last, &build->key)) {
+				memtx_tuple_load_xc(tuple);
+				fiber_testcancel();
+				memtx_scan_restore(pk, it, build->key);
+				last = NULL;
+				continue;
+			}
+			/* Without the key the body is read in place. */
+			tuple = tuple_fetch_xc(tuple);
+		}
+		if (tuple_validate(build->format, tuple))
+			diag_raise();
+		struct tuple *old_tuple =
+			new_index->replace(NULL, tuple, DUP_INSERT);
+		assert(old_tuple == NULL); /* Guaranteed by DUP_INSERT. */
+		(void) old_tuple;
+		build->processed++;
+		last = tuple;
+		if (++batch_size < MEMTX_BUILD_BATCH)
+			continue;
+		batch_size = 0;
+		/* Without the key the scan goes on without a yield. */
+		if (!memtx_scan_save(pk, tuple, &build->key))
+			continue;
+		fiber_sleep(0);
+		fiber_testcancel();
+		memtx_scan_restore(pk, it, build->key);
+		last = NULL;
+	}
+	/*
+	 * Writes made while the alter is written to WAL are
+	 * applied by AddIndex, but rollbacks of those made
+	 * before may still come, and they must undo all,
+	 * until the alter is over, see memtx_build_end().
+	 */
+	build_guard.is_active = false;
+	trigger_clear(&on_replace);
+	free(build->key);
+	build->key = NULL;
+	build->is_done = true;
+}
+
+/* }}} */
+
 void
 MemtxEngine::buildSecondaryKey(struct space *old_space,
 			       struct space *new_space, Index *new_index)
@@ -350,6 +686,16 @@ MemtxEngine::buildSecondaryKey(struct space *old_space,
 			return;
 	}
 	Index *pk = index_find_xc(old_space, 0);
+	/*
+	 * A scan of a primary key can be resumed after a yield
+	 * only in a TREE. System spaces are read by DDL itself,
+	 * and if triggers are off, writes would miss the index.
+	 */
+	if (new_index_def->iid != 0 && pk->index_def->type == TREE &&
+	    !space_is_system(old_space) && old_space->run_triggers) {
+		memtx_build_online(old_space, new_space, new_index);
+		return;
+	}
 
 	/* Now deal with any kind of add index during normal operation. */
 	struct iterator *it = pk->allocIterator();
@@ -367,6 +713,13 @@ MemtxEngine::buildSecondaryKey(struct space *old_space,
 	struct tuple *tuple;
 	struct tuple_format *format = new_space->format;
 	while ((tuple = it->next(it))) {
+		/*
+		 * A stub of an evicted tuple may lack fields of
+		 * the new index. The scan can't be resumed after
+		 * a yield, so the body is read in place.
+		 */
+		if (!memtx_tuple_has_fields(tuple, format))
+			tuple = tuple_fetch_xc(tuple);
 		/*
 		 * Check that the tuple is OK according to the
 		 * new format.
@@ -386,6 +739,18 @@ MemtxEngine::buildSecondaryKey(struct space *old_space,
 void
 MemtxEngine::checkIndexDef(struct space *space, struct index_def *index_def)
 {
+	if (index_def->opts.is_multikey && index_def->type != TREE) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "only TREE index can be multikey");
+	}
+	if (index_def->opts.path[0] != '\0' && index_def->type != TREE) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "only TREE index can have a path");
+	}
 	switch (index_def->type) {
 	case HASH:
 		if (! index_def->opts.is_unique) {
@@ -396,7 +761,20 @@ MemtxEngine::checkIndexDef(struct space *space, struct index_def *index_def)
 		}
 		break;
 	case TREE:
-		/* TREE index has no limitations. */
+		if (index_def->opts.is_multikey &&
+		    index_def->opts.is_unique) {
+			tnt_raise(ClientError, ER_MODIFY_INDEX,
+				  index_def->name,
+				  space_name(space),
+				  "multikey index can not be unique");
+		}
+		if (index_def->opts.path[0] != '\0' &&
+		    index_def->opts.is_unique) {
+			tnt_raise(ClientError, ER_MODIFY_INDEX,
+				  index_def->name,
+				  space_name(space),
+				  "index with a path can not be unique");
+		}
 		break;
 	case RTREE:
 		if (index_def->key_def.part_count != 1) {
@@ -524,8 +902,12 @@ MemtxEngine::rollbackStatement(struct txn *, struct txn_stmt *stmt)
 	/** Rollback change of bsize */
 	space_bsize_rollback(space, stmt->bsize_change);
 
-	if (stmt->new_tuple)
+	if (stmt->new_tuple) {
+		/* Unpin the tuple, see memtx_stmt_pin(). */
+		if (stmt->engine_savepoint != NULL)
+			tuple_unref(stmt->new_tuple);
 		tuple_unref(stmt->new_tuple);
+	}
 
 	stmt->old_tuple = NULL;
 	stmt->new_tuple = NULL;
@@ -549,6 +931,9 @@ MemtxEngine::commit(struct txn *txn, int64_t signature)
 	stailq_foreach_entry(stmt, &txn->stmts, next) {
 		if (stmt->old_tuple)
 			tuple_unref(stmt->old_tuple);
+		/* The space references the tuple alone now. */
+		if (stmt->engine_savepoint != NULL && stmt->new_tuple)
+			tuple_unref(stmt->new_tuple);
 	}
 }
 
@@ -627,7 +1012,17 @@ checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple)
 	row.body[0].iov_base = &body;
 	row.body[0].iov_len = sizeof(body);
 	uint32_t bsize;
-	row.body[1].iov_base = (char *) tuple_data_range(tuple, &bsize);
+	const char *data = tuple_data_range(tuple, &bsize);
+	struct memtx_spill_ref ref;
+	if (memtx_tuple_spill_ref(tuple, &ref)) {
+		/* Freed by fiber_gc() in checkpoint_write_row(). */
+		char *body = (char *) region_alloc_xc(&fiber()->gc, ref.bsize);
+		if (memtx_spill_read(body, &ref) != 0)
+			diag_raise();
+		data = body;
+		bsize = ref.bsize;
+	}
+	row.body[1].iov_base = (char *) data;
 	row.body[1].iov_len = bsize;
 	checkpoint_write_row(l, &row);
 }
@@ -635,6 +1030,13 @@ checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple)
 struct checkpoint_entry {
 	struct space *space;
 	struct iterator *iterator;
+	/** Tuples of the space freed during the checkpoint. */
+	struct memtx_snapshot_garbage garbage;
+	/**
+	 * Size of tuples overwritten in the space since the
+	 * previous checkpoint, the entries are sorted by it.
+	 */
+	size_t overwritten_bsize;
 	struct rlist link;
 };
 
@@ -655,8 +1057,48 @@ struct checkpoint {
 	 * checkpoint already exists.
 	 */
 	bool touch;
+	/**
+	 * The number of entries written by the snapshot thread,
+	 * in the list order. Accessed atomically.
+	 */
+	int written_count;
+	/** Signalled by the snapshot thread on each written entry. */
+	struct ev_async on_write;
+	/** The event loop of the tx thread. */
+	struct ev_loop *loop;
 };
 
+/**
+ * Free the read view and the garbage of a space as soon as
+ * it is written rather than at the end of the checkpoint.
+ */
+static void
+checkpoint_entry_release(struct checkpoint_entry *entry)
+{
+	if (entry->iterator == NULL)
+		return;
+	Index *pk = space_index(entry->space, 0);
+	pk->destroyReadViewForIterator(entry->iterator);
+	entry->iterator->free(entry->iterator);
+	entry->iterator = NULL;
+	memtx_tuple_snapshot_release(&entry->garbage);
+}
+
+static void
+checkpoint_on_write(struct ev_loop *loop, struct ev_async *ev, int revents)
+{
+	(void) loop;
+	(void) revents;
+	struct checkpoint *ckpt = (struct checkpoint *) ev->data;
+	int written_count = pm_atomic_load(&ckpt->written_count);
+	struct checkpoint_entry *entry;
+	rlist_foreach_entry(entry, &ckpt->entries, link) {
+		if (written_count-- == 0)
+			break;
+		checkpoint_entry_release(entry);
+	}
+}
+
 static void
 checkpoint_init(struct checkpoint *ckpt, const char *snap_dirname,
 		uint64_t snap_io_rate_limit)
@@ -668,17 +1110,19 @@ checkpoint_init(struct checkpoint *ckpt, const char *snap_dirname,
 	/* May be used in abortCheckpoint() */
 	vclock_create(&ckpt->vclock);
 	ckpt->touch = false;
+	ckpt->written_count = 0;
+	ev_async_init(&ckpt->on_write, checkpoint_on_write);
+	ckpt->on_write.data = ckpt;
+	ckpt->loop = loop();
 }
 
 static void
 checkpoint_destroy(struct checkpoint *ckpt)
 {
+	ev_async_stop(ckpt->loop, &ckpt->on_write);
 	struct checkpoint_entry *entry;
-	rlist_foreach_entry(entry, &ckpt->entries, link) {
-		Index *pk = space_index(entry->space, 0);
-		pk->destroyReadViewForIterator(entry->iterator);
-		entry->iterator->free(entry->iterator);
-	}
+	rlist_foreach_entry(entry, &ckpt->entries, link)
+		checkpoint_entry_release(entry);
 	ckpt->entries = RLIST_HEAD_INITIALIZER(ckpt->entries);
 	xdir_destroy(&ckpt->dir);
 }
@@ -697,13 +1141,27 @@ checkpoint_add_space(struct space *sp, void *data)
 	struct checkpoint *ckpt = (struct checkpoint *)data;
 	struct checkpoint_entry *entry;
 	entry = region_alloc_object_xc(&fiber()->gc, struct checkpoint_entry);
-	rlist_add_tail_entry(&ckpt->entries, entry, link);
+	MemtxSpace *handler = (MemtxSpace *) sp->handler;
+	entry->overwritten_bsize = handler->overwritten_bsize;
+	handler->overwritten_bsize = 0;
+	/*
+	 * Spaces which change most are written first, so that
+	 * their garbage is released as early as possible.
+	 */
+	struct checkpoint_entry *next;
+	rlist_foreach_entry(next, &ckpt->entries, link) {
+		if (next->overwritten_bsize < entry->overwritten_bsize)
+			break;
+	}
+	rlist_add_tail(&next->link, &entry->link);
 
 	entry->space = sp;
 	entry->iterator = pk->allocIterator();
 
 	pk->initIterator(entry->iterator, ITER_ALL, NULL, 0);
 	pk->createReadViewForIterator(entry->iterator);
+	if (memtx_tuple_snapshot_track(space_id(sp), &entry->garbage) != 0)
+		diag_raise();
 };
 
 int
@@ -737,6 +1195,9 @@ checkpoint_f(va_list ap)
 			checkpoint_write_tuple(&snap, space_id(entry->space),
 					       tuple);
 		}
+		/* Let tx release the space, it is not read anymore. */
+		pm_atomic_fetch_add(&ckpt->written_count, 1);
+		ev_async_send(ckpt->loop, &ckpt->on_write);
 	}
 	xlog_flush(&snap);
 	say_info("done");
@@ -755,6 +1216,7 @@ MemtxEngine::beginCheckpoint()
 
 	/* increment snapshot version; set tuple deletion to delayed mode */
 	memtx_tuple_begin_snapshot();
+	memtx_spill_begin_snapshot();
 	return 0;
 }
 
@@ -770,6 +1232,7 @@ MemtxEngine::waitCheckpoint(struct vclock *vclock)
 			      (vclock_compare(&last_vclock, vclock) == 0);
 	vclock_copy(&m_checkpoint->vclock, vclock);
 
+	ev_async_start(m_checkpoint->loop, &m_checkpoint->on_write);
 	if (cord_costart(&m_checkpoint->cord, "snapshot",
 			 checkpoint_f, m_checkpoint)) {
 		return -1;
@@ -795,6 +1258,11 @@ MemtxEngine::commitCheckpoint(struct vclock *vclock)
 	assert(!m_checkpoint->waiting_for_snap_thread);
 
 	memtx_tuple_end_snapshot();
+	memtx_spill_end_snapshot();
+	say_info("checkpoint kept %zu bytes of freed tuples at most, "
+		 "%zu bytes were released early",
+		 memtx_snapshot_stat.garbage_size_max,
+		 memtx_snapshot_stat.released_size);
 
 	if (!m_checkpoint->touch) {
 		int64_t lsn = vclock_sum(&m_checkpoint->vclock);
@@ -827,6 +1295,7 @@ MemtxEngine::abortCheckpoint()
 	}
 
 	memtx_tuple_end_snapshot();
+	memtx_spill_end_snapshot();
 
 	/** Remove garbage .inprogress file. */
 	char *filename =
@@ -916,6 +1385,440 @@ MemtxEngine::join(struct vclock *vclock, struct xstream *stream)
 		diag_raise();
 }
 
+/* {{{ Tuple arena defragmentation */
+
+enum {
+	/** Tuples visited by the defragmenter without a yield. */
+	MEMTX_DEFRAG_BATCH = 128,
+};
+
+/** Seconds between passes over all spaces. */
+static const double MEMTX_DEFRAG_PERIOD = 1;
+
+static int
+memtx_defrag_f(va_list ap)
+{
+	MemtxEngine *engine = va_arg(ap, MemtxEngine *);
+	engine->defrag();
+	return 0;
+}
+
+void
+MemtxEngine::setDefragThreshold(double threshold)
+{
+	m_defrag_threshold = threshold;
+	if (m_defrag_fiber == NULL && threshold > 0) {
+		m_defrag_fiber = fiber_new_xc("memtx.defrag", memtx_defrag_f);
+		fiber_start(m_defrag_fiber, this);
+	} else if (m_defrag_fiber != NULL) {
+		fiber_wakeup(m_defrag_fiber);
+	}
+}
+
+/** space_foreach() callback of MemtxEngine::defragPass() */
+static void
+memtx_defrag_add_space(struct space *space, void *data)
+{
+	struct ibuf *ids = (struct ibuf *) data;
+	if (!space_is_memtx(space) || space_index(space, 0) == NULL)
+		return;
+	uint32_t *id = (uint32_t *) ibuf_alloc(ids, sizeof(*id));
+	if (id == NULL)
+		tnt_raise(OutOfMemory, sizeof(*id), "ibuf", "space id");
+	*id = space_id(space);
+}
+
+/**
+ * Replace a tuple with a copy in a lower slab in all indexes
+ * of the space, if it's worth it.
+ * @return the tuple which is in the space now
+ */
+static struct tuple *
+memtx_defrag_tuple(struct space *space, struct tuple *tuple)
+{
+	/* Someone else knows the address of the tuple. */
+	if (tuple->refs != 1)
+		return tuple;
+	struct tuple *new_tuple = memtx_tuple_move(tuple);
+	if (new_tuple == NULL)
+		return tuple;
+	/* The tuple is freed by the move. */
+	uint32_t bsize = tuple->bsize;
+	try {
+		memtx_relocate_tuple(space, tuple, new_tuple);
+	} catch (Exception *e) {
+		e->log();
+		diag_clear(diag_get());
+		return tuple;
+	}
+	memtx_defrag_stat.moved_count++;
+	memtx_defrag_stat.moved_size += bsize;
+	return new_tuple;
+}
+
+bool
+MemtxEngine::defragSpace(struct space *space)
+{
+	MemtxIndex *pk = (MemtxIndex *) space_index(space, 0);
+	struct iterator *it = pk->allocIterator();
+	auto it_guard = make_scoped_guard([=]{
+		it->free(it);
+	});
+	memtx_scan_restore(pk, it, m_defrag_key);
+	struct tuple *tuple = NULL;
+	for (int i = 0; i < MEMTX_DEFRAG_BATCH; i++) {
+		struct tuple *next = it->next(it);
+		if (next == NULL) {
+			free(m_defrag_key);
+			m_defrag_key = NULL;
+			return true;
+		}
+		tuple = memtx_defrag_tuple(space, next);
+	}
+	/* Without the key the rest of the space waits for a pass. */
+	return !memtx_scan_save(pk, tuple, &m_defrag_key);
+}
+
+void
+MemtxEngine::defragPass(struct ibuf *ids)
+{
+	/*
+	 * Spaces are visited in the order of ids, a space
+	 * created during the pass waits for the next one.
+	 */
+	ibuf_reset(ids);
+	space_foreach(memtx_defrag_add_space, ids);
+	uint32_t *id = (uint32_t *) ids->rpos;
+	uint32_t *id_end = (uint32_t *) ids->wpos;
+	while (id < id_end && !fiber_is_cancelled()) {
+		/*
+		 * A checkpoint keeps freed tuples, so moving
+		 * them is useless. New tuples of transactions in
+		 * progress are pinned, see memtx_stmt_pin().
+		 */
+		if (m_state != MEMTX_OK || m_checkpoint != NULL) {
+			fiber_sleep(MEMTX_DEFRAG_PERIOD / 100);
+			continue;
+		}
+		/* The classes are dense enough already. */
+		if (memtx_tuple_defrag_check(m_defrag_threshold) == 0)
+			break;
+		/* The key may not match a recreated index. */
+		if (m_defrag_space_id != *id ||
+		    m_defrag_schema_version != schema_version) {
+			free(m_defrag_key);
+			m_defrag_key = NULL;
+			m_defrag_space_id = *id;
+			m_defrag_schema_version = schema_version;
+		}
+		struct space *space = space_by_id(*id);
+		if (space == NULL || space_index(space, 0) == NULL ||
+		    defragSpace(space))
+			id++;
+		fiber_sleep(0);
+	}
+	memtx_defrag_stat.pass_count++;
+}
+
+void
+MemtxEngine::defrag()
+{
+	struct ibuf ids;
+	ibuf_create(&ids, &cord()->slabc, 16 * sizeof(uint32_t));
+	auto ids_guard = make_scoped_guard([&]{
+		ibuf_destroy(&ids);
+	});
+	while (!fiber_is_cancelled()) {
+		if (m_defrag_threshold == 0) {
+			fiber_yield();
+			continue;
+		}
+		fiber_sleep(MEMTX_DEFRAG_PERIOD);
+		try {
+			defragPass(&ids);
+		} catch (Exception *e) {
+			e->log();
+		}
+	}
+}
+
+/* }}} */
+
+/* {{{ Tuple eviction */
+
+enum {
+	/** Tuples visited by the eviction clock without a yield. */
+	MEMTX_EVICT_SCAN = 1024,
+	/** Tuples written to the spill file at once. */
+	MEMTX_EVICT_BATCH = 128,
+	/** Limit of the total size of a batch. */
+	MEMTX_EVICT_BATCH_SIZE = 1024 * 1024,
+};
+
+/** Seconds between passes over tiered spaces. */
+static const double MEMTX_EVICT_PERIOD = 1;
+
+static int
+memtx_stats_noop_cb(const struct mempool_stats *stats, void *cb_ctx)
+{
+	(void) stats;
+	(void) cb_ctx;
+	return 0;
+}
+
+/** The share of memtx memory used by tuples and indexes. */
+static double
+memtx_used_ratio()
+{
+	struct small_stats totals;
+	small_stats(&memtx_alloc, &totals, memtx_stats_noop_cb, NULL);
+	struct mempool_stats index_stats;
+	mempool_stats(&memtx_index_extent_pool, &index_stats);
+	return (double) (totals.used + index_stats.totals.used) /
+	       quota_total(memtx_arena.quota);
+}
+
+static int
+memtx_evict_f(va_list ap)
+{
+	MemtxEngine *engine = va_arg(ap, MemtxEngine *);
+	engine->evict();
+	return 0;
+}
+
+void
+MemtxEngine::setEvictThreshold(double threshold)
+{
+	m_evict_threshold = threshold;
+	if (m_evict_fiber == NULL && threshold < 1) {
+		m_evict_fiber = fiber_new_xc("memtx.evict", memtx_evict_f);
+		fiber_start(m_evict_fiber, this);
+	} else if (m_evict_fiber != NULL) {
+		fiber_wakeup(m_evict_fiber);
+	}
+}
+
+/** space_foreach() callback of MemtxEngine::evictPass() */
+static void
+memtx_evict_add_space(struct space *space, void *data)
+{
+	if (!space->def.opts.tiered)
+		return;
+	memtx_defrag_add_space(space, data);
+}
+
+/**
+ * Replace a tuple, or a stub of a body in the old spill file,
+ * with the stub of its body written to the spill file, unless
+ * it has left the space.
+ * @retval true the tuple is evicted
+ */
+static bool
+memtx_evict_tuple(struct space *space, struct tuple *tuple,
+		  const struct memtx_spill_ref *ref)
+{
+	MemtxIndex *pk = (MemtxIndex *) space->index[0];
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	struct tuple *stub = NULL;
+	bool is_evicted = false;
+	try {
+		if (pk->findByTuple(tuple) == tuple)
+			stub = memtx_tuple_evict(tuple, ref);
+		if (stub != NULL) {
+			memtx_relocate_tuple(space, tuple, stub);
+			is_evicted = true;
+		}
+	} catch (Exception *e) {
+		e->log();
+	}
+	region_truncate(region, used);
+	diag_clear(diag_get());
+	/* Otherwise the body is dropped with the stub. */
+	if (stub == NULL)
+		memtx_spill_drop(ref);
+	return is_evicted;
+}
+
+void
+MemtxEngine::evictBatch(uint32_t space_id, struct tuple **batch,
+			int count, struct ibuf *buf)
+{
+	uint32_t version = schema_version;
+	struct memtx_spill_ref ref;
+	bool is_written =
+		memtx_spill_read_stubs(batch, count, buf->rpos) == 0 &&
+		memtx_spill_write(buf->rpos, ibuf_used(buf), &ref) == 0;
+	if (!is_written) {
+		error_log(diag_last_error(diag_get()));
+		diag_clear(diag_get());
+	}
+	/* A stub must not miss fields indexed after the scan. */
+	struct space *space = version == schema_version ?
+			      space_by_id(space_id) : NULL;
+	if (space != NULL && memtx_build_is_running(space))
+		space = NULL;
+	ref.space_id = space_id;
+	for (int i = 0; i < count; i++) {
+		struct tuple *tuple = batch[i];
+		struct memtx_spill_ref old_ref;
+		bool is_moved = memtx_tuple_spill_ref(tuple, &old_ref);
+		ref.bsize = is_moved ? old_ref.bsize : tuple->bsize;
+		if (!is_written) {
+			tuple_unref(tuple);
+			continue;
+		}
+		/* Skip tuples read or replaced during the write. */
+		if (space == NULL || (!is_moved && !memtx_tuple_age(tuple))) {
+			memtx_spill_drop(&ref);
+		} else if (memtx_evict_tuple(space, tuple, &ref) &&
+			   !is_moved) {
+			((MemtxSpace *) space->handler)->evicted_count++;
+			memtx_spill_stat.evicted_count++;
+			memtx_spill_stat.evicted_size += ref.bsize;
+		}
+		ref.offset += ref.bsize;
+		tuple_unref(tuple);
+	}
+}
+
+bool
+MemtxEngine::evictSpace(struct space *space, struct ibuf *buf)
+{
+	MemtxIndex *pk = (MemtxIndex *) space_index(space, 0);
+	struct iterator *it = pk->allocIterator();
+	auto it_guard = make_scoped_guard([=]{
+		it->free(it);
+	});
+	memtx_scan_restore(pk, it, m_evict_key);
+	struct tuple *batch[MEMTX_EVICT_BATCH];
+	int count = 0;
+	struct tuple *tuple = NULL;
+	bool is_done = false;
+	ibuf_reset(buf);
+	for (int i = 0; i < MEMTX_EVICT_SCAN; i++) {
+		if (count == MEMTX_EVICT_BATCH ||
+		    ibuf_used(buf) >= MEMTX_EVICT_BATCH_SIZE)
+			break;
+		tuple = it->next(it);
+		if (tuple == NULL) {
+			is_done = true;
+			break;
+		}
+		/* A tuple referenced elsewhere would not be freed. */
+		if (tuple->refs != 1)
+			continue;
+		/*
+		 * Bodies in the old spill file are copied to the
+		 * current one, the body is read before the write.
+		 */
+		struct memtx_spill_ref ref;
+		if (memtx_tuple_spill_ref(tuple, &ref)) {
+			if (!memtx_spill_is_old(&ref))
+				continue;
+			if (ibuf_alloc(buf, ref.bsize) == NULL)
+				break;
+			tuple_ref(tuple);
+			batch[count++] = tuple;
+			continue;
+		}
+		/*
+		 * A stub has indexed fields of the tuple format,
+		 * which may lack fields indexed after an ALTER.
+		 */
+		if (tuple->format_id != tuple_format_id(space->format) ||
+		    !memtx_tuple_age(tuple))
+			continue;
+		void *body = ibuf_alloc(buf, tuple->bsize);
+		if (body == NULL)
+			break;
+		memcpy(body, tuple_data(tuple), tuple->bsize);
+		tuple_ref(tuple);
+		batch[count++] = tuple;
+	}
+	/* Remember where to continue before the write yields. */
+	if (is_done) {
+		free(m_evict_key);
+		m_evict_key = NULL;
+	} else if (tuple != NULL) {
+		/* Without the key the rest of the space waits for a pass. */
+		is_done = !memtx_scan_save(pk, tuple, &m_evict_key);
+	}
+	it_guard.is_active = false;
+	it->free(it);
+	if (count > 0)
+		evictBatch(space_id(space), batch, count, buf);
+	return is_done;
+}
+
+void
+MemtxEngine::evictPass(struct ibuf *ids, struct ibuf *buf)
+{
+	/*
+	 * Spaces are visited in the order of ids, a space
+	 * created during the pass waits for the next one.
+	 */
+	ibuf_reset(ids);
+	space_foreach(memtx_evict_add_space, ids);
+	uint32_t *id = (uint32_t *) ids->rpos;
+	uint32_t *id_end = (uint32_t *) ids->wpos;
+	while (id < id_end && !fiber_is_cancelled()) {
+		/*
+		 * A checkpoint keeps freed tuples, so evicting
+		 * them is useless. New tuples of transactions in
+		 * progress are pinned, see memtx_stmt_pin().
+		 */
+		if (m_state != MEMTX_OK || m_checkpoint != NULL) {
+			fiber_sleep(MEMTX_EVICT_PERIOD / 100);
+			continue;
+		}
+		if (memtx_used_ratio() < m_evict_threshold)
+			break;
+		/* The key may not match a recreated index. */
+		if (m_evict_space_id != *id ||
+		    m_evict_schema_version != schema_version) {
+			free(m_evict_key);
+			m_evict_key = NULL;
+			m_evict_space_id = *id;
+			m_evict_schema_version = schema_version;
+		}
+		struct space *space = space_by_id(*id);
+		/* Stubs may lack fields of an index being built. */
+		if (space == NULL || space_index(space, 0) == NULL ||
+		    memtx_build_is_running(space) ||
+		    evictSpace(space, buf))
+			id++;
+		fiber_sleep(0);
+	}
+	memtx_spill_stat.pass_count++;
+}
+
+void
+MemtxEngine::evict()
+{
+	struct ibuf ids, buf;
+	ibuf_create(&ids, &cord()->slabc, 16 * sizeof(uint32_t));
+	ibuf_create(&buf, &cord()->slabc, MEMTX_EVICT_BATCH_SIZE);
+	auto ibuf_guard = make_scoped_guard([&]{
+		ibuf_destroy(&ids);
+		ibuf_destroy(&buf);
+	});
+	while (!fiber_is_cancelled()) {
+		if (m_evict_threshold >= 1) {
+			fiber_yield();
+			continue;
+		}
+		fiber_sleep(MEMTX_EVICT_PERIOD);
+		try {
+			evictPass(&ids, &buf);
+		} catch (Exception *e) {
+			e->log();
+		}
+	}
+}
+
+/* }}} */
+
 /**
  * Initialize arena for indexes.
  * The arena is used for memtx_index_extent_alloc
@@ -74,7 +74,8 @@ struct MemtxEngine: public Engine {
 	MemtxEngine(const char *snap_dirname, bool force_recovery,
 		    uint64_t tuple_arena_max_size,
 		    uint32_t objsize_min, uint32_t objsize_max,
-		    float alloc_factor);
+		    float alloc_factor, uint32_t huge_page_size,
+		    int numa_node);
 	~MemtxEngine();
 	virtual Handler *open() override;
 	virtual void addPrimaryKey(struct space *space) override;
@@ -108,9 +109,43 @@ struct MemtxEngine: public Engine {
 		m_snap_io_rate_limit = new_limit * 1024 * 1024;
 	}
 	void recoverSnapshot(const struct vclock *vclock);
+	/* Update memtx_defrag_threshold. */
+	void setDefragThreshold(double threshold);
+	/** The loop of the tuple arena defragmenter fiber. */
+	void defrag();
+	/* Update memtx_evict_threshold. */
+	void setEvictThreshold(double threshold);
+	/** The loop of the cold tuple eviction fiber. */
+	void evict();
 private:
 	void
 	recoverSnapshotRow(struct xrow_header *row);
+	/**
+	 * Move the next batch of tuples of a space.
+	 * @retval true the space is done
+	 */
+	bool
+	defragSpace(struct space *space);
+	/** Visit all memtx spaces with the defragmenter. */
+	void
+	defragPass(struct ibuf *ids);
+	/**
+	 * Evict cold tuples among the next batch of tuples of
+	 * a tiered space.
+	 * @retval true the space is done
+	 */
+	bool
+	evictSpace(struct space *space, struct ibuf *buf);
+	/**
+	 * Write bodies of tuples to the spill file and replace
+	 * the tuples which are still cold with stubs.
+	 */
+	void
+	evictBatch(uint32_t space_id, struct tuple **batch, int count,
+		   struct ibuf *buf);
+	/** Visit all tiered spaces with the eviction clock. */
+	void
+	evictPass(struct ibuf *ids, struct ibuf *buf);
 	/** Non-zero if there is a checkpoint (snapshot) in progress. */
 	struct checkpoint *m_checkpoint;
 	enum memtx_recovery_state m_state;
@@ -119,6 +154,39 @@ private:
 	/** Limit disk usage of checkpointing (bytes per second). */
 	uint64_t m_snap_io_rate_limit;
 	bool m_force_recovery;
+	/**
+	 * Tuples of size classes used below this ratio are
+	 * moved by the defragmenter, 0 if it's off.
+	 */
+	double m_defrag_threshold;
+	/** The defragmenter fiber, started on demand. */
+	struct fiber *m_defrag_fiber;
+	/** Id of the space the defragmenter is in. */
+	uint32_t m_defrag_space_id;
+	/** Schema version m_defrag_key was taken at. */
+	uint32_t m_defrag_schema_version;
+	/**
+	 * Primary key of the last tuple visited by the
+	 * defragmenter in the space, NULL to start over.
+	 */
+	char *m_defrag_key;
+	/**
+	 * Cold tuples of tiered spaces are evicted while the
+	 * share of used memtx memory is above this ratio, 1 if
+	 * eviction is off.
+	 */
+	double m_evict_threshold;
+	/** The eviction fiber, started on demand. */
+	struct fiber *m_evict_fiber;
+	/** Id of the space the eviction clock is in. */
+	uint32_t m_evict_space_id;
+	/** Schema version m_evict_key was taken at. */
+	uint32_t m_evict_schema_version;
+	/**
+	 * Primary key of the last tuple visited by the eviction
+	 * clock in the space, NULL to start over.
+	 */
+	char *m_evict_key;
 };
 
 enum {
@@ -154,4 +222,33 @@ memtx_index_extent_free(void *ctx, void *extent);
 void
 memtx_index_extent_reserve(int num);
 
+struct info_handler;
+
+/**
+ * Append the progress of an online build of a secondary index
+ * scanning this primary key, if there is one, to index:info().
+ */
+void
+memtx_build_info(const Index *pk, struct info_handler *info);
+
+/**
+ * Forget the online build of the index, if there is one.
+ * Called when the alter which has built the index commits,
+ * or when the index is deleted along with a rolled back
+ * alter, so that rollbacks of writes made during the build
+ * don't touch the index.
+ */
+void
+memtx_build_end(const Index *index);
+
+class MemtxIndex;
+
+/**
+ * The index being built on the space, if the build has put
+ * the tuple into it, so that a move of the tuple must be made
+ * in the index too, or NULL.
+ */
+MemtxIndex *
+memtx_build_index(struct space *space, struct tuple *tuple);
+
 #endif /* TARANTOOL_BOX_MEMTX_ENGINE_H_INCLUDED */
@@ -31,12 +31,22 @@
  */
 #include "index.h"
 #include "memtx_index.h"
+#include "memtx_engine.h"
+#include "info.h"
 #include "tuple.h"
 #include "say.h"
 #include "schema.h"
 #include "user_def.h"
 #include "space.h"
 
+MemtxIndex::~MemtxIndex()
+{
+	if (m_position != NULL)
+		m_position->free(m_position);
+	/* A rolled back alter deletes the index it has built. */
+	memtx_build_end(this);
+}
+
 void
 MemtxIndex::beginBuild()
 {}
@@ -55,6 +65,43 @@ void
 MemtxIndex::endBuild()
 {}
 
+void
+MemtxIndex::relocate(struct tuple *old_tuple, struct tuple *new_tuple)
+{
+	/*
+	 * Unique trees and hashes replace an equal key in place.
+	 * Keys of a non-unique tree include the tuple address,
+	 * so the tuple is inserted and the old one is deleted.
+	 */
+	replace(old_tuple, new_tuple, DUP_REPLACE);
+}
+
+void
+MemtxIndex::reserveRelocate()
+{}
+
+void
+MemtxIndex::info(struct info_handler *info) const
+{
+	info_begin(info);
+	if (index_def->iid == 0)
+		memtx_build_info(this, info);
+	info_end(info);
+}
+
+struct tuple *
+MemtxIndex::findByTuple(struct tuple *tuple) const
+{
+	assert(index_def->opts.is_unique);
+	uint32_t key_size;
+	const char *key = tuple_extract_key(tuple, &index_def->key_def,
+					    &key_size);
+	if (key == NULL)
+		diag_raise();
+	uint32_t part_count = mp_decode_array(&key);
+	return findByKey(key, part_count);
+}
+
 struct tuple *
 MemtxIndex::min(const char *key, uint32_t part_count) const
 {
@@ -37,16 +37,17 @@ public:
 	MemtxIndex(struct index_def *index_def_arg)
 		:Index(index_def_arg), m_position(NULL)
 	{}
-	virtual ~MemtxIndex() override {
-		if (m_position != NULL)
-			m_position->free(m_position);
-	}
+	virtual ~MemtxIndex() override;
 	virtual struct tuple *min(const char *key,
 				  uint32_t part_count) const override;
 	virtual struct tuple *max(const char *key,
 				  uint32_t part_count) const override;
 	virtual size_t count(enum iterator_type type, const char *key,
 			     uint32_t part_count) const override;
+	/** Look up a unique index by the key of the tuple. */
+	virtual struct tuple *findByTuple(struct tuple *tuple) const override;
+	/** Reports the progress of a secondary index build. */
+	virtual void info(struct info_handler *handler) const override;
 
 	inline struct iterator *position() const
 	{
@@ -67,6 +68,20 @@ public:
 	virtual void reserve(uint32_t /* size_hint */);
 	virtual void buildNext(struct tuple *tuple);
 	virtual void endBuild();
+	/**
+	 * Replace a tuple with its copy at another address or
+	 * with the stub of an evicted tuple, used by the arena
+	 * defragmenter and tuple eviction. The tuples have the
+	 * same key, so open iterators must remain valid.
+	 * May allocate index extents, which the caller reserves,
+	 * but must not fail otherwise, see memtx_relocate_tuple().
+	 */
+	virtual void relocate(struct tuple *old_tuple, struct tuple *new_tuple);
+	/**
+	 * Reserve the memory other than index extents which
+	 * relocate() of a tuple and of the tuple back needs.
+	 */
+	virtual void reserveRelocate();
 protected:
 	/*
 	 * Pre-allocated iterator to speed up the main case of
@@ -0,0 +1,540 @@
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "memtx_multikey.h"
+#include "tuple_compare.h"
+#include "space.h"
+#include "schema.h" /* space_cache_find() */
+#include "fiber.h"
+#include <third_party/qsort_arg.h>
+
+/* {{{ Utilities. *************************************************/
+
+struct memtx_multikey_key {
+	const char *key;
+	uint32_t part_count;
+};
+
+int
+memtx_multikey_compare(struct memtx_multikey_entry a,
+		       struct memtx_multikey_entry b,
+		       struct index_def *index_def)
+{
+	int r = tuple_compare_multikey(memtx_tuple_by_handle(a.tuple),
+				       a.offset,
+				       memtx_tuple_by_handle(b.tuple),
+				       b.offset, &index_def->key_def);
+	/*
+	 * Equal elements of one tuple make one entry, so the
+	 * offset does not take part in the comparison.
+	 */
+	if (r == 0)
+		r = a.tuple < b.tuple ? -1 : a.tuple > b.tuple;
+	return r;
+}
+
+int
+memtx_multikey_compare_key(struct memtx_multikey_entry a,
+			   const struct memtx_multikey_key *key,
+			   struct index_def *index_def)
+{
+	return tuple_compare_with_key_multikey(memtx_tuple_by_handle(a.tuple),
+					       a.offset, key->key,
+					       key->part_count,
+					       &index_def->key_def);
+}
+
+static int
+memtx_multikey_qcompare(const void *a, const void *b, void *c)
+{
+	return memtx_multikey_compare(*(struct memtx_multikey_entry *)a,
+				      *(struct memtx_multikey_entry *)b,
+				      (struct index_def *)c);
+}
+
+/**
+ * Find the indexed values of a tuple: the elements of the array
+ * of a multikey index or the only value otherwise. They are the
+ * first key part field or are at the index path inside it.
+ * @param[out] count the number of values
+ * @return the first value or NULL if there is nothing to index
+ *         at the path
+ */
+static const char *
+memtx_multikey_values(struct tuple *tuple, const struct key_def *key_def,
+		      uint32_t *count)
+{
+	*count = 0;
+	const char *field = tuple_field(tuple, key_def->parts[0].fieldno);
+	assert(field != NULL);
+	if (key_def->path[0] != '\0') {
+		field = tuple_field_go_to_path(field, key_def->path);
+		if (field == NULL)
+			return NULL;
+	}
+	if (! key_def->is_multikey) {
+		*count = 1;
+		return field;
+	}
+	if (mp_typeof(*field) != MP_ARRAY)
+		return NULL;
+	*count = mp_decode_array(&field);
+	return field;
+}
+
+/**
+ * Find the indexed values of a tuple and check that they are
+ * of the first key part type.
+ * @sa memtx_multikey_values()
+ */
+static const char *
+memtx_multikey_elements(struct tuple *tuple, const struct key_def *key_def,
+			uint32_t *count)
+{
+	const struct key_part *part = &key_def->parts[0];
+	const char *field = memtx_multikey_values(tuple, key_def, count);
+	if (field == NULL) {
+		/* The tuple format checks a field without a path. */
+		assert(key_def->path[0] != '\0');
+		enum field_type type = key_def->is_multikey ?
+				       FIELD_TYPE_ARRAY : part->type;
+		tnt_raise(ClientError, ER_FIELD_TYPE,
+			  part->fieldno + TUPLE_INDEX_BASE,
+			  field_type_strs[type]);
+	}
+	const char *element = field;
+	for (uint32_t i = 0; i < *count; i++) {
+		if (key_mp_type_validate(part->type, mp_typeof(*element),
+					 ER_FIELD_TYPE,
+					 part->fieldno + TUPLE_INDEX_BASE) != 0)
+			diag_raise();
+		mp_next(&element);
+	}
+	return field;
+}
+
+/* }}} */
+
+/* {{{ MemtxMultikeyTree Iterators ********************************/
+
+struct multikey_iterator {
+	struct iterator base;
+	const struct memtx_multikey_tree *tree;
+	struct index_def *index_def;
+	struct memtx_multikey_tree_iterator tree_iterator;
+	struct memtx_multikey_key key_data;
+};
+
+static void
+multikey_iterator_free(struct iterator *iterator);
+
+static inline struct multikey_iterator *
+multikey_iterator(struct iterator *it)
+{
+	assert(it->free == multikey_iterator_free);
+	return (struct multikey_iterator *) it;
+}
+
+static void
+multikey_iterator_free(struct iterator *iterator)
+{
+	free(iterator);
+}
+
+static struct tuple *
+multikey_iterator_dummie(struct iterator *iterator)
+{
+	(void)iterator;
+	return NULL;
+}
+
+static struct tuple *
+multikey_iterator_fwd(struct iterator *iterator)
+{
+	struct multikey_iterator *it = multikey_iterator(iterator);
+	struct memtx_multikey_entry *res =
+		memtx_multikey_tree_iterator_get_elem(it->tree,
+						      &it->tree_iterator);
+	if (res == NULL)
+		return NULL;
+	memtx_multikey_tree_iterator_next(it->tree, &it->tree_iterator);
+	return memtx_tuple_by_handle(res->tuple);
+}
+
+static struct tuple *
+multikey_iterator_bwd(struct iterator *iterator)
+{
+	struct multikey_iterator *it = multikey_iterator(iterator);
+	struct memtx_multikey_entry *res =
+		memtx_multikey_tree_iterator_get_elem(it->tree,
+						      &it->tree_iterator);
+	if (res == NULL)
+		return NULL;
+	memtx_multikey_tree_iterator_prev(it->tree, &it->tree_iterator);
+	return memtx_tuple_by_handle(res->tuple);
+}
+
+static struct tuple *
+multikey_iterator_fwd_check_equality(struct iterator *iterator)
+{
+	struct multikey_iterator *it = multikey_iterator(iterator);
+	struct memtx_multikey_entry *res =
+		memtx_multikey_tree_iterator_get_elem(it->tree,
+						      &it->tree_iterator);
+	if (res == NULL)
+		return NULL;
+	if (memtx_multikey_compare_key(*res, &it->key_data,
+				       it->index_def) != 0) {
+		it->tree_iterator = memtx_multikey_tree_invalid_iterator();
+		return NULL;
+	}
+	memtx_multikey_tree_iterator_next(it->tree, &it->tree_iterator);
+	return memtx_tuple_by_handle(res->tuple);
+}
+
+static struct tuple *
+multikey_iterator_fwd_check_next_equality(struct iterator *iterator)
+{
+	struct multikey_iterator *it = multikey_iterator(iterator);
+	struct memtx_multikey_entry *res =
+		memtx_multikey_tree_iterator_get_elem(it->tree,
+						      &it->tree_iterator);
+	if (res == NULL)
+		return NULL;
+	memtx_multikey_tree_iterator_next(it->tree, &it->tree_iterator);
+	iterator->next = multikey_iterator_fwd_check_equality;
+	return memtx_tuple_by_handle(res->tuple);
+}
+
+static struct tuple *
+multikey_iterator_bwd_skip_one(struct iterator *iterator)
+{
+	struct multikey_iterator *it = multikey_iterator(iterator);
+	memtx_multikey_tree_iterator_prev(it->tree, &it->tree_iterator);
+	iterator->next = multikey_iterator_bwd;
+	return multikey_iterator_bwd(iterator);
+}
+
+static struct tuple *
+multikey_iterator_bwd_check_equality(struct iterator *iterator)
+{
+	struct multikey_iterator *it = multikey_iterator(iterator);
+	struct memtx_multikey_entry *res =
+		memtx_multikey_tree_iterator_get_elem(it->tree,
+						      &it->tree_iterator);
+	if (res == NULL)
+		return NULL;
+	if (memtx_multikey_compare_key(*res, &it->key_data,
+				       it->index_def) != 0) {
+		it->tree_iterator = memtx_multikey_tree_invalid_iterator();
+		return NULL;
+	}
+	memtx_multikey_tree_iterator_prev(it->tree, &it->tree_iterator);
+	return memtx_tuple_by_handle(res->tuple);
+}
+
+static struct tuple *
+multikey_iterator_bwd_skip_one_check_next_equality(struct iterator *iterator)
+{
+	struct multikey_iterator *it = multikey_iterator(iterator);
+	memtx_multikey_tree_iterator_prev(it->tree, &it->tree_iterator);
+	iterator->next = multikey_iterator_bwd_check_equality;
+	return multikey_iterator_bwd_check_equality(iterator);
+}
+
+/* }}} */
+
+/* {{{ MemtxMultikeyTree ******************************************/
+
+MemtxMultikeyTree::MemtxMultikeyTree(struct index_def *index_def_arg)
+	: MemtxIndex(index_def_arg), m_build_array(NULL),
+	  m_build_array_size(0), m_build_array_alloc_size(0)
+{
+	assert(index_def->key_def.is_multikey);
+	memtx_index_arena_init();
+	memtx_multikey_tree_create(&m_tree, index_def,
+				   memtx_index_extent_alloc,
+				   memtx_index_extent_free, NULL);
+}
+
+MemtxMultikeyTree::~MemtxMultikeyTree()
+{
+	memtx_multikey_tree_destroy(&m_tree);
+	free(m_build_array);
+}
+
+size_t
+MemtxMultikeyTree::size() const
+{
+	return memtx_multikey_tree_size(&m_tree);
+}
+
+size_t
+MemtxMultikeyTree::bsize() const
+{
+	return memtx_multikey_tree_mem_used(&m_tree);
+}
+
+struct tuple *
+MemtxMultikeyTree::random(uint32_t rnd) const
+{
+	struct memtx_multikey_entry *res =
+		memtx_multikey_tree_random(&m_tree, rnd);
+	return res != NULL ? memtx_tuple_by_handle(res->tuple) : NULL;
+}
+
+void
+MemtxMultikeyTree::deleteEntries(struct tuple *tuple, uint32_t count)
+{
+	const char *data = tuple_data(tuple);
+	uint32_t total;
+	const char *element = memtx_multikey_values(tuple,
+						    &index_def->key_def,
+						    &total);
+	assert(count <= total);
+	struct memtx_multikey_entry entry;
+	entry.tuple = memtx_tuple_handle(tuple);
+	for (uint32_t i = 0; i < count; i++) {
+		entry.offset = element - data;
+		/* Equal elements share one entry, it may be gone. */
+		memtx_multikey_tree_delete(&m_tree, entry);
+		mp_next(&element);
+	}
+}
+
+struct tuple *
+MemtxMultikeyTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
+			   enum dup_replace_mode mode)
+{
+	assert(! index_def->opts.is_unique);
+	(void) mode;
+	if (new_tuple != NULL) {
+		uint32_t count;
+		const char *data = tuple_data(new_tuple);
+		const char *element =
+			memtx_multikey_elements(new_tuple,
+						&index_def->key_def, &count);
+		struct memtx_multikey_entry entry;
+		entry.tuple = memtx_tuple_handle(new_tuple);
+		for (uint32_t i = 0; i < count; i++) {
+			entry.offset = element - data;
+			if (memtx_multikey_tree_insert(&m_tree, entry,
+						       NULL) != 0) {
+				deleteEntries(new_tuple, i);
+				tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE,
+					  "MemtxMultikeyTree", "replace");
+			}
+			mp_next(&element);
+		}
+	}
+	if (old_tuple != NULL) {
+		/* The old tuple passed the checks on insertion. */
+		uint32_t count;
+		memtx_multikey_values(old_tuple, &index_def->key_def,
+				      &count);
+		deleteEntries(old_tuple, count);
+	}
+	return old_tuple;
+}
+
+struct iterator *
+MemtxMultikeyTree::allocIterator() const
+{
+	struct multikey_iterator *it = (struct multikey_iterator *)
+			calloc(1, sizeof(*it));
+	if (it == NULL) {
+		tnt_raise(OutOfMemory, sizeof(struct multikey_iterator),
+			  "MemtxMultikeyTree", "iterator");
+	}
+
+	it->index_def = index_def;
+	it->tree = &m_tree;
+	it->base.free = multikey_iterator_free;
+	it->tree_iterator = memtx_multikey_tree_invalid_iterator();
+	return (struct iterator *) it;
+}
+
+void
+MemtxMultikeyTree::initIterator(struct iterator *iterator,
+				enum iterator_type type,
+				const char *key, uint32_t part_count) const
+{
+	assert(part_count == 0 || key != NULL);
+	struct multikey_iterator *it = multikey_iterator(iterator);
+
+	if (part_count == 0) {
+		/*
+		 * If no key is specified, downgrade equality
+		 * iterators to a full range.
+		 */
+		if (type < 0 || type > ITER_GT) {
+			return Index::initIterator(iterator, type, key,
+						   part_count);
+		}
+		type = iterator_type_is_reverse(type) ? ITER_LE : ITER_GE;
+		key = NULL;
+	}
+	it->key_data.key = key;
+	it->key_data.part_count = part_count;
+
+	bool exact = false;
+	if (key == NULL) {
+		if (iterator_type_is_reverse(type))
+			it->tree_iterator =
+				memtx_multikey_tree_invalid_iterator();
+		else
+			it->tree_iterator =
+				memtx_multikey_tree_iterator_first(&m_tree);
+	} else if (type == ITER_ALL || type == ITER_EQ ||
+		   type == ITER_GE || type == ITER_LT) {
+		it->tree_iterator =
+			memtx_multikey_tree_lower_bound(&m_tree,
+							&it->key_data,
+							&exact);
+		if (type == ITER_EQ && !exact) {
+			it->base.next = multikey_iterator_dummie;
+			return;
+		}
+	} else { /* ITER_GT, ITER_REQ, ITER_LE */
+		it->tree_iterator =
+			memtx_multikey_tree_upper_bound(&m_tree,
+							&it->key_data,
+							&exact);
+		if (type == ITER_REQ && !exact) {
+			it->base.next = multikey_iterator_dummie;
+			return;
+		}
+	}
+
+	switch (type) {
+	case ITER_EQ:
+		it->base.next = multikey_iterator_fwd_check_next_equality;
+		break;
+	case ITER_REQ:
+		it->base.next =
+			multikey_iterator_bwd_skip_one_check_next_equality;
+		break;
+	case ITER_ALL:
+	case ITER_GE:
+	case ITER_GT:
+		it->base.next = multikey_iterator_fwd;
+		break;
+	case ITER_LE:
+	case ITER_LT:
+		it->base.next = multikey_iterator_bwd_skip_one;
+		break;
+	default:
+		return Index::initIterator(iterator, type, key, part_count);
+	}
+}
+
+void
+MemtxMultikeyTree::beginBuild()
+{
+	assert(memtx_multikey_tree_size(&m_tree) == 0);
+}
+
+void
+MemtxMultikeyTree::buildNext(struct tuple *tuple)
+{
+	uint32_t count;
+	const char *data = tuple_data(tuple);
+	const char *element = memtx_multikey_elements(tuple,
+						      &index_def->key_def,
+						      &count);
+	if (m_build_array_size + count > m_build_array_alloc_size) {
+		size_t alloc_size = MAX(m_build_array_alloc_size, (size_t)
+			MEMTX_EXTENT_SIZE / sizeof(*m_build_array));
+		while (alloc_size < m_build_array_size + count)
+			alloc_size += alloc_size / 2;
+		struct memtx_multikey_entry *tmp =
+			(struct memtx_multikey_entry *)
+			realloc(m_build_array, alloc_size * sizeof(*tmp));
+		if (tmp == NULL) {
+			tnt_raise(OutOfMemory, alloc_size * sizeof(*tmp),
+				  "MemtxMultikeyTree", "buildNext");
+		}
+		m_build_array = tmp;
+		m_build_array_alloc_size = alloc_size;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		struct memtx_multikey_entry *entry =
+			&m_build_array[m_build_array_size++];
+		entry->tuple = memtx_tuple_handle(tuple);
+		entry->offset = element - data;
+		mp_next(&element);
+	}
+}
+
+void
+MemtxMultikeyTree::endBuild()
+{
+	qsort_arg(m_build_array, m_build_array_size, sizeof(*m_build_array),
+		  memtx_multikey_qcompare, index_def);
+	/* Leave one entry for equal elements of a tuple. */
+	size_t count = 0;
+	for (size_t i = 0; i < m_build_array_size; i++) {
+		if (count > 0 &&
+		    memtx_multikey_compare(m_build_array[count - 1],
+					   m_build_array[i], index_def) == 0)
+			continue;
+		m_build_array[count++] = m_build_array[i];
+	}
+	int rc = memtx_multikey_tree_build(&m_tree, m_build_array, count);
+
+	free(m_build_array);
+	m_build_array = NULL;
+	m_build_array_size = 0;
+	m_build_array_alloc_size = 0;
+	if (rc != 0) {
+		tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE,
+			  "MemtxMultikeyTree", "endBuild");
+	}
+}
+
+void
+MemtxMultikeyTree::createReadViewForIterator(struct iterator *iterator)
+{
+	struct multikey_iterator *it = multikey_iterator(iterator);
+	struct memtx_multikey_tree *tree =
+		(struct memtx_multikey_tree *) it->tree;
+	memtx_multikey_tree_iterator_freeze(tree, &it->tree_iterator);
+}
+
+void
+MemtxMultikeyTree::destroyReadViewForIterator(struct iterator *iterator)
+{
+	struct multikey_iterator *it = multikey_iterator(iterator);
+	struct memtx_multikey_tree *tree =
+		(struct memtx_multikey_tree *) it->tree;
+	memtx_multikey_tree_iterator_destroy(tree, &it->tree_iterator);
+}
+
+/* }}} */
@@ -0,0 +1,121 @@
+#ifndef TARANTOOL_BOX_MEMTX_MULTIKEY_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_MULTIKEY_H_INCLUDED
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "memtx_index.h"
+#include "memtx_engine.h"
+#include "memtx_tuple.h"
+
+struct memtx_multikey_key;
+
+/**
+ * An entry of a multikey index: a tuple and one element of its
+ * indexed array field, or the value at the index path.
+ */
+struct memtx_multikey_entry {
+	memtx_tuple_handle_t tuple;
+	/** Offset of the indexed value in the tuple data. */
+	uint32_t offset;
+};
+
+int
+memtx_multikey_compare(struct memtx_multikey_entry a,
+		       struct memtx_multikey_entry b,
+		       struct index_def *index_def);
+
+int
+memtx_multikey_compare_key(struct memtx_multikey_entry a,
+			   const struct memtx_multikey_key *b,
+			   struct index_def *index_def);
+
+#define BPS_TREE_NAME memtx_multikey_tree
+#define BPS_TREE_BLOCK_SIZE (512)
+#define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
+#define BPS_TREE_COMPARE(a, b, arg) memtx_multikey_compare(a, b, arg)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_multikey_compare_key(a, b, arg)
+#define bps_tree_elem_t struct memtx_multikey_entry
+#define bps_tree_key_t const struct memtx_multikey_key *
+#define bps_tree_arg_t struct index_def *
+#define BPS_TREE_NO_DEBUG
+
+#include "salad/bps_tree.h"
+
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+#undef BPS_TREE_NO_DEBUG
+
+/**
+ * TREE index over elements of an array field, @sa
+ * index_opts::is_multikey, or over a value nested in a field,
+ * @sa index_opts::path. A tuple is stored once per distinct
+ * element, iterators return it for every matching element.
+ */
+class MemtxMultikeyTree: public MemtxIndex {
+public:
+	MemtxMultikeyTree(struct index_def *index_def);
+	virtual ~MemtxMultikeyTree() override;
+
+	virtual void beginBuild() override;
+	virtual void buildNext(struct tuple *tuple) override;
+	virtual void endBuild() override;
+	virtual size_t size() const override;
+	virtual struct tuple *random(uint32_t rnd) const override;
+	virtual struct tuple *replace(struct tuple *old_tuple,
+				      struct tuple *new_tuple,
+				      enum dup_replace_mode mode) override;
+
+	virtual size_t bsize() const override;
+	virtual struct iterator *allocIterator() const override;
+	virtual void initIterator(struct iterator *iterator,
+				  enum iterator_type type,
+				  const char *key,
+				  uint32_t part_count) const override;
+
+	virtual void createReadViewForIterator(struct iterator *iterator) override;
+	virtual void destroyReadViewForIterator(struct iterator *iterator) override;
+
+private:
+	/** Delete entries of the first count elements of a tuple. */
+	void deleteEntries(struct tuple *tuple, uint32_t count);
+
+	struct memtx_multikey_tree m_tree;
+	struct memtx_multikey_entry *m_build_array;
+	size_t m_build_array_size, m_build_array_alloc_size;
+};
+
+#endif /* TARANTOOL_BOX_MEMTX_MULTIKEY_H_INCLUDED */
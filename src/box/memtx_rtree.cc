@@ -161,10 +161,12 @@ MemtxRTree::~MemtxRTree()
 		m_position = NULL;
 	}
 	rtree_destroy(&m_tree);
+	free(m_build_array);
 }
 
 MemtxRTree::MemtxRTree(struct index_def *index_def_arg)
-	: MemtxIndex(index_def_arg)
+	: MemtxIndex(index_def_arg), m_build_array(NULL),
+	  m_build_array_size(0), m_build_array_alloc_size(0)
 {
 	assert(index_def->key_def.part_count == 1);
 	assert(index_def->key_def.parts[0].type == FIELD_TYPE_ARRAY);
@@ -234,6 +236,17 @@ MemtxRTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	return old_tuple;
 }
 
+void
+MemtxRTree::relocate(struct tuple *old_tuple, struct tuple *new_tuple)
+{
+	/* Removal and insertion would invalidate iterators. */
+	struct rtree_rect rect;
+	extract_rectangle(&rect, old_tuple, index_def);
+	bool found = rtree_replace_record(&m_tree, &rect, old_tuple,
+					  new_tuple);
+	assert(found); (void) found;
+}
+
 struct iterator *
 MemtxRTree::allocIterator() const
 {
@@ -306,3 +319,64 @@ MemtxRTree::beginBuild()
 	rtree_purge(&m_tree);
 }
 
+void
+MemtxRTree::reserve(uint32_t size_hint)
+{
+	if (size_hint < m_build_array_alloc_size)
+		return;
+	record_t *tmp = (record_t *)
+		realloc(m_build_array, size_hint * sizeof(*tmp));
+	if (tmp == NULL)
+		tnt_raise(OutOfMemory, size_hint * sizeof(*tmp),
+			  "MemtxRTree", "reserve");
+	m_build_array = tmp;
+	m_build_array_alloc_size = size_hint;
+}
+
+void
+MemtxRTree::buildNext(struct tuple *tuple)
+{
+	/* Check the rectangle now, the bulk load can not fail. */
+	struct rtree_rect rect;
+	extract_rectangle(&rect, tuple, index_def);
+	if (m_build_array_size == m_build_array_alloc_size) {
+		size_t alloc_size = m_build_array_alloc_size > 0 ?
+			m_build_array_alloc_size +
+			m_build_array_alloc_size / 2 :
+			MEMTX_EXTENT_SIZE / sizeof(*m_build_array);
+		record_t *tmp = (record_t *)
+			realloc(m_build_array, alloc_size * sizeof(*tmp));
+		if (tmp == NULL) {
+			tnt_raise(OutOfMemory, alloc_size * sizeof(*tmp),
+				  "MemtxRTree", "buildNext");
+		}
+		m_build_array = tmp;
+		m_build_array_alloc_size = alloc_size;
+	}
+	m_build_array[m_build_array_size++] = tuple;
+}
+
+static void
+memtx_rtree_extract_rect(record_t record, struct rtree_rect *rect, void *ctx)
+{
+	extract_rectangle(rect, (struct tuple *) record,
+			  (struct index_def *) ctx);
+}
+
+void
+MemtxRTree::endBuild()
+{
+	/* The extent allocator throws through the C code otherwise. */
+	memtx_index_extent_reserve(
+		rtree_bulk_load_extent_count(&m_tree, m_build_array_size));
+	int rc = rtree_bulk_load(&m_tree, m_build_array, m_build_array_size,
+				 memtx_rtree_extract_rect, index_def);
+	size_t size = m_build_array_size * sizeof(*m_build_array);
+	free(m_build_array);
+	m_build_array = NULL;
+	m_build_array_size = 0;
+	m_build_array_alloc_size = 0;
+	if (rc != 0)
+		tnt_raise(OutOfMemory, size, "MemtxRTree", "endBuild");
+}
+
@@ -41,9 +41,14 @@ public:
 	~MemtxRTree();
 
 	virtual void beginBuild() override;
+	virtual void reserve(uint32_t size_hint) override;
+	virtual void buildNext(struct tuple *tuple) override;
+	virtual void endBuild() override;
 	virtual size_t size() const override;
 	virtual struct tuple *findByKey(const char *key,
 					uint32_t part_count) const override;
+	virtual void relocate(struct tuple *old_tuple,
+			      struct tuple *new_tuple) override;
 	virtual struct tuple *replace(struct tuple *old_tuple,
                                       struct tuple *new_tuple,
                                       enum dup_replace_mode mode) override;
@@ -58,6 +63,9 @@ public:
 protected:
 	unsigned m_dimension;
 	struct rtree m_tree;
+	/** Tuples collected by buildNext() for a bulk load. */
+	record_t *m_build_array;
+	size_t m_build_array_size, m_build_array_alloc_size;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_RTREE_H_INCLUDED */
@@ -34,12 +34,15 @@
 #include "txn.h"
 #include "tuple_compare.h"
 #include "xrow.h"
+#include "request.h"
 #include "memtx_hash.h"
 #include "memtx_tree.h"
+#include "memtx_multikey.h"
 #include "memtx_rtree.h"
 #include "memtx_bitset.h"
 #include "port.h"
 #include "memtx_tuple.h"
+#include "schema.h"
 
 /**
  * A version of space_replace for a space which has
@@ -63,9 +66,32 @@ enum {
 	 * number of new block allocations.
 	 */
 	RESERVE_EXTENTS_BEFORE_DELETE = 8,
-	RESERVE_EXTENTS_BEFORE_REPLACE = 16
+	RESERVE_EXTENTS_BEFORE_REPLACE = 16,
+	/**
+	 * A move of a tuple is an insertion and a deletion in
+	 * each non-unique tree, and so is its rollback.
+	 */
+	RESERVE_EXTENTS_BEFORE_RELOCATE = 2 * RESERVE_EXTENTS_BEFORE_REPLACE
 };
 
+/**
+ * Reference the new tuple of a statement once more until the
+ * transaction ends, see MemtxEngine::commit(). The defragmenter
+ * and eviction only move tuples which the space references
+ * alone, and the statement refers to its new tuple until then.
+ * Called after the indexes are changed, and can't fail: a new
+ * tuple is referenced by its statement only.
+ */
+static inline void
+memtx_stmt_pin(struct txn_stmt *stmt)
+{
+	if (stmt->new_tuple == NULL)
+		return;
+	int rc = tuple_ref(stmt->new_tuple);
+	assert(rc == 0);
+	(void) rc;
+}
+
 /**
  * A short-cut version of replace() used during bulk load
  * from snapshot.
@@ -87,6 +113,7 @@ memtx_replace_build_next(struct txn_stmt *stmt, struct space *space,
 		      "from snapshot");
 	}
 	((MemtxIndex *) space->index[0])->buildNext(stmt->new_tuple);
+	memtx_stmt_pin(stmt);
 	stmt->engine_savepoint = stmt;
 	stmt->bsize_change = space_bsize_update(space, NULL, stmt->new_tuple);
 }
@@ -101,6 +128,7 @@ memtx_replace_primary_key(struct txn_stmt *stmt, struct space *space,
 {
 	stmt->old_tuple = space->index[0]->replace(stmt->old_tuple,
 						   stmt->new_tuple, mode);
+	memtx_stmt_pin(stmt);
 	stmt->engine_savepoint = stmt;
 	stmt->bsize_change = space_bsize_update(space, stmt->old_tuple, stmt->new_tuple);
 }
@@ -229,13 +257,53 @@ memtx_replace_all_keys(struct txn_stmt *stmt, struct space *space,
 		throw;
 	}
 	stmt->old_tuple = old_tuple;
+	memtx_stmt_pin(stmt);
 	stmt->engine_savepoint = stmt;
 	stmt->bsize_change = space_bsize_update(space, old_tuple, new_tuple);
+	if (old_tuple != NULL) {
+		MemtxSpace *handler = (MemtxSpace *) space->handler;
+		handler->overwritten_bsize += box_tuple_bsize(old_tuple);
+	}
 }
 
+void
+memtx_relocate_tuple(struct space *space, struct tuple *old_tuple,
+		     struct tuple *new_tuple)
+{
+	/* An index being built on the space refers to the tuple too. */
+	MemtxIndex *build_index = memtx_build_index(space, old_tuple);
+	uint32_t index_count = space->index_count;
+	auto index_at = [=](uint32_t i) {
+		return i < index_count ?
+		       (MemtxIndex *) space->index[i] : build_index;
+	};
+	if (build_index != NULL)
+		index_count++;
+	/* The rollback below must not run out of memory. */
+	memtx_index_extent_reserve(RESERVE_EXTENTS_BEFORE_RELOCATE);
+	for (uint32_t i = 0; i < index_count; i++)
+		index_at(i)->reserveRelocate();
+	tuple_ref_xc(new_tuple);
+	uint32_t i = 0;
+	try {
+		for (; i < index_count; i++)
+			index_at(i)->relocate(old_tuple, new_tuple);
+	} catch (Exception *) {
+		try {
+			while (i-- > 0)
+				index_at(i)->relocate(new_tuple, old_tuple);
+		} catch (Exception *) {
+			panic("failed to roll back a tuple move in space '%s'",
+			      space_name(space));
+		}
+		tuple_unref(new_tuple);
+		throw;
+	}
+	tuple_unref(old_tuple);
+}
 
 MemtxSpace::MemtxSpace(Engine *e)
-	: Handler(e)
+	: Handler(e), overwritten_bsize(0), evicted_count(0)
 {
 	replace = memtx_replace_no_keys;
 }
@@ -275,6 +343,16 @@ MemtxSpace::prepareReplace(struct txn_stmt *stmt, struct space *space,
 	stmt->new_tuple = memtx_tuple_new_xc(space->format, request->tuple,
 					     request->tuple_end);
 	tuple_ref(stmt->new_tuple);
+	/*
+	 * The replaced tuple is passed to triggers and its size
+	 * is subtracted from the space size, load its body.
+	 */
+	if (evicted_count > 0) {
+		MemtxIndex *pk = (MemtxIndex *) index_find_xc(space, 0);
+		struct tuple *old_tuple = pk->findByTuple(stmt->new_tuple);
+		if (old_tuple != NULL)
+			tuple_fetch_xc(old_tuple);
+	}
 }
 
 void
@@ -285,9 +363,12 @@ MemtxSpace::prepareDelete(struct txn_stmt *stmt, struct space *space,
 	Index *pk = index_find_unique(space, request->index_id);
 	const char *key = request->key;
 	uint32_t part_count = mp_decode_array(&key);
-	if (primary_key_validate(&pk->index_def->key_def, key, part_count) != 0)
+	if (! request_is_checked(request) &&
+	    primary_key_validate(&pk->index_def->key_def, key, part_count) != 0)
 		diag_raise();
 	stmt->old_tuple = pk->findByKey(key, part_count);
+	if (stmt->old_tuple != NULL)
+		stmt->old_tuple = tuple_fetch_xc(stmt->old_tuple);
 }
 
 void
@@ -298,12 +379,14 @@ MemtxSpace::prepareUpdate(struct txn_stmt *stmt, struct space *space,
 	Index *pk = index_find_unique(space, request->index_id);
 	const char *key = request->key;
 	uint32_t part_count = mp_decode_array(&key);
-	if (primary_key_validate(&pk->index_def->key_def, key, part_count) != 0)
+	if (! request_is_checked(request) &&
+	    primary_key_validate(&pk->index_def->key_def, key, part_count) != 0)
 		diag_raise();
 	stmt->old_tuple = pk->findByKey(key, part_count);
 
 	if (stmt->old_tuple == NULL)
 		return;
+	stmt->old_tuple = tuple_fetch_xc(stmt->old_tuple);
 
 	/* Update the tuple; legacy, request ops are in request->tuple */
 	uint32_t new_size = 0, bsize;
@@ -329,7 +412,8 @@ MemtxSpace::prepareUpsert(struct txn_stmt *stmt, struct space *space,
 	 * Check all tuple fields: we should produce an error on
 	 * malformed tuple even if upsert turns into an update.
 	 */
-	if (tuple_validate_raw(space->format, request->tuple))
+	if (! request_is_checked(request) &&
+	    tuple_validate_raw(space->format, request->tuple))
 		diag_raise();
 
 	Index *index = index_find_unique(space, 0);
@@ -375,6 +459,7 @@ MemtxSpace::prepareUpsert(struct txn_stmt *stmt, struct space *space,
 						     request->tuple_end);
 		tuple_ref(stmt->new_tuple);
 	} else {
+		stmt->old_tuple = tuple_fetch_xc(stmt->old_tuple);
 		uint32_t new_size = 0, bsize;
 		const char *old_data = tuple_data_range(stmt->old_tuple,
 							&bsize);
@@ -465,12 +550,16 @@ MemtxSpace::executeUpsert(struct txn *txn, struct space *space,
 Index *
 MemtxSpace::createIndex(struct space *space, struct index_def *index_def_arg)
 {
-	(void) space;
+	Index *index;
 	switch (index_def_arg->type) {
 	case HASH:
-		return new MemtxHash(index_def_arg);
+		index = new MemtxHash(index_def_arg);
+		break;
 	case TREE:
-		return new MemtxTree(index_def_arg);
+		if (key_def_is_nested(&index_def_arg->key_def))
+			return new MemtxMultikeyTree(index_def_arg);
+		index = new MemtxTree(index_def_arg);
+		break;
 	case RTREE:
 		return new MemtxRTree(index_def_arg);
 	case BITSET:
@@ -479,6 +568,14 @@ MemtxSpace::createIndex(struct space *space, struct index_def *index_def_arg)
 		unreachable();
 		return NULL;
 	}
+	/*
+	 * The index is empty yet, so it is safe to switch its
+	 * comparators. Tuples of other formats, e.g. inserted
+	 * before ALTER, are compared correctly too.
+	 */
+	if (space->format->native_field_count > 0)
+		key_def_set_fixed_layout_cmp(&index->index_def->key_def);
+	return index;
 }
 
 void
@@ -505,6 +602,15 @@ MemtxSpace::prepareAlterSpace(struct space *old_space, struct space *new_space)
 	replace = handler->replace;
 }
 
+void
+MemtxSpace::commitAlterSpace(struct space *old_space, struct space *new_space)
+{
+	(void) old_space;
+	/* Writes made before the alter can't be rolled back now. */
+	for (uint32_t i = 0; i < new_space->index_count; i++)
+		memtx_build_end(new_space->index[i]);
+}
+
 void
 MemtxSpace::executeSelect(struct txn *, struct space *space,
 			  uint32_t index_id, uint32_t iterator,
@@ -528,6 +634,7 @@ MemtxSpace::executeSelect(struct txn *, struct space *space,
 	struct iterator *it = index->position();
 	index->initIterator(it, type, key, part_count);
 
+	struct port_entry *last = port->size > 0 ? port->last : NULL;
 	struct tuple *tuple;
 	while ((tuple = it->next(it)) != NULL) {
 		if (offset > 0) {
@@ -538,4 +645,18 @@ MemtxSpace::executeSelect(struct txn *, struct space *space,
 			break;
 		port_add_tuple(port, tuple);
 	}
+	/*
+	 * A load of an evicted tuple may yield, and the index
+	 * may change meanwhile, so bodies are loaded after the
+	 * scan. The port keeps the stubs referenced till then.
+	 */
+	struct port_entry *e = last != NULL ? last->next : port->first;
+	for (; port->size > 0 && e != NULL; e = e->next) {
+		tuple = tuple_fetch_xc(e->tuple);
+		if (tuple == e->tuple)
+			continue;
+		tuple_ref_xc(tuple);
+		tuple_unref(e->tuple);
+		e->tuple = tuple;
+	}
 }
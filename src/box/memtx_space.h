@@ -48,6 +48,16 @@ void
 memtx_replace_all_keys(struct txn_stmt *, struct space *space,
 		       enum dup_replace_mode /* mode */);
 
+/**
+ * Replace a tuple with an equal one, e.g. its copy at another
+ * address, in all indexes of the space. The new tuple is
+ * referenced and the old one is unreferenced. On error the
+ * indexes are left intact.
+ */
+void
+memtx_relocate_tuple(struct space *space, struct tuple *old_tuple,
+		     struct tuple *new_tuple);
+
 struct MemtxSpace: public Handler {
 	MemtxSpace(Engine *e);
 	virtual ~MemtxSpace()
@@ -82,12 +92,25 @@ struct MemtxSpace: public Handler {
 	virtual void dropIndex(Index *index) override;
 	virtual void prepareAlterSpace(struct space *old_space,
 				       struct space *new_space) override;
+	virtual void commitAlterSpace(struct space *old_space,
+				      struct space *new_space) override;
 public:
 	/**
 	 * A pointer to replace function, set to different values
 	 * at different stages of recovery.
 	 */
 	engine_replace_f replace;
+	/**
+	 * Size of tuples replaced or deleted since the last
+	 * checkpoint. Spaces which change most are written
+	 * to a snapshot first.
+	 */
+	size_t overwritten_bsize;
+	/**
+	 * The number of stubs of evicted tuples in the space.
+	 * Requests to a space without stubs never yield.
+	 */
+	uint32_t evicted_count;
 private:
 	void
 	prepareReplace(struct txn_stmt *stmt, struct space *space,
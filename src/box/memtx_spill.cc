@@ -0,0 +1,394 @@
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include "memtx_spill.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include "fiber.h"
+#include "fio.h"
+#include "coeio.h"
+#include "say.h"
+#include "space.h"
+#include "schema.h"
+#include "memtx_index.h"
+#include "memtx_space.h"
+#include "memtx_tuple.h"
+#include "scoped_guard.h"
+
+struct memtx_spill_stat memtx_spill_stat;
+
+enum {
+	/** Files are switched when the garbage exceeds a half. */
+	MEMTX_SPILL_ROTATE_SIZE = 512 * 1024,
+};
+
+/** Name of a spill file in the memtx directory. */
+static const char MEMTX_SPILL_FILENAME[] = "memtx.%u.spill";
+
+struct memtx_spill_file {
+	/** -1 until a tuple is evicted to the file. */
+	int fd;
+	char path[PATH_MAX];
+	/** Offset of the next write, which is the file size. */
+	uint64_t size;
+	/** Size of the bodies which are not referenced. */
+	uint64_t garbage_size;
+};
+
+/**
+ * Bodies are appended to the current file. When most of it
+ * is garbage, new bodies go to the other one, and the eviction
+ * clock copies the rest, so that the file is removed.
+ */
+static struct memtx_spill_file spill_files[2];
+static uint32_t spill_current;
+/** A checkpoint may read bodies of the freed stubs. */
+static bool spill_is_snapshot;
+
+static void
+memtx_spill_update_stat(void)
+{
+	memtx_spill_stat.file_size = 0;
+	memtx_spill_stat.garbage_size = 0;
+	for (uint32_t i = 0; i < lengthof(spill_files); i++) {
+		memtx_spill_stat.file_size += spill_files[i].size;
+		memtx_spill_stat.garbage_size += spill_files[i].garbage_size;
+	}
+}
+
+void
+memtx_spill_init(const char *dirname)
+{
+	for (uint32_t i = 0; i < lengthof(spill_files); i++) {
+		struct memtx_spill_file *file = &spill_files[i];
+		file->fd = -1;
+		snprintf(file->path, sizeof(file->path), "%s/", dirname);
+		size_t len = strlen(file->path);
+		snprintf(file->path + len, sizeof(file->path) - len,
+			 MEMTX_SPILL_FILENAME, i);
+		/* Bodies evicted before a restart are not referenced. */
+		unlink(file->path);
+	}
+}
+
+static void
+memtx_spill_close(struct memtx_spill_file *file)
+{
+	if (file->fd < 0)
+		return;
+	close(file->fd);
+	unlink(file->path);
+	file->fd = -1;
+	file->size = 0;
+	file->garbage_size = 0;
+}
+
+void
+memtx_spill_free(void)
+{
+	for (uint32_t i = 0; i < lengthof(spill_files); i++)
+		memtx_spill_close(&spill_files[i]);
+	memtx_spill_update_stat();
+}
+
+static int
+memtx_spill_open(struct memtx_spill_file *file)
+{
+	file->fd = open(file->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file->fd < 0) {
+		diag_set(SystemError, "failed to create file '%s'",
+			 file->path);
+		return -1;
+	}
+	file->size = 0;
+	file->garbage_size = 0;
+	return 0;
+}
+
+/** Remove the other file if it has no bodies referenced. */
+static void
+memtx_spill_collect(void)
+{
+	struct memtx_spill_file *file = &spill_files[!spill_current];
+	if (file->fd < 0 || file->garbage_size < file->size ||
+	    spill_is_snapshot)
+		return;
+	memtx_spill_close(file);
+	memtx_spill_update_stat();
+}
+
+/** Switch to the other file if it is removed. */
+static void
+memtx_spill_rotate(void)
+{
+	struct memtx_spill_file *file = &spill_files[spill_current];
+	if (file->size < MEMTX_SPILL_ROTATE_SIZE ||
+	    file->garbage_size < file->size / 2 ||
+	    spill_files[!spill_current].fd >= 0)
+		return;
+	spill_current = !spill_current;
+	say_info("switched to spill file '%s', %llu bytes of %llu in "
+		 "'%s' are garbage", spill_files[spill_current].path,
+		 (unsigned long long) file->garbage_size,
+		 (unsigned long long) file->size, file->path);
+	memtx_spill_collect();
+}
+
+static ssize_t
+memtx_spill_write_f(va_list ap)
+{
+	int fd = va_arg(ap, int);
+	const char *data = va_arg(ap, const char *);
+	size_t size = va_arg(ap, size_t);
+	off_t offset = va_arg(ap, off_t);
+	while (size > 0) {
+		ssize_t written = pwrite(fd, data, size, offset);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			diag_set(SystemError, "failed to write to file '%s'",
+				 spill_path);
+			return -1;
+		}
+		data += written;
+		size -= written;
+		offset += written;
+	}
+	return 0;
+}
+
+int
+memtx_spill_write(const char *data, size_t size, struct memtx_spill_ref *ref)
+{
+	memtx_spill_rotate();
+	struct memtx_spill_file *file = &spill_files[spill_current];
+	if (file->fd < 0 && memtx_spill_open(file) != 0)
+		return -1;
+	/*
+	 * Reserve the range before the yield. A failed write
+	 * leaves a hole, which is garbage.
+	 */
+	ref->file_no = spill_current;
+	ref->offset = file->size;
+	file->size += size;
+	memtx_spill_update_stat();
+	if (coio_call(memtx_spill_write_f, file->fd, data, size,
+		      (off_t) ref->offset) != 0) {
+		file->garbage_size += size;
+		memtx_spill_update_stat();
+		return -1;
+	}
+	return 0;
+}
+
+void
+memtx_spill_drop(const struct memtx_spill_ref *ref)
+{
+	struct memtx_spill_file *file = &spill_files[ref->file_no];
+	/* Stubs are freed after the files on shutdown. */
+	if (file->fd < 0)
+		return;
+	file->garbage_size += ref->bsize;
+	assert(file->garbage_size <= file->size);
+	memtx_spill_update_stat();
+	if (ref->file_no != spill_current)
+		memtx_spill_collect();
+}
+
+bool
+memtx_spill_is_old(const struct memtx_spill_ref *ref)
+{
+	return ref->file_no != spill_current;
+}
+
+void
+memtx_spill_begin_snapshot(void)
+{
+	spill_is_snapshot = true;
+}
+
+void
+memtx_spill_end_snapshot(void)
+{
+	spill_is_snapshot = false;
+	memtx_spill_collect();
+}
+
+int
+memtx_spill_read(char *buf, const struct memtx_spill_ref *ref)
+{
+	const struct memtx_spill_file *file = &spill_files[ref->file_no];
+	ssize_t size = fio_pread(file->fd, buf, ref->bsize, ref->offset);
+	if (size < 0) {
+		diag_set(SystemError, "failed to read from file '%s'",
+			 file->path);
+		return -1;
+	}
+	if (size != (ssize_t) ref->bsize) {
+		errno = EIO;
+		diag_set(SystemError, "unexpected end of file '%s'",
+			 file->path);
+		return -1;
+	}
+	return 0;
+}
+
+static ssize_t
+memtx_spill_read_f(va_list ap)
+{
+	char *buf = va_arg(ap, char *);
+	const struct memtx_spill_ref *ref =
+		va_arg(ap, const struct memtx_spill_ref *);
+	return memtx_spill_read(buf, ref);
+}
+
+static ssize_t
+memtx_spill_read_batch_f(va_list ap)
+{
+	char **bufs = va_arg(ap, char **);
+	const struct memtx_spill_ref *refs =
+		va_arg(ap, const struct memtx_spill_ref *);
+	int count = va_arg(ap, int);
+	for (int i = 0; i < count; i++) {
+		if (memtx_spill_read(bufs[i], &refs[i]) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+int
+memtx_spill_read_stubs(struct tuple **batch, int count, char *buf)
+{
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	struct memtx_spill_ref *refs = (struct memtx_spill_ref *)
+		region_alloc(region, count * sizeof(*refs));
+	char **bufs = (char **) region_alloc(region, count * sizeof(*bufs));
+	if (refs == NULL || bufs == NULL) {
+		region_truncate(region, used);
+		diag_set(OutOfMemory, count * sizeof(*refs), "region",
+			 "spill refs");
+		return -1;
+	}
+	int stub_count = 0;
+	for (int i = 0; i < count; i++) {
+		struct memtx_spill_ref *ref = &refs[stub_count];
+		if (!memtx_tuple_spill_ref(batch[i], ref)) {
+			buf += batch[i]->bsize;
+			continue;
+		}
+		bufs[stub_count++] = buf;
+		buf += ref->bsize;
+	}
+	int rc = 0;
+	if (stub_count > 0) {
+		rc = coio_call(memtx_spill_read_batch_f, bufs, refs,
+			       stub_count);
+	}
+	region_truncate(region, used);
+	return rc;
+}
+
+/**
+ * Find the space the stub is still in.
+ * @retval NULL the stub has been replaced or the space dropped
+ */
+static struct space *
+memtx_spill_find_space(uint32_t space_id, struct tuple *stub)
+{
+	struct space *space = space_by_id(space_id);
+	if (space == NULL || !space_is_memtx(space) ||
+	    space_index(space, 0) == NULL)
+		return NULL;
+	MemtxIndex *pk = (MemtxIndex *) space->index[0];
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	auto region_guard = make_scoped_guard([=]{
+		region_truncate(region, used);
+	});
+	return pk->findByTuple(stub) == stub ? space : NULL;
+}
+
+struct tuple *
+memtx_spill_load(struct tuple_format *format, struct tuple *stub,
+		 const struct memtx_spill_ref *ref, bool can_yield)
+{
+	struct region *region = &fiber()->gc;
+	size_t used = region_used(region);
+	char *data = (char *) region_alloc(region, ref->bsize);
+	if (data == NULL) {
+		diag_set(OutOfMemory, ref->bsize, "region", "tuple body");
+		return NULL;
+	}
+	/* The stub may be replaced and freed during the read. */
+	if (tuple_ref(stub) != 0) {
+		region_truncate(region, used);
+		return NULL;
+	}
+	int rc;
+	if (can_yield)
+		rc = coio_call(memtx_spill_read_f, data, ref);
+	else
+		rc = memtx_spill_read(data, ref);
+	struct tuple *tuple = NULL;
+	if (rc == 0)
+		tuple = memtx_tuple_new(format, data, data + ref->bsize);
+	region_truncate(region, used);
+	if (tuple == NULL) {
+		tuple_unref(stub);
+		return NULL;
+	}
+	memtx_spill_stat.loaded_count++;
+	memtx_spill_stat.loaded_size += ref->bsize;
+	struct space *space;
+	try {
+		space = memtx_spill_find_space(ref->space_id, stub);
+	} catch (Exception *) {
+		tuple_unref(stub);
+		tuple_delete(tuple);
+		return NULL;
+	}
+	if (space != NULL) {
+		/* The tuple is freed if the relocation fails. */
+		try {
+			memtx_relocate_tuple(space, stub, tuple);
+		} catch (Exception *) {
+			tuple_unref(stub);
+			return NULL;
+		}
+		((MemtxSpace *) space->handler)->evicted_count--;
+	}
+	tuple_unref(stub);
+	return tuple;
+}
@@ -0,0 +1,150 @@
+#ifndef TARANTOOL_BOX_MEMTX_SPILL_H_INCLUDED
+#define TARANTOOL_BOX_MEMTX_SPILL_H_INCLUDED
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct tuple;
+struct tuple_format;
+struct memtx_spill_ref;
+
+/**
+ * Bodies of cold tuples of tiered spaces are appended to
+ * a spill file in the memtx directory, their stubs with indexed
+ * fields stay in the indexes. When most of the file is garbage,
+ * bodies are appended to another file and the live ones are
+ * copied there, so that the first file is removed. The files
+ * are not a part of the persistent state: tuples are recovered
+ * from the snapshot and the WAL, and the files are removed on
+ * startup.
+ */
+struct memtx_spill_stat {
+	/** Passes of the eviction clock over tiered spaces. */
+	uint64_t pass_count;
+	/** The number of evicted tuples. */
+	uint64_t evicted_count;
+	/** The total MessagePack size of the evicted tuples. */
+	uint64_t evicted_size;
+	/** The number of tuples loaded back on access. */
+	uint64_t loaded_count;
+	/** The total MessagePack size of the loaded tuples. */
+	uint64_t loaded_size;
+	/** Size of the spill files. */
+	uint64_t file_size;
+	/** Size of the bodies in the files which are not used. */
+	uint64_t garbage_size;
+};
+
+extern struct memtx_spill_stat memtx_spill_stat;
+
+/** Set the directory of the spill file. */
+void
+memtx_spill_init(const char *dirname);
+
+/** Close and remove the spill files. */
+void
+memtx_spill_free(void);
+
+/**
+ * Append tuple bodies to the spill file in a coio thread.
+ * @param[out] ref the file and the offset of the data
+ * @retval -1 on error, check diag
+ */
+int
+memtx_spill_write(const char *data, size_t size, struct memtx_spill_ref *ref);
+
+/**
+ * Account the body of a freed stub, or of a tuple which is not
+ * evicted after the write, as garbage. A file which has only
+ * garbage is removed.
+ */
+void
+memtx_spill_drop(const struct memtx_spill_ref *ref);
+
+/**
+ * Check if the body is in the file which is being emptied, so
+ * that the stub should be evicted once again.
+ */
+bool
+memtx_spill_is_old(const struct memtx_spill_ref *ref);
+
+/**
+ * A checkpoint reads bodies of stubs freed after its start, so
+ * files are not removed till its end.
+ */
+void
+memtx_spill_begin_snapshot(void);
+
+void
+memtx_spill_end_snapshot(void);
+
+/**
+ * Read the body of an evicted tuple without a yield. Safe to
+ * call from any thread.
+ * @param buf the buffer of ref->bsize bytes
+ * @retval -1 on error, check diag
+ */
+int
+memtx_spill_read(char *buf, const struct memtx_spill_ref *ref);
+
+/**
+ * Read the bodies of the stubs of a batch in a coio thread.
+ * The buffer has the bodies of the batch one after another,
+ * those of tuples are already there.
+ * @retval -1 on error, check diag
+ */
+int
+memtx_spill_read_stubs(struct tuple **batch, int count, char *buf);
+
+/**
+ * Load the body of an evicted tuple and put it in place of
+ * the stub in the space, unless the stub is replaced while
+ * the body is read.
+ * @param can_yield read in a coio thread, otherwise the tx
+ *        thread is blocked
+ * @retval the loaded tuple, not referenced
+ * @retval NULL on error, check diag
+ */
+struct tuple *
+memtx_spill_load(struct tuple_format *format, struct tuple *stub,
+		 const struct memtx_spill_ref *ref, bool can_yield);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_MEMTX_SPILL_H_INCLUDED */
@@ -46,27 +46,30 @@ struct key_data
 };
 
 int
-memtx_tree_compare(const tuple *a, const tuple *b, struct index_def *index_def)
+memtx_tree_compare(memtx_tuple_handle_t a, memtx_tuple_handle_t b,
+		   struct index_def *index_def)
 {
-	int r = tuple_compare(a, b, &index_def->key_def);
+	int r = tuple_compare(memtx_tuple_by_handle(a),
+			      memtx_tuple_by_handle(b), &index_def->key_def);
 	if (r == 0 && !index_def->opts.is_unique)
 		r = a < b ? -1 : a > b;
 	return r;
 }
 
 int
-memtx_tree_compare_key(const tuple *a, const struct key_data *key_data,
+memtx_tree_compare_key(memtx_tuple_handle_t a,
+		       const struct key_data *key_data,
 		       struct index_def *index_def)
 {
-	return tuple_compare_with_key(a, key_data->key,
+	return tuple_compare_with_key(memtx_tuple_by_handle(a), key_data->key,
 				      key_data->part_count, &index_def->key_def);
 }
 
 int
 memtx_tree_qcompare(const void* a, const void *b, void *c)
 {
-	return memtx_tree_compare(*(struct tuple **)a,
-		*(struct tuple **)b, (struct index_def *)c);
+	return memtx_tree_compare(*(memtx_tuple_handle_t *)a,
+		*(memtx_tuple_handle_t *)b, (struct index_def *)c);
 }
 
 /* {{{ MemtxTree Iterators ****************************************/
@@ -105,29 +108,32 @@ static struct tuple *
 tree_iterator_fwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	memtx_tuple_handle_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return *res;
+	return memtx_tuple_by_handle(*res);
 }
 
 static struct tuple *
 tree_iterator_bwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	memtx_tuple_handle_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	return *res;
+	return memtx_tuple_by_handle(*res);
 }
 
 static struct tuple *
 tree_iterator_fwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	memtx_tuple_handle_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	if (memtx_tree_compare_key(*res, &it->key_data, it->index_def) != 0) {
@@ -135,19 +141,20 @@ tree_iterator_fwd_check_equality(struct iterator *iterator)
 		return 0;
 	}
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
-	return *res;
+	return memtx_tuple_by_handle(*res);
 }
 
 static struct tuple *
 tree_iterator_fwd_check_next_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	memtx_tuple_handle_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	memtx_tree_iterator_next(it->tree, &it->tree_iterator);
 	iterator->next = tree_iterator_fwd_check_equality;
-	return *res;
+	return memtx_tuple_by_handle(*res);
 }
 
 static struct tuple *
@@ -163,7 +170,8 @@ static struct tuple *
 tree_iterator_bwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
+	memtx_tuple_handle_t *res =
+		memtx_tree_iterator_get_elem(it->tree, &it->tree_iterator);
 	if (!res)
 		return 0;
 	if (memtx_tree_compare_key(*res, &it->key_data, it->index_def) != 0) {
@@ -171,7 +179,7 @@ tree_iterator_bwd_check_equality(struct iterator *iterator)
 		return 0;
 	}
 	memtx_tree_iterator_prev(it->tree, &it->tree_iterator);
-	return *res;
+	return memtx_tuple_by_handle(*res);
 }
 
 static struct tuple *
@@ -217,8 +225,8 @@ MemtxTree::bsize() const
 struct tuple *
 MemtxTree::random(uint32_t rnd) const
 {
-	struct tuple **res = memtx_tree_random(&tree, rnd);
-	return res ? *res : 0;
+	memtx_tuple_handle_t *res = memtx_tree_random(&tree, rnd);
+	return res ? memtx_tuple_by_handle(*res) : 0;
 }
 
 struct tuple *
@@ -229,8 +237,8 @@ MemtxTree::findByKey(const char *key, uint32_t part_count) const
 	struct key_data key_data;
 	key_data.key = key;
 	key_data.part_count = part_count;
-	struct tuple **res = memtx_tree_find(&tree, &key_data);
-	return res ? *res : 0;
+	memtx_tuple_handle_t *res = memtx_tree_find(&tree, &key_data);
+	return res ? memtx_tuple_by_handle(*res) : 0;
 }
 
 struct tuple *
@@ -240,22 +248,24 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	uint32_t errcode;
 
 	if (new_tuple) {
-		struct tuple *dup_tuple = NULL;
+		memtx_tuple_handle_t dup_handle = 0;
 
 		/* Try to optimistically replace the new_tuple. */
-		int tree_res =
-		memtx_tree_insert(&tree, new_tuple, &dup_tuple);
+		int tree_res = memtx_tree_insert(&tree,
+						 memtx_tuple_handle(new_tuple),
+						 &dup_handle);
 		if (tree_res) {
-			tnt_raise(OutOfMemory, BPS_TREE_EXTENT_SIZE,
+			tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE,
 				  "MemtxTree", "replace");
 		}
 
+		struct tuple *dup_tuple = memtx_tuple_by_handle(dup_handle);
 		errcode = replace_check_dup(old_tuple, dup_tuple, mode);
 
 		if (errcode) {
-			memtx_tree_delete(&tree, new_tuple);
+			memtx_tree_delete(&tree, memtx_tuple_handle(new_tuple));
 			if (dup_tuple)
-				memtx_tree_insert(&tree, dup_tuple, 0);
+				memtx_tree_insert(&tree, dup_handle, 0);
 			struct space *sp = space_cache_find(index_def->space_id);
 			tnt_raise(ClientError, errcode, index_name(this),
 				  space_name(sp));
@@ -264,7 +274,7 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 			return dup_tuple;
 	}
 	if (old_tuple) {
-		memtx_tree_delete(&tree, old_tuple);
+		memtx_tree_delete(&tree, memtx_tuple_handle(old_tuple));
 	}
 	return old_tuple;
 }
@@ -366,7 +376,7 @@ MemtxTree::reserve(uint32_t size_hint)
 {
 	if (size_hint < build_array_alloc_size)
 		return;
-	struct tuple **tmp = (struct tuple**)
+	memtx_tuple_handle_t *tmp = (memtx_tuple_handle_t *)
 		realloc(build_array, size_hint * sizeof(*tmp));
 	if (tmp == NULL)
 		tnt_raise(OutOfMemory, size_hint * sizeof(*tmp),
@@ -379,19 +389,20 @@ void
 MemtxTree::buildNext(struct tuple *tuple)
 {
 	if (build_array == NULL) {
-		build_array = (struct tuple**) malloc(BPS_TREE_EXTENT_SIZE);
+		build_array = (memtx_tuple_handle_t *)
+			malloc(MEMTX_EXTENT_SIZE);
 		if (build_array == NULL) {
-			tnt_raise(OutOfMemory, BPS_TREE_EXTENT_SIZE,
+			tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE,
 				"MemtxTree", "buildNext");
 		}
 		build_array_alloc_size =
-			BPS_TREE_EXTENT_SIZE / sizeof(struct tuple*);
+			MEMTX_EXTENT_SIZE / sizeof(*build_array);
 	}
 	assert(build_array_size <= build_array_alloc_size);
 	if (build_array_size == build_array_alloc_size) {
 		build_array_alloc_size = build_array_alloc_size +
 					 build_array_alloc_size / 2;
-		struct tuple **tmp = (struct tuple **)
+		memtx_tuple_handle_t *tmp = (memtx_tuple_handle_t *)
 			realloc(build_array, build_array_alloc_size *
 				sizeof(*tmp));
 		if (tmp == NULL) {
@@ -400,13 +411,14 @@ MemtxTree::buildNext(struct tuple *tuple)
 		}
 		build_array = tmp;
 	}
-	build_array[build_array_size++] = tuple;
+	build_array[build_array_size++] = memtx_tuple_handle(tuple);
 }
 
 void
 MemtxTree::endBuild()
 {
-	qsort_arg(build_array, build_array_size, sizeof(struct tuple *), memtx_tree_qcompare, index_def);
+	qsort_arg(build_array, build_array_size, sizeof(*build_array),
+		  memtx_tree_qcompare, index_def);
 	memtx_tree_build(&tree, build_array, build_array_size);
 
 	free(build_array);
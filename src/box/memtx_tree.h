@@ -33,27 +33,39 @@
 
 #include "memtx_index.h"
 #include "memtx_engine.h"
+#include "memtx_tuple.h"
 
 struct tuple;
 struct key_data;
 
 int
-memtx_tree_compare(const struct tuple *a, const struct tuple *b, struct index_def *index_def);
+memtx_tree_compare(memtx_tuple_handle_t a, memtx_tuple_handle_t b,
+		   struct index_def *index_def);
 
 int
-memtx_tree_compare_key(const tuple *a, const key_data *b, struct index_def *index_def);
+memtx_tree_compare_key(memtx_tuple_handle_t a, const key_data *b,
+		       struct index_def *index_def);
 
 #define BPS_TREE_NAME memtx_tree
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
 #define BPS_TREE_COMPARE(a, b, arg) memtx_tree_compare(a, b, arg)
 #define BPS_TREE_COMPARE_KEY(a, b, arg) memtx_tree_compare_key(a, b, arg)
-#define bps_tree_elem_t struct tuple *
+#define bps_tree_elem_t memtx_tuple_handle_t
 #define bps_tree_key_t struct key_data *
 #define bps_tree_arg_t struct index_def *
 
 #include "salad/bps_tree.h"
 
+#undef BPS_TREE_NAME
+#undef BPS_TREE_BLOCK_SIZE
+#undef BPS_TREE_EXTENT_SIZE
+#undef BPS_TREE_COMPARE
+#undef BPS_TREE_COMPARE_KEY
+#undef bps_tree_elem_t
+#undef bps_tree_key_t
+#undef bps_tree_arg_t
+
 class MemtxTree: public MemtxIndex {
 public:
 	MemtxTree(struct index_def *index_def);
@@ -91,7 +103,7 @@ public:
 
 // protected:
 	struct memtx_tree tree;
-	struct tuple **build_array;
+	memtx_tuple_handle_t *build_array;
 	size_t build_array_size, build_array_alloc_size;
 };
 
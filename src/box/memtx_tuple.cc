@@ -35,7 +35,11 @@
 #include "small/region.h"
 #include "small/quota.h"
 #include "fiber.h"
+#include "memory.h"
+#include "txn.h"
 #include "box.h"
+#include "memtx_spill.h"
+#include "assoc.h"
 
 struct memtx_tuple {
 	/*
@@ -43,14 +47,36 @@ struct memtx_tuple {
 	 * to store a free list pointer in smfree_delayed.
 	 * Please don't change it without understanding
 	 * how smfree_delayed and snapshotting COW works.
+	 * A garbage list of a checkpoint keeps the flags,
+	 * which are the lowest bits, @sa memtx_garbage_tuple.
 	 */
+	/**
+	 * Set on every read of the tuple and cleared by the
+	 * eviction clock, @sa memtx_tuple_age().
+	 */
+	uint32_t is_accessed:1;
+	/**
+	 * The tuple is a stub of an evicted tuple: it has only
+	 * indexed fields and is followed by a memtx_spill_ref.
+	 */
+	uint32_t is_evicted:1;
 	/** Snapshot generation version. */
-	uint32_t version;
+	uint32_t version:30;
 	struct tuple base;
 };
 
-/** Memtx slab arena */
-extern struct slab_arena memtx_arena; /* defined in memtx_engine.cc */
+enum {
+	/** Versions wrap around to fit memtx_tuple::version. */
+	MEMTX_TUPLE_VERSION_MASK = (1U << 30) - 1,
+	/** Bits of memtx_tuple flags in its first word. */
+	MEMTX_TUPLE_FLAG_MASK = 3,
+};
+
+#if defined(ENABLE_MEMTX_COMPACT_HANDLES)
+static_assert(offsetof(struct memtx_tuple, base) == MEMTX_TUPLE_BASE_OFFSET,
+	      "memtx_tuple_handle() must know where struct tuple is");
+#endif
+
 /* Memtx slab_cache for tuples */
 static struct slab_cache memtx_slab_cache;
 /** Common quota for memtx tuples and indexes */
@@ -60,6 +86,40 @@ struct small_alloc memtx_alloc; /* used box box.slab.info() */
 
 uint32_t snapshot_version;
 
+struct memtx_defrag_stat memtx_defrag_stat;
+
+struct memtx_snapshot_stat memtx_snapshot_stat;
+
+/**
+ * A freed tuple in a garbage list. The link takes the first
+ * 8 bytes of the tuple, as the delayed free list does, and
+ * keeps the tuple flags in its low bits, which are 0 in a
+ * tuple address. The rest of the tuple is intact: the
+ * checkpoint may still be reading it.
+ */
+struct memtx_garbage_tuple {
+	/** Address of the next tuple | flags of this one. */
+	uintptr_t next;
+};
+
+/** Garbage lists of the running checkpoint, by space id. */
+static struct mh_i32ptr_t *snapshot_garbage;
+
+/** A size class of the tuple allocator, for defragmentation. */
+struct memtx_defrag_class {
+	/** Size of objects of the class. */
+	uint32_t objsize;
+	/** Mask of the address of the slab an object is in. */
+	uintptr_t slab_mask;
+	/** True if the class is used below the threshold. */
+	bool is_sparse;
+};
+
+/** Size classes, sorted by object size. */
+static struct memtx_defrag_class *defrag_classes;
+static uint32_t defrag_class_count;
+static uint32_t defrag_class_capacity;
+
 enum {
 	/** Lowest allowed slab_alloc_minimal */
 	OBJSIZE_MIN = 16,
@@ -71,7 +131,8 @@ enum {
 
 void
 memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 uint32_t objsize_max, float alloc_factor)
+		 uint32_t objsize_max, float alloc_factor,
+		 uint32_t huge_page_size, int numa_node)
 {
 	/* Apply lowest allowed objsize bounds */
 	if (objsize_min < OBJSIZE_MIN)
@@ -89,6 +150,14 @@ memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
 	 * have accurate value of quota_used_ratio
 	 */
 	size_t prealloc = small_align(tuple_arena_max_size, slab_size);
+#if defined(ENABLE_MEMTX_COMPACT_HANDLES)
+	if (prealloc > ((uint64_t) UINT32_MAX << MEMTX_TUPLE_HANDLE_SHIFT)) {
+		panic("'memtx_memory' must not exceed %llu bytes with "
+		      "compact tuple handles",
+		      (unsigned long long) UINT32_MAX <<
+		      MEMTX_TUPLE_HANDLE_SHIFT);
+	}
+#endif
 	/** Preallocate entire quota. */
 	quota_init(&memtx_quota, prealloc);
 
@@ -106,6 +175,33 @@ memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
 				       prealloc);
 		}
 	}
+	/*
+	 * The arena is not touched yet, so it can be remapped
+	 * with huge pages. The memory policy is set last since
+	 * it is lost on remap.
+	 */
+	if (huge_page_size != 0 &&
+	    memory_use_huge_pages(memtx_arena.arena, memtx_arena.prealloc,
+				  huge_page_size) != 0) {
+		say_syserror("failed to map %u bytes huge pages for tuple "
+			     "arena, falling back to transparent huge pages",
+			     huge_page_size);
+	}
+	if (numa_node >= 0 &&
+	    memory_bind_numa_node(memtx_arena.arena, memtx_arena.prealloc,
+				  numa_node) != 0) {
+		say_syserror("failed to bind tuple arena to NUMA node %d",
+			     numa_node);
+	}
+#ifndef NDEBUG
+	struct memtx_tuple probe;
+	memset(&probe, 0, sizeof(probe));
+	probe.is_accessed = true;
+	probe.is_evicted = true;
+	uint32_t flags;
+	memcpy(&flags, &probe, sizeof(flags));
+	assert(flags == MEMTX_TUPLE_FLAG_MASK);
+#endif
 	slab_cache_create(&memtx_slab_cache, &memtx_arena);
 	small_alloc_create(&memtx_alloc, &memtx_slab_cache,
 			   objsize_min, alloc_factor);
@@ -114,10 +210,62 @@ memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
 void
 memtx_tuple_free(void)
 {
+	free(defrag_classes);
+	if (snapshot_garbage != NULL)
+		mh_i32ptr_delete(snapshot_garbage);
+}
+
+/** Allocation size of a tuple. */
+static inline size_t
+memtx_tuple_size(struct tuple_format *format,
+		 const struct memtx_tuple *memtx_tuple)
+{
+	size_t total = sizeof(struct memtx_tuple) +
+		       tuple_format_meta_size(format) + memtx_tuple->base.bsize;
+	if (memtx_tuple->is_evicted)
+		total += sizeof(struct memtx_spill_ref);
+	return total;
+}
+
+/**
+ * Allocation size of a tuple in a garbage list. Its format id
+ * is overwritten by the link, but data_offset includes the
+ * size of the format meta.
+ */
+static inline size_t
+memtx_garbage_tuple_size(const struct memtx_tuple *memtx_tuple)
+{
+	size_t total = sizeof(struct memtx_tuple) - sizeof(struct tuple) +
+		       memtx_tuple->base.data_offset + memtx_tuple->base.bsize;
+	if (memtx_tuple->is_evicted)
+		total += sizeof(struct memtx_spill_ref);
+	return total;
+}
+
+/** Load the body of an evicted tuple, mark others as accessed. */
+static struct tuple *
+memtx_tuple_fetch(struct tuple_format *format, struct tuple *tuple)
+{
+	struct memtx_tuple *memtx_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	if (likely(!memtx_tuple->is_evicted)) {
+		/* Don't dirty the cache line of a hot tuple. */
+		if (!memtx_tuple->is_accessed)
+			memtx_tuple->is_accessed = true;
+		return tuple;
+	}
+	struct memtx_spill_ref ref;
+	memcpy(&ref, tuple_data(tuple) + tuple->bsize, sizeof(ref));
+	/*
+	 * A yield would abort the transaction in progress, so
+	 * its reads block the tx thread.
+	 */
+	return memtx_spill_load(format, tuple, &ref, in_txn() == NULL);
 }
 
 struct tuple_format_vtab memtx_tuple_format_vtab = {
 	memtx_tuple_delete,
+	memtx_tuple_fetch,
 };
 
 struct tuple *
@@ -156,6 +304,9 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	struct tuple *tuple = &memtx_tuple->base;
 	tuple->refs = 0;
 	memtx_tuple->version = snapshot_version;
+	/* A new tuple is not evicted until the clock passes it. */
+	memtx_tuple->is_accessed = true;
+	memtx_tuple->is_evicted = false;
 	assert(tuple_len <= UINT32_MAX); /* bsize is UINT32_MAX */
 	tuple->bsize = tuple_len;
 	tuple->format_id = tuple_format_id(format);
@@ -182,22 +333,302 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 {
 	say_debug("%s(%p)", __func__, tuple);
 	assert(tuple->refs == 0);
-	size_t total = sizeof(struct memtx_tuple) +
-		       tuple_format_meta_size(format) + tuple->bsize;
-	tuple_format_ref(format, -1);
 	struct memtx_tuple *memtx_tuple =
 		container_of(tuple, struct memtx_tuple, base);
+	size_t total = memtx_tuple_size(format, memtx_tuple);
+	if (memtx_tuple->is_evicted) {
+		struct memtx_spill_ref ref;
+		memcpy(&ref, tuple_data(tuple) + tuple->bsize, sizeof(ref));
+		memtx_spill_drop(&ref);
+	}
+	/* The format may be deleted with its last tuple. */
+	uint32_t space_id = format->space_id;
+	tuple_format_ref(format, -1);
 	if (!memtx_alloc.is_delayed_free_mode ||
-	    memtx_tuple->version == snapshot_version)
+	    memtx_tuple->version == snapshot_version) {
 		smfree(&memtx_alloc, memtx_tuple, total);
-	else
+		return;
+	}
+	struct memtx_snapshot_garbage *garbage = NULL;
+	if (snapshot_garbage != NULL) {
+		mh_int_t k = mh_i32ptr_find(snapshot_garbage, space_id,
+					    NULL);
+		if (k != mh_end(snapshot_garbage)) {
+			garbage = (struct memtx_snapshot_garbage *)
+				mh_i32ptr_node(snapshot_garbage, k)->val;
+		}
+	}
+	if (garbage != NULL && garbage->is_released) {
+		smfree(&memtx_alloc, memtx_tuple, total);
+		memtx_snapshot_stat.released_size += total;
+		return;
+	}
+	if (garbage == NULL) {
 		smfree_delayed(&memtx_alloc, memtx_tuple, total);
+	} else {
+		struct memtx_garbage_tuple *node =
+			(struct memtx_garbage_tuple *) memtx_tuple;
+		assert(((uintptr_t) garbage->head &
+			MEMTX_TUPLE_FLAG_MASK) == 0);
+		node->next = (uintptr_t) garbage->head |
+			     (node->next & MEMTX_TUPLE_FLAG_MASK);
+		garbage->head = node;
+		garbage->size += total;
+	}
+	memtx_snapshot_stat.garbage_size += total;
+	if (memtx_snapshot_stat.garbage_size >
+	    memtx_snapshot_stat.garbage_size_max) {
+		memtx_snapshot_stat.garbage_size_max =
+			memtx_snapshot_stat.garbage_size;
+	}
+}
+
+static int
+memtx_defrag_class_cb(const struct mempool_stats *stats, void *cb_ctx)
+{
+	double threshold = *(double *) cb_ctx;
+	if (stats->slabcount == 0)
+		return 0;
+	if (defrag_class_count == defrag_class_capacity) {
+		uint32_t capacity = MAX(defrag_class_capacity * 2, 64);
+		struct memtx_defrag_class *classes = (struct memtx_defrag_class *)
+			realloc(defrag_classes, capacity * sizeof(*classes));
+		/* The class is just not defragmented. */
+		if (classes == NULL)
+			return 0;
+		defrag_classes = classes;
+		defrag_class_capacity = capacity;
+	}
+	struct memtx_defrag_class *cls = &defrag_classes[defrag_class_count++];
+	cls->objsize = stats->objsize;
+	cls->slab_mask = ~((uintptr_t) stats->slabsize - 1);
+	/* A single slab can't be freed by moving objects out of it. */
+	cls->is_sparse = stats->slabcount > 1 &&
+		stats->totals.used < threshold * stats->totals.total;
+	return 0;
+}
+
+static int
+memtx_defrag_class_cmp(const void *a, const void *b)
+{
+	uint32_t objsize_a = ((const struct memtx_defrag_class *) a)->objsize;
+	uint32_t objsize_b = ((const struct memtx_defrag_class *) b)->objsize;
+	return objsize_a < objsize_b ? -1 : objsize_a > objsize_b;
+}
+
+uint32_t
+memtx_tuple_defrag_check(double threshold)
+{
+	defrag_class_count = 0;
+	struct small_stats totals;
+	small_stats(&memtx_alloc, &totals, memtx_defrag_class_cb, &threshold);
+	qsort(defrag_classes, defrag_class_count, sizeof(*defrag_classes),
+	      memtx_defrag_class_cmp);
+	uint32_t sparse_count = 0;
+	for (uint32_t i = 0; i < defrag_class_count; i++)
+		sparse_count += defrag_classes[i].is_sparse;
+	return sparse_count;
+}
+
+/** Find the class of an object: the smallest one it fits. */
+static const struct memtx_defrag_class *
+memtx_defrag_class_find(size_t size)
+{
+	uint32_t begin = 0, end = defrag_class_count;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (defrag_classes[mid].objsize < size)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin < defrag_class_count ? &defrag_classes[begin] : NULL;
+}
+
+struct tuple *
+memtx_tuple_move(struct tuple *tuple)
+{
+	/* The old tuple would not be freed. */
+	if (memtx_alloc.is_delayed_free_mode)
+		return NULL;
+	struct tuple_format *format = tuple_format(tuple);
+	struct memtx_tuple *old_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	size_t total = memtx_tuple_size(format, old_tuple);
+	const struct memtx_defrag_class *cls = memtx_defrag_class_find(total);
+	if (cls == NULL || !cls->is_sparse)
+		return NULL;
+	struct memtx_tuple *new_tuple =
+		(struct memtx_tuple *) smalloc(&memtx_alloc, total);
+	if (new_tuple == NULL)
+		return NULL;
+	/*
+	 * The allocator takes a free object from the lowest slab
+	 * of the class, so an object which is not moved to
+	 * a lower slab is in a dense part of the class already.
+	 */
+	if (((uintptr_t) new_tuple & cls->slab_mask) >=
+	    ((uintptr_t) old_tuple & cls->slab_mask)) {
+		smfree(&memtx_alloc, new_tuple, total);
+		return NULL;
+	}
+	memcpy(new_tuple, old_tuple, total);
+	new_tuple->version = snapshot_version;
+	new_tuple->base.refs = 0;
+	tuple_format_ref(format, 1);
+	return &new_tuple->base;
+}
+
+bool
+memtx_tuple_age(struct tuple *tuple)
+{
+	struct memtx_tuple *memtx_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	if (memtx_tuple->is_evicted)
+		return false;
+	bool is_cold = !memtx_tuple->is_accessed;
+	memtx_tuple->is_accessed = false;
+	return is_cold;
+}
+
+/** Copy a stub with another reference to the body. */
+static struct tuple *
+memtx_tuple_copy_stub(struct tuple_format *format,
+		      struct memtx_tuple *memtx_tuple,
+		      const struct memtx_spill_ref *ref)
+{
+	size_t total = memtx_tuple_size(format, memtx_tuple);
+	struct memtx_tuple *stub =
+		(struct memtx_tuple *) smalloc(&memtx_alloc, total);
+	if (stub == NULL) {
+		diag_set(OutOfMemory, total, "slab allocator", "memtx_tuple");
+		return NULL;
+	}
+	memcpy(stub, memtx_tuple, total);
+	stub->version = snapshot_version;
+	stub->is_accessed = false;
+	stub->base.refs = 0;
+	tuple_format_ref(format, 1);
+	memcpy((char *) tuple_data(&stub->base) + stub->base.bsize, ref,
+	       sizeof(*ref));
+	return &stub->base;
+}
+
+struct tuple *
+memtx_tuple_evict(struct tuple *tuple, const struct memtx_spill_ref *ref)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	struct memtx_tuple *memtx_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	if (memtx_tuple->is_evicted)
+		return memtx_tuple_copy_stub(format, memtx_tuple, ref);
+	/*
+	 * The stub keeps indexed fields, so that it is found and
+	 * compared as the tuple, and nil in place of the others.
+	 */
+	uint32_t field_count = format->field_count;
+	uint32_t bsize = mp_sizeof_array(field_count);
+	for (uint32_t i = 0; i < field_count; i++) {
+		if (format->fields[i].type == FIELD_TYPE_ANY) {
+			bsize += mp_sizeof_nil();
+			continue;
+		}
+		const char *field = tuple_field(tuple, i);
+		const char *field_end = field;
+		mp_next(&field_end);
+		bsize += field_end - field;
+	}
+	size_t meta_size = tuple_format_meta_size(format);
+	size_t total = sizeof(struct memtx_tuple) + meta_size + bsize +
+		       sizeof(struct memtx_spill_ref);
+	if (total >= memtx_tuple_size(format, memtx_tuple))
+		return NULL;
+	struct memtx_tuple *stub =
+		(struct memtx_tuple *) smalloc(&memtx_alloc, total);
+	if (stub == NULL) {
+		diag_set(OutOfMemory, total, "slab allocator", "memtx_tuple");
+		return NULL;
+	}
+	stub->version = snapshot_version;
+	stub->is_accessed = false;
+	stub->is_evicted = true;
+	stub->base.refs = 0;
+	stub->base.format_id = tuple->format_id;
+	stub->base.bsize = bsize;
+	stub->base.data_offset = sizeof(struct tuple) + meta_size;
+	tuple_format_ref(format, 1);
+	char *raw = (char *) &stub->base + stub->base.data_offset;
+	char *pos = mp_encode_array(raw, field_count);
+	for (uint32_t i = 0; i < field_count; i++) {
+		if (format->fields[i].type == FIELD_TYPE_ANY) {
+			pos = mp_encode_nil(pos);
+			continue;
+		}
+		const char *field = tuple_field(tuple, i);
+		const char *field_end = field;
+		mp_next(&field_end);
+		memcpy(pos, field, field_end - field);
+		pos += field_end - field;
+	}
+	assert(pos == raw + bsize);
+	if (tuple_init_field_map(format, (uint32_t *) raw, raw) != 0) {
+		/* The body is not referenced by the stub yet. */
+		tuple_format_ref(format, -1);
+		smfree(&memtx_alloc, stub, total);
+		return NULL;
+	}
+	assert(ref->bsize == tuple->bsize);
+	memcpy(pos, ref, sizeof(*ref));
+	return &stub->base;
+}
+
+struct tuple *
+memtx_tuple_load(struct tuple *tuple)
+{
+	struct memtx_tuple *memtx_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	if (!memtx_tuple->is_evicted)
+		return tuple;
+	struct memtx_spill_ref ref;
+	memcpy(&ref, tuple_data(tuple) + tuple->bsize, sizeof(ref));
+	return memtx_spill_load(tuple_format(tuple), tuple, &ref, true);
+}
+
+bool
+memtx_tuple_has_fields(const struct tuple *tuple,
+		       const struct tuple_format *format)
+{
+	const struct memtx_tuple *memtx_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	if (!memtx_tuple->is_evicted)
+		return true;
+	const struct tuple_format *stub_format = tuple_format(tuple);
+	for (uint32_t i = 0; i < format->field_count; i++) {
+		if (format->fields[i].type == FIELD_TYPE_ANY)
+			continue;
+		if (i >= stub_format->field_count ||
+		    stub_format->fields[i].type == FIELD_TYPE_ANY)
+			return false;
+	}
+	return true;
+}
+
+bool
+memtx_tuple_spill_ref(const struct tuple *tuple, struct memtx_spill_ref *ref)
+{
+	const struct memtx_tuple *memtx_tuple =
+		container_of(tuple, struct memtx_tuple, base);
+	if (!memtx_tuple->is_evicted)
+		return false;
+	memcpy(ref, tuple_data(tuple) + tuple->bsize, sizeof(*ref));
+	return true;
 }
 
 void
 memtx_tuple_begin_snapshot()
 {
-	snapshot_version++;
+	snapshot_version = (snapshot_version + 1) & MEMTX_TUPLE_VERSION_MASK;
+	memset(&memtx_snapshot_stat, 0, sizeof(memtx_snapshot_stat));
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, true);
 }
 
@@ -205,6 +636,60 @@ void
 memtx_tuple_end_snapshot()
 {
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, false);
+	if (snapshot_garbage != NULL) {
+		mh_i32ptr_delete(snapshot_garbage);
+		snapshot_garbage = NULL;
+	}
+	memtx_snapshot_stat.garbage_size = 0;
+}
+
+int
+memtx_tuple_snapshot_track(uint32_t space_id,
+			   struct memtx_snapshot_garbage *garbage)
+{
+	garbage->head = NULL;
+	garbage->size = 0;
+	garbage->is_released = false;
+	if (snapshot_garbage == NULL) {
+		snapshot_garbage = mh_i32ptr_new();
+		if (snapshot_garbage == NULL) {
+			diag_set(OutOfMemory, sizeof(*snapshot_garbage),
+				 "mh_i32ptr_new", "snapshot_garbage");
+			return -1;
+		}
+	}
+	const struct mh_i32ptr_node_t node = { space_id, garbage };
+	if (mh_i32ptr_put(snapshot_garbage, &node, NULL, NULL) ==
+	    mh_end(snapshot_garbage)) {
+		diag_set(OutOfMemory, sizeof(node), "mh_i32ptr_put",
+			 "snapshot_garbage");
+		return -1;
+	}
+	return 0;
+}
+
+void
+memtx_tuple_snapshot_release(struct memtx_snapshot_garbage *garbage)
+{
+	struct memtx_tuple *memtx_tuple =
+		(struct memtx_tuple *) garbage->head;
+	while (memtx_tuple != NULL) {
+		struct memtx_garbage_tuple *node =
+			(struct memtx_garbage_tuple *) memtx_tuple;
+		struct memtx_tuple *next = (struct memtx_tuple *)
+			(node->next & ~(uintptr_t) MEMTX_TUPLE_FLAG_MASK);
+		smfree(&memtx_alloc, memtx_tuple,
+		       memtx_garbage_tuple_size(memtx_tuple));
+		memtx_tuple = next;
+	}
+	/* The stat is reset if the checkpoint is over already. */
+	if (memtx_alloc.is_delayed_free_mode) {
+		memtx_snapshot_stat.garbage_size -= garbage->size;
+		memtx_snapshot_stat.released_size += garbage->size;
+	}
+	garbage->head = NULL;
+	garbage->size = 0;
+	garbage->is_released = true;
 }
 
 box_tuple_t *
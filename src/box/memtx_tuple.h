@@ -31,9 +31,11 @@
  * SUCH DAMAGE.
  */
 
+#include "trivia/config.h"
 #include "diag.h"
 #include "tuple_format.h"
 #include "tuple.h"
+#include "small/slab_arena.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -41,10 +43,15 @@ extern "C" {
 
 /**
  * Initialize memtx_tuple library
+ *
+ * The arena shared by tuples and index extents is backed with
+ * huge pages of huge_page_size bytes unless it is 0, and bound
+ * to NUMA node numa_node unless it is negative.
  */
 void
 memtx_tuple_init(uint64_t tuple_arena_max_size, uint32_t objsize_min,
-		 uint32_t objsize_max, float alloc_factor);
+		 uint32_t objsize_max, float alloc_factor,
+		 uint32_t huge_page_size, int numa_node);
 
 /**
  * Cleanup memtx_tuple library
@@ -66,12 +73,214 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple);
 /** tuple format vtab for memtx engine. */
 extern struct tuple_format_vtab memtx_tuple_format_vtab;
 
+/** Memtx slab arena, shared by tuples and index extents. */
+extern struct slab_arena memtx_arena; /* defined in memtx_engine.cc */
+
+#if defined(ENABLE_MEMTX_COMPACT_HANDLES)
+
+enum {
+	/**
+	 * Tuples are allocated at 8-byte boundaries, so a handle
+	 * addresses up to 32 GB of the arena.
+	 */
+	MEMTX_TUPLE_HANDLE_SHIFT = 3,
+	/** Offset of struct tuple in a memtx tuple allocation. */
+	MEMTX_TUPLE_BASE_OFFSET = sizeof(uint32_t),
+};
+
+/**
+ * A reference to a memtx tuple stored in index nodes: the
+ * offset of the tuple allocation in the arena, in 8-byte
+ * units. It takes half the size of a pointer. 0 stands for
+ * NULL: the arena begins with a slab header, not a tuple.
+ */
+typedef uint32_t memtx_tuple_handle_t;
+
+static inline memtx_tuple_handle_t
+memtx_tuple_handle(struct tuple *tuple)
+{
+	if (tuple == NULL)
+		return 0;
+	size_t offset = (char *) tuple - MEMTX_TUPLE_BASE_OFFSET -
+			(char *) memtx_arena.arena;
+	assert(offset % (1 << MEMTX_TUPLE_HANDLE_SHIFT) == 0);
+	assert((offset >> MEMTX_TUPLE_HANDLE_SHIFT) <= UINT32_MAX);
+	return offset >> MEMTX_TUPLE_HANDLE_SHIFT;
+}
+
+static inline struct tuple *
+memtx_tuple_by_handle(memtx_tuple_handle_t handle)
+{
+	if (handle == 0)
+		return NULL;
+	return (struct tuple *) ((char *) memtx_arena.arena +
+				 ((size_t) handle << MEMTX_TUPLE_HANDLE_SHIFT) +
+				 MEMTX_TUPLE_BASE_OFFSET);
+}
+
+#else /* !defined(ENABLE_MEMTX_COMPACT_HANDLES) */
+
+typedef struct tuple *memtx_tuple_handle_t;
+
+static inline memtx_tuple_handle_t
+memtx_tuple_handle(struct tuple *tuple)
+{
+	return tuple;
+}
+
+static inline struct tuple *
+memtx_tuple_by_handle(memtx_tuple_handle_t handle)
+{
+	return handle;
+}
+
+#endif /* defined(ENABLE_MEMTX_COMPACT_HANDLES) */
+
+/** Statistics of the tuple arena defragmentation. */
+struct memtx_defrag_stat {
+	/** The number of passes over all spaces. */
+	uint64_t pass_count;
+	/** The number of tuples moved to lower slabs. */
+	uint64_t moved_count;
+	/** The total MessagePack size of the moved tuples. */
+	uint64_t moved_size;
+};
+
+extern struct memtx_defrag_stat memtx_defrag_stat;
+
+/**
+ * Find out the size classes of the tuple allocator which are
+ * used below the threshold (0..1), for memtx_tuple_move().
+ * @return the number of such classes
+ */
+uint32_t
+memtx_tuple_defrag_check(double threshold);
+
+/**
+ * Copy a tuple of a sparse size class to a lower slab, so
+ * that the slabs at the end of the class are emptied and
+ * returned to the arena. The copy has no references, the
+ * caller replaces the tuple with it in all indexes.
+ * @retval NULL the tuple stays where it is
+ */
+struct tuple *
+memtx_tuple_move(struct tuple *tuple);
+
+/** Where the body of an evicted tuple is in the spill files. */
+struct memtx_spill_ref {
+	/** Offset of the MessagePack body in the file. */
+	uint64_t offset:63;
+	/** Which of the two spill files has the body. */
+	uint64_t file_no:1;
+	/** Size of the body. */
+	uint32_t bsize;
+	/** The space the tuple was evicted from. */
+	uint32_t space_id;
+};
+
+/**
+ * Advance the eviction clock over a tuple: clear its access
+ * bit, which is set by tuple_fetch().
+ * @retval true the tuple hasn't been read since the previous
+ *         call and is not evicted yet
+ */
+bool
+memtx_tuple_age(struct tuple *tuple);
+
+/**
+ * Create a stub of a tuple whose body has been written to the
+ * spill file. The stub has the indexed fields of the tuple, so
+ * the caller replaces the tuple with it in all indexes. The
+ * body is loaded back by tuple_fetch(). A stub of a body which
+ * is copied to another file is copied with the new reference.
+ * @retval NULL the stub is not smaller than the tuple or out
+ *         of memory
+ */
+struct tuple *
+memtx_tuple_evict(struct tuple *tuple, const struct memtx_spill_ref *ref);
+
+/**
+ * Load the body of an evicted tuple like tuple_fetch() does,
+ * but in a coio thread even if there is a transaction, for
+ * a scan which can be resumed after a yield.
+ * @retval the tuple itself if it is not evicted
+ * @retval NULL on error, check diag
+ */
+struct tuple *
+memtx_tuple_load(struct tuple *tuple);
+
+/**
+ * Check if a tuple has all the fields indexed in a format.
+ * A stub of an evicted tuple has only the fields indexed in
+ * its own format, which may lack those of a new index.
+ */
+bool
+memtx_tuple_has_fields(const struct tuple *tuple,
+		       const struct tuple_format *format);
+
+/**
+ * Find out where the body of an evicted tuple is.
+ * @retval false the tuple is not evicted
+ */
+bool
+memtx_tuple_spill_ref(const struct tuple *tuple, struct memtx_spill_ref *ref);
+
 void
 memtx_tuple_begin_snapshot();
 
 void
 memtx_tuple_end_snapshot();
 
+/**
+ * Tuples of one space freed while a checkpoint is in progress.
+ * They are kept until the checkpoint writes the space rather
+ * than until it ends.
+ */
+struct memtx_snapshot_garbage {
+	/** Freed tuples, linked through their headers. */
+	void *head;
+	/** Total size of the freed tuples. */
+	size_t size;
+	/** True if the space is written, tuples are freed at once. */
+	bool is_released;
+};
+
+/** Statistics of memory kept by the running checkpoint. */
+struct memtx_snapshot_stat {
+	/** Size of freed tuples kept for the checkpoint. */
+	size_t garbage_size;
+	/** Peak of garbage_size during the checkpoint. */
+	size_t garbage_size_max;
+	/**
+	 * Size of tuples freed before the checkpoint end since
+	 * their spaces had been written already.
+	 */
+	size_t released_size;
+};
+
+extern struct memtx_snapshot_stat memtx_snapshot_stat;
+
+/**
+ * Keep tuples of the space freed during the running
+ * checkpoint in the garbage list instead of the allocator
+ * delayed free list. Tuples of all formats the space has
+ * had are tracked, @sa tuple_format::space_id. Tuples of
+ * spaces not tracked are kept till the checkpoint end.
+ *
+ * @retval  0 success.
+ * @retval -1 out of memory, diag is set.
+ */
+int
+memtx_tuple_snapshot_track(uint32_t space_id,
+			   struct memtx_snapshot_garbage *garbage);
+
+/**
+ * Free tuples of the garbage list, and free tuples added to it
+ * later at once: the checkpoint does not need them anymore.
+ */
+void
+memtx_tuple_snapshot_release(struct memtx_snapshot_garbage *garbage);
+
 /** \cond public */
 
 /**
@@ -116,6 +325,16 @@ memtx_tuple_new_xc(struct tuple_format *format, const char *data,
 	return res;
 }
 
+/** @copydoc memtx_tuple_load() */
+static inline struct tuple *
+memtx_tuple_load_xc(struct tuple *tuple)
+{
+	struct tuple *res = memtx_tuple_load(tuple);
+	if (res == NULL)
+		diag_raise();
+	return res;
+}
+
 #endif /* defined(__cplusplus) */
 
 #endif
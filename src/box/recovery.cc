@@ -36,6 +36,8 @@
 #include "xrow.h"
 #include "xstream.h"
 #include "wal.h" /* wal_watcher */
+#include "wal_tail.h"
+#include "small/ibuf.h"
 #include "replication.h"
 #include "session.h"
 #include "coeio_file.h"
@@ -174,6 +176,37 @@ recovery_exit(struct recovery *r)
 	recovery_delete(r);
 }
 
+/**
+ * Write the tx the cursor has just started to read to a stream
+ * as is, if none of its rows has been recovered yet. Otherwise
+ * the rows are filtered and written one by one.
+ * @retval true the tx is written, its rows are skipped
+ */
+static bool
+recover_xlog_tx(struct recovery *r, struct xstream *stream)
+{
+	const char *block, *rows;
+	size_t block_size, rows_size;
+	xlog_cursor_tx(&r->cursor, &block, &block_size, &rows, &rows_size);
+	struct vclock vclock;
+	vclock_copy(&vclock, &r->vclock);
+	const char *pos = rows, *end = rows + rows_size;
+	while (pos < end) {
+		struct xrow_header row;
+		/* A broken row fails when it's read on its own. */
+		if (xrow_header_decode(&row, &pos, end) != 0 ||
+		    row.lsn <= vclock_get(&vclock, row.replica_id))
+			return false;
+		vclock_follow(&vclock, row.replica_id, row.lsn);
+	}
+	if (! stream->write_tx(stream, block, block_size, rows, rows_size,
+			       &vclock))
+		return false;
+	vclock_copy(&r->vclock, &vclock);
+	xlog_cursor_skip_tx(&r->cursor);
+	return true;
+}
+
 /**
  * Read all rows in a file starting from the last position.
  * Advance the position. If end of file is reached,
@@ -187,8 +220,14 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 {
 	struct xrow_header row;
 	uint64_t row_count = 0;
-	while (xlog_cursor_next_xc(&r->cursor, &row,
-				   r->wal_dir.force_recovery) == 0) {
+	while (true) {
+		/*
+		 * A tx is offered to a stream which can take it
+		 * as a whole before its first row is recovered.
+		 */
+		bool is_tx_start = stream->write_tx != NULL &&
+				   stop_vclock == NULL &&
+				   xlog_cursor_tx_is_read(&r->cursor);
 		/*
 		 * Read the next row from xlog file.
 		 *
@@ -197,9 +236,14 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 		 * the file is fully read: it's fully read only
 		 * when EOF marker has been read, see i.eof_read
 		 */
+		if (xlog_cursor_next_xc(&r->cursor, &row,
+					r->wal_dir.force_recovery) != 0)
+			break;
 		if (stop_vclock != NULL &&
 		    r->vclock.signature >= stop_vclock->signature)
 			return;
+		if (is_tx_start && recover_xlog_tx(r, stream))
+			continue;
 		int64_t current_lsn = vclock_get(&r->vclock, row.replica_id);
 		if (row.lsn <= current_lsn)
 			continue; /* already applied, skip */
@@ -467,6 +511,78 @@ public:
 	}
 };
 
+/** Max size of rows copied from the WAL tail at once. */
+static const size_t WAL_TAIL_READ_MAX = 256 * 1024;
+
+/** State of reading rows from the in-memory WAL tail. */
+struct recovery_tail {
+	/** True if the cursor is positioned. */
+	bool is_open;
+	struct wal_tail_cursor cursor;
+	/** Rows copied from the tail. */
+	struct ibuf buf;
+};
+
+/**
+ * Read new rows from the in-memory WAL tail instead of xlog
+ * files, if the tail has all rows we have not read yet.
+ *
+ * @retval true  all new rows have been read
+ * @retval false the tail can not be used, read xlog files
+ */
+static bool
+recover_wal_tail(struct recovery *r, struct xstream *stream,
+		 struct recovery_tail *rt)
+{
+	struct wal_tail *tail = wal_tail();
+	if (tail == NULL)
+		return false;
+	if (! rt->is_open) {
+		if (wal_tail_cursor_create(tail, &rt->cursor,
+					   &r->vclock) != 0)
+			return false;
+		rt->is_open = true;
+		/* The position in files is kept by r->vclock. */
+		if (r->cursor.state != XLOG_CURSOR_CLOSED)
+			xlog_cursor_close(&r->cursor, false);
+		say_info("reading rows from the WAL tail in memory");
+	}
+	while (! fiber_is_cancelled()) {
+		ibuf_reset(&rt->buf);
+		int rc = wal_tail_read(tail, &rt->cursor, &rt->buf,
+				       WAL_TAIL_READ_MAX);
+		if (rc < 0)
+			diag_raise();
+		if (rc > 0) {
+			rt->is_open = false;
+			say_info("fell behind the WAL tail in memory, "
+				 "reading xlog files");
+			return false;
+		}
+		if (ibuf_used(&rt->buf) == 0)
+			break;
+		const char *pos = rt->buf.rpos;
+		const char *end = rt->buf.wpos;
+		while (pos < end) {
+			struct wal_tail_row tail_row;
+			memcpy(&tail_row, pos, sizeof(tail_row));
+			pos += sizeof(tail_row);
+			const char *row_end = pos + tail_row.size;
+			int64_t current_lsn = vclock_get(&r->vclock,
+							 tail_row.replica_id);
+			if (tail_row.lsn <= current_lsn) {
+				pos = row_end;
+				continue; /* already sent, skip */
+			}
+			struct xrow_header row;
+			xrow_header_decode_xc(&row, &pos, row_end);
+			vclock_follow(&r->vclock, row.replica_id, row.lsn);
+			xstream_write_xc(stream, &row);
+		}
+	}
+	return true;
+}
+
 static int
 recovery_follow_f(va_list ap)
 {
@@ -476,7 +592,21 @@ recovery_follow_f(va_list ap)
 
 	WalSubscription subscription(r->wal_dir.dirname);
 
+	struct recovery_tail rt;
+	rt.is_open = false;
+	ibuf_create(&rt.buf, cord_slab_cache(), WAL_TAIL_READ_MAX);
+	auto buf_guard = make_scoped_guard([&]{
+		ibuf_destroy(&rt.buf);
+	});
+
 	while (! fiber_is_cancelled()) {
+		/*
+		 * Rows which are still in memory are sent without
+		 * touching the disk, and the WAL watcher wakes us
+		 * up right after they are written.
+		 */
+		if (recover_wal_tail(r, stream, &rt))
+			goto wait;
 
 		/*
 		 * Recover until there is no new stuff which appeared in
@@ -514,7 +644,7 @@ recovery_follow_f(va_list ap)
 
 		subscription.set_log_path(r->cursor.state != XLOG_CURSOR_CLOSED ?
 					  r->cursor.name: NULL);
-
+wait:
 		if (subscription.signaled == false) {
 			/**
 			 * Allow an immediate wakeup/break loop
@@ -36,8 +36,11 @@
 #include "cfg.h"
 #include "errinj.h"
 #include "fiber.h"
+#include "histogram.h"
+#include "latch.h"
 #include "say.h"
 #include "scoped_guard.h"
+#include "small/ibuf.h"
 
 #include "coeio.h"
 #include "coio.h"
@@ -47,6 +50,7 @@
 #include "replication.h"
 #include "trigger.h"
 #include "vclock.h"
+#include "xlog.h"
 #include "xrow.h"
 #include "xrow_io.h"
 #include "xstream.h"
@@ -54,6 +58,17 @@
 /** Report relay status to tx thread at least once per this interval */
 static const int RELAY_REPORT_INTERVAL = 1;
 
+enum {
+	/**
+	 * Rows are compressed and sent when this many bytes
+	 * are accumulated, or when there are no more rows to
+	 * send at the moment.
+	 */
+	RELAY_TX_BLOCK_MAX = 128 * 1024,
+	/** Bytes to read acks from the replica socket with */
+	RELAY_ACK_READAHEAD = 1024,
+};
+
 /**
  * Cbus message to send status updates from relay to tx thread.
  */
@@ -64,6 +79,10 @@ struct relay_status_msg {
 	struct relay *relay;
 	/** New vclock */
 	struct vclock vclock;
+	/** New vclock acknowledged by the replica */
+	struct vclock ack_vclock;
+	/** Lag histograms to deliver to tx */
+	struct histogram *lag_hist[RELAY_STAGE_MAX];
 };
 
 /**
@@ -76,10 +95,42 @@ struct relay_exit_msg {
 	struct relay *relay;
 };
 
+/**
+ * A thread of the relay pool. Relays of subscribed replicas
+ * are fibers spread over a fixed number of such threads.
+ */
+struct relay_worker {
+	/** The thread. */
+	struct cord cord;
+	/** Name of the thread and of its cbus endpoint */
+	char name[FIBER_NAME_MAX];
+	/** A pipe from 'tx' thread to the worker */
+	struct cpipe pipe;
+	/** A pipe from the worker to 'tx' */
+	struct cpipe tx_pipe;
+	/** Number of relays running in the worker, used in tx */
+	int relay_count;
+};
+
+/** Relay pool, started on the first SUBSCRIBE. */
+static struct relay_worker *relay_workers;
+static int relay_worker_count;
+
 /** State of a replication relay. */
 struct relay {
-	/** The thread in which we relay data to the replica. */
+	/** The thread in which we relay data to the replica (JOIN). */
 	struct cord cord;
+	/** The pool thread running the relay (SUBSCRIBE). */
+	struct relay_worker *worker;
+	/** Starts the relay fiber in the worker thread. */
+	struct cbus_call_msg start_msg;
+	/**
+	 * The last message of the relay fiber, after it is
+	 * delivered the fiber no longer uses the relay.
+	 */
+	struct cmsg done_msg;
+	/** The error the relay fiber has stopped with. */
+	struct diag diag;
 	/** Replica connection */
 	struct ev_io io;
 	/** Request sync */
@@ -94,6 +145,61 @@ struct relay {
 	ev_tstamp wal_dir_rescan_delay;
 	/** Remote replica id */
 	uint32_t replica_id;
+	/** Name of the relay fiber and of its cbus endpoint */
+	char name[FIBER_NAME_MAX];
+	/** zstd level asked for by the replica, 0 if none */
+	uint32_t compression;
+	/**
+	 * Rows to be sent compressed in the next block.
+	 * Initial JOIN rows are appended from threads of
+	 * engines, so the buffers are malloc'ed rather than
+	 * taken from the slab cache of a cord.
+	 */
+	char *tx_rows;
+	/** Size of the rows in tx_rows */
+	size_t tx_rows_used;
+	/** Size of the memory allocated for tx_rows */
+	size_t tx_rows_capacity;
+	/** The block being sent */
+	char *tx_block;
+	/** Size of the memory allocated for tx_block */
+	size_t tx_block_capacity;
+	/** zstd context to compress blocks */
+	ZSTD_CCtx *zctx;
+	/** Serializes writes of blocks to the replica socket */
+	struct latch write_latch;
+	/** The fiber which flushes rows sent by recovery */
+	struct fiber *flusher;
+	/** Initial JOIN rows the replica already has */
+	uint64_t join_skip;
+	/** Bytes per second to send initial JOIN with, 0 if unlimited */
+	double rate_limit;
+	/** Bytes sent since throttle_time */
+	size_t unthrottled;
+	/** Time of the last throttling */
+	ev_tstamp throttle_time;
+	/**
+	 * Lag histograms per relay_stage, updated by the relay
+	 * fiber. NULL for JOIN.
+	 */
+	struct histogram *lag_hist[RELAY_STAGE_MAX];
+	/** Time the first row of tx_rows was read */
+	ev_tstamp tx_rows_time;
+	/**
+	 * Vclock of recovery as of the last row appended to
+	 * tx_rows or skipped. Recovery promotes its vclock
+	 * before it writes a row, so the vclock of recovery
+	 * itself may cover a row which is not appended yet.
+	 */
+	struct vclock tx_rows_vclock;
+	/** The last vclock acknowledged by the replica */
+	struct vclock ack_vclock;
+	/**
+	 * Vclock of the rows written to the replica socket.
+	 * Lags behind the vclock of recovery by the rows
+	 * waiting in tx_rows if the stream is compressed.
+	 */
+	struct vclock send_vclock;
 
 	/** Relay endpoint */
 	struct cbus_endpoint endpoint;
@@ -113,8 +219,16 @@ struct relay {
 		alignas(CACHELINE_SIZE)
 		/** Current vclock sent by relay */
 		struct vclock vclock;
+		/** Current vclock acknowledged by the replica */
+		struct vclock ack_vclock;
 		/** The condition is signaled at relay exit. */
 		struct ipc_cond exit_cond;
+		/** Lag histograms as of the last status update */
+		struct histogram *lag_hist[RELAY_STAGE_MAX];
+		/** Set when done_msg is delivered. */
+		bool is_done;
+		/** The condition is signaled when is_done is set. */
+		struct ipc_cond done_cond;
 	} tx;
 };
 
@@ -124,10 +238,56 @@ relay_vclock(const struct relay *relay)
 	return &relay->tx.vclock;
 }
 
+const struct vclock *
+relay_ack_vclock(const struct relay *relay)
+{
+	return &relay->tx.ack_vclock;
+}
+
+const struct histogram *
+relay_lag_hist(const struct relay *relay, enum relay_stage stage)
+{
+	return relay->tx.lag_hist[stage];
+}
+
+/** Create lag histograms of the relay, the message and tx. */
+static void
+relay_create_lag_hist(struct relay *relay)
+{
+	for (int i = 0; i < RELAY_STAGE_MAX; i++) {
+		relay->lag_hist[i] = replication_lag_histogram_new();
+		relay->status_msg.lag_hist[i] =
+			replication_lag_histogram_new();
+		relay->tx.lag_hist[i] = replication_lag_histogram_new();
+		if (relay->lag_hist[i] == NULL ||
+		    relay->status_msg.lag_hist[i] == NULL ||
+		    relay->tx.lag_hist[i] == NULL)
+			diag_raise();
+	}
+}
+
+static void
+relay_destroy_lag_hist(struct relay *relay)
+{
+	for (int i = 0; i < RELAY_STAGE_MAX; i++) {
+		if (relay->lag_hist[i] != NULL)
+			histogram_delete(relay->lag_hist[i]);
+		if (relay->status_msg.lag_hist[i] != NULL)
+			histogram_delete(relay->status_msg.lag_hist[i]);
+		if (relay->tx.lag_hist[i] != NULL)
+			histogram_delete(relay->tx.lag_hist[i]);
+	}
+}
+
 static void
 relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row);
 static void
 relay_send_row(struct xstream *stream, struct xrow_header *row);
+static void
+relay_flush(struct relay *relay);
+static bool
+relay_send_tx(struct xstream *stream, const char *block, size_t block_size,
+	      const char *rows, size_t rows_size, const struct vclock *vclock);
 
 static inline void
 relay_create(struct relay *relay, int fd, uint64_t sync,
@@ -145,32 +305,105 @@ relay_destroy(struct relay *relay)
 	(void) relay;
 }
 
+/**
+ * Set up compression of rows sent to the replica,
+ * relay->compression is the level to use.
+ */
+static void
+relay_create_compression(struct relay *relay)
+{
+	assert(relay->compression > 0);
+	relay->zctx = ZSTD_createCCtx();
+	if (relay->zctx == NULL) {
+		tnt_raise(OutOfMemory, sizeof(ZSTD_CCtx *),
+			  "ZSTD_createCCtx", "relay zctx");
+	}
+	latch_create(&relay->write_latch);
+}
+
+static void
+relay_destroy_compression(struct relay *relay)
+{
+	if (relay->zctx == NULL)
+		return;
+	ZSTD_freeCCtx(relay->zctx);
+	free(relay->tx_rows);
+	free(relay->tx_block);
+	latch_destroy(&relay->write_latch);
+}
+
+/** Set up compression and throttling of JOIN rows. */
+static void
+relay_create_join(struct relay *relay, uint32_t compression)
+{
+	/* The same units as snap_io_rate_limit: megabytes per second. */
+	relay->rate_limit = cfg_getd("replication_join_rate_limit") *
+			    1024 * 1024;
+	relay->throttle_time = ev_time();
+	relay->compression = MIN(compression, (uint32_t) ZSTD_maxCLevel());
+	if (relay->compression > 0)
+		relay_create_compression(relay);
+}
+
+/**
+ * Make sure there is room for @a size bytes in a buffer
+ * of rows or blocks, grow it if necessary.
+ */
+static char *
+relay_reserve(char **buf, size_t *capacity, size_t size)
+{
+	if (size <= *capacity)
+		return *buf;
+	size_t new_capacity = MAX(*capacity * 2, (size_t) RELAY_TX_BLOCK_MAX);
+	while (new_capacity < size)
+		new_capacity *= 2;
+	char *new_buf = (char *) realloc(*buf, new_capacity);
+	if (new_buf == NULL)
+		tnt_raise(OutOfMemory, new_capacity, "realloc", "relay buffer");
+	*buf = new_buf;
+	*capacity = new_capacity;
+	return new_buf;
+}
+
 static inline void
-relay_set_cord_name(int fd)
+relay_format_name(int fd, char *name, size_t size)
 {
-	char name[FIBER_NAME_MAX];
 	struct sockaddr_storage peer;
 	socklen_t addrlen = sizeof(peer);
 	if (getpeername(fd, ((struct sockaddr*)&peer), &addrlen) == 0) {
-		snprintf(name, sizeof(name), "relay/%s",
+		snprintf(name, size, "relay/%s",
 			 sio_strfaddr((struct sockaddr *)&peer, addrlen));
 	} else {
-		snprintf(name, sizeof(name), "relay/<unknown>");
+		snprintf(name, size, "relay/<unknown>");
 	}
+}
+
+static inline void
+relay_set_cord_name(int fd)
+{
+	char name[FIBER_NAME_MAX];
+	relay_format_name(fd, name, sizeof(name));
 	cord_set_name(name);
 }
 
 void
-relay_initial_join(int fd, uint64_t sync, struct vclock *vclock)
+relay_initial_join(int fd, uint64_t sync, struct vclock *vclock,
+		   uint64_t offset, uint32_t compression)
 {
 	struct relay relay;
 	relay_create(&relay, fd, sync, relay_send_initial_join_row);
+	relay.join_skip = offset;
+	relay_create_join(&relay, compression);
 	auto scope_guard = make_scoped_guard([&]{
+		relay_destroy_compression(&relay);
 		relay_destroy(&relay);
 	});
 
 	assert(relay.stream.write != NULL);
 	engine_join(vclock, &relay.stream);
+	/* Engines may leave the tail of the last block unsent. */
+	if (relay.zctx != NULL)
+		relay_flush(&relay);
 }
 
 int
@@ -190,7 +423,7 @@ relay_final_join_f(va_list ap)
 
 void
 relay_final_join(int fd, uint64_t sync, struct vclock *start_vclock,
-	         struct vclock *stop_vclock)
+	         struct vclock *stop_vclock, uint32_t compression)
 {
 	struct relay relay;
 	relay_create(&relay, fd, sync, relay_send_row);
@@ -198,7 +431,9 @@ relay_final_join(int fd, uint64_t sync, struct vclock *start_vclock,
 			       cfg_geti("force_recovery"),
 			       start_vclock);
 	vclock_copy(&relay.stop_vclock, stop_vclock);
+	relay_create_join(&relay, compression);
 	auto scope_guard = make_scoped_guard([&]{
+		relay_destroy_compression(&relay);
 		recovery_delete(relay.r);
 		relay_destroy(&relay);
 	});
@@ -206,6 +441,8 @@ relay_final_join(int fd, uint64_t sync, struct vclock *start_vclock,
 	cord_costart(&relay.cord, "final_join", relay_final_join_f, &relay);
 	if (cord_cojoin(&relay.cord) != 0)
 		diag_raise();
+	if (relay.zctx != NULL)
+		relay_flush(&relay);
 	ERROR_INJECT(ERRINJ_RELAY_FINAL_SLEEP, {
 		while (vclock_compare(stop_vclock, &replicaset_vclock) == 0)
 			fiber_sleep(0.001);
@@ -238,11 +475,17 @@ tx_status_update(struct cmsg *msg)
 {
 	struct relay_status_msg *status = (struct relay_status_msg *)msg;
 	vclock_copy(&status->relay->tx.vclock, &status->vclock);
+	vclock_copy(&status->relay->tx.ack_vclock, &status->ack_vclock);
+	for (int i = 0; i < RELAY_STAGE_MAX; i++) {
+		histogram_copy(status->relay->tx.lag_hist[i],
+			       status->lag_hist[i]);
+	}
 	static const struct cmsg_hop route[] = {
 		{relay_status_update, NULL}
 	};
 	cmsg_init(msg, route);
 	cpipe_push(&status->relay->relay_pipe, msg);
+	replication_synchro_update();
 }
 
 static void
@@ -278,32 +521,80 @@ relay_cbus_detach(struct relay *relay)
 	ipc_cond_destroy(&relay->status_cond);
 }
 
+static void
+tx_done_cb(struct cmsg *msg)
+{
+	struct relay *relay = container_of(msg, struct relay, done_msg);
+	relay->tx.is_done = true;
+	ipc_cond_signal(&relay->tx.done_cond);
+}
+
 /**
- * A libev callback invoked when a relay client socket is ready
- * for read. This currently only happens when the client closes
- * its socket, and we get an EOF.
+ * Read vclocks acknowledged by the replica from the socket,
+ * without blocking. The replica sends an ack after each batch
+ * of rows it writes to WAL, the last one wins.
+ * @retval true the replica has closed its socket
  */
-static int
-relay_subscribe_f(va_list ap)
+static bool
+relay_read_ack(struct relay *relay, struct ibuf *buf)
+{
+	if (ibuf_reserve(buf, RELAY_ACK_READAHEAD) == NULL) {
+		tnt_raise(OutOfMemory, RELAY_ACK_READAHEAD, "ibuf",
+			  "relay ack");
+	}
+	ssize_t rc = recv(relay->io.fd, buf->wpos, ibuf_unused(buf), 0);
+	if (rc == 0 || (rc < 0 && errno == ECONNRESET))
+		return true;
+	if (rc < 0) {
+		if (errno != EINTR && errno != EAGAIN &&
+		    errno != EWOULDBLOCK)
+			say_syserror("recv");
+		return false;
+	}
+	buf->wpos += rc;
+	struct xrow_header row;
+	while (xrow_read_buffered(buf, &row)) {
+		if (row.type != IPROTO_OK) {
+			tnt_raise(ClientError, ER_PROTOCOL,
+				  "Invalid replica ack");
+		}
+		struct vclock ack_vclock;
+		vclock_create(&ack_vclock);
+		xrow_decode_vclock(&row, &ack_vclock);
+		vclock_copy(&relay->ack_vclock, &ack_vclock);
+	}
+	if (ibuf_used(buf) == 0)
+		ibuf_reset(buf);
+	return false;
+}
+
+/**
+ * The loop of a subscribed relay: recovery sends rows to the
+ * replica, while the relay reads acks from the replica socket
+ * and reports both vclocks to tx.
+ */
+static void
+relay_follow(struct relay *relay)
 {
-	struct relay *relay = va_arg(ap, struct relay *);
 	struct recovery *r = relay->r;
-	coeio_enable();
-	relay->stream.write = relay_send_row;
-	ipc_cond_create(&relay->status_cond);
-	cbus_endpoint_create(&relay->endpoint, cord_name(cord()),
-			     fiber_schedule_cb, fiber());
-	/*
-	 * Use tx_prio router because our handler never yields and
-	 * just updates struct relay members.
-	 */
-	cpipe_create(&relay->tx_pipe, "tx_prio");
+	char name[FIBER_NAME_MAX];
+	relay_format_name(relay->io.fd, name, sizeof(name));
+	fiber_set_name(fiber(), name);
 
-	/* Create a guard to detach the relay from cbus on exit */
-	auto cbus_guard = make_scoped_guard([&]{
-		relay_cbus_detach(relay);
+	if (relay->compression > 0) {
+		relay_create_compression(relay);
+		relay->flusher = fiber();
+	}
+	auto compression_guard = make_scoped_guard([&]{
+		relay_destroy_compression(relay);
 	});
-	relay_set_cord_name(relay->io.fd);
+
+	struct ibuf ack_buf;
+	ibuf_create(&ack_buf, &cord()->slabc, RELAY_ACK_READAHEAD);
+	auto ack_buf_guard = make_scoped_guard([&]{
+		ibuf_destroy(&ack_buf);
+	});
+
 	recovery_follow_local(r, &relay->stream, fiber_name(fiber()),
 			      relay->wal_dir_rescan_delay);
 
@@ -337,6 +628,19 @@ relay_subscribe_f(va_list ap)
 		ev_io_start(loop(), &read_ev);
 		fiber_yield_timeout(RELAY_REPORT_INTERVAL);
 		ev_io_stop(loop(), &read_ev);
+		/*
+		 * Recovery has yielded, send what it has
+		 * accumulated so far. Recovery must be stopped
+		 * before the relay exits, so don't throw here.
+		 */
+		if (relay->zctx != NULL) {
+			try {
+				relay_flush(relay);
+			} catch (Exception *e) {
+				e->log();
+				break;
+			}
+		}
 		/*
 		 * The fiber can be woken by IO read event, by the timeout of
 		 * status messaging or by an acknowledge to status message.
@@ -344,30 +648,42 @@ relay_subscribe_f(va_list ap)
 		 */
 		cbus_process(&relay->endpoint);
 
-		uint8_t data;
-		int rc = recv(read_ev.fd, &data, sizeof(data), 0);
-
-		if (rc == 0 || (rc < 0 && errno == ECONNRESET)) {
+		bool is_eof;
+		try {
+			is_eof = relay_read_ack(relay, &ack_buf);
+		} catch (Exception *e) {
+			e->log();
+			break;
+		}
+		if (is_eof) {
 			say_info("the replica has closed its socket, exiting");
 			break;
 		}
-		if (rc < 0 && errno != EINTR && errno != EAGAIN &&
-		    errno != EWOULDBLOCK)
-			say_syserror("recv");
 
 		/*
 		 * Check that the vclock has been updated and the previous
-		 * status message is delivered
+		 * status message is delivered. Acks received while
+		 * a message is in flight are sent with the next one,
+		 * as soon as it is back.
 		 */
+		const struct vclock *send_vclock = relay->zctx != NULL ?
+			&relay->send_vclock : &r->vclock;
 		if (relay->status_msg.msg.route != NULL ||
-		    vclock_compare(&relay->status_msg.vclock,
-				   &r->vclock) == 0)
+		    (vclock_compare(&relay->status_msg.vclock,
+				    send_vclock) == 0 &&
+		     vclock_compare(&relay->status_msg.ack_vclock,
+				    &relay->ack_vclock) == 0))
 			continue;
 		static const struct cmsg_hop route[] = {
 			{tx_status_update, NULL}
 		};
 		cmsg_init(&relay->status_msg.msg, route);
-		vclock_copy(&relay->status_msg.vclock, &r->vclock);
+		vclock_copy(&relay->status_msg.vclock, send_vclock);
+		vclock_copy(&relay->status_msg.ack_vclock, &relay->ack_vclock);
+		for (int i = 0; i < RELAY_STAGE_MAX; i++) {
+			histogram_copy(relay->status_msg.lag_hist[i],
+				       relay->lag_hist[i]);
+		}
 		relay->status_msg.relay = relay;
 		cpipe_push(&relay->tx_pipe, &relay->status_msg.msg);
 	}
@@ -377,13 +693,134 @@ relay_subscribe_f(va_list ap)
 	 */
 	trigger_clear(&on_follow_error);
 	recovery_stop_local(r);
+}
+
+/** The relay fiber, runs in a thread of the relay pool. */
+static int
+relay_subscribe_f(va_list ap)
+{
+	struct relay *relay = va_arg(ap, struct relay *);
+	relay->stream.write = relay_send_row;
+	relay->stream.write_tx = relay_send_tx;
+	ipc_cond_create(&relay->status_cond);
+	cbus_endpoint_create(&relay->endpoint, relay->name,
+			     fiber_schedule_cb, fiber());
+	/*
+	 * Use tx_prio router because our handler never yields and
+	 * just updates struct relay members.
+	 */
+	cpipe_create(&relay->tx_pipe, "tx_prio");
+	try {
+		relay_follow(relay);
+	} catch (Exception *e) {
+		/* Reraised in tx by relay_subscribe(). */
+		diag_move(diag_get(), &relay->diag);
+	}
+	relay_cbus_detach(relay);
+
+	static const struct cmsg_hop done_route[] = {
+		{tx_done_cb, NULL}
+	};
+	cmsg_init(&relay->done_msg, done_route);
+	cpipe_push(&relay->worker->tx_pipe, &relay->done_msg);
 	return 0;
 }
 
+/** Start the relay fiber, invoked in the worker thread. */
+static int
+relay_start_f(struct cbus_call_msg *msg)
+{
+	struct relay *relay = container_of(msg, struct relay, start_msg);
+	struct fiber *f = fiber_new(relay->name, relay_subscribe_f);
+	if (f == NULL)
+		return -1;
+	fiber_start(f, relay);
+	return 0;
+}
+
+static int
+relay_worker_f(va_list ap)
+{
+	struct relay_worker *worker = va_arg(ap, struct relay_worker *);
+	coeio_enable();
+	/*
+	 * Relays of the thread which read the same xlog files
+	 * decompress each block once.
+	 */
+	if (xlog_tx_cache_enable() != 0)
+		error_log(diag_last_error(diag_get()));
+	struct cbus_endpoint endpoint;
+	cbus_endpoint_create(&endpoint, worker->name, fiber_schedule_cb,
+			     fiber());
+	/* Replies to cbus_call() and done messages never yield. */
+	cpipe_create(&worker->tx_pipe, "tx_prio");
+	cbus_loop(&endpoint);
+	cpipe_destroy(&worker->tx_pipe);
+	cbus_endpoint_destroy(&endpoint, cbus_process);
+	xlog_tx_cache_disable();
+	return 0;
+}
+
+/** Start the threads of the relay pool. */
+static void
+relay_pool_start(void)
+{
+	int count = cfg_geti("replication_relay_threads");
+	relay_workers = (struct relay_worker *)
+		calloc(count, sizeof(*relay_workers));
+	if (relay_workers == NULL) {
+		tnt_raise(OutOfMemory, count * sizeof(*relay_workers),
+			  "calloc", "relay pool");
+	}
+	for (int i = 0; i < count; i++) {
+		struct relay_worker *worker = &relay_workers[i];
+		snprintf(worker->name, sizeof(worker->name), "relay_pool/%d",
+			 i);
+		if (cord_costart(&worker->cord, worker->name,
+				 relay_worker_f, worker) != 0) {
+			panic("failed to start relay thread");
+		}
+		cpipe_create(&worker->pipe, worker->name);
+	}
+	relay_worker_count = count;
+}
+
+void
+relay_free(void)
+{
+	if (relay_workers == NULL)
+		return;
+	for (int i = 0; i < relay_worker_count; i++) {
+		struct relay_worker *worker = &relay_workers[i];
+		cbus_stop_loop(&worker->pipe);
+		/* The worker waits for its pipes to be destroyed. */
+		cpipe_destroy(&worker->pipe);
+		if (cord_join(&worker->cord) != 0)
+			panic_syserror("relay pool: thread join failed");
+	}
+	free(relay_workers);
+	relay_workers = NULL;
+	relay_worker_count = 0;
+}
+
+/** Pick the pool thread with the fewest relays. */
+static struct relay_worker *
+relay_pool_worker(void)
+{
+	if (relay_workers == NULL)
+		relay_pool_start();
+	struct relay_worker *worker = &relay_workers[0];
+	for (int i = 1; i < relay_worker_count; i++) {
+		if (relay_workers[i].relay_count < worker->relay_count)
+			worker = &relay_workers[i];
+	}
+	return worker;
+}
+
 /** Replication acceptor fiber handler. */
 void
 relay_subscribe(int fd, uint64_t sync, struct replica *replica,
-		struct vclock *replica_clock)
+		struct vclock *replica_clock, uint32_t compression)
 {
 	assert(replica->id != REPLICA_ID_NIL);
 	/* Don't allow multiple relays for the same replica */
@@ -398,7 +835,14 @@ relay_subscribe(int fd, uint64_t sync, struct replica *replica,
 			       cfg_geti("force_recovery"),
 			       replica_clock);
 	vclock_copy(&relay.tx.vclock, replica_clock);
+	vclock_copy(&relay.send_vclock, replica_clock);
+	vclock_copy(&relay.tx_rows_vclock, replica_clock);
+	/* The replica has written the rows it subscribes after. */
+	vclock_copy(&relay.ack_vclock, replica_clock);
+	vclock_copy(&relay.status_msg.ack_vclock, replica_clock);
+	vclock_copy(&relay.tx.ack_vclock, replica_clock);
 	relay.replica_id = replica->id;
+	relay.compression = MIN(compression, (uint32_t) ZSTD_maxCLevel());
 	relay.wal_dir_rescan_delay = cfg_getd("wal_dir_rescan_delay");
 	replica_set_relay(replica, &relay);
 
@@ -408,41 +852,189 @@ relay_subscribe(int fd, uint64_t sync, struct replica *replica,
 		relay_destroy(&relay);
 	});
 
-	struct cord cord;
-	char name[FIBER_NAME_MAX];
-	snprintf(name, sizeof(name), "relay: %u", replica->id);
+	snprintf(relay.name, sizeof(relay.name), "relay: %u", replica->id);
+	relay.worker = relay_pool_worker();
+	relay.worker->relay_count++;
+	diag_create(&relay.diag);
 	ipc_cond_create(&relay.tx.exit_cond);
-	cord_costart(&cord, name, relay_subscribe_f, &relay);
-	cpipe_create(&relay.relay_pipe, name);
+	ipc_cond_create(&relay.tx.done_cond);
+	auto worker_guard = make_scoped_guard([&]{
+		relay.worker->relay_count--;
+		ipc_cond_destroy(&relay.tx.exit_cond);
+		ipc_cond_destroy(&relay.tx.done_cond);
+		diag_destroy(&relay.diag);
+		relay_destroy_lag_hist(&relay);
+	});
+	relay_create_lag_hist(&relay);
+	if (cbus_call(&relay.worker->pipe, &relay.worker->tx_pipe,
+		      &relay.start_msg, relay_start_f, NULL,
+		      TIMEOUT_INFINITY) != 0)
+		diag_raise();
+	cpipe_create(&relay.relay_pipe, relay.name);
 	/*
 	 * When relay exits, it sends a message which signals the
 	 * exit condition in tx thread.
 	 */
 	ipc_cond_wait(&relay.tx.exit_cond);
-	ipc_cond_destroy(&relay.tx.exit_cond);
 	/*
 	 * Destroy the cpipe so that relay fiber can destroy
 	 * the corresponding endpoint and exit.
 	 */
 	cpipe_destroy(&relay.relay_pipe);
-	if (cord_cojoin(&cord) != 0) {
+	/* The relay fiber has no cord to join, wait for its end. */
+	while (! relay.tx.is_done)
+		ipc_cond_wait(&relay.tx.done_cond);
+	if (! diag_is_empty(&relay.diag)) {
+		diag_move(&relay.diag, diag_get());
 		diag_raise();
 	}
 }
 
+/**
+ * Sleep if the relay is ahead of its rate limit. Works the
+ * same way as xlog rate limiting: the check is done once per
+ * a second worth of bytes.
+ */
+static void
+relay_throttle(struct relay *relay, size_t size)
+{
+	if (relay->rate_limit <= 0)
+		return;
+	relay->unthrottled += size;
+	if (relay->unthrottled < relay->rate_limit)
+		return;
+	double throttle_time = (double) relay->unthrottled /
+		relay->rate_limit - (ev_time() - relay->throttle_time);
+	if (throttle_time > 0)
+		fiber_sleep(throttle_time);
+	relay->unthrottled = 0;
+	relay->throttle_time = ev_time();
+}
+
 static void
 relay_send(struct relay *relay, struct xrow_header *packet)
 {
 	packet->sync = relay->sync;
-	coio_write_xrow(&relay->io, packet);
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_to_iovec(packet, iov);
+	ssize_t size = coio_writev(&relay->io, iov, iovcnt, 0);
+	fiber_gc();
+	relay_throttle(relay, size);
+}
+
+/**
+ * Compress the accumulated rows into a single block and send
+ * it to the replica.
+ */
+static void
+relay_flush(struct relay *relay)
+{
+	latch_lock(&relay->write_latch);
+	auto latch_guard = make_scoped_guard([&]{
+		latch_unlock(&relay->write_latch);
+	});
+	/* The rows could have been sent while waiting. */
+	size_t len = relay->tx_rows_used;
+	if (len == 0) {
+		/* Rows skipped since the last block are sent too. */
+		if (relay->r != NULL)
+			vclock_copy(&relay->send_vclock,
+				    &relay->tx_rows_vclock);
+		return;
+	}
+	char *block = relay_reserve(&relay->tx_block,
+				    &relay->tx_block_capacity,
+				    xlog_tx_encode_bound(len));
+	ssize_t size = xlog_tx_encode(relay->tx_rows, len, block,
+				      relay->compression, relay->zctx);
+	if (size < 0)
+		diag_raise();
+	relay->tx_rows_used = 0;
+	/* Initial JOIN has no recovery and doesn't report it. */
+	struct vclock vclock;
+	if (relay->r != NULL)
+		vclock_copy(&vclock, &relay->tx_rows_vclock);
+	struct xrow_header packet;
+	xrow_encode_tx_block(&packet, block, size, len);
+	ev_tstamp read_time = relay->tx_rows_time;
+	/* Rows appended while the block is written go to the next one. */
+	relay_send(relay, &packet);
+	if (relay->r != NULL)
+		vclock_copy(&relay->send_vclock, &vclock);
+	/* One sample per block, timed from its first row. */
+	replication_lag_collect(relay->lag_hist[RELAY_STAGE_SEND],
+				ev_time() - read_time);
+}
+
+/**
+ * Append a row to the next block, send the block if it's big
+ * enough, or make sure it's sent once recovery yields.
+ */
+static void
+relay_send_compressed(struct relay *relay, struct xrow_header *packet)
+{
+	packet->sync = relay->sync;
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_header_encode(packet, iov, 0);
+	size_t size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+	if (relay->tx_rows_used + size > IPROTO_TX_LEN_MAX) {
+		/* The replica wouldn't accept such a block. */
+		relay_flush(relay);
+		if (size > IPROTO_TX_LEN_MAX) {
+			latch_lock(&relay->write_latch);
+			auto latch_guard = make_scoped_guard([&]{
+				latch_unlock(&relay->write_latch);
+			});
+			relay_send(relay, packet);
+			if (relay->r != NULL) {
+				vclock_copy(&relay->tx_rows_vclock,
+					    &relay->r->vclock);
+				vclock_copy(&relay->send_vclock,
+					    &relay->r->vclock);
+			}
+			return;
+		}
+		/* The flush has freed the encoded header. */
+		iovcnt = xrow_header_encode(packet, iov, 0);
+	}
+	bool was_empty = relay->tx_rows_used == 0;
+	for (int i = 0; i < iovcnt; i++) {
+		char *rows = relay_reserve(&relay->tx_rows,
+					   &relay->tx_rows_capacity,
+					   relay->tx_rows_used +
+					   iov[i].iov_len);
+		memcpy(rows + relay->tx_rows_used, iov[i].iov_base,
+		       iov[i].iov_len);
+		relay->tx_rows_used += iov[i].iov_len;
+	}
+	if (relay->r != NULL)
+		vclock_copy(&relay->tx_rows_vclock, &relay->r->vclock);
 	fiber_gc();
+	if (relay->tx_rows_used >= RELAY_TX_BLOCK_MAX)
+		relay_flush(relay);
+	else if (was_empty && relay->flusher != NULL)
+		fiber_wakeup(relay->flusher);
 }
 
 static void
 relay_send_initial_join_row(struct xstream *stream, struct xrow_header *row)
 {
 	struct relay *relay = container_of(stream, struct relay, stream);
-	relay_send(relay, row);
+	/*
+	 * Engines send rows in the same order for the same
+	 * checkpoint, so the rows the replica got before the
+	 * connection was lost are just skipped.
+	 */
+	if (relay->join_skip > 0) {
+		relay->join_skip--;
+		return;
+	}
+	if (relay->zctx != NULL)
+		relay_send_compressed(relay, row);
+	else
+		relay_send(relay, row);
 	ERROR_INJECT(ERRINJ_RELAY,
 	{
 		fiber_sleep(1000.0);
@@ -461,10 +1053,80 @@ relay_send_row(struct xstream *stream, struct xrow_header *packet)
 	 * (i.e. don't send replica's own rows back).
 	 */
 	if (packet->replica_id != relay->replica_id) {
-		relay_send(relay, packet);
+		ev_tstamp read_time = ev_time();
+		if (packet->tm != 0) {
+			replication_lag_collect(
+				relay->lag_hist[RELAY_STAGE_READ],
+				read_time - packet->tm);
+		}
+		if (relay->zctx != NULL) {
+			if (relay->tx_rows_used == 0)
+				relay->tx_rows_time = read_time;
+			relay_send_compressed(relay, packet);
+		} else {
+			relay_send(relay, packet);
+			replication_lag_collect(
+				relay->lag_hist[RELAY_STAGE_SEND],
+				ev_time() - read_time);
+		}
 		ERROR_INJECT(ERRINJ_RELAY,
 		{
 			fiber_sleep(1000.0);
 		});
+	} else if (relay->zctx != NULL) {
+		/* The replica has the row, it's sent with the block. */
+		vclock_copy(&relay->tx_rows_vclock, &relay->r->vclock);
+	}
+}
+
+/**
+ * Send an xlog block to the client as is, without decoding
+ * and compressing its rows once again. Only a replica which
+ * takes compressed blocks understands it, and only a block
+ * without the replica's own rows can be sent whole.
+ */
+static bool
+relay_send_tx(struct xstream *stream, const char *block, size_t block_size,
+	      const char *rows, size_t rows_size, const struct vclock *vclock)
+{
+	struct relay *relay = container_of(stream, struct relay, stream);
+	if (relay->zctx == NULL || rows_size > IPROTO_TX_LEN_MAX)
+		return false;
+	/*
+	 * The block has the replica's own rows if it moves their
+	 * component. Recovery promotes its vclock only when the
+	 * block is sent.
+	 */
+	if (vclock_get(vclock, relay->replica_id) !=
+	    vclock_get(&relay->r->vclock, relay->replica_id))
+		return false;
+	ev_tstamp read_time = ev_time();
+	const char *pos = rows, *end = rows + rows_size;
+	while (pos < end) {
+		struct xrow_header row;
+		xrow_header_decode_xc(&row, &pos, end);
+		if (row.tm != 0) {
+			replication_lag_collect(
+				relay->lag_hist[RELAY_STAGE_READ],
+				read_time - row.tm);
+		}
 	}
+	/* Rows appended before go first. */
+	relay_flush(relay);
+	latch_lock(&relay->write_latch);
+	auto latch_guard = make_scoped_guard([&]{
+		latch_unlock(&relay->write_latch);
+	});
+	struct xrow_header packet;
+	xrow_encode_tx_block(&packet, block, block_size, rows_size);
+	relay_send(relay, &packet);
+	vclock_copy(&relay->send_vclock, vclock);
+	vclock_copy(&relay->tx_rows_vclock, vclock);
+	replication_lag_collect(relay->lag_hist[RELAY_STAGE_SEND],
+				ev_time() - read_time);
+	ERROR_INJECT(ERRINJ_RELAY,
+	{
+		fiber_sleep(1000.0);
+	});
+	return true;
 }
@@ -41,6 +41,16 @@ struct relay;
 struct replica;
 struct tt_uuid;
 struct vclock;
+struct histogram;
+
+/** Stages of replication lag measured by the relay */
+enum relay_stage {
+	/** From WAL commit to the relay reading the row */
+	RELAY_STAGE_READ,
+	/** From reading the row to writing it to the socket */
+	RELAY_STAGE_SEND,
+	RELAY_STAGE_MAX
+};
 
 /**
  * Returns relay's vclock
@@ -50,6 +60,20 @@ struct vclock;
 const struct vclock *
 relay_vclock(const struct relay *relay);
 
+/**
+ * Returns the vclock acknowledged by the replica, i.e. written
+ * to its WAL, as of the last status update.
+ */
+const struct vclock *
+relay_ack_vclock(const struct relay *relay);
+
+/**
+ * Returns relay's lag histogram of a stage, as of the last
+ * status update, in microseconds.
+ */
+const struct histogram *
+relay_lag_hist(const struct relay *relay, enum relay_stage stage);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -57,30 +81,44 @@ relay_vclock(const struct relay *relay);
 /**
  * Send initial JOIN rows to the replica
  *
- * @param fd        client connection
- * @param sync      sync from incoming JOIN request
- * @param vclock    vclock of the last checkpoint
+ * @param fd          client connection
+ * @param sync        sync from incoming JOIN request
+ * @param vclock      vclock of the checkpoint to send
+ * @param offset      number of rows the replica already has
+ * @param compression zstd level to send rows with, 0 to send
+ *                    rows as is
  */
 void
-relay_initial_join(int fd, uint64_t sync, struct vclock *vclock);
+relay_initial_join(int fd, uint64_t sync, struct vclock *vclock,
+		   uint64_t offset, uint32_t compression);
 
 /**
  * Send final JOIN rows to the replica.
  *
- * @param fd        client connection
- * @param sync      sync from incoming JOIN request
+ * @param fd          client connection
+ * @param sync        sync from incoming JOIN request
+ * @param compression zstd level to send rows with, 0 to send
+ *                    rows as is
  */
 void
 relay_final_join(int fd, uint64_t sync, struct vclock *start_vclock,
-	         struct vclock *stop_vclock);
+	         struct vclock *stop_vclock, uint32_t compression);
 
 /**
  * Subscribe a replica to updates.
  *
+ * @param compression zstd level to send rows with, 0 to send
+ *                    rows as is
  * @return none.
  */
 void
 relay_subscribe(int fd, uint64_t sync, struct replica *replica,
-		struct vclock *replica_vclock);
+		struct vclock *replica_vclock, uint32_t compression);
+
+/**
+ * Stop and join the threads of the relay pool.
+ */
+void
+relay_free(void);
 
 #endif /* TARANTOOL_REPLICATION_RELAY_H_INCLUDED */
@@ -40,8 +40,11 @@
 #include "applier.h"
 #include "error.h"
 #include "vclock.h" /* VCLOCK_MAX */
+#include "histogram.h"
+#include "relay.h"
 
 struct vclock replicaset_vclock;
+struct latch replicaset_apply_latch[VCLOCK_MAX];
 uint32_t instance_id = REPLICA_ID_NIL;
 /**
  * Globally unique identifier of this replica set.
@@ -70,6 +73,13 @@ rb_gen(, replicaset_, replicaset_t, struct replica, link,
 static struct mempool replica_pool;
 static replicaset_t replicaset;
 
+int replication_synchro_quorum = 1;
+double replication_synchro_timeout = 5;
+/** LSN of this instance written by the quorum, never decreases. */
+static int64_t replication_synchro_lsn;
+/** Commits waiting for replication_synchro_lsn to advance. */
+static struct ipc_cond replication_synchro_cond;
+
 void
 replication_init(void)
 {
@@ -77,11 +87,17 @@ replication_init(void)
 		       sizeof(struct replica));
 	replicaset_new(&replicaset);
 	vclock_create(&replicaset_vclock);
+	for (int i = 0; i < VCLOCK_MAX; i++)
+		latch_create(&replicaset_apply_latch[i]);
+	ipc_cond_create(&replication_synchro_cond);
 }
 
 void
 replication_free(void)
 {
+	ipc_cond_destroy(&replication_synchro_cond);
+	for (int i = 0; i < VCLOCK_MAX; i++)
+		latch_destroy(&replicaset_apply_latch[i]);
 	mempool_destroy(&replica_pool);
 }
 
@@ -243,6 +259,97 @@ replicaset_update(struct applier **appliers, int count)
 	}
 }
 
+struct histogram *
+replication_lag_histogram_new(void)
+{
+	/* From 100 microseconds to 100 seconds. */
+	static const int64_t buckets[] = {
+		100, 200, 500,
+		1000, 2000, 5000,
+		10000, 20000, 50000,
+		100000, 200000, 500000,
+		1000000, 2000000, 5000000,
+		10000000, 20000000, 50000000,
+		100000000,
+	};
+	struct histogram *hist = histogram_new(buckets, lengthof(buckets));
+	if (hist == NULL) {
+		diag_set(OutOfMemory, sizeof(*hist), "histogram_new",
+			 "replication lag");
+	}
+	return hist;
+}
+
+void
+replication_lag_collect(struct histogram *hist, double lag)
+{
+	/* JOIN relays collect no lag. */
+	if (hist == NULL)
+		return;
+	/* Clocks of the master and the replica may differ. */
+	histogram_collect(hist, lag > 0 ? (int64_t) (lag * 1000000) : 0);
+}
+
+static int
+lsn_compare_desc(const void *a, const void *b)
+{
+	int64_t lsn_a = *(const int64_t *) a, lsn_b = *(const int64_t *) b;
+	return lsn_a > lsn_b ? -1 : lsn_a < lsn_b;
+}
+
+void
+replication_synchro_update(void)
+{
+	/* This instance is a part of the quorum. */
+	int count = replication_synchro_quorum - 1;
+	if (count <= 0 || instance_id == REPLICA_ID_NIL)
+		return;
+	int64_t lsns[VCLOCK_MAX];
+	int n = 0;
+	replicaset_foreach(replica) {
+		if (replica->relay == NULL || replica->id == instance_id)
+			continue;
+		lsns[n++] = vclock_get(relay_ack_vclock(replica->relay),
+				       instance_id);
+	}
+	if (n < count)
+		return;
+	qsort(lsns, n, sizeof(*lsns), lsn_compare_desc);
+	/* The lowest LSN among the count best replicas. */
+	int64_t lsn = lsns[count - 1];
+	if (lsn > replication_synchro_lsn) {
+		replication_synchro_lsn = lsn;
+		ipc_cond_broadcast(&replication_synchro_cond);
+	}
+}
+
+int
+replication_synchro_wait(int64_t lsn)
+{
+	if (replication_synchro_quorum <= 1)
+		return 0;
+	ev_tstamp deadline = ev_now(loop()) + replication_synchro_timeout;
+	while (replication_synchro_lsn < lsn) {
+		if (fiber_is_cancelled()) {
+			diag_set(FiberIsCancelled);
+			return -1;
+		}
+		ev_tstamp timeout = deadline - ev_now(loop());
+		if (timeout <= 0 ||
+		    ipc_cond_wait_timeout(&replication_synchro_cond,
+					  timeout) != 0) {
+			say_warn("synchronous commit of LSN %lld timed out "
+				 "waiting for %d replicas, written by the "
+				 "quorum is %lld", (long long) lsn,
+				 replication_synchro_quorum - 1,
+				 (long long) replication_synchro_lsn);
+			diag_set(ClientError, ER_TIMEOUT);
+			return -1;
+		}
+	}
+	return 0;
+}
+
 void
 replica_set_relay(struct replica *replica, struct relay *relay)
 {
@@ -32,6 +32,8 @@
  */
 #include "tt_uuid.h"
 #include <stdint.h>
+#include "latch.h"
+#include "vclock.h" /* VCLOCK_MAX */
 #define RB_COMPACT 1
 #include <small/rb.h> /* replicaset_t */
 
@@ -99,6 +101,12 @@ extern uint32_t instance_id;
  * state of the cluster, as maintained by the appliers.
  */
 extern struct vclock replicaset_vclock;
+/**
+ * Appliers of different masters may receive the same rows.
+ * Rows of a replica are applied under its latch, and
+ * replicaset_vclock is promoted once they are committed.
+ */
+extern struct latch replicaset_apply_latch[VCLOCK_MAX];
 
 /** UUID of the instance. */
 extern struct tt_uuid INSTANCE_UUID;
@@ -155,6 +163,53 @@ replica_set_id(struct replica *replica, uint32_t id);
 void
 replica_clear_id(struct replica *replica);
 
+struct histogram;
+
+/**
+ * Create a histogram of replication lag, see box.info.replication.
+ * Samples are in microseconds.
+ * Returns NULL and sets diag on OOM.
+ */
+struct histogram *
+replication_lag_histogram_new(void);
+
+/**
+ * Collect a lag sample given in seconds. Does nothing if
+ * \a hist is NULL.
+ */
+void
+replication_lag_collect(struct histogram *hist, double lag);
+
+/**
+ * Number of instances, this one included, which must have
+ * written a transaction to a synchronous space to their WAL
+ * before its commit returns, box.cfg.replication_synchro_quorum.
+ */
+extern int replication_synchro_quorum;
+
+/**
+ * How long a commit waits for the quorum, seconds,
+ * box.cfg.replication_synchro_timeout.
+ */
+extern double replication_synchro_timeout;
+
+/**
+ * Recalculate the LSN of this instance written by the quorum
+ * from vclocks acknowledged by replicas, and wake up commits
+ * waiting for it. Called on every ack and on quorum change.
+ */
+void
+replication_synchro_update(void);
+
+/**
+ * Wait until the quorum writes the rows of this instance up to
+ * @a lsn inclusive.
+ * @retval 0 success
+ * @retval -1 timeout or the fiber is cancelled, diag is set
+ */
+int
+replication_synchro_wait(int64_t lsn);
+
 /**
  * Register \a relay of a \a replica.
  * \pre a replica can have only one relay
@@ -32,9 +32,114 @@
 #include "xrow.h"
 #include "iproto_constants.h"
 #include "fiber.h"
+#include "key_def.h"
+#include "schema.h"
 
 struct rmean *rmean_box;
 
+static const struct request_schema_space *
+request_schema_find(const struct request_schema *schema, uint32_t id)
+{
+	uint32_t begin = 0, end = schema->space_count;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		const struct request_schema_space *space = &schema->spaces[mid];
+		if (space->id == id)
+			return space;
+		if (space->id < id)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return NULL;
+}
+
+static inline bool
+request_check_type(uint8_t type, const char *field)
+{
+	return (key_mp_type[type] & (1U << mp_typeof(*field))) != 0;
+}
+
+/** @sa tuple_validate_raw() */
+static bool
+request_check_tuple(const struct request_schema_space *space,
+		    const char *tuple)
+{
+	if (space->field_count == 0)
+		return true;
+	uint32_t field_count = mp_decode_array(&tuple);
+	if (space->exact_field_count > 0 &&
+	    space->exact_field_count != field_count)
+		return false;
+	if (field_count < space->field_count)
+		return false;
+	for (uint32_t i = 0; i < space->field_count; i++) {
+		if (! request_check_type(space->field_types[i], tuple))
+			return false;
+		mp_next(&tuple);
+	}
+	return true;
+}
+
+/** @sa primary_key_validate() */
+static bool
+request_check_key(const struct request_schema_space *space,
+		  uint32_t index_id, const char *key)
+{
+	const struct request_schema_index *index = NULL;
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		if (space->indexes[i].iid == index_id) {
+			index = &space->indexes[i];
+			break;
+		}
+	}
+	if (index == NULL)
+		return false; /* No such unique index. */
+	uint32_t part_count = mp_decode_array(&key);
+	if (part_count != index->part_count)
+		return false;
+	for (uint32_t i = 0; i < part_count; i++) {
+		if (! request_check_type(index->part_types[i], key))
+			return false;
+		mp_next(&key);
+	}
+	return true;
+}
+
+void
+request_check(struct request *request, const struct request_schema *schema)
+{
+	const struct request_schema_space *space =
+		request_schema_find(schema, request->space_id);
+	if (space == NULL)
+		return;
+	bool is_valid;
+	switch (request->type) {
+	case IPROTO_INSERT:
+	case IPROTO_REPLACE:
+	case IPROTO_UPSERT:
+		is_valid = request_check_tuple(space, request->tuple);
+		break;
+	case IPROTO_UPDATE:
+	case IPROTO_DELETE:
+		is_valid = request_check_key(space, request->index_id,
+					     request->key);
+		break;
+	default:
+		is_valid = false;
+		break;
+	}
+	if (is_valid)
+		request->checked_schema_version = schema->schema_version;
+}
+
+bool
+request_is_checked(const struct request *request)
+{
+	return request->checked_schema_version != 0 &&
+	       request->checked_schema_version == schema_version;
+}
+
 int
 request_normalize_ops(struct request *request)
 {
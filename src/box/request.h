@@ -30,6 +30,8 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdbool.h>
+#include <stdint.h>
 #include "trivia/util.h"
 
 #if defined(__cplusplus)
@@ -38,6 +40,60 @@ extern "C" {
 
 struct request;
 
+/** Key part types of a unique index. */
+struct request_schema_index {
+	uint32_t iid;
+	uint32_t part_count;
+	/** enum field_type of each part. */
+	const uint8_t *part_types;
+};
+
+/** Field types of tuples of a space and its unique indexes. */
+struct request_schema_space {
+	uint32_t id;
+	/** \sa tuple_format::field_count */
+	uint32_t field_count;
+	/** \sa tuple_format::exact_field_count */
+	uint32_t exact_field_count;
+	uint32_t index_count;
+	/** enum field_type of each field. */
+	const uint8_t *field_types;
+	const struct request_schema_index *indexes;
+};
+
+/**
+ * A read-only copy of the part of the schema which is needed
+ * to validate DML requests. It is built by tx and used by the
+ * network thread, so that tx does not have to check requests
+ * which are known to be valid. Allocated as a single block with
+ * malloc().
+ */
+struct request_schema {
+	/** Schema version the copy was made at. */
+	uint32_t schema_version;
+	uint32_t space_count;
+	/** Sorted by space id. */
+	struct request_schema_space spaces[0];
+};
+
+/**
+ * Check the tuple of INSERT, REPLACE or UPSERT or the key of
+ * UPDATE or DELETE against a copy of the schema, the way tx
+ * would do it. If it is valid, stamp the request with the
+ * version of the copy. Otherwise leave the request as is, so
+ * that tx reports the error in the usual order. Never sets
+ * diag.
+ */
+void
+request_check(struct request *request, const struct request_schema *schema);
+
+/**
+ * Return true if the request was found valid by request_check()
+ * and the schema has not changed since then.
+ */
+bool
+request_is_checked(const struct request *request);
+
 /**
  * Convert one-based upsert/update operations to zero-based
  *
@@ -40,6 +40,7 @@
 #include "key_def.h"
 #include "alter.h"
 #include "scoped_guard.h"
+#include "request.h"
 #include <stdio.h>
 /**
  * @module Data Dictionary
@@ -428,3 +429,84 @@ schema_find_grants(const char *type, uint32_t id)
 	index->initIterator(it, ITER_EQ, key, 2);
 	return it->next(it);
 }
+
+static int
+request_schema_space_cmp(const void *a, const void *b)
+{
+	uint32_t id_a = ((const struct request_schema_space *) a)->id;
+	uint32_t id_b = ((const struct request_schema_space *) b)->id;
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
+struct request_schema *
+request_schema_new()
+{
+	/* Count everything to allocate the copy in one block. */
+	uint32_t space_count = 0, index_count = 0, type_count = 0;
+	mh_int_t i;
+	mh_foreach(spaces, i) {
+		struct space *space =
+			(struct space *) mh_i32ptr_node(spaces, i)->val;
+		space_count++;
+		type_count += space->format->field_count;
+		for (uint32_t j = 0; j < space->index_count; j++) {
+			struct index_def *def = space->index[j]->index_def;
+			if (! def->opts.is_unique)
+				continue;
+			index_count++;
+			type_count += def->key_def.part_count;
+		}
+	}
+	size_t size = sizeof(struct request_schema) +
+		space_count * sizeof(struct request_schema_space) +
+		index_count * sizeof(struct request_schema_index) +
+		type_count;
+	struct request_schema *schema = (struct request_schema *) malloc(size);
+	if (schema == NULL) {
+		diag_set(OutOfMemory, size, "malloc", "struct request_schema");
+		return NULL;
+	}
+	schema->schema_version = schema_version;
+	schema->space_count = space_count;
+	struct request_schema_index *index =
+		(struct request_schema_index *) (schema->spaces + space_count);
+	uint8_t *type = (uint8_t *) (index + index_count);
+
+	struct request_schema_space *copy = schema->spaces;
+	mh_foreach(spaces, i) {
+		struct space *space =
+			(struct space *) mh_i32ptr_node(spaces, i)->val;
+		struct tuple_format *format = space->format;
+		copy->id = space_id(space);
+		copy->field_count = format->field_count;
+		copy->exact_field_count = format->exact_field_count;
+		copy->field_types = type;
+		for (uint32_t j = 0; j < format->field_count; j++)
+			*type++ = format->fields[j].type;
+		copy->index_count = 0;
+		copy->indexes = index;
+		for (uint32_t j = 0; j < space->index_count; j++) {
+			struct index_def *def = space->index[j]->index_def;
+			if (! def->opts.is_unique)
+				continue;
+			index->iid = def->iid;
+			index->part_count = def->key_def.part_count;
+			index->part_types = type;
+			for (uint32_t k = 0; k < def->key_def.part_count; k++)
+				*type++ = def->key_def.parts[k].type;
+			index++;
+			copy->index_count++;
+		}
+		copy++;
+	}
+	assert((char *) type == (char *) schema + size);
+	qsort(schema->spaces, space_count, sizeof(*schema->spaces),
+	      request_schema_space_cmp);
+	return schema;
+}
+
+void
+request_schema_delete(struct request_schema *schema)
+{
+	free(schema);
+}
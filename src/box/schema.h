@@ -178,6 +178,21 @@ func_by_name(const char *name, uint32_t name_len);
  */
 bool
 schema_find_grants(const char *type, uint32_t id);
+
+struct request_schema;
+
+/**
+ * Make a copy of field and unique key part types of all spaces
+ * for request_check(). The copy does not reference the space
+ * cache and can be passed to another thread.
+ *
+ * @retval NULL out of memory, diag is set
+ */
+struct request_schema *
+request_schema_new();
+
+void
+request_schema_delete(struct request_schema *schema);
 #endif /* defined(__cplusplus) */
 
 #endif /* INCLUDES_TARANTOOL_BOX_SCHEMA_H */
@@ -128,7 +128,17 @@ space_new(struct space_def *def, struct rlist *key_list)
 	space->format = tuple_format_new(engine->format, keys, index_count, 0);
 	if (space->format == NULL)
 		diag_raise();
+	if ((def->opts.fixed_layout &&
+	     tuple_format_set_fixed_layout(space->format) != 0) ||
+	    tuple_format_set_offset_stride(space->format,
+					   def->opts.field_offset_stride,
+					   def->exact_field_count) != 0) {
+		tuple_format_delete(space->format);
+		space->format = NULL;
+		diag_raise();
+	}
 	space->has_unique_secondary_key = has_unique_secondary_key;
+	space->format->space_id = def->id;
 	tuple_format_ref(space->format, 1);
 	space->format->exact_field_count = def->exact_field_count;
 	/* init space engine instance */
@@ -407,6 +407,24 @@ tuple_delete(struct tuple *tuple)
 	format->vtab.destroy(format, tuple);
 }
 
+/**
+ * Make sure the body of a tuple taken from an index is in
+ * memory. An engine may keep only the indexed fields of cold
+ * tuples in memory, the rest is loaded by this function, which
+ * may yield unless there is a transaction in progress.
+ * @retval the tuple to return to the user, it is not
+ *         referenced and may differ from @a tuple
+ * @retval NULL on error, check diag
+ */
+static inline struct tuple *
+tuple_fetch(struct tuple *tuple)
+{
+	struct tuple_format *format = tuple_format(tuple);
+	if (format->vtab.fetch == NULL)
+		return tuple;
+	return format->vtab.fetch(format, tuple);
+}
+
 /**
  * Check tuple data correspondence to space format.
  * Actually checks everything that checks tuple_init_field_map.
@@ -668,6 +686,16 @@ tuple_bless_xc(struct tuple *tuple)
 	return blessed;
 }
 
+/** \copydoc tuple_fetch */
+static inline struct tuple *
+tuple_fetch_xc(struct tuple *tuple)
+{
+	struct tuple *res = tuple_fetch(tuple);
+	if (res == NULL)
+		diag_raise();
+	return res;
+}
+
 /** Make tuple references exception-friendly in absence of @finally. */
 struct TupleRefNil {
 	struct tuple *tuple;
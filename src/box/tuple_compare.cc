@@ -511,10 +511,37 @@ tuple_compare_with_key_slowpath(const struct tuple *tuple, const char *key,
 						   part_count, key_def);
 }
 
+/**
+ * Compare two fields of the given type. UNSIGNED and STRING
+ * have hand-written versions below, other types share the
+ * comparators of tuple_compare_field() with the switch
+ * resolved at compile time.
+ */
 template <int TYPE>
 static inline int
 field_compare(const char **field_a, const char **field_b);
 
+template <>
+inline int
+field_compare<FIELD_TYPE_INTEGER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_integer(*field_a, *field_b);
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_NUMBER>(const char **field_a, const char **field_b)
+{
+	return mp_compare_number(*field_a, *field_b);
+}
+
+template <>
+inline int
+field_compare<FIELD_TYPE_SCALAR>(const char **field_a, const char **field_b)
+{
+	return mp_compare_scalar(*field_a, *field_b);
+}
+
 template <>
 inline int
 field_compare<FIELD_TYPE_UNSIGNED>(const char **field_a, const char **field_b)
@@ -537,7 +564,13 @@ field_compare<FIELD_TYPE_STRING>(const char **field_a, const char **field_b)
 
 template <int TYPE>
 static inline int
-field_compare_and_next(const char **field_a, const char **field_b);
+field_compare_and_next(const char **field_a, const char **field_b)
+{
+	int r = field_compare<TYPE>(field_a, field_b);
+	mp_next(field_a);
+	mp_next(field_b);
+	return r;
+}
 
 template <>
 inline int
@@ -668,16 +701,28 @@ struct comparator_signature {
 #define COMPARATOR(...) \
 	{ TupleCompare<__VA_ARGS__>::compare, { __VA_ARGS__, UINT32_MAX } },
 
+/**
+ * Instantiate MACRO for every scalar field type of the last
+ * key part: MACRO(<arguments>, <type>).
+ */
+#define FOREACH_SCALAR_TYPE(MACRO, ...) \
+	MACRO(__VA_ARGS__, FIELD_TYPE_UNSIGNED) \
+	MACRO(__VA_ARGS__, FIELD_TYPE_STRING) \
+	MACRO(__VA_ARGS__, FIELD_TYPE_INTEGER) \
+	MACRO(__VA_ARGS__, FIELD_TYPE_NUMBER) \
+	MACRO(__VA_ARGS__, FIELD_TYPE_SCALAR)
+
 /**
  * field1 no, field1 type, field2 no, field2 type, ...
  */
 static const comparator_signature cmp_arr[] = {
-	COMPARATOR(0, FIELD_TYPE_UNSIGNED)
-	COMPARATOR(0, FIELD_TYPE_STRING)
-	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED)
-	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED)
-	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING)
-	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING)
+	/* All one- and two-part keys starting from the first field. */
+	FOREACH_SCALAR_TYPE(COMPARATOR, 0)
+	FOREACH_SCALAR_TYPE(COMPARATOR, 0, FIELD_TYPE_UNSIGNED, 1)
+	FOREACH_SCALAR_TYPE(COMPARATOR, 0, FIELD_TYPE_STRING  , 1)
+	FOREACH_SCALAR_TYPE(COMPARATOR, 0, FIELD_TYPE_INTEGER , 1)
+	FOREACH_SCALAR_TYPE(COMPARATOR, 0, FIELD_TYPE_NUMBER  , 1)
+	FOREACH_SCALAR_TYPE(COMPARATOR, 0, FIELD_TYPE_SCALAR  , 1)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
@@ -711,7 +756,10 @@ tuple_compare_create(const struct key_def *def) {
 /* {{{ tuple_compare_with_key */
 
 template <int TYPE>
-static inline int field_compare_with_key(const char **field, const char **key);
+static inline int field_compare_with_key(const char **field, const char **key)
+{
+	return field_compare<TYPE>(field, key);
+}
 
 template <>
 inline int
@@ -735,7 +783,10 @@ field_compare_with_key<FIELD_TYPE_STRING>(const char **field, const char **key)
 
 template <int TYPE>
 static inline int
-field_compare_with_key_and_next(const char **field_a, const char **field_b);
+field_compare_with_key_and_next(const char **field_a, const char **field_b)
+{
+	return field_compare_and_next<TYPE>(field_a, field_b);
+}
 
 template <>
 inline int
@@ -877,6 +928,16 @@ static const comparator_with_key_signature cmp_wk_arr[] = {
 	KEY_COMPARATOR(0, FIELD_TYPE_UNSIGNED, 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 	KEY_COMPARATOR(0, FIELD_TYPE_STRING  , 1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_STRING)
 
+	/*
+	 * Since key comparators are matched by prefix, these also
+	 * serve one-part keys.
+	 */
+	FOREACH_SCALAR_TYPE(KEY_COMPARATOR, 0, FIELD_TYPE_UNSIGNED, 1)
+	FOREACH_SCALAR_TYPE(KEY_COMPARATOR, 0, FIELD_TYPE_STRING  , 1)
+	FOREACH_SCALAR_TYPE(KEY_COMPARATOR, 0, FIELD_TYPE_INTEGER , 1)
+	FOREACH_SCALAR_TYPE(KEY_COMPARATOR, 0, FIELD_TYPE_NUMBER  , 1)
+	FOREACH_SCALAR_TYPE(KEY_COMPARATOR, 0, FIELD_TYPE_SCALAR  , 1)
+
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_STRING  , 2, FIELD_TYPE_UNSIGNED)
 	KEY_COMPARATOR(1, FIELD_TYPE_UNSIGNED, 2, FIELD_TYPE_STRING)
@@ -884,6 +945,7 @@ static const comparator_with_key_signature cmp_wk_arr[] = {
 };
 
 #undef KEY_COMPARATOR
+#undef FOREACH_SCALAR_TYPE
 
 tuple_compare_with_key_t
 tuple_compare_with_key_create(const struct key_def *def)
@@ -909,6 +971,247 @@ tuple_compare_with_key_create(const struct key_def *def)
 
 /* }}} tuple_compare_with_key */
 
+/* {{{ tuple_compare_multikey */
+
+/**
+ * Compare parts of multikey index entries which follow the
+ * first one, they are ordinary tuple fields.
+ */
+static inline int
+tuple_compare_multikey_tail(const struct tuple *tuple_a,
+			    const struct tuple *tuple_b,
+			    const struct key_part *part,
+			    const struct key_part *end)
+{
+	const struct tuple_format *format_a = tuple_format(tuple_a);
+	const struct tuple_format *format_b = tuple_format(tuple_b);
+	const char *data_a = tuple_data(tuple_a);
+	const char *data_b = tuple_data(tuple_b);
+	const uint32_t *field_map_a = tuple_field_map(tuple_a);
+	const uint32_t *field_map_b = tuple_field_map(tuple_b);
+	int r = 0;
+	for (; part < end; part++) {
+		const char *field_a = tuple_field_raw(format_a, data_a,
+						      field_map_a,
+						      part->fieldno);
+		const char *field_b = tuple_field_raw(format_b, data_b,
+						      field_map_b,
+						      part->fieldno);
+		assert(field_a != NULL && field_b != NULL);
+		if ((r = tuple_compare_field(field_a, field_b, part->type)))
+			break;
+	}
+	return r;
+}
+
+template <int TYPE>
+static int
+tuple_compare_multikey_single(const struct tuple *tuple_a, uint32_t offset_a,
+			      const struct tuple *tuple_b, uint32_t offset_b,
+			      const struct key_def *key_def)
+{
+	(void) key_def;
+	const char *field_a = tuple_data(tuple_a) + offset_a;
+	const char *field_b = tuple_data(tuple_b) + offset_b;
+	return field_compare<TYPE>(&field_a, &field_b);
+}
+
+static int
+tuple_compare_multikey_slowpath(const struct tuple *tuple_a,
+				uint32_t offset_a,
+				const struct tuple *tuple_b,
+				uint32_t offset_b,
+				const struct key_def *key_def)
+{
+	const struct key_part *part = key_def->parts;
+	int r = tuple_compare_field(tuple_data(tuple_a) + offset_a,
+				    tuple_data(tuple_b) + offset_b,
+				    part->type);
+	if (r != 0)
+		return r;
+	return tuple_compare_multikey_tail(tuple_a, tuple_b, part + 1,
+					   part + key_def->part_count);
+}
+
+template <int TYPE>
+static int
+tuple_compare_with_key_multikey_single(const struct tuple *tuple,
+				       uint32_t offset, const char *key,
+				       uint32_t part_count,
+				       const struct key_def *key_def)
+{
+	(void) key_def;
+	if (part_count == 0)
+		return 0;
+	const char *field = tuple_data(tuple) + offset;
+	return field_compare_with_key<TYPE>(&field, &key);
+}
+
+static int
+tuple_compare_with_key_multikey_slowpath(const struct tuple *tuple,
+					 uint32_t offset, const char *key,
+					 uint32_t part_count,
+					 const struct key_def *key_def)
+{
+	assert(key != NULL || part_count == 0);
+	assert(part_count <= key_def->part_count);
+	if (part_count == 0)
+		return 0;
+	const struct key_part *part = key_def->parts;
+	int r = tuple_compare_field(tuple_data(tuple) + offset, key,
+				    part->type);
+	if (r != 0 || part_count == 1)
+		return r;
+	mp_next(&key);
+	const struct tuple_format *format = tuple_format(tuple);
+	const char *data = tuple_data(tuple);
+	const uint32_t *field_map = tuple_field_map(tuple);
+	const struct key_part *end = part + part_count;
+	for (part++; part < end; part++) {
+		const char *field = tuple_field_raw(format, data, field_map,
+						    part->fieldno);
+		r = tuple_compare_field(field, key, part->type);
+		if (r != 0)
+			break;
+		mp_next(&key);
+	}
+	return r;
+}
+
+tuple_compare_multikey_t
+tuple_compare_multikey_create(const struct key_def *def)
+{
+	assert(key_def_is_nested(def));
+	if (def->part_count > 1)
+		return tuple_compare_multikey_slowpath;
+	switch (def->parts[0].type) {
+	case FIELD_TYPE_UNSIGNED:
+		return tuple_compare_multikey_single<FIELD_TYPE_UNSIGNED>;
+	case FIELD_TYPE_STRING:
+		return tuple_compare_multikey_single<FIELD_TYPE_STRING>;
+	case FIELD_TYPE_INTEGER:
+		return tuple_compare_multikey_single<FIELD_TYPE_INTEGER>;
+	case FIELD_TYPE_NUMBER:
+		return tuple_compare_multikey_single<FIELD_TYPE_NUMBER>;
+	case FIELD_TYPE_SCALAR:
+		return tuple_compare_multikey_single<FIELD_TYPE_SCALAR>;
+	default:
+		return tuple_compare_multikey_slowpath;
+	}
+}
+
+tuple_compare_with_key_multikey_t
+tuple_compare_with_key_multikey_create(const struct key_def *def)
+{
+	assert(key_def_is_nested(def));
+	if (def->part_count > 1)
+		return tuple_compare_with_key_multikey_slowpath;
+	switch (def->parts[0].type) {
+	case FIELD_TYPE_UNSIGNED:
+		return tuple_compare_with_key_multikey_single<
+			FIELD_TYPE_UNSIGNED>;
+	case FIELD_TYPE_STRING:
+		return tuple_compare_with_key_multikey_single<
+			FIELD_TYPE_STRING>;
+	case FIELD_TYPE_INTEGER:
+		return tuple_compare_with_key_multikey_single<
+			FIELD_TYPE_INTEGER>;
+	case FIELD_TYPE_NUMBER:
+		return tuple_compare_with_key_multikey_single<
+			FIELD_TYPE_NUMBER>;
+	case FIELD_TYPE_SCALAR:
+		return tuple_compare_with_key_multikey_single<
+			FIELD_TYPE_SCALAR>;
+	default:
+		return tuple_compare_with_key_multikey_slowpath;
+	}
+}
+
+/* }}} tuple_compare_multikey */
+
+/* {{{ tuple_compare_fixed_layout */
+
+/**
+ * Compare tuples by unsigned parts taken from native slots of
+ * the field map.
+ * \sa tuple_format_set_fixed_layout()
+ */
+static int
+tuple_compare_fixed_layout(const struct tuple *tuple_a,
+			   const struct tuple *tuple_b,
+			   const struct key_def *key_def)
+{
+	const struct tuple_format *format_a = tuple_format(tuple_a);
+	const struct tuple_format *format_b = tuple_format(tuple_b);
+	const char *data_a = tuple_data(tuple_a);
+	const char *data_b = tuple_data(tuple_b);
+	const uint32_t *field_map_a = tuple_field_map(tuple_a);
+	const uint32_t *field_map_b = tuple_field_map(tuple_b);
+	const struct key_part *part = key_def->parts;
+	const struct key_part *end = part + key_def->part_count;
+	for (; part < end; part++) {
+		uint64_t a = tuple_field_u64_raw(format_a, data_a, field_map_a,
+						 part->fieldno);
+		uint64_t b = tuple_field_u64_raw(format_b, data_b, field_map_b,
+						 part->fieldno);
+		if (a != b)
+			return a < b ? -1 : 1;
+	}
+	return 0;
+}
+
+/** @copydoc tuple_compare_fixed_layout() */
+static int
+tuple_compare_with_key_fixed_layout(const struct tuple *tuple,
+				    const char *key, uint32_t part_count,
+				    const struct key_def *key_def)
+{
+	assert(key != NULL || part_count == 0);
+	assert(part_count <= key_def->part_count);
+	const struct tuple_format *format = tuple_format(tuple);
+	const char *data = tuple_data(tuple);
+	const uint32_t *field_map = tuple_field_map(tuple);
+	const struct key_part *part = key_def->parts;
+	const struct key_part *end = part + part_count;
+	for (; part < end; part++) {
+		uint64_t a = tuple_field_u64_raw(format, data, field_map,
+						 part->fieldno);
+		uint64_t b = mp_decode_uint(&key);
+		if (a != b)
+			return a < b ? -1 : 1;
+	}
+	return 0;
+}
+
+/** Return true if all parts of @a def are unsigned. */
+static bool
+key_def_is_unsigned(const struct key_def *def)
+{
+	for (uint32_t i = 0; i < def->part_count; i++) {
+		if (def->parts[i].type != FIELD_TYPE_UNSIGNED)
+			return false;
+	}
+	return true;
+}
+
+tuple_compare_t
+tuple_compare_fixed_layout_create(const struct key_def *def)
+{
+	if (! key_def_is_unsigned(def))
+		return NULL;
+	return tuple_compare_fixed_layout;
+}
+
+tuple_compare_with_key_t
+tuple_compare_with_key_fixed_layout_create(const struct key_def *def)
+{
+	if (! key_def_is_unsigned(def))
+		return NULL;
+	return tuple_compare_with_key_fixed_layout;
+}
+
+/* }}} tuple_compare_fixed_layout */
+
 int
 box_tuple_compare(const box_tuple_t *tuple_a, const box_tuple_t *tuple_b,
 		  const box_key_def_t *key_def)
@@ -56,6 +56,26 @@ tuple_compare_create(const struct key_def *key_def);
 tuple_compare_with_key_t
 tuple_compare_with_key_create(const struct key_def *key_def);
 
+/**
+ * Create a comparison function for the key_def that reads
+ * unsigned fields from native slots of the field map.
+ * Tuples of formats without native slots are compared
+ * correctly too, but slower.
+ * \sa tuple_format_set_fixed_layout()
+ *
+ * @param key_def key_definition
+ * @returns a comparison function or NULL if some key part is
+ *          not unsigned
+ */
+tuple_compare_t
+tuple_compare_fixed_layout_create(const struct key_def *key_def);
+
+/**
+ * @copydoc tuple_compare_fixed_layout_create()
+ */
+tuple_compare_with_key_t
+tuple_compare_with_key_fixed_layout_create(const struct key_def *key_def);
+
 /**
  * Compare keys using the key definition.
  * @param key_a key parts with MessagePack array header
@@ -72,6 +92,19 @@ int
 key_compare(const char *key_a, const char *key_b,
 	    const struct key_def *key_def);
 
+/**
+ * Create a comparator of multikey index entries.
+ * @pre key_def_is_nested(key_def)
+ */
+tuple_compare_multikey_t
+tuple_compare_multikey_create(const struct key_def *key_def);
+
+/**
+ * @copydoc tuple_compare_multikey_create()
+ */
+tuple_compare_with_key_multikey_t
+tuple_compare_with_key_multikey_create(const struct key_def *key_def);
+
 /**
  * Compare tuples using the key definition.
  * @param tuple_a first tuple
@@ -88,6 +121,42 @@ tuple_compare(const struct tuple *tuple_a, const struct tuple *tuple_b,
 	return key_def->tuple_compare(tuple_a, tuple_b, key_def);
 }
 
+/**
+ * Compare entries of a multikey index. The first key part of
+ * an entry is the array element or the value at the index path
+ * found at the offset in the tuple data, the rest are taken
+ * from the tuple fields.
+ * @param tuple_a first tuple
+ * @param offset_a offset of the first part in tuple_a data
+ * @param tuple_b second tuple
+ * @param offset_b offset of the first part in tuple_b data
+ * @param key_def key definition
+ * @retval 0  if the entries have equal keys
+ * @retval <0 if key of entry a < key of entry b
+ * @retval >0 if key of entry a > key of entry b
+ */
+static inline int
+tuple_compare_multikey(const struct tuple *tuple_a, uint32_t offset_a,
+		       const struct tuple *tuple_b, uint32_t offset_b,
+		       const struct key_def *key_def)
+{
+	return key_def->tuple_compare_multikey(tuple_a, offset_a,
+					       tuple_b, offset_b, key_def);
+}
+
+/**
+ * Compare an entry of a multikey index with a key.
+ * @sa tuple_compare_multikey(), tuple_compare_with_key().
+ */
+static inline int
+tuple_compare_with_key_multikey(const struct tuple *tuple, uint32_t offset,
+				const char *key, uint32_t part_count,
+				const struct key_def *key_def)
+{
+	return key_def->tuple_compare_with_key_multikey(tuple, offset, key,
+							part_count, key_def);
+}
+
 /**
  * @brief Compare tuple with key using the key definition.
  * @param tuple tuple
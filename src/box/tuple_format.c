@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "tuple_format.h"
+#include <stdlib.h>
 
 /** Global table of tuple formats */
 struct tuple_format **tuple_formats;
@@ -51,6 +52,7 @@ tuple_format_create(struct tuple_format *format, struct key_def **keys,
 	for (uint32_t i = 0; i < format->field_count; i++) {
 		format->fields[i].type = FIELD_TYPE_ANY;
 		format->fields[i].offset_slot = TUPLE_OFFSET_SLOT_NIL;
+		format->fields[i].native_slot = TUPLE_OFFSET_SLOT_NIL;
 	}
 
 	int current_slot = 0;
@@ -66,10 +68,27 @@ tuple_format_create(struct tuple_format *format, struct key_def **keys,
 			assert(part->fieldno < format->field_count);
 			struct tuple_field_format *field =
 				&format->fields[part->fieldno];
-
-			if (field->type == FIELD_TYPE_ANY) {
-				field->type = part->type;
-			} else if (field->type != part->type) {
+			/*
+			 * The first part of a multikey index is
+			 * an element of an array field. With a path
+			 * it is somewhere inside the field, which
+			 * must be an array if the path starts with
+			 * an index and is a map otherwise.
+			 */
+			enum field_type type = part->type;
+			if (part == key_def->parts && key_def->path[0] == '[')
+				type = FIELD_TYPE_ARRAY;
+			else if (part == key_def->parts &&
+				 key_def->path[0] != '\0')
+				type = FIELD_TYPE_ANY;
+			else if (part == key_def->parts && key_def->is_multikey)
+				type = FIELD_TYPE_ARRAY;
+
+			if (type == FIELD_TYPE_ANY) {
+				/* There is no map field type. */
+			} else if (field->type == FIELD_TYPE_ANY) {
+				field->type = type;
+			} else if (field->type != type) {
 				/**
 				 * Check that two different indexes do not
 				 * put contradicting constraints on
@@ -77,7 +96,7 @@ tuple_format_create(struct tuple_format *format, struct key_def **keys,
 				 */
 				diag_set(ClientError, ER_FIELD_TYPE_MISMATCH,
 					 part->fieldno + TUPLE_INDEX_BASE,
-					 field_type_strs[part->type],
+					 field_type_strs[type],
 					 field_type_strs[field->type]);
 				return -1;
 			}
@@ -182,6 +201,10 @@ tuple_format_alloc(struct key_def **keys, uint16_t key_count)
 	format->id = FORMAT_ID_NIL;
 	format->field_count = field_count;
 	format->exact_field_count = 0;
+	format->native_field_count = 0;
+	format->offset_stride = 0;
+	format->offset_checkpoint_count = 0;
+	format->offset_checkpoint_slot = 0;
 	return format;
 }
 
@@ -200,6 +223,7 @@ tuple_format_new(struct tuple_format_vtab *vtab, struct key_def **keys,
 	if (format == NULL)
 		return NULL;
 	format->vtab = *vtab;
+	format->space_id = 0;
 	format->extra_size = extra_size;
 	if (tuple_format_register(format) < 0) {
 		tuple_format_delete(format);
@@ -234,11 +258,88 @@ tuple_format_dup(const struct tuple_format *src)
 	return format;
 }
 
+int
+tuple_format_set_fixed_layout(struct tuple_format *format)
+{
+	/* There are no tuples with the old field map yet. */
+	assert(format->refs == 0);
+	/* Checkpoint slots must be the last ones. */
+	assert(format->offset_checkpoint_count == 0);
+	if (format->native_field_count > 0)
+		return 0;
+	uint32_t native_field_count = 0;
+	for (uint32_t i = 0; i < format->field_count; i++) {
+		if (format->fields[i].type == FIELD_TYPE_UNSIGNED)
+			native_field_count++;
+	}
+	size_t field_map_size = format->field_map_size +
+				native_field_count * sizeof(uint64_t);
+	if (field_map_size + format->extra_size > UINT16_MAX) {
+		/** tuple->data_offset is 16 bits */
+		diag_set(ClientError, ER_INDEX_FIELD_COUNT_LIMIT,
+			 (int) (field_map_size / sizeof(uint32_t)));
+		return -1;
+	}
+	int32_t current_slot = -(int32_t) (format->field_map_size /
+					   sizeof(uint32_t));
+	for (uint32_t i = 0; i < format->field_count; i++) {
+		struct tuple_field_format *field = &format->fields[i];
+		if (field->type != FIELD_TYPE_UNSIGNED)
+			continue;
+		current_slot -= sizeof(uint64_t) / sizeof(uint32_t);
+		field->native_slot = current_slot;
+	}
+	format->native_field_count = native_field_count;
+	format->field_map_size = field_map_size;
+	return 0;
+}
+
+int
+tuple_format_set_offset_stride(struct tuple_format *format, uint32_t stride,
+			       uint32_t field_count_max)
+{
+	/* There are no tuples with the old field map yet. */
+	assert(format->refs == 0);
+	assert(stride <= UINT16_MAX);
+	size_t field_map_size = format->field_map_size -
+		format->offset_checkpoint_count * sizeof(uint32_t);
+	uint32_t checkpoint_count = 0;
+	if (stride > 0) {
+		checkpoint_count = TUPLE_OFFSET_CHECKPOINT_MAX;
+		if (field_count_max > 0)
+			checkpoint_count = MIN(checkpoint_count,
+					       (field_count_max - 1) / stride);
+	}
+	if (checkpoint_count == 0) {
+		/* Either disabled or no tuple is that wide. */
+		stride = 0;
+	}
+	size_t new_size = field_map_size + checkpoint_count * sizeof(uint32_t);
+	if (new_size + format->extra_size > UINT16_MAX) {
+		/** tuple->data_offset is 16 bits */
+		diag_set(ClientError, ER_INDEX_FIELD_COUNT_LIMIT,
+			 (int) (new_size / sizeof(uint32_t)));
+		return -1;
+	}
+	format->offset_stride = stride;
+	format->offset_checkpoint_count = checkpoint_count;
+	format->offset_checkpoint_slot =
+		-(int32_t) (field_map_size / sizeof(uint32_t));
+	format->field_map_size = new_size;
+	return 0;
+}
+
 /** @sa declaration for details. */
 int
 tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 		     const char *tuple)
 {
+	if (format->offset_checkpoint_count > 0) {
+		/* Checkpoints are computed on demand. */
+		uint32_t count = format->offset_checkpoint_count;
+		memset(field_map + format->offset_checkpoint_slot - count, 0,
+		       count * sizeof(uint32_t));
+	}
 	if (format->field_count == 0)
 		return 0; /* Nothing to initialize */
 
@@ -265,6 +366,11 @@ tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 	if (key_mp_type_validate(format->fields[0].type, mp_type, ER_FIELD_TYPE,
 				 TUPLE_INDEX_BASE))
 		return -1;
+	if (format->fields[0].native_slot != TUPLE_OFFSET_SLOT_NIL) {
+		const char *value = pos;
+		store_u64(field_map + format->fields[0].native_slot,
+			  mp_decode_uint(&value));
+	}
 	mp_next(&pos);
 	/* other fields...*/
 	for (uint32_t i = 1; i < format->field_count; i++) {
@@ -275,11 +381,104 @@ tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 		if (format->fields[i].offset_slot != TUPLE_OFFSET_SLOT_NIL)
 			field_map[format->fields[i].offset_slot] =
 				(uint32_t) (pos - tuple);
+		if (format->fields[i].native_slot != TUPLE_OFFSET_SLOT_NIL) {
+			const char *value = pos;
+			store_u64(field_map + format->fields[i].native_slot,
+				  mp_decode_uint(&value));
+		}
 		mp_next(&pos);
 	}
 	return 0;
 }
 
+const char *
+tuple_field_raw_checkpoint(const struct tuple_format *format,
+			   const char *tuple, const uint32_t *field_map,
+			   uint32_t field_no)
+{
+	assert(format->offset_stride != 0);
+	const char *pos = tuple;
+	uint32_t field_count = mp_decode_array(&pos);
+	if (unlikely(field_no >= field_count))
+		return NULL;
+	/*
+	 * The checkpoints are a cache filled on demand, so they
+	 * are updated even though the tuple is constant. See
+	 * the function comment for why this is safe.
+	 */
+	uint32_t *checkpoints = (uint32_t *) field_map +
+				format->offset_checkpoint_slot;
+	uint32_t stride = format->offset_stride;
+	uint32_t last = MIN(field_no / stride,
+			    format->offset_checkpoint_count);
+	/*
+	 * Checkpoints are always computed in order, so the set
+	 * of computed checkpoints is a prefix: find its end.
+	 */
+	uint32_t i = last;
+	while (i > 0 && checkpoints[-(int) i] == 0)
+		i--;
+	uint32_t pos_no = 0;
+	if (i > 0) {
+		pos = tuple + checkpoints[-(int) i];
+		pos_no = i * stride;
+	}
+	for (i++; i <= last; i++) {
+		for (; pos_no < i * stride; pos_no++)
+			mp_next(&pos);
+		checkpoints[-(int) i] = (uint32_t) (pos - tuple);
+	}
+	for (; pos_no < field_no; pos_no++)
+		mp_next(&pos);
+	return pos;
+}
+
+const char *
+tuple_field_go_to_path(const char *field, const char *path)
+{
+	while (*path != '\0') {
+		if (*path == '[') {
+			char *end;
+			uint32_t index = strtoul(path + 1, &end, 10);
+			assert(*end == ']' && index >= TUPLE_INDEX_BASE);
+			path = end + 1;
+			if (mp_typeof(*field) != MP_ARRAY)
+				return NULL;
+			if (index - TUPLE_INDEX_BASE >= mp_decode_array(&field))
+				return NULL;
+			for (uint32_t i = TUPLE_INDEX_BASE; i < index; i++)
+				mp_next(&field);
+			continue;
+		}
+		if (*path == '.')
+			path++;
+		const char *name = path;
+		while (*path != '\0' && *path != '.' && *path != '[')
+			path++;
+		uint32_t name_len = path - name;
+		if (mp_typeof(*field) != MP_MAP)
+			return NULL;
+		uint32_t count = mp_decode_map(&field);
+		const char *value = NULL;
+		for (uint32_t i = 0; i < count && value == NULL; i++) {
+			if (mp_typeof(*field) == MP_STR) {
+				uint32_t len;
+				const char *key = mp_decode_str(&field, &len);
+				if (len == name_len &&
+				    memcmp(key, name, len) == 0)
+					value = field;
+			} else {
+				mp_next(&field);
+			}
+			mp_next(&field);
+		}
+		if (value == NULL)
+			return NULL;
+		field = value;
+	}
+	return field;
+}
+
 int
 tuple_format_init()
 {
@@ -33,6 +33,7 @@
 
 #include "key_def.h" /* for enum field_type */
 #include "errinj.h"
+#include "bit/bit.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -66,6 +67,12 @@ enum { TUPLE_INDEX_BASE = 1 };
  */
 enum { TUPLE_OFFSET_SLOT_NIL = INT32_MAX };
 
+/*
+ * The maximal number of field offset checkpoints a tuple can
+ * cache in its field map, see tuple_format::offset_stride.
+ */
+enum { TUPLE_OFFSET_CHECKPOINT_MAX = 64 };
+
 /**
  * @brief Tuple field format
  * Support structure for struct tuple_format.
@@ -96,6 +103,14 @@ struct tuple_field_format {
 	 * gives the start of the field
 	 */
 	int32_t offset_slot;
+	/**
+	 * Slot in field map where the value of the field is
+	 * stored in native byte order, if the format has fixed
+	 * layout and the field is unsigned. The value occupies
+	 * two slots, starting from this one. Otherwise
+	 * TUPLE_OFFSET_SLOT_NIL.
+	 */
+	int32_t native_slot;
 };
 
 struct tuple;
@@ -106,6 +121,13 @@ struct tuple_format_vtab {
 	/** Free allocated tuple using engine-specific memory allocator. */
 	void
 	(*destroy)(struct tuple_format *format, struct tuple *tuple);
+	/**
+	 * Make the body of a tuple found in an index available
+	 * for reading, NULL if tuples are always in memory.
+	 * \sa tuple_fetch()
+	 */
+	struct tuple *
+	(*fetch)(struct tuple_format *format, struct tuple *tuple);
 };
 
 /**
@@ -125,6 +147,12 @@ struct tuple_format {
 	uint16_t id;
 	/** Reference counter */
 	int refs;
+	/**
+	 * Id of the space the format is created for, 0 for
+	 * formats of tuples out of spaces. Tuples of the formats
+	 * a space has had after alter stay in the space.
+	 */
+	uint32_t space_id;
 	/**
 	 * The number of extra bytes to reserve in tuples before
 	 * field map.
@@ -143,6 +171,38 @@ struct tuple_format {
 	uint32_t exact_field_count;
 	/* Length of 'fields' array. */
 	uint32_t field_count;
+	/**
+	 * The number of fields stored in native byte order in
+	 * the field map. A tuple of a format with fixed layout
+	 * keeps values of its unsigned indexed fields decoded,
+	 * so that comparators do not have to decode MessagePack.
+	 * The MessagePack body of the tuple stays intact and is
+	 * what is sent to clients, written to WAL and seen from
+	 * Lua.
+	 */
+	uint16_t native_field_count;
+	/**
+	 * If not 0, a tuple of this format caches the offset of
+	 * every offset_stride-th field (a checkpoint) in the
+	 * field map. Checkpoints are computed lazily, on first
+	 * access to a field which has no offset slot of its own,
+	 * so that such access costs at most offset_stride - 1
+	 * calls to mp_next() instead of a scan from the
+	 * beginning of the tuple. A stride of 1 makes the field
+	 * map a full offset table.
+	 */
+	uint16_t offset_stride;
+	/** The number of checkpoint slots in the field map. */
+	uint16_t offset_checkpoint_count;
+	/**
+	 * Offset slot of the checkpoint 0, which is never used:
+	 * checkpoint i, i.e. the offset of the field
+	 * i * offset_stride, is stored in the slot
+	 * offset_checkpoint_slot - i. An unset checkpoint is 0,
+	 * since no field can start at the beginning of the
+	 * MessagePack array.
+	 */
+	int32_t offset_checkpoint_slot;
 	/* Formats of the fields */
 	struct tuple_field_format fields[];
 };
@@ -208,6 +268,36 @@ tuple_format_new(struct tuple_format_vtab *vtab, struct key_def **keys,
 struct tuple_format *
 tuple_format_dup(const struct tuple_format *src);
 
+/**
+ * Make tuples of the format store unsigned indexed fields in
+ * native byte order in the field map, see
+ * tuple_format::native_field_count. The format must not have
+ * any tuples yet, since the size of the field map changes.
+ * Must be called before tuple_format_set_offset_stride().
+ *
+ * @retval  0 Success.
+ * @retval -1 The field map is too big.
+ */
+int
+tuple_format_set_fixed_layout(struct tuple_format *format);
+
+/**
+ * Make tuples of the format cache offsets of every @a stride-th
+ * field, see tuple_format::offset_stride. The format must not
+ * have any tuples yet, since the size of the field map changes.
+ * @param format          Tuple format.
+ * @param stride          Distance between two cached offsets,
+ *                        0 disables the cache.
+ * @param field_count_max The maximal number of fields in a
+ *                        tuple or 0 if it is unknown.
+ *
+ * @retval  0 Success.
+ * @retval -1 The field map is too big.
+ */
+int
+tuple_format_set_offset_stride(struct tuple_format *format, uint32_t stride,
+			       uint32_t field_count_max);
+
 /**
  * Returns the total size of tuple metadata of this format.
  * See @link struct tuple @endlink for explanation of tuple layout.
@@ -274,6 +364,32 @@ int
 tuple_init_field_map(const struct tuple_format *format, uint32_t *field_map,
 		     const char *tuple);
 
+/**
+ * Find a field using offset checkpoints of the field map,
+ * computing and caching the missing ones along the way.
+ *
+ * The field map is written through a const pointer. This is
+ * safe, because:
+ * - the field map is allocated together with the tuple, in
+ *   writable memory, and only the checkpoint slots, which are
+ *   not a part of the tuple value, are ever written;
+ * - a checkpoint is written only from the tx thread: other
+ *   threads (the snapshot and initial join cords) read tuples
+ *   with tuple_data_range() and never look at the field map;
+ * - a slot goes from 0 straight to its final value, which
+ *   depends only on the immutable MessagePack body, so a
+ *   reader never sees a wrong offset.
+ * Tuples of engines which do not guarantee the above must not
+ * have checkpoints, see ENGINE_CAN_CACHE_FIELD_OFFSETS.
+ *
+ * @pre format->offset_stride != 0
+ * @sa tuple_field_raw()
+ */
+const char *
+tuple_field_raw_checkpoint(const struct tuple_format *format,
+			   const char *tuple, const uint32_t *field_map,
+			   uint32_t field_no);
+
 /**
  * Get a field at the specific position in this MessagePack array.
  * Returns a pointer to MessagePack data.
@@ -302,6 +418,9 @@ tuple_field_raw(const struct tuple_format *format, const char *tuple,
 			return tuple + field_map[offset_slot];
 	}
 	ERROR_INJECT(ERRINJ_TUPLE_FIELD, return NULL);
+	if (format->offset_stride != 0 && field_no >= format->offset_stride)
+		return tuple_field_raw_checkpoint(format, tuple, field_map,
+						  field_no);
 	uint32_t field_count = mp_decode_array(&tuple);
 	if (unlikely(field_no >= field_count))
 		return NULL;
@@ -310,6 +429,39 @@ tuple_field_raw(const struct tuple_format *format, const char *tuple,
 	return tuple;
 }
 
+/**
+ * Find a value inside a field by an index path.
+ * @param field a pointer to MessagePack data of the field
+ * @param path a path, @sa index_opts::path
+ *
+ * @pre key_path_validate(path) == 0
+ * @returns the value data or NULL if there is no such value
+ */
+const char *
+tuple_field_go_to_path(const char *field, const char *path);
+
+/**
+ * Get the value of an unsigned field. The value is taken from
+ * the native slot of the field if the format has one, or
+ * decoded from MessagePack otherwise.
+ * @pre the field exists and is MP_UINT
+ * @sa tuple_field_raw()
+ */
+static inline uint64_t
+tuple_field_u64_raw(const struct tuple_format *format, const char *tuple,
+		    const uint32_t *field_map, uint32_t field_no)
+{
+	if (likely(field_no < format->field_count)) {
+		int32_t native_slot = format->fields[field_no].native_slot;
+		if (native_slot != TUPLE_OFFSET_SLOT_NIL)
+			return load_u64(field_map + native_slot);
+	}
+	const char *field = tuple_field_raw(format, tuple, field_map,
+					    field_no);
+	assert(field != NULL && mp_typeof(*field) == MP_UINT);
+	return mp_decode_uint(&field);
+}
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -189,16 +189,31 @@ struct hasher_signature {
 	uint32_t p[64];
 };
 
+/**
+ * Instantiate HASHER for every scalar field type of the last
+ * key part.
+ */
+#define HASHER_FOREACH_SCALAR_TYPE(...) \
+	HASHER(__VA_ARGS__, FIELD_TYPE_UNSIGNED) \
+	HASHER(__VA_ARGS__, FIELD_TYPE_STRING) \
+	HASHER(__VA_ARGS__, FIELD_TYPE_INTEGER) \
+	HASHER(__VA_ARGS__, FIELD_TYPE_NUMBER) \
+	HASHER(__VA_ARGS__, FIELD_TYPE_SCALAR)
+
 /**
  * field1 type,  field2 type, ...
  */
 static const hasher_signature hash_arr[] = {
 	HASHER(FIELD_TYPE_UNSIGNED)
 	HASHER(FIELD_TYPE_STRING)
-	HASHER(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
-	HASHER(FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED)
-	HASHER(FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING)
-	HASHER(FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
+	HASHER(FIELD_TYPE_INTEGER)
+	HASHER(FIELD_TYPE_NUMBER)
+	HASHER(FIELD_TYPE_SCALAR)
+	HASHER_FOREACH_SCALAR_TYPE(FIELD_TYPE_UNSIGNED)
+	HASHER_FOREACH_SCALAR_TYPE(FIELD_TYPE_STRING)
+	HASHER_FOREACH_SCALAR_TYPE(FIELD_TYPE_INTEGER)
+	HASHER_FOREACH_SCALAR_TYPE(FIELD_TYPE_NUMBER)
+	HASHER_FOREACH_SCALAR_TYPE(FIELD_TYPE_SCALAR)
 	HASHER(FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
 	HASHER(FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED, FIELD_TYPE_UNSIGNED)
 	HASHER(FIELD_TYPE_UNSIGNED, FIELD_TYPE_STRING  , FIELD_TYPE_UNSIGNED)
@@ -209,6 +224,7 @@ static const hasher_signature hash_arr[] = {
 	HASHER(FIELD_TYPE_STRING  , FIELD_TYPE_STRING  , FIELD_TYPE_STRING)
 };
 
+#undef HASHER_FOREACH_SCALAR_TYPE
 #undef HASHER
 
 uint32_t
@@ -251,6 +267,36 @@ slowpath:
 	key_def->key_hash = key_hash_slowpath;
 }
 
+/**
+ * Same as TupleHash<FIELD_TYPE_UNSIGNED>, but takes the value
+ * from the native slot of the field if there is one.
+ */
+static uint32_t
+tuple_hash_fixed_layout(const struct tuple *tuple,
+			const struct key_def *key_def)
+{
+	uint64_t val = tuple_field_u64_raw(tuple_format(tuple),
+					   tuple_data(tuple),
+					   tuple_field_map(tuple),
+					   key_def->parts->fieldno);
+	if (likely(val <= UINT32_MAX))
+		return val;
+	return ((uint32_t)((val)>>33^(val)^(val)<<11));
+}
+
+void
+tuple_hash_func_set_fixed_layout(struct key_def *key_def)
+{
+	/*
+	 * Multipart keys are hashed as MessagePack, see
+	 * field_hash(), and key_hash() must agree with
+	 * tuple_hash().
+	 */
+	if (key_def->part_count == 1 &&
+	    key_def->parts[0].type == FIELD_TYPE_UNSIGNED)
+		key_def->tuple_hash = tuple_hash_fixed_layout;
+}
+
 static uint32_t
 tuple_hash_field(uint32_t *ph1, uint32_t *pcarry, const char **field,
 		enum field_type type)
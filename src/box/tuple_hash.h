@@ -44,6 +44,16 @@ extern "C" {
 void
 tuple_hash_func_set(struct key_def *def);
 
+/**
+ * Make tuple_hash() of the key_def read the value from the
+ * native slot of the field map when possible. key_hash() is
+ * not changed.
+ * \sa tuple_format_set_fixed_layout()
+ * @param key_def key definition
+ */
+void
+tuple_hash_func_set_fixed_layout(struct key_def *def);
+
 /**
  * Calculates a common hash value for a tuple
  * @param tuple - a tuple
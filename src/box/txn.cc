@@ -34,6 +34,7 @@
 #include "journal.h"
 #include <fiber.h>
 #include "xrow.h"
+#include "replication.h"
 
 enum {
 	/**
@@ -101,6 +102,7 @@ txn_begin(bool is_autocommit)
 	txn->n_rows = 0;
 	txn->is_autocommit = is_autocommit;
 	txn->has_triggers  = false;
+	txn->is_sync = false;
 	txn->in_sub_stmt = 0;
 	txn->engine = NULL;
 	txn->engine_tx = NULL;
@@ -162,6 +164,10 @@ txn_commit_stmt(struct txn *txn, struct request *request)
 	if (!space_is_temporary(stmt->space)) {
 		txn_add_redo(stmt, request);
 		++txn->n_rows;
+		/* Only local changes wait, not replicated ones. */
+		if (stmt->space->def.opts.is_sync &&
+		    stmt->row->replica_id == 0)
+			txn->is_sync = true;
 	}
 	/*
 	 * If there are triggers, and they are not disabled, and
@@ -223,6 +229,22 @@ txn_write_to_wal(struct txn *txn)
 	return res;
 }
 
+/**
+ * Return the LSN WAL has assigned to the last row of
+ * a transaction, 0 if WAL is off.
+ */
+static int64_t
+txn_sync_lsn(struct txn *txn)
+{
+	int64_t lsn = 0;
+	struct txn_stmt *stmt;
+	stailq_foreach_entry(stmt, &txn->stmts, next) {
+		if (stmt->row != NULL)
+			lsn = stmt->row->lsn;
+	}
+	return lsn;
+}
+
 void
 txn_commit(struct txn *txn)
 {
@@ -230,6 +252,8 @@ txn_commit(struct txn *txn)
 
 	assert(stailq_empty(&txn->stmts) || txn->engine);
 
+	/* LSN of this instance to wait for replicas to write */
+	int64_t sync_lsn = -1;
 	/* Do transaction conflict resolving */
 	if (txn->engine) {
 		int64_t signature = -1;
@@ -237,6 +261,8 @@ txn_commit(struct txn *txn)
 
 		if (txn->n_rows > 0)
 			signature = txn_write_to_wal(txn);
+		if (txn->is_sync)
+			sync_lsn = txn_sync_lsn(txn);
 		/*
 		 * The transaction is in the binary log. No action below
 		 * may throw. In case an error has happened, there is
@@ -251,6 +277,13 @@ txn_commit(struct txn *txn)
 	/** Free volatile txn memory. */
 	fiber_gc();
 	fiber_set_txn(fiber(), NULL);
+	/*
+	 * The transaction is committed locally and is visible,
+	 * a timeout only tells the client that replicas may
+	 * not have it yet.
+	 */
+	if (sync_lsn > 0 && replication_synchro_wait(sync_lsn) != 0)
+		diag_raise();
 }
 
 /**
@@ -88,6 +88,11 @@ struct txn {
 	bool is_autocommit;
 	/** True if on_commit and on_rollback lists are non-empty. */
 	bool has_triggers;
+	/**
+	 * True if the transaction writes to a synchronous space
+	 * and its commit waits for replicas.
+	 */
+	bool is_sync;
 	/** The number of active nested statement-level transactions. */
 	int in_sub_stmt;
 	/** Engine involved in multi-statement transaction. */
@@ -6150,7 +6150,8 @@ vy_delete(struct vy_tx *tx, struct txn_stmt *stmt, struct space *space,
 	bool has_secondary = space->index_count > 1;
 	const char *key = request->key;
 	uint32_t part_count = mp_decode_array(&key);
-	if (vy_unique_key_validate(index, key, part_count))
+	if (! request_is_checked(request) &&
+	    vy_unique_key_validate(index, key, part_count))
 		return -1;
 	/*
 	 * There are two cases when need to get the full tuple
@@ -6266,7 +6267,8 @@ vy_update(struct vy_tx *tx, struct txn_stmt *stmt, struct space *space,
 		return -1;
 	const char *key = request->key;
 	uint32_t part_count = mp_decode_array(&key);
-	if (vy_unique_key_validate(index, key, part_count))
+	if (! request_is_checked(request) &&
+	    vy_unique_key_validate(index, key, part_count))
 		return -1;
 
 	if (vy_index_full_by_key(tx, index, key, part_count, &stmt->old_tuple))
@@ -6446,7 +6448,8 @@ vy_upsert(struct vy_tx *tx, struct txn_stmt *stmt, struct space *space,
 		return -1;
 	/* Primary key is dumped last. */
 	assert(!vy_is_committed_one(tx, pk));
-	if (tuple_validate_raw(space->format, tuple))
+	if (! request_is_checked(request) &&
+	    tuple_validate_raw(space->format, tuple))
 		return -1;
 
 	if (space->index_count == 1 && rlist_empty(&space->on_replace))
@@ -6611,7 +6614,8 @@ vy_replace(struct vy_tx *tx, struct txn_stmt *stmt, struct space *space,
 	if (vy_is_committed(tx, space))
 		return 0;
 	/* Check the tuple fields. */
-	if (tuple_validate_raw(space->format, request->tuple))
+	if (! request_is_checked(request) &&
+	    tuple_validate_raw(space->format, request->tuple))
 		return -1;
 	if (request->type == IPROTO_INSERT && env->status == VINYL_ONLINE)
 		return vy_insert(tx, stmt, space, request);
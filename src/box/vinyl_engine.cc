@@ -51,6 +51,7 @@
 
 struct tuple_format_vtab vy_tuple_format_vtab = {
 	vy_tuple_delete,
+	NULL,
 };
 
 /* Used by lua/info.c */
@@ -64,7 +65,7 @@ vinyl_engine_get_env()
 VinylEngine::VinylEngine()
 	:Engine("vinyl", &vy_tuple_format_vtab)
 {
-	flags = 0;
+	flags = ENGINE_READS_FROM_DISK;
 	env = NULL;
 }
 
@@ -170,6 +171,18 @@ VinylEngine::checkIndexDef(struct space *space, struct index_def *index_def)
 		          index_def->name,
 		          space_name(space));
 	}
+	if (index_def->opts.is_multikey) {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "vinyl does not support multikey indexes");
+	}
+	if (index_def->opts.path[0] != '\0') {
+		tnt_raise(ClientError, ER_MODIFY_INDEX,
+			  index_def->name,
+			  space_name(space),
+			  "vinyl does not support index paths");
+	}
 }
 
 void
@@ -41,12 +41,16 @@
 #include "cbus.h"
 #include "coeio.h"
 #include "replication.h"
+#include "wal_tail.h"
 
 
 const char *wal_mode_STRS[] = { "none", "write", "fsync", NULL };
 
 int wal_dir_lock = -1;
 
+/** Size of the in-memory copy of recent WAL rows for relays. */
+static const size_t WAL_TAIL_SIZE = 16 * 1024 * 1024;
+
 static int64_t
 wal_write(struct journal *, struct journal_entry *);
 
@@ -119,6 +123,12 @@ struct wal_writer
 	struct rlist watchers;
 	/** The lock protecting the watchers list. */
 	pthread_mutex_t watchers_mutex;
+	/**
+	 * Rows recently written to the current WAL, read by
+	 * relays. NULL in case of out of memory.
+	 */
+	struct wal_tail *tail;
+	struct wal_tail tail_storage;
 };
 
 struct wal_msg: public cmsg {
@@ -287,6 +297,18 @@ wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 
 	tt_pthread_mutex_init(&writer->watchers_mutex, NULL);
 	rlist_create(&writer->watchers);
+
+	writer->tail = NULL;
+	if (wal_mode != WAL_NONE) {
+		if (wal_tail_create(&writer->tail_storage, WAL_TAIL_SIZE,
+				    vclock) == 0) {
+			writer->tail = &writer->tail_storage;
+		} else {
+			/* Relays can do with xlog files. */
+			error_log(diag_last_error(diag_get()));
+			diag_clear(diag_get());
+		}
+	}
 }
 
 /** Destroy a WAL writer structure. */
@@ -295,6 +317,8 @@ wal_writer_destroy(struct wal_writer *writer)
 {
 	xdir_destroy(&writer->wal_dir);
 	tt_pthread_mutex_destroy(&writer->watchers_mutex);
+	if (writer->tail != NULL)
+		wal_tail_destroy(writer->tail);
 }
 
 /** WAL thread routine. */
@@ -568,6 +592,37 @@ wal_writer_begin_rollback(struct wal_writer *writer)
 static void
 wal_notify_watchers(struct wal_writer *writer);
 
+/** Copy rows of successfully written requests to the WAL tail. */
+static void
+wal_tail_append_entries(struct wal_writer *writer, struct stailq *commit,
+			struct journal_entry *last)
+{
+	if (writer->tail == NULL || last == NULL)
+		return;
+	struct journal_entry *entry;
+	stailq_foreach_entry(entry, commit, fifo) {
+		struct xrow_header **row = entry->rows;
+		for (; row < entry->rows + entry->n_rows; row++) {
+			struct iovec iov[XROW_IOVMAX];
+			int iovcnt = xrow_header_encode(*row, iov, 0);
+			if (iovcnt < 0) {
+				/*
+				 * The row is in the WAL file,
+				 * relays will read it from there.
+				 */
+				diag_clear(diag_get());
+				wal_tail_skip(writer->tail,
+					      (*row)->replica_id, (*row)->lsn);
+				continue;
+			}
+			wal_tail_append(writer->tail, (*row)->replica_id,
+					(*row)->lsn, iov, iovcnt);
+		}
+		if (entry == last)
+			break;
+	}
+}
+
 static void
 wal_assign_lsn(struct wal_writer *writer, struct xrow_header **row,
 	       struct xrow_header **end)
@@ -667,6 +722,7 @@ done:
 		stailq_next_entry(last_commit_entry, fifo) :
 		stailq_first_entry(&wal_msg->commit, struct journal_entry,
 				   fifo);
+	wal_tail_append_entries(writer, &wal_msg->commit, last_commit_entry);
 	if (rollback_entry) {
 		/* Update status of the successfully committed requests. */
 		for (entry = rollback_entry; entry != NULL;
@@ -882,6 +938,15 @@ wal_set_watcher(struct wal_watcher *watcher, struct ev_async *async)
 	return 0;
 }
 
+struct wal_tail *
+wal_tail()
+{
+	struct wal_writer *writer = &wal_writer_singleton;
+	if (journal_is_initialized(&writer->base) == false)
+		return NULL;
+	return writer->tail;
+}
+
 void
 wal_clear_watcher(struct wal_watcher *watcher)
 {
@@ -38,6 +38,7 @@
 struct fiber;
 struct vclock;
 struct wal_writer;
+struct wal_tail;
 
 enum wal_mode { WAL_NONE = 0, WAL_WRITE, WAL_FSYNC, WAL_MODE_MAX };
 
@@ -80,6 +81,13 @@ wal_set_watcher(struct wal_watcher *, struct ev_async *);
 void
 wal_clear_watcher(struct wal_watcher *);
 
+/**
+ * Return the in-memory copy of recently written WAL rows
+ * or NULL if there is none, \sa struct wal_tail.
+ */
+struct wal_tail *
+wal_tail();
+
 void
 wal_atfork();
 
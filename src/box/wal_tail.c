@@ -0,0 +1,192 @@
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "wal_tail.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trivia/util.h"
+#include "small/ibuf.h"
+#include "diag.h"
+#include "tt_pthread.h"
+
+int
+wal_tail_create(struct wal_tail *tail, size_t capacity,
+		const struct vclock *vclock)
+{
+	tail->buf = (char *) malloc(capacity);
+	if (tail->buf == NULL) {
+		diag_set(OutOfMemory, capacity, "malloc", "WAL tail");
+		return -1;
+	}
+	tail->capacity = capacity;
+	tail->begin = tail->end = 0;
+	vclock_copy(&tail->vclock, vclock);
+	tt_pthread_mutex_init(&tail->mutex, NULL);
+	return 0;
+}
+
+void
+wal_tail_destroy(struct wal_tail *tail)
+{
+	tt_pthread_mutex_destroy(&tail->mutex);
+	free(tail->buf);
+}
+
+/** Copy data to the ring at the given position. */
+static void
+wal_tail_write(struct wal_tail *tail, uint64_t pos, const void *data,
+	       size_t size)
+{
+	size_t offset = pos % tail->capacity;
+	size_t chunk = MIN(size, tail->capacity - offset);
+	memcpy(tail->buf + offset, data, chunk);
+	memcpy(tail->buf, (const char *) data + chunk, size - chunk);
+}
+
+/** Copy data from the ring at the given position. */
+static void
+wal_tail_copy(struct wal_tail *tail, uint64_t pos, void *data, size_t size)
+{
+	size_t offset = pos % tail->capacity;
+	size_t chunk = MIN(size, tail->capacity - offset);
+	memcpy(data, tail->buf + offset, chunk);
+	memcpy((char *) data + chunk, tail->buf, size - chunk);
+}
+
+/** Evict the oldest row. */
+static void
+wal_tail_evict(struct wal_tail *tail)
+{
+	assert(tail->begin < tail->end);
+	struct wal_tail_row row;
+	wal_tail_copy(tail, tail->begin, &row, sizeof(row));
+	vclock_follow(&tail->vclock, row.replica_id, row.lsn);
+	tail->begin += sizeof(row) + row.size;
+}
+
+void
+wal_tail_skip(struct wal_tail *tail, uint32_t replica_id, int64_t lsn)
+{
+	tt_pthread_mutex_lock(&tail->mutex);
+	while (tail->begin < tail->end)
+		wal_tail_evict(tail);
+	vclock_follow(&tail->vclock, replica_id, lsn);
+	/*
+	 * Move past the current position so that readers
+	 * waiting for the next row see that it has been evicted.
+	 */
+	tail->begin = tail->end = tail->end + 1;
+	tt_pthread_mutex_unlock(&tail->mutex);
+}
+
+void
+wal_tail_append(struct wal_tail *tail, uint32_t replica_id, int64_t lsn,
+		const struct iovec *iov, int iovcnt)
+{
+	struct wal_tail_row row;
+	row.lsn = lsn;
+	row.replica_id = replica_id;
+	row.size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		row.size += iov[i].iov_len;
+	size_t size = sizeof(row) + row.size;
+
+	if (size > tail->capacity) {
+		wal_tail_skip(tail, replica_id, lsn);
+		return;
+	}
+	tt_pthread_mutex_lock(&tail->mutex);
+	while (tail->end + size - tail->begin > tail->capacity)
+		wal_tail_evict(tail);
+	uint64_t pos = tail->end;
+	wal_tail_write(tail, pos, &row, sizeof(row));
+	pos += sizeof(row);
+	for (int i = 0; i < iovcnt; i++) {
+		wal_tail_write(tail, pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+	tail->end = pos;
+	tt_pthread_mutex_unlock(&tail->mutex);
+}
+
+int
+wal_tail_cursor_create(struct wal_tail *tail, struct wal_tail_cursor *cursor,
+		       const struct vclock *vclock)
+{
+	tt_pthread_mutex_lock(&tail->mutex);
+	/*
+	 * The reader has got every row written before the
+	 * oldest one iff its vclock is not less than the tail
+	 * vclock in any component.
+	 */
+	int cmp = vclock_compare(&tail->vclock, vclock);
+	cursor->pos = tail->begin;
+	tt_pthread_mutex_unlock(&tail->mutex);
+	return cmp == 0 || cmp == -1 ? 0 : -1;
+}
+
+int
+wal_tail_read(struct wal_tail *tail, struct wal_tail_cursor *cursor,
+	      struct ibuf *buf, size_t max_size)
+{
+	int rc = 0;
+	tt_pthread_mutex_lock(&tail->mutex);
+	if (cursor->pos < tail->begin) {
+		rc = 1;
+		goto out;
+	}
+	/* Find out how many rows fit. */
+	uint64_t end = cursor->pos;
+	while (end < tail->end) {
+		struct wal_tail_row row;
+		wal_tail_copy(tail, end, &row, sizeof(row));
+		size_t size = sizeof(row) + row.size;
+		if (end > cursor->pos && end + size - cursor->pos > max_size)
+			break;
+		end += size;
+	}
+	size_t size = end - cursor->pos;
+	if (size == 0)
+		goto out;
+	void *data = ibuf_alloc(buf, size);
+	if (data == NULL) {
+		diag_set(OutOfMemory, size, "ibuf_alloc", "WAL tail rows");
+		rc = -1;
+		goto out;
+	}
+	wal_tail_copy(tail, cursor->pos, data, size);
+	cursor->pos = end;
+out:
+	tt_pthread_mutex_unlock(&tail->mutex);
+	return rc;
+}
@@ -0,0 +1,165 @@
+#ifndef TARANTOOL_BOX_WAL_TAIL_H_INCLUDED
+#define TARANTOOL_BOX_WAL_TAIL_H_INCLUDED
+/*
+ * Copyright 2010-2017, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY AUTHORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * AUTHORS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "vclock.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+struct ibuf;
+
+/**
+ * WAL tail - a bounded in-memory copy of the rows most recently
+ * written to the WAL.
+ *
+ * The WAL thread appends every row it has successfully written
+ * to disk. Replication relays read rows from the tail instead of
+ * re-reading xlog files, as long as the rows they need are still
+ * there. Once a relay falls behind the tail, it goes back to
+ * reading files.
+ *
+ * The tail is a byte ring of encoded rows. Rows are evicted in
+ * the order they were written. Positions in the ring grow
+ * monotonically and are never reused, so a reader can tell
+ * whether the rows it needs have been evicted by comparing its
+ * position with the position of the oldest row.
+ */
+struct wal_tail {
+	/** Protects all members below. */
+	pthread_mutex_t mutex;
+	/** The ring. */
+	char *buf;
+	/** Size of the ring. */
+	size_t capacity;
+	/** Position of the oldest row. */
+	uint64_t begin;
+	/** Position following the newest row. */
+	uint64_t end;
+	/**
+	 * The vclock of the WAL before the oldest row. All rows
+	 * the WAL has not got at this vclock are in the ring.
+	 */
+	struct vclock vclock;
+};
+
+/** Header of a row in the ring and in the output of wal_tail_read(). */
+struct wal_tail_row {
+	/** Row LSN. */
+	int64_t lsn;
+	/** Row replica id. */
+	uint32_t replica_id;
+	/** Size of the encoded row following the header. */
+	uint32_t size;
+};
+
+/** A reader position in a WAL tail. */
+struct wal_tail_cursor {
+	/** Position of the next row to read. */
+	uint64_t pos;
+};
+
+/**
+ * Create a WAL tail.
+ *
+ * @param capacity  maximal size of rows kept in memory
+ * @param vclock    the WAL vclock at the moment of creation
+ *
+ * @retval 0 success
+ * @retval -1 out of memory, diag is set
+ */
+int
+wal_tail_create(struct wal_tail *tail, size_t capacity,
+		const struct vclock *vclock);
+
+void
+wal_tail_destroy(struct wal_tail *tail);
+
+/**
+ * Append a row written to the WAL, evicting the oldest rows
+ * if there is no room for it. A row larger than the ring is
+ * not kept, \sa wal_tail_skip().
+ *
+ * @param replica_id  row replica id
+ * @param lsn         row LSN
+ * @param iov, iovcnt the encoded row, \sa xrow_header_encode()
+ */
+void
+wal_tail_append(struct wal_tail *tail, uint32_t replica_id, int64_t lsn,
+		const struct iovec *iov, int iovcnt);
+
+/**
+ * Account for a row written to the WAL which is not kept in
+ * the tail. Evicts all rows, so that readers go to xlog files
+ * for it.
+ */
+void
+wal_tail_skip(struct wal_tail *tail, uint32_t replica_id, int64_t lsn);
+
+/**
+ * Position a cursor at the oldest row in the tail.
+ *
+ * @param vclock  the vclock of the reader
+ *
+ * @retval 0 success
+ * @retval -1 some rows the reader has not got yet have already
+ *         been evicted, the reader must use xlog files
+ */
+int
+wal_tail_cursor_create(struct wal_tail *tail, struct wal_tail_cursor *cursor,
+		       const struct vclock *vclock);
+
+/**
+ * Copy rows following the cursor to a buffer and advance the
+ * cursor. Each row is copied as struct wal_tail_row followed
+ * by the encoded row. At least one row is copied unless there
+ * are no new rows, no more than @a max_size bytes otherwise.
+ *
+ * @retval 0 success, nothing is copied if there are no new rows
+ * @retval 1 the rows following the cursor have been evicted
+ * @retval -1 out of memory, diag is set
+ */
+int
+wal_tail_read(struct wal_tail *tail, struct wal_tail_cursor *cursor,
+	      struct ibuf *buf, size_t max_size);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_BOX_WAL_TAIL_H_INCLUDED */
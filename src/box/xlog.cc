@@ -77,6 +77,8 @@ enum {
 	 * Maybe this should be a configuration option.
 	 */
 	XLOG_TX_COMPRESS_THRESHOLD = 2 * 1024,
+	/** Number of blocks in the cache of decompressed blocks */
+	XLOG_TX_CACHE_SIZE = 8,
 };
 
 const struct type type_XlogError = make_type("XlogError", &type_Exception);
@@ -912,6 +914,35 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	return 0;
 }
 
+/**
+ * Encode a fixheader of a tx: the magic, the length and crc32 of
+ * the tx data, padded to XLOG_FIXHEADER_SIZE.
+ */
+static void
+xlog_fixheader_encode(char *fixheader, log_magic_t magic, uint32_t len,
+		      uint32_t crc32c)
+{
+	*(log_magic_t *)fixheader = magic;
+	char *data = fixheader + sizeof(log_magic_t);
+	data = mp_encode_uint(data, len);
+	/* Encode crc32 for previous row */
+	data = mp_encode_uint(data, 0);
+	/* Encode crc32 for current row */
+	data = mp_encode_uint(data, crc32c);
+	/*
+	 * Encode a padding, to ensure the resulting
+	 * fixheader always has the same size.
+	 */
+	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
+	if (padding > 0) {
+		data = mp_encode_strl(data, padding - 1);
+		if (padding > 1) {
+			memset(data, 0, padding - 1);
+			data += padding - 1;
+		}
+	}
+}
+
 /**
  * Write a sequence of uncompressed xrow objects.
  *
@@ -926,14 +957,6 @@ xlog_tx_write_plain(struct xlog *log)
 	 * now populate it with data.
 	 */
 	char *fixheader = (char *)log->obuf.iov[0].iov_base;
-	*(log_magic_t *)fixheader = row_marker;
-	char *data = fixheader + sizeof(log_magic_t);
-
-	data = mp_encode_uint(data,
-			      obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, 0);
-	/* Encode crc32 for current row */
 	uint32_t crc32c = 0;
 	struct iovec *iov;
 	size_t offset = XLOG_FIXHEADER_SIZE;
@@ -943,19 +966,9 @@ xlog_tx_write_plain(struct xlog *log)
 				    iov->iov_len - offset);
 		offset = 0;
 	}
-	data = mp_encode_uint(data, crc32c);
-	/*
-	 * Encode a padding, to ensure the resulting
-	 * fixheader always has the same size.
-	 */
-	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0) {
-		data = mp_encode_strl(data, padding - 1);
-		if (padding > 1) {
-			memset(data, 0, padding - 1);
-			data += padding - 1;
-		}
-	}
+	xlog_fixheader_encode(fixheader, row_marker,
+			      obuf_size(&log->obuf) - XLOG_FIXHEADER_SIZE,
+			      crc32c);
 
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
@@ -1025,25 +1038,9 @@ xlog_tx_write_zstd(struct xlog *log)
 		offset = 0;
 	}
 
-	*(log_magic_t *)fixheader = zrow_marker;
-	char *data;
-	data = fixheader + sizeof(log_magic_t);
-	data = mp_encode_uint(data,
-			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, 0);
-	/* Encode crc32 for current row */
-	data = mp_encode_uint(data, crc32c);
-	/* Encode padding */
-	ssize_t padding;
-	padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0) {
-		data = mp_encode_strl(data, padding - 1);
-		if (padding > 1) {
-			memset(data, 0, padding - 1);
-			data += padding - 1;
-		}
-	}
+	xlog_fixheader_encode(fixheader, zrow_marker,
+			      obuf_size(&log->zbuf) - XLOG_FIXHEADER_SIZE,
+			      crc32c);
 
 	ERROR_INJECT(ERRINJ_WAL_WRITE_DISK, {
 		diag_set(ClientError, ER_INJECTION, "xlog write injection");
@@ -1503,6 +1500,29 @@ xlog_fixheader_decode(struct xlog_fixheader *fixheader,
 	return 0;
 }
 
+size_t
+xlog_tx_encode_bound(size_t size)
+{
+	return XLOG_FIXHEADER_SIZE + ZSTD_compressBound(size);
+}
+
+ssize_t
+xlog_tx_encode(const char *rows, size_t size, char *block, int level,
+	       ZSTD_CCtx *zctx)
+{
+	char *zdst = block + XLOG_FIXHEADER_SIZE;
+	size_t zsize = ZSTD_compressCCtx(zctx, zdst, ZSTD_compressBound(size),
+					 rows, size, level);
+	if (ZSTD_isError(zsize)) {
+		diag_set(ClientError, ER_COMPRESSION,
+			 ZSTD_getErrorName(zsize));
+		return -1;
+	}
+	xlog_fixheader_encode(block, zrow_marker, zsize,
+			      crc32_calc(0, zdst, zsize));
+	return XLOG_FIXHEADER_SIZE + zsize;
+}
+
 int
 xlog_tx_decode(const char *data, const char *data_end,
 	       char *rows, char *rows_end, ZSTD_DStream *zdctx)
@@ -1556,6 +1576,119 @@ xlog_tx_decode(const char *data, const char *data_end,
 	return 0;
 }
 
+/* {{{ xlog_tx_cache */
+
+/** Rows decompressed from a tx block. */
+struct xlog_tx_cache_entry {
+	/** Compressed data of the block, NULL if the entry is free */
+	char *data;
+	/** Size of the compressed data */
+	size_t data_size;
+	/** Checksum of the compressed data, from the fixheader */
+	uint32_t crc32c;
+	/** Rows decompressed from the data */
+	char *rows;
+	/** Size of the rows */
+	size_t rows_size;
+	/** xlog_tx_cache::clock as of the last use of the entry */
+	uint64_t used;
+};
+
+/** Blocks recently decompressed by cursors of a thread. */
+struct xlog_tx_cache {
+	struct xlog_tx_cache_entry entries[XLOG_TX_CACHE_SIZE];
+	/** Incremented on every use of an entry */
+	uint64_t clock;
+};
+
+static __thread struct xlog_tx_cache *xlog_tx_cache;
+
+int
+xlog_tx_cache_enable(void)
+{
+	assert(xlog_tx_cache == NULL);
+	xlog_tx_cache = (struct xlog_tx_cache *)
+		calloc(1, sizeof(*xlog_tx_cache));
+	if (xlog_tx_cache == NULL) {
+		diag_set(OutOfMemory, sizeof(*xlog_tx_cache),
+			 "calloc", "xlog tx cache");
+		return -1;
+	}
+	return 0;
+}
+
+void
+xlog_tx_cache_disable(void)
+{
+	if (xlog_tx_cache == NULL)
+		return;
+	for (int i = 0; i < XLOG_TX_CACHE_SIZE; i++) {
+		free(xlog_tx_cache->entries[i].data);
+		free(xlog_tx_cache->entries[i].rows);
+	}
+	free(xlog_tx_cache);
+	xlog_tx_cache = NULL;
+}
+
+/**
+ * Find the rows decompressed from @a data. The checksum only
+ * narrows the search, the data is compared byte by byte.
+ */
+static struct xlog_tx_cache_entry *
+xlog_tx_cache_find(struct xlog_tx_cache *cache, uint32_t crc32c,
+		   const char *data, size_t data_size)
+{
+	for (int i = 0; i < XLOG_TX_CACHE_SIZE; i++) {
+		struct xlog_tx_cache_entry *entry = &cache->entries[i];
+		if (entry->data != NULL && entry->crc32c == crc32c &&
+		    entry->data_size == data_size &&
+		    memcmp(entry->data, data, data_size) == 0) {
+			entry->used = ++cache->clock;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Remember the rows decompressed from @a data in place of the
+ * least recently used entry. The cache is only an optimization,
+ * so the entry is just dropped if there is no memory for it.
+ */
+static void
+xlog_tx_cache_put(struct xlog_tx_cache *cache, uint32_t crc32c,
+		  const char *data, size_t data_size,
+		  const char *rows, size_t rows_size)
+{
+	struct xlog_tx_cache_entry *entry = &cache->entries[0];
+	for (int i = 1; i < XLOG_TX_CACHE_SIZE; i++) {
+		if (cache->entries[i].used < entry->used)
+			entry = &cache->entries[i];
+	}
+	char *new_data = (char *) realloc(entry->data, data_size);
+	if (new_data == NULL)
+		goto drop;
+	entry->data = new_data;
+	char *new_rows;
+	new_rows = (char *) realloc(entry->rows, rows_size);
+	if (new_rows == NULL)
+		goto drop;
+	entry->rows = new_rows;
+	memcpy(entry->data, data, data_size);
+	entry->data_size = data_size;
+	entry->crc32c = crc32c;
+	memcpy(entry->rows, rows, rows_size);
+	entry->rows_size = rows_size;
+	entry->used = ++cache->clock;
+	return;
+drop:
+	free(entry->data);
+	free(entry->rows);
+	memset(entry, 0, sizeof(*entry));
+}
+
+/* }}} */
+
 /**
  * @retval -1 error
  * @retval 0 success
@@ -1583,6 +1716,8 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 		return -1;
 	}
 	data_end = rpos + fixheader.len;
+	tx_cursor->block = *data;
+	tx_cursor->block_size = data_end - *data;
 
 	ibuf_create(&tx_cursor->rows, &cord()->slabc,
 		    XLOG_TX_AUTOCOMMIT_THRESHOLD);
@@ -1601,6 +1736,26 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 	};
 
 	assert(fixheader.magic == zrow_marker);
+	struct xlog_tx_cache *cache = xlog_tx_cache;
+	if (cache != NULL) {
+		struct xlog_tx_cache_entry *entry =
+			xlog_tx_cache_find(cache, fixheader.crc32c, rpos,
+					   fixheader.len);
+		if (entry != NULL) {
+			void *dst = ibuf_alloc(&tx_cursor->rows,
+					       entry->rows_size);
+			if (dst == NULL) {
+				diag_set(OutOfMemory, entry->rows_size,
+					 "runtime", "xlog rows buffer");
+				ibuf_destroy(&tx_cursor->rows);
+				return -1;
+			}
+			memcpy(dst, entry->rows, entry->rows_size);
+			*data = data_end;
+			return 0;
+		}
+	}
+	const char *zdata = rpos;
 	ZSTD_initDStream(zdctx);
 	int rc;
 	do {
@@ -1616,6 +1771,11 @@ xlog_tx_cursor_create(struct xlog_tx_cursor *tx_cursor,
 					      data_end, zdctx)) == 1);
 	if (rc != 0)
 		return -1;
+	if (cache != NULL) {
+		xlog_tx_cache_put(cache, fixheader.crc32c, zdata,
+				  fixheader.len, tx_cursor->rows.rpos,
+				  ibuf_used(&tx_cursor->rows));
+	}
 
 	*data = rpos;
 	assert(*data <= data_end);
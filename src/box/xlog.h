@@ -462,6 +462,23 @@ xlog_atfork(struct xlog *xlog);
 
 /* {{{ xlog_tx_cursor - iterate over rows in xlog transaction */
 
+/**
+ * Make xlog cursors of the current thread keep the last few
+ * decompressed tx blocks and reuse them when they read the same
+ * block again. Cursors which read the same files close to each
+ * other, e.g. relays of replicas at about the same position,
+ * then decompress each block once.
+ *
+ * @retval  0 success
+ * @retval -1 error, check diag
+ */
+int
+xlog_tx_cache_enable(void);
+
+/** Free the blocks cached by xlog_tx_cache_enable(). */
+void
+xlog_tx_cache_disable(void);
+
 /**
  * xlog tx iterator
  */
@@ -469,6 +486,10 @@ struct xlog_tx_cursor
 {
 	/** rows buffer */
 	struct ibuf rows;
+	/** raw tx data the rows are decoded from, with fixheader */
+	const char *block;
+	/** size of the raw tx data */
+	size_t block_size;
 };
 
 /**
@@ -500,6 +521,28 @@ xlog_tx_cursor_destroy(struct xlog_tx_cursor *tx_cursor);
 int
 xlog_tx_cursor_next_row(struct xlog_tx_cursor *tx_cursor, struct xrow_header *xrow);
 
+/**
+ * Max size of a tx block made of rows of @a size bytes by
+ * xlog_tx_encode().
+ */
+size_t
+xlog_tx_encode_bound(size_t size);
+
+/**
+ * Compress rows into a raw tx buffer of the same format as
+ * the one written to xlog files, to be read by xlog_tx_decode().
+ *
+ * @param rows encoded rows
+ * @param size the size of @a rows
+ * @param[out] block a buffer of xlog_tx_encode_bound() bytes
+ * @param level zstd compression level
+ * @retval >0 the size of the block
+ * @retval -1 error, check diag
+ */
+ssize_t
+xlog_tx_encode(const char *rows, size_t size, char *block, int level,
+	       ZSTD_CCtx *zctx);
+
 /**
  * A conventional helper to decode rows from the raw tx buffer.
  * Decodes fixheader, checks crc32 and length, decompresses rows.
@@ -636,6 +679,50 @@ xlog_cursor_next(struct xlog_cursor *cursor,
 int
 xlog_cursor_find_tx_magic(struct xlog_cursor *i);
 
+/**
+ * Return true if all rows of the current tx have been read,
+ * so that the next row read starts a new tx.
+ */
+static inline bool
+xlog_cursor_tx_is_read(struct xlog_cursor *cursor)
+{
+	return cursor->state != XLOG_CURSOR_TX ||
+	       ibuf_used(&cursor->tx_cursor.rows) == 0;
+}
+
+/**
+ * Get the current tx both as stored in the file and decoded.
+ * Valid until the next tx is read.
+ * @param cursor cursor, a row of the tx has been read
+ * @param[out] block raw tx data: fixheader and rows,
+ *             compressed or not, see xlog_tx_decode()
+ * @param[out] block_size size of @a block
+ * @param[out] rows all rows of the tx, including read ones
+ * @param[out] rows_size size of @a rows
+ */
+static inline void
+xlog_cursor_tx(struct xlog_cursor *cursor, const char **block,
+	       size_t *block_size, const char **rows, size_t *rows_size)
+{
+	assert(cursor->state == XLOG_CURSOR_TX);
+	struct xlog_tx_cursor *tx_cursor = &cursor->tx_cursor;
+	*block = tx_cursor->block;
+	*block_size = tx_cursor->block_size;
+	*rows = tx_cursor->rows.buf;
+	*rows_size = tx_cursor->rows.wpos - tx_cursor->rows.buf;
+}
+
+/**
+ * Skip the rows of the current tx which haven't been read,
+ * the next row read starts a new tx.
+ */
+static inline void
+xlog_cursor_skip_tx(struct xlog_cursor *cursor)
+{
+	assert(cursor->state == XLOG_CURSOR_TX);
+	cursor->tx_cursor.rows.rpos = cursor->tx_cursor.rows.wpos;
+}
+
 /* }}} */
 
 /** {{{ miscellaneous log io functions. */
@@ -39,6 +39,7 @@
 #include "error.h"
 #include "vclock.h"
 #include "scramble.h"
+#include "mp_scan.h"
 #include "iproto_constants.h"
 
 enum { HEADER_LEN_MAX = 40, BODY_LEN_MAX = 128 };
@@ -215,7 +216,7 @@ error:
 		}
 		uint64_t key = mp_decode_uint(&data);
 		const char *value = data;
-		if (mp_check(&data, end) ||
+		if (mp_check_fast(&data, end) ||
 		    key >= IPROTO_KEY_MAX ||
 		    iproto_key_type[key] != mp_typeof(*value))
 			goto error;
@@ -436,7 +437,7 @@ void
 xrow_encode_subscribe(struct xrow_header *row,
 		      const struct tt_uuid *replicaset_uuid,
 		      const struct tt_uuid *instance_uuid,
-		      const struct vclock *vclock)
+		      const struct vclock *vclock, uint32_t compression)
 {
 	memset(row, 0, sizeof(*row));
 	uint32_t replicaset_size = vclock_size(vclock);
@@ -444,7 +445,12 @@ xrow_encode_subscribe(struct xrow_header *row,
 		(mp_sizeof_uint(UINT32_MAX) + mp_sizeof_uint(UINT64_MAX));
 	char *buf = (char *) region_alloc_xc(&fiber()->gc, size);
 	char *data = buf;
-	data = mp_encode_map(data, 3);
+	/* Don't confuse older masters with the key if it's off. */
+	data = mp_encode_map(data, compression > 0 ? 4 : 3);
+	if (compression > 0) {
+		data = mp_encode_uint(data, IPROTO_COMPRESSION);
+		data = mp_encode_uint(data, compression);
+	}
 	data = mp_encode_uint(data, IPROTO_CLUSTER_UUID);
 	data = xrow_encode_uuid(data, replicaset_uuid);
 	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
@@ -464,9 +470,13 @@ xrow_encode_subscribe(struct xrow_header *row,
 	row->type = IPROTO_SUBSCRIBE;
 }
 
-void
-xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
-		      struct tt_uuid *instance_uuid, struct vclock *vclock)
+/** Decode keys of SUBSCRIBE or JOIN, skip keys not asked for. */
+static void
+xrow_decode_replication(struct xrow_header *row,
+			struct tt_uuid *replicaset_uuid,
+			struct tt_uuid *instance_uuid, struct vclock *vclock,
+			uint64_t *join_offset, uint32_t *compression,
+			bool *replica_ack)
 {
 	if (row->bodycnt == 0)
 		tnt_raise(ClientError, ER_INVALID_MSGPACK, "request body");
@@ -508,6 +518,33 @@ xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
 			lsnmap = d;
 			mp_next(&d);
 			break;
+		case IPROTO_COMPRESSION:
+			if (compression == NULL)
+				goto skip;
+			if (mp_typeof(*d) != MP_UINT) {
+				tnt_raise(ClientError, ER_INVALID_MSGPACK,
+					  "invalid COMPRESSION");
+			}
+			*compression = mp_decode_uint(&d);
+			break;
+		case IPROTO_JOIN_OFFSET:
+			if (join_offset == NULL)
+				goto skip;
+			if (mp_typeof(*d) != MP_UINT) {
+				tnt_raise(ClientError, ER_INVALID_MSGPACK,
+					  "invalid JOIN_OFFSET");
+			}
+			*join_offset = mp_decode_uint(&d);
+			break;
+		case IPROTO_REPLICA_ACK:
+			if (replica_ack == NULL)
+				goto skip;
+			if (mp_typeof(*d) != MP_UINT) {
+				tnt_raise(ClientError, ER_INVALID_MSGPACK,
+					  "invalid REPLICA_ACK");
+			}
+			*replica_ack = mp_decode_uint(&d) != 0;
+			break;
 		default: skip:
 			mp_next(&d); /* value */
 		}
@@ -534,17 +571,48 @@ xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
 }
 
 void
-xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
+xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
+		      struct tt_uuid *instance_uuid, struct vclock *vclock,
+		      uint32_t *compression)
+{
+	xrow_decode_replication(row, replicaset_uuid, instance_uuid, vclock,
+				NULL, compression, NULL);
+}
+
+void
+xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid,
+		 const struct vclock *vclock, uint64_t offset,
+		 uint32_t compression)
 {
 	memset(row, 0, sizeof(*row));
 
-	size_t size = 64;
+	uint32_t replicaset_size = offset > 0 ? vclock_size(vclock) : 0;
+	size_t size = BODY_LEN_MAX + replicaset_size *
+		(mp_sizeof_uint(UINT32_MAX) + mp_sizeof_uint(UINT64_MAX));
 	char *buf = (char *) region_alloc_xc(&fiber()->gc, size);
 	char *data = buf;
-	data = mp_encode_map(data, 1);
+	/* Don't confuse older masters with the keys they don't know. */
+	data = mp_encode_map(data, 1 + (offset > 0 ? 2 : 0) +
+			     (compression > 0 ? 1 : 0));
 	data = mp_encode_uint(data, IPROTO_INSTANCE_UUID);
 	/* Greet the remote replica with our replica UUID */
 	data = xrow_encode_uuid(data, instance_uuid);
+	if (offset > 0) {
+		data = mp_encode_uint(data, IPROTO_JOIN_OFFSET);
+		data = mp_encode_uint(data, offset);
+		data = mp_encode_uint(data, IPROTO_VCLOCK);
+		data = mp_encode_map(data, replicaset_size);
+		struct vclock_iterator it;
+		vclock_iterator_init(&it, vclock);
+		vclock_foreach(&it, replica) {
+			data = mp_encode_uint(data, replica.id);
+			data = mp_encode_uint(data, replica.lsn);
+		}
+	}
+	if (compression > 0) {
+		data = mp_encode_uint(data, IPROTO_COMPRESSION);
+		data = mp_encode_uint(data, compression);
+	}
 	assert(data <= buf + size);
 
 	row->body[0].iov_base = buf;
@@ -554,17 +622,31 @@ xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid)
 }
 
 void
-xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
+xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid,
+		 struct vclock *vclock, uint64_t *offset,
+		 uint32_t *compression)
+{
+	xrow_decode_replication(row, NULL, instance_uuid, vclock, offset,
+				compression, NULL);
+}
+
+/**
+ * Encode a vclock into an OK response body, optionally with
+ * REPLICA_ACK flag set.
+ */
+static void
+xrow_encode_vclock_body(struct xrow_header *row, const struct vclock *vclock,
+			bool replica_ack)
 {
 	memset(row, 0, sizeof(*row));
 
 	/* Add vclock to response body */
 	uint32_t replicaset_size = vclock_size(vclock);
-	size_t size = 8 + replicaset_size *
+	size_t size = 16 + replicaset_size *
 		(mp_sizeof_uint(UINT32_MAX) + mp_sizeof_uint(UINT64_MAX));
 	char *buf = (char *) region_alloc_xc(&fiber()->gc, size);
 	char *data = buf;
-	data = mp_encode_map(data, 1);
+	data = mp_encode_map(data, replica_ack ? 2 : 1);
 	data = mp_encode_uint(data, IPROTO_VCLOCK);
 	data = mp_encode_map(data, replicaset_size);
 	struct vclock_iterator it;
@@ -573,6 +655,10 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 		data = mp_encode_uint(data, replica.id);
 		data = mp_encode_uint(data, replica.lsn);
 	}
+	if (replica_ack) {
+		data = mp_encode_uint(data, IPROTO_REPLICA_ACK);
+		data = mp_encode_uint(data, 1);
+	}
 	assert(data <= buf + size);
 	row->body[0].iov_base = buf;
 	row->body[0].iov_len = (data - buf);
@@ -580,6 +666,88 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
 	row->type = IPROTO_OK;
 }
 
+void
+xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock)
+{
+	xrow_encode_vclock_body(row, vclock, false);
+}
+
+void
+xrow_encode_subscribe_response(struct xrow_header *row,
+			       const struct vclock *vclock)
+{
+	xrow_encode_vclock_body(row, vclock, true);
+}
+
+void
+xrow_decode_subscribe_response(struct xrow_header *row,
+			       struct vclock *vclock, bool *replica_ack)
+{
+	xrow_decode_replication(row, NULL, NULL, vclock, NULL, NULL,
+				replica_ack);
+}
+
+void
+xrow_encode_tx_block(struct xrow_header *row, const char *block,
+		     uint32_t size, uint32_t len)
+{
+	memset(row, 0, sizeof(*row));
+	size_t buf_size = mp_sizeof_map(2) +
+		mp_sizeof_uint(IPROTO_TX_LEN) + mp_sizeof_uint(len) +
+		mp_sizeof_uint(IPROTO_TX_DATA) + mp_sizeof_binl(size);
+	char *buf = (char *) region_alloc_xc(&fiber()->gc, buf_size);
+	char *data = buf;
+	data = mp_encode_map(data, 2);
+	data = mp_encode_uint(data, IPROTO_TX_LEN);
+	data = mp_encode_uint(data, len);
+	data = mp_encode_uint(data, IPROTO_TX_DATA);
+	data = mp_encode_binl(data, size);
+	assert(data == buf + buf_size);
+	row->body[0].iov_base = buf;
+	row->body[0].iov_len = buf_size;
+	row->body[1].iov_base = (void *) block;
+	row->body[1].iov_len = size;
+	row->bodycnt = 2;
+	row->type = IPROTO_TX_BLOCK;
+}
+
+void
+xrow_decode_tx_block(struct xrow_header *row, const char **block,
+		     uint32_t *size, uint32_t *len)
+{
+	if (row->bodycnt == 0)
+		tnt_raise(ClientError, ER_INVALID_MSGPACK, "request body");
+	assert(row->bodycnt == 1);
+	const char *data = (const char *) row->body[0].iov_base;
+	const char *end = data + row->body[0].iov_len;
+	const char *d = data;
+	if (mp_check(&d, end) != 0 || mp_typeof(*data) != MP_MAP)
+		tnt_raise(ClientError, ER_INVALID_MSGPACK, "request body");
+
+	*block = NULL;
+	*len = 0;
+	d = data;
+	uint32_t map_size = mp_decode_map(&d);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*d) != MP_UINT) {
+			mp_next(&d); /* key */
+			mp_next(&d); /* value */
+			continue;
+		}
+		uint8_t key = mp_decode_uint(&d);
+		if (key == IPROTO_TX_LEN && mp_typeof(*d) == MP_UINT) {
+			*len = mp_decode_uint(&d);
+		} else if (key == IPROTO_TX_DATA && mp_typeof(*d) == MP_BIN) {
+			*block = mp_decode_bin(&d, size);
+		} else {
+			mp_next(&d); /* value */
+		}
+	}
+	/* The rows are unpacked into a buffer of this size. */
+	if (*block == NULL || *len == 0 || *len > IPROTO_TX_LEN_MAX)
+		tnt_raise(ClientError, ER_INVALID_MSGPACK, "TX_BLOCK");
+}
+
 void
 greeting_encode(char *greetingbuf, uint32_t version_id, const tt_uuid *uuid,
 		const char *salt, uint32_t salt_len)
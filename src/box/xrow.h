@@ -122,6 +122,12 @@ struct request
 	const char *ops_end;
 	/** Base field offset for UPDATE/UPSERT, e.g. 0 for C and 1 for Lua. */
 	int index_base;
+	/**
+	 * If not 0, the schema version at which the tuple or the
+	 * key of the request was found valid before the request
+	 * reached tx. \sa request_check().
+	 */
+	uint32_t checked_schema_version;
 };
 
 /**
@@ -289,12 +295,13 @@ xrow_encode_auth(struct xrow_header *row, const char *salt, size_t salt_len,
  * \param replicaset_uuid replica set uuid
  * \param instance_uuid instance uuid
  * \param vclock replication clock
+ * \param compression zstd level of the stream, 0 for none
 */
 void
 xrow_encode_subscribe(struct xrow_header *row,
 		      const struct tt_uuid *replicaset_uuid,
 		      const struct tt_uuid *instance_uuid,
-		      const struct vclock *vclock);
+		      const struct vclock *vclock, uint32_t compression);
 
 /**
  * \brief Decode SUBSCRIBE command
@@ -302,29 +309,39 @@ xrow_encode_subscribe(struct xrow_header *row,
  * \param[out] replicaset_uuid
  * \param[out] instance_uuid
  * \param[out] vclock
+ * \param[out] compression, left intact if not asked for
 */
 void
 xrow_decode_subscribe(struct xrow_header *row, struct tt_uuid *replicaset_uuid,
-		      struct tt_uuid *instance_uuid, struct vclock *vclock);
+		      struct tt_uuid *instance_uuid, struct vclock *vclock,
+		      uint32_t *compression);
 
 /**
  * \brief Encode JOIN command
  * \param[out] row
  * \param instance_uuid
+ * \param vclock checkpoint of the interrupted JOIN to resume
+ * \param offset number of initial JOIN rows already received,
+ *        0 to join from scratch
+ * \param compression zstd level of the stream, 0 for none
 */
 void
-xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid);
+xrow_encode_join(struct xrow_header *row, const struct tt_uuid *instance_uuid,
+		 const struct vclock *vclock, uint64_t offset,
+		 uint32_t compression);
 
 /**
  * \brief Decode JOIN command
  * \param row
  * \param[out] instance_uuid
+ * \param[out] vclock, left intact if JOIN is not resumed
+ * \param[out] offset, left intact if JOIN is not resumed
+ * \param[out] compression, left intact if not asked for
 */
-static inline void
-xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid)
-{
-	return xrow_decode_subscribe(row, NULL, instance_uuid, NULL);
-}
+void
+xrow_decode_join(struct xrow_header *row, struct tt_uuid *instance_uuid,
+		 struct vclock *vclock, uint64_t *offset,
+		 uint32_t *compression);
 
 /**
  * \brief Encode end of stream command (a response to JOIN command)
@@ -342,9 +359,56 @@ xrow_encode_vclock(struct xrow_header *row, const struct vclock *vclock);
 static inline void
 xrow_decode_vclock(struct xrow_header *row, struct vclock *vclock)
 {
-	return xrow_decode_subscribe(row, NULL, NULL, vclock);
+	return xrow_decode_subscribe(row, NULL, NULL, vclock, NULL);
 }
 
+/**
+ * \brief Encode a response to SUBSCRIBE command
+ * \param[out] row
+ * \param vclock the current vclock of the master
+ *
+ * The response tells the replica that the master reads vclocks
+ * it acknowledges (see xrow_encode_vclock()) from the socket.
+*/
+void
+xrow_encode_subscribe_response(struct xrow_header *row,
+			       const struct vclock *vclock);
+
+/**
+ * \brief Decode a response to SUBSCRIBE command
+ * \param row
+ * \param[out] vclock
+ * \param[out] replica_ack, left intact if the master doesn't
+ *             read acks
+*/
+void
+xrow_decode_subscribe_response(struct xrow_header *row,
+			       struct vclock *vclock, bool *replica_ack);
+
+/**
+ * \brief Encode a block of rows (a reply to SUBSCRIBE asking
+ * for compression)
+ * \param row[out]
+ * \param block rows in the xlog tx format, see xlog_tx_encode()
+ * \param size the size of \a block
+ * \param len the size of the rows unpacked
+*/
+void
+xrow_encode_tx_block(struct xrow_header *row, const char *block,
+		     uint32_t size, uint32_t len);
+
+/**
+ * \brief Decode a block of rows, the size of the rows unpacked
+ * must not exceed IPROTO_TX_LEN_MAX
+ * \param row
+ * \param[out] block rows in the xlog tx format
+ * \param[out] size the size of \a block
+ * \param[out] len the size of the rows unpacked
+*/
+void
+xrow_decode_tx_block(struct xrow_header *row, const char **block,
+		     uint32_t *size, uint32_t *len);
+
 #endif
 
 #endif /* TARANTOOL_XROW_H_INCLUDED */
@@ -61,6 +61,26 @@ coio_read_xrow(struct ev_io *coio, struct ibuf *in, struct xrow_header *row)
 	xrow_header_decode_xc(row, (const char **) &in->rpos, in->rpos + len);
 }
 
+bool
+xrow_read_buffered(struct ibuf *in, struct xrow_header *row)
+{
+	const char *pos = in->rpos;
+	if (pos == in->wpos)
+		return false;
+	if (mp_typeof(*pos) != MP_UINT) {
+		tnt_raise(ClientError, ER_INVALID_MSGPACK,
+			  "packet length");
+	}
+	if (mp_check_uint(pos, in->wpos) > 0)
+		return false;
+	uint32_t len = mp_decode_uint(&pos);
+	if ((size_t) (in->wpos - pos) < len)
+		return false;
+	in->rpos = (char *) pos;
+	xrow_header_decode_xc(row, (const char **) &in->rpos, in->rpos + len);
+	return true;
+}
+
 void
 coio_write_xrow(struct ev_io *coio, const struct xrow_header *row)
 {
@@ -30,6 +30,8 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <stdbool.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -44,6 +46,16 @@ coio_read_xrow(struct ev_io *coio, struct ibuf *in, struct xrow_header *row);
 void
 coio_write_xrow(struct ev_io *coio, const struct xrow_header *row);
 
+/**
+ * Decode the next row from the input buffer without reading
+ * from the socket.
+ *
+ * @retval true  the row has been decoded
+ * @retval false the row has not been read entirely yet
+ */
+bool
+xrow_read_buffered(struct ibuf *in, struct xrow_header *row);
+
 
 #if defined(__cplusplus)
 } /* extern "C" */
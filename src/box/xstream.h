@@ -32,25 +32,45 @@
  * SUCH DAMAGE.
  */
 
+#include <stdbool.h>
+#include <stddef.h>
 #include "diag.h"
 
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
 
+struct vclock;
 struct xrow_header;
 struct xstream;
 
 typedef void (*xstream_write_f)(struct xstream *, struct xrow_header *);
 
+/**
+ * Write a whole xlog tx at once, see xlog_cursor_tx().
+ * @a vclock is the vclock of the stream as of the last row
+ * of the tx, so the stream needn't decode the rows to tell
+ * which replicas wrote them.
+ * May throw, like xstream_write_f.
+ * @retval true the tx is written
+ * @retval false the stream wants the rows one by one
+ */
+typedef bool (*xstream_write_tx_f)(struct xstream *, const char *block,
+				   size_t block_size, const char *rows,
+				   size_t rows_size,
+				   const struct vclock *vclock);
+
 struct xstream {
 	xstream_write_f write;
+	/** Optional, NULL if rows are written one by one. */
+	xstream_write_tx_f write_tx;
 };
 
 static inline void
 xstream_create(struct xstream *xstream, xstream_write_f write)
 {
 	xstream->write = write;
+	xstream->write_tx = NULL;
 }
 
 int
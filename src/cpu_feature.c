@@ -109,3 +109,42 @@ sse42_enabled_cpu()
 }
 
 #endif
+
+#if defined(ENABLE_MP_SCAN_SIMD) && defined (__x86_64__)
+
+#include <cpuid.h>
+
+bool
+avx2_enabled_cpu()
+{
+	unsigned int ax, bx, cx, dx;
+
+	if (__get_cpuid(1, &ax, &bx, &cx, &dx) == 0)
+		return 0;
+	/* OSXSAVE: the OS may have enabled YMM state saving. */
+	if ((cx & (1 << 27)) == 0)
+		return 0;
+	unsigned int xcr0_lo, xcr0_hi;
+	__asm__ __volatile__(
+		"xgetbv"
+		:"=a"(xcr0_lo), "=d"(xcr0_hi)
+		:"c"(0)
+	);
+	/* XMM and YMM registers are saved on context switch. */
+	if ((xcr0_lo & 0x6) != 0x6)
+		return 0;
+	if (__get_cpuid_max(0, NULL) < 7)
+		return 0;
+	__cpuid_count(7, 0, ax, bx, cx, dx);
+	return (bx & (1 << 5)) != 0;
+}
+
+#else /* !(defined(ENABLE_MP_SCAN_SIMD) && defined (__x86_64__)) */
+
+bool
+avx2_enabled_cpu()
+{
+	return false;
+}
+
+#endif
@@ -42,6 +42,13 @@
  */
 bool sse42_enabled_cpu();
 
+/* Check whether CPU and OS support AVX2 (needed to scan MessagePack
+ * 32 bytes at a time).
+ *
+ * @return	true if AVX2 is available, false if unavailable.
+ */
+bool avx2_enabled_cpu();
+
 #if defined (__x86_64__) || defined (__i386__)
 /* Hardware-calculate CRC32 for the given data buffer.
  *
@@ -34,6 +34,7 @@
 #include "histogram.h"
 
 #include <assert.h>
+#include <string.h>
 
 struct histogram *
 histogram_new(const int64_t *buckets, size_t n_buckets)
@@ -122,13 +123,21 @@ histogram_discard(struct histogram *hist, int64_t val)
 	hist->total--;
 }
 
+void
+histogram_copy(struct histogram *dst, const struct histogram *src)
+{
+	assert(dst->n_buckets == src->n_buckets);
+	memcpy(dst, src, sizeof(*src) +
+	       src->n_buckets * sizeof(*src->buckets));
+}
+
 int64_t
-histogram_percentile(struct histogram *hist, int pct)
+histogram_percentile(const struct histogram *hist, int pct)
 {
 	size_t count = 0;
 
 	for (size_t i = 0; i < hist->n_buckets; i++) {
-		struct histogram_bucket *bucket = &hist->buckets[i];
+		const struct histogram_bucket *bucket = &hist->buckets[i];
 		count += bucket->count;
 		if (count * 100 > hist->total * pct)
 			return bucket->max;
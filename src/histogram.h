@@ -76,12 +76,19 @@ histogram_collect(struct histogram *hist, int64_t val);
 void
 histogram_discard(struct histogram *hist, int64_t val);
 
+/**
+ * Copy observations of a histogram to another one created
+ * with the same bucket boundaries.
+ */
+void
+histogram_copy(struct histogram *dst, const struct histogram *src);
+
 /**
  * Calculate a percentile, i.e. the value below which a given
  * percentage of observations fall.
  */
 int64_t
-histogram_percentile(struct histogram *hist, int pct);
+histogram_percentile(const struct histogram *hist, int pct);
 
 /**
  * Print string representation of a histogram.
@@ -76,7 +76,126 @@ bitset_test(struct bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	return bit_test(bitset_page_data(page), pos - page->first_pos);
+	return bitset_page_test(page, pos - page->first_pos);
+}
+
+/**
+ * Replace a full sparse page with a bitmap one.
+ * Returns the new page or NULL on memory error, in which
+ * case the old page is left intact.
+ */
+static struct bitset_page *
+bitset_page_to_bitmap(struct bitset *bitset, struct bitset_page *page)
+{
+	size_t size = bitset_page_alloc_size(bitset->realloc);
+	struct bitset_page *bitmap = bitset->realloc(NULL, size);
+	if (bitmap == NULL)
+		return NULL;
+
+	bitset_page_create(bitmap);
+	bitmap->first_pos = page->first_pos;
+	bitmap->cardinality = page->cardinality;
+	void *data = bitset_page_data(bitmap);
+	uint16_t *array = bitset_page_array(page);
+	for (uint32_t i = 0; i < page->cardinality; i++)
+		bit_set(data, array[i]);
+
+	bitset_pages_remove(&bitset->pages, page);
+	bitset_pages_insert(&bitset->pages, bitmap);
+	bitset_page_destroy(page);
+	bitset->realloc(page, 0);
+	return bitmap;
+}
+
+/**
+ * Replace a bitmap page that has become sparse with an array one.
+ * The conversion is best effort: on memory error the bitmap
+ * page is kept.
+ */
+static void
+bitset_page_to_array(struct bitset *bitset, struct bitset_page *page)
+{
+	assert(page->cardinality < BITSET_PAGE_ARRAY_SHRINK);
+	uint32_t capacity = BITSET_PAGE_ARRAY_SHRINK;
+	size_t size = bitset_page_array_alloc_size(capacity);
+	struct bitset_page *sparse = bitset->realloc(NULL, size);
+	if (sparse == NULL)
+		return;
+
+	bitset_page_array_create(sparse, capacity);
+	sparse->first_pos = page->first_pos;
+	uint16_t *array = bitset_page_array(sparse);
+	struct bit_iterator it;
+	bit_iterator_init(&it, bitset_page_data(page),
+			  BITSET_PAGE_DATA_SIZE, true);
+	size_t offset;
+	while ((offset = bit_iterator_next(&it)) != SIZE_MAX)
+		array[sparse->cardinality++] = offset;
+	assert(sparse->cardinality == page->cardinality);
+
+	bitset_pages_remove(&bitset->pages, page);
+	bitset_pages_insert(&bitset->pages, sparse);
+	bitset_page_destroy(page);
+	bitset->realloc(page, 0);
+}
+
+/**
+ * Double the capacity of a full sparse page. Since the page
+ * may move, it is reinserted into the pages tree.
+ */
+static struct bitset_page *
+bitset_page_array_grow(struct bitset *bitset, struct bitset_page *page)
+{
+	uint32_t capacity = page->array_capacity * 2;
+	assert(capacity <= BITSET_PAGE_ARRAY_MAX);
+	bitset_pages_remove(&bitset->pages, page);
+	struct bitset_page *grown = bitset->realloc(page,
+				bitset_page_array_alloc_size(capacity));
+	if (grown == NULL) {
+		bitset_pages_insert(&bitset->pages, page);
+		return NULL;
+	}
+	grown->array_capacity = capacity;
+	bitset_pages_insert(&bitset->pages, grown);
+	return grown;
+}
+
+/**
+ * Set bit @a offset in a sparse page, growing it or converting
+ * it to a bitmap if it is full.
+ * Returns the same values as bitset_set().
+ */
+static int
+bitset_page_array_set(struct bitset *bitset, struct bitset_page *page,
+		      uint16_t offset)
+{
+	uint32_t i = bitset_page_array_find(page, offset);
+	if (i < page->cardinality && bitset_page_array(page)[i] == offset) {
+		/* Value has not changed */
+		return 1;
+	}
+
+	if (page->cardinality == page->array_capacity) {
+		if (page->array_capacity >= BITSET_PAGE_ARRAY_MAX) {
+			page = bitset_page_to_bitmap(bitset, page);
+			if (page == NULL)
+				return -1;
+			bit_set(bitset_page_data(page), offset);
+			goto done;
+		}
+		page = bitset_page_array_grow(bitset, page);
+		if (page == NULL)
+			return -1;
+	}
+
+	uint16_t *array = bitset_page_array(page);
+	memmove(array + i + 1, array + i,
+		(page->cardinality - i) * sizeof(*array));
+	array[i] = offset;
+done:
+	bitset->cardinality++;
+	page->cardinality++;
+	return 0;
 }
 
 int
@@ -88,13 +207,14 @@ bitset_set(struct bitset *bitset, size_t pos)
 	/* Find a page in pages tree */
 	struct bitset_page *page = bitset_pages_search(&bitset->pages, &key);
 	if (page == NULL) {
-		/* Allocate a new page */
-		size_t size = bitset_page_alloc_size(bitset->realloc);
+		/* Allocate a new page, it starts sparse */
+		size_t size = bitset_page_array_alloc_size(
+					BITSET_PAGE_ARRAY_MIN);
 		page = bitset->realloc(NULL, size);
 		if (page == NULL)
 			return -1;
 
-		bitset_page_create(page);
+		bitset_page_array_create(page, BITSET_PAGE_ARRAY_MIN);
 		page->first_pos = key.first_pos;
 
 		/* Insert the page into pages tree */
@@ -103,6 +223,10 @@ bitset_set(struct bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
+	if (bitset_page_is_array(page))
+		return bitset_page_array_set(bitset, page,
+					     pos - page->first_pos);
+
 	bool prev = bit_set(bitset_page_data(page), pos - page->first_pos);
 	if (prev) {
 		/* Value has not changed */
@@ -128,9 +252,18 @@ bitset_clear(struct bitset *bitset, size_t pos)
 
 	assert(page->first_pos <= pos && pos < page->first_pos +
 	       BITSET_PAGE_DATA_SIZE * CHAR_BIT);
-	bool prev = bit_clear(bitset_page_data(page), pos - page->first_pos);
-	if (!prev) {
-		return 0;
+	size_t offset = pos - page->first_pos;
+	if (bitset_page_is_array(page)) {
+		uint32_t i = bitset_page_array_find(page, offset);
+		uint16_t *array = bitset_page_array(page);
+		if (i >= page->cardinality || array[i] != offset)
+			return 0;
+		memmove(array + i, array + i + 1,
+			(page->cardinality - i - 1) * sizeof(*array));
+	} else {
+		bool prev = bit_clear(bitset_page_data(page), offset);
+		if (!prev)
+			return 0;
 	}
 
 	assert(bitset->cardinality > 0);
@@ -144,6 +277,9 @@ bitset_clear(struct bitset *bitset, size_t pos)
 		/* Free the page */
 		bitset_page_destroy(page);
 		bitset->realloc(page, 0);
+	} else if (!bitset_page_is_array(page) &&
+		   page->cardinality < BITSET_PAGE_ARRAY_SHRINK) {
+		bitset_page_to_array(bitset, page);
 	}
 
 	return 1;
@@ -164,6 +300,13 @@ bitset_info(struct bitset *bitset, struct bitset_info *info)
 	struct bitset_page *page = bitset_pages_first(&bitset->pages);
 	while (page != NULL) {
 		info->pages++;
+		if (bitset_page_is_array(page)) {
+			info->array_pages++;
+			info->total_size += bitset_page_array_alloc_size(
+						page->array_capacity);
+		} else {
+			info->total_size += info->page_total_size;
+		}
 		cardinality_check += page->cardinality;
 		page = bitset_pages_next(&bitset->pages, page);
 	}
@@ -186,6 +329,7 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		info.page_data_size, info.page_total_size);
 	fprintf(stream, "    " "page_bit    = %zu\n", PAGE_BIT);
 	fprintf(stream, "    " "pages       = %zu\n", info.pages);
+	fprintf(stream, "    " "array_pages = %zu\n", info.array_pages);
 
 
 	size_t cardinality = bitset_cardinality(bitset);
@@ -204,10 +348,12 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 		fprintf(stream, "    "
 			"utilization = undefined\n");
 	}
-	size_t mem_data  = info.page_data_size * info.pages;
-	size_t mem_total = info.page_total_size * info.pages;
+	size_t mem_data  = info.page_data_size *
+			   (info.pages - info.array_pages);
+	size_t mem_total = info.total_size;
 
-	fprintf(stream, "    " "mem_data    = %zu bytes\n", mem_data);
+	fprintf(stream, "    " "mem_data    = %zu bytes "
+		"/* bitmap pages */\n", mem_data);
 	fprintf(stream, "    " "mem_total   = %zu bytes "
 		"/* data + padding + tree */\n", mem_total);
 	if (cardinality > 0) {
@@ -236,7 +382,7 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 		fprintf(stream, "utilization = %8.4f%% (%zu/%zu)",
 			(float) page->cardinality * 1e2 / PAGE_BIT,
-			page->cardinality, PAGE_BIT);
+			(size_t) page->cardinality, PAGE_BIT);
 
 		if (verbose < 2) {
 			fprintf(stream, "\n");
@@ -246,6 +392,16 @@ bitset_dump(struct bitset *bitset, int verbose, FILE *stream)
 
 		fprintf(stream, "vals = {");
 
+		if (bitset_page_is_array(page)) {
+			uint16_t *array = bitset_page_array(page);
+			for (uint32_t i = 0; i < page->cardinality; i++) {
+				fprintf(stream, "%zu, ",
+					page->first_pos + array[i]);
+			}
+			fprintf(stream, "}\n");
+			continue;
+		}
+
 		size_t pos = 0;
 		struct bit_iterator it;
 		bit_iterator_init(&it, bitset_page_data(page),
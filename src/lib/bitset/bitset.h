@@ -69,7 +69,13 @@ extern "C" {
 struct bitset_page {
 	size_t first_pos;
 	rb_node(struct bitset_page) node;
-	size_t cardinality;
+	uint32_t cardinality;
+	/**
+	 * Number of slots allocated for a sparse page, which keeps
+	 * sorted 16-bit offsets of set bits in data instead of a bitmap.
+	 * Zero for bitmap pages.
+	 */
+	uint32_t array_capacity;
 	uint8_t data[0];
 };
 
@@ -151,6 +157,10 @@ bitset_cardinality(const struct bitset *bitset) {
 struct bitset_info {
 	/** Number of allocated pages */
 	size_t pages;
+	/** Number of sparse pages stored as sorted arrays */
+	size_t array_pages;
+	/** Memory used by all pages, bitmap and sparse ones */
+	size_t total_size;
 	/** Data (payload) size of one page (in bytes) */
 	size_t page_data_size;
 	/** Full size of one page (in bytes, including padding and tree data) */
@@ -305,6 +305,45 @@ bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 	assert(conj->size > 0);
 	assert(conj->page_first_pos != SIZE_MAX);
 
+	/* Find the sparsest page the conjunction is ANDed with */
+	struct bitset_page *pivot = NULL;
+	for (size_t b = 0; b < conj->size; b++) {
+		struct bitset_page *page = conj->pages[b];
+		if (conj->pre_nots[b] || !bitset_page_is_array(page))
+			continue;
+		if (pivot == NULL || page->cardinality < pivot->cardinality)
+			pivot = page;
+	}
+
+	if (pivot != NULL) {
+		/*
+		 * The result is a subset of a sparse page, so probe
+		 * its few bits against other pages instead of
+		 * ANDing whole bitmaps.
+		 */
+		bitset_page_set_zeros(dst);
+		void *data = bitset_page_data(dst);
+		uint16_t *array = bitset_page_array(pivot);
+		for (uint32_t i = 0; i < pivot->cardinality; i++) {
+			uint16_t offset = array[i];
+			bool match = true;
+			for (size_t b = 0; b < conj->size && match; b++) {
+				struct bitset_page *page = conj->pages[b];
+				if (page == pivot)
+					continue;
+				if (!conj->pre_nots[b]) {
+					match = bitset_page_test(page, offset);
+				} else if (page != NULL && page->first_pos ==
+					   conj->page_first_pos) {
+					match = !bitset_page_test(page, offset);
+				}
+			}
+			if (match)
+				bit_set(data, offset);
+		}
+		return;
+	}
+
 	bitset_page_set_ones(dst);
 	for (size_t b = 0; b < conj->size; b++) {
 		if (!conj->pre_nots[b]) {
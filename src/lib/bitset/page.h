@@ -55,7 +55,13 @@ extern "C" {
 
 enum {
 	/** How many bytes to store in one page */
-	BITSET_PAGE_DATA_SIZE = 160
+	BITSET_PAGE_DATA_SIZE = 160,
+	/** Initial number of slots in a sparse page */
+	BITSET_PAGE_ARRAY_MIN = 4,
+	/** A sparse page is converted to a bitmap when it overflows this */
+	BITSET_PAGE_ARRAY_MAX = 64,
+	/** A bitmap page is converted back to a sparse one below this */
+	BITSET_PAGE_ARRAY_SHRINK = BITSET_PAGE_ARRAY_MAX / 4,
 };
 
 #if defined(ENABLE_AVX)
@@ -128,6 +134,69 @@ bitset_page_destroy(struct bitset_page *page)
 	/* nothing */
 }
 
+/**
+ * Sparse pages keep offsets of set bits in a sorted array of
+ * uint16_t right after the page header, the way roaring bitmaps
+ * keep their array containers. A bitmap page costs
+ * BITSET_PAGE_DATA_SIZE bytes even for a single bit, which is
+ * what most pages of a bitset index over rarely used tags
+ * would contain.
+ */
+inline size_t
+bitset_page_array_alloc_size(uint32_t capacity)
+{
+	return sizeof(struct bitset_page) + capacity * sizeof(uint16_t);
+}
+
+inline void
+bitset_page_array_create(struct bitset_page *page, uint32_t capacity)
+{
+	memset(page, 0, sizeof(*page));
+	page->array_capacity = capacity;
+}
+
+inline bool
+bitset_page_is_array(const struct bitset_page *page)
+{
+	return page->array_capacity > 0;
+}
+
+inline uint16_t *
+bitset_page_array(struct bitset_page *page)
+{
+	assert(bitset_page_is_array(page));
+	return (uint16_t *) page->data;
+}
+
+/**
+ * Return the index of the first offset in a sparse page
+ * that is greater than or equal to @a offset.
+ */
+inline uint32_t
+bitset_page_array_find(struct bitset_page *page, uint16_t offset)
+{
+	uint16_t *array = bitset_page_array(page);
+	uint32_t begin = 0, end = page->cardinality;
+	while (begin < end) {
+		uint32_t mid = begin + (end - begin) / 2;
+		if (array[mid] < offset)
+			begin = mid + 1;
+		else
+			end = mid;
+	}
+	return begin;
+}
+
+inline bool
+bitset_page_test(struct bitset_page *page, size_t offset)
+{
+	assert(offset < BITSET_PAGE_DATA_SIZE * CHAR_BIT);
+	if (!bitset_page_is_array(page))
+		return bit_test(bitset_page_data(page), offset);
+	uint32_t i = bitset_page_array_find(page, offset);
+	return i < page->cardinality && bitset_page_array(page)[i] == offset;
+}
+
 inline size_t
 bitset_page_first_pos(size_t pos) {
 	return pos - (pos % (BITSET_PAGE_DATA_SIZE * CHAR_BIT));
@@ -150,7 +219,21 @@ bitset_page_set_ones(struct bitset_page *page)
 inline void
 bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(!bitset_page_is_array(dst));
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
+	if (bitset_page_is_array(src)) {
+		/* Keep only bits listed in src */
+		bitset_word_t tmp[BITSET_PAGE_DATA_SIZE /
+				  sizeof(bitset_word_t)];
+		memset(tmp, 0, sizeof(tmp));
+		uint16_t *array = bitset_page_array(src);
+		for (uint32_t i = 0; i < src->cardinality; i++) {
+			if (bit_test(d, array[i]))
+				bit_set(tmp, array[i]);
+		}
+		memcpy(d, tmp, sizeof(tmp));
+		return;
+	}
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
 	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
@@ -163,7 +246,14 @@ bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
 inline void
 bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(!bitset_page_is_array(dst));
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
+	if (bitset_page_is_array(src)) {
+		uint16_t *array = bitset_page_array(src);
+		for (uint32_t i = 0; i < src->cardinality; i++)
+			bit_clear(d, array[i]);
+		return;
+	}
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
 	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
@@ -176,7 +266,14 @@ bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
 inline void
 bitset_page_or(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(!bitset_page_is_array(dst));
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
+	if (bitset_page_is_array(src)) {
+		uint16_t *array = bitset_page_array(src);
+		for (uint32_t i = 0; i < src->cardinality; i++)
+			bit_set(d, array[i]);
+		return;
+	}
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
 
 	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
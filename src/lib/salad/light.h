@@ -122,6 +122,13 @@ struct LIGHT(record) {
 
 /**
  * Main struct for holding hash table
+ *
+ * The table uses linear hashing: it grows by GROW_INCREMENT
+ * slots at a time, splitting only the buckets that map to
+ * the new slots, and shrinks back the same way when records
+ * are deleted. No operation rehashes the whole table, so
+ * the cost of any insertion or deletion does not depend on
+ * the table size.
  */
 struct LIGHT(core) {
 	/* Number of records added while grow iteration */
@@ -142,6 +149,13 @@ struct LIGHT(core) {
 	 */
 	uint32_t empty_slot;
 
+	/*
+	 * Number of frozen iterators. The table is not shrunk
+	 * while there are any, since moving records would make
+	 * matras copy blocks for their read views.
+	 */
+	uint32_t read_view_count;
+
 	/* additional parameter for data comparison */
 	LIGHT_CMP_ARG_TYPE arg;
 
@@ -258,6 +272,16 @@ int
 LIGHT(delete_value)(struct LIGHT(core) *ht,
 		    uint32_t hash, LIGHT_DATA_TYPE value);
 
+/**
+ * @brief Shrink hash table by one grow step, releasing the last
+ * GROW_INCREMENT slots. Deletions call it automatically when
+ * the table becomes less than half full.
+ * @param ht - pointer to a hash table struct
+ * @return 0 if ok, 1 if the table can't be shrunk now
+ */
+int
+LIGHT(shrink)(struct LIGHT(core) *ht);
+
 /**
  * @brief Get a value from a desired position
  * @param ht - pointer to a hash table struct
@@ -346,6 +370,7 @@ LIGHT(create)(struct LIGHT(core) *ht, size_t extent_size,
 	ht->count = 0;
 	ht->table_size = 0;
 	ht->empty_slot = LIGHT(end);
+	ht->read_view_count = 0;
 	ht->arg = arg;
 	matras_create(&ht->mtable,
 		      extent_size, sizeof(struct LIGHT(record)),
@@ -814,14 +839,11 @@ LIGHT(insert)(struct LIGHT(core) *ht, uint32_t hash, LIGHT_DATA_TYPE value)
 	}
 }
 
-/**
- * @brief Delete a record from a hash table by given record ID
- * @param ht - pointer to a hash table struct
- * @param slotpos - ID of an record. See LIGHT(find) for details.
- * @return 0 if ok, -1 on memory error (only with freezed iterators)
+/*
+ * Delete a record by given record ID, never shrinking the table
  */
 inline int
-LIGHT(delete)(struct LIGHT(core) *ht, uint32_t slot)
+LIGHT(delete_no_shrink)(struct LIGHT(core) *ht, uint32_t slot)
 {
 	assert(slot < ht->table_size);
 	uint32_t empty_slot;
@@ -871,6 +893,97 @@ LIGHT(delete)(struct LIGHT(core) *ht, uint32_t slot)
 	return 0;
 }
 
+/**
+ * @brief Shrink hash table by one grow step, releasing the last
+ * GROW_INCREMENT slots. Deletions call it automatically when
+ * the table becomes less than half full.
+ * @param ht - pointer to a hash table struct
+ * @return 0 if ok, 1 if the table can't be shrunk now
+ */
+inline int
+LIGHT(shrink)(struct LIGHT(core) *ht)
+{
+	/* Limit of records that may live in the released slots */
+	enum { SHRINK_BUF_SIZE = 64 };
+	if (ht->table_size <= ht->GROW_INCREMENT
+	    || ht->count > ht->table_size - ht->GROW_INCREMENT
+	    || ht->read_view_count > 0)
+		return 1;
+	/*
+	 * Take out all records stored in the released slots: the
+	 * chains that start there and members of other chains
+	 * placed there as overflow. With no read views matras
+	 * never allocates on touch, so nothing below can fail.
+	 */
+	struct LIGHT(record) saved[SHRINK_BUF_SIZE];
+	uint32_t saved_count = 0;
+	uint32_t first_slot = ht->table_size - ht->GROW_INCREMENT;
+	int rc = 0;
+	for (uint32_t slot = first_slot; slot < ht->table_size; slot++) {
+		while (LIGHT(pos_valid)(ht, slot)) {
+			if (saved_count == SHRINK_BUF_SIZE) {
+				/* Unlucky long chains, try next time */
+				rc = 1;
+				goto reinsert;
+			}
+			saved[saved_count++] = *(struct LIGHT(record) *)
+				matras_get(&ht->mtable, slot);
+			int delete_rc = LIGHT(delete_no_shrink)(ht, slot);
+			assert(delete_rc == 0);
+			(void)delete_rc;
+		}
+	}
+	for (uint32_t slot = first_slot; slot < ht->table_size; slot++) {
+		struct LIGHT(record) *record = LIGHT(detach_empty)(ht, slot);
+		assert(record != NULL);
+		(void)record;
+	}
+	matras_dealloc_range(&ht->mtable, ht->GROW_INCREMENT);
+	ht->table_size -= ht->GROW_INCREMENT;
+	if (ht->table_size <= (ht->cover_mask >> 1) + 1)
+		ht->cover_mask >>= 1;
+	/*
+	 * The remaining records keep their slots: linear hashing
+	 * maps them the same way for both sizes. Only the taken
+	 * out ones are put back, now into the merged buckets.
+	 */
+reinsert:
+	for (uint32_t i = 0; i < saved_count; i++) {
+		uint32_t slot = LIGHT(insert)(ht, saved[i].hash,
+					      saved[i].value);
+		assert(slot != LIGHT(end));
+		(void)slot;
+	}
+	return rc;
+}
+
+/*
+ * Shrink the table by one step if it is less than half full.
+ * Grow happens only when the table is full, so a workload
+ * that oscillates around some size never resizes back and forth.
+ */
+inline void
+LIGHT(shrink_if_sparse)(struct LIGHT(core) *ht)
+{
+	if (ht->count < ht->table_size / 2)
+		LIGHT(shrink)(ht);
+}
+
+/**
+ * @brief Delete a record from a hash table by given record ID
+ * @param ht - pointer to a hash table struct
+ * @param slotpos - ID of an record. See LIGHT(find) for details.
+ * @return 0 if ok, -1 on memory error (only with freezed iterators)
+ */
+inline int
+LIGHT(delete)(struct LIGHT(core) *ht, uint32_t slot)
+{
+	if (LIGHT(delete_no_shrink)(ht, slot) != 0)
+		return -1;
+	LIGHT(shrink_if_sparse)(ht);
+	return 0;
+}
+
 /**
  * @brief Delete a record from a hash table by that value and its hash.
  * @param ht - pointer to a hash table struct
@@ -919,11 +1032,13 @@ LIGHT(delete_value)(struct LIGHT(core) *ht, uint32_t hash, LIGHT_DATA_TYPE value
 		prev_record->next = record->next;
 		LIGHT(enqueue_empty)(ht, slot, record);
 		ht->count--;
+		LIGHT(shrink_if_sparse)(ht);
 		return 0;
 	}
 	if (record->next == LIGHT(end)) {
 		LIGHT(enqueue_empty)(ht, slot, record);
 		ht->count--;
+		LIGHT(shrink_if_sparse)(ht);
 		return 0;
 	}
 	uint32_t next_slot = record->next;
@@ -934,6 +1049,7 @@ LIGHT(delete_value)(struct LIGHT(core) *ht, uint32_t hash, LIGHT_DATA_TYPE value
 	*record = *next_record;
 	LIGHT(enqueue_empty)(ht, next_slot, next_record);
 	ht->count--;
+	LIGHT(shrink_if_sparse)(ht);
 	return 0;
 }
 
@@ -1032,6 +1148,7 @@ LIGHT(iterator_freeze)(struct LIGHT(core) *ht, struct LIGHT(iterator) *itr)
 {
 	assert(!matras_is_read_view_created(&itr->view));
 	matras_create_read_view(&ht->mtable, &itr->view);
+	ht->read_view_count++;
 }
 
 /**
@@ -1043,6 +1160,10 @@ LIGHT(iterator_freeze)(struct LIGHT(core) *ht, struct LIGHT(iterator) *itr)
 inline void
 LIGHT(iterator_destroy)(struct LIGHT(core) *ht, struct LIGHT(iterator) *itr)
 {
+	if (matras_is_read_view_created(&itr->view)) {
+		assert(ht->read_view_count > 0);
+		ht->read_view_count--;
+	}
 	matras_destroy_read_view(&ht->mtable, &itr->view);
 }
 
@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "rtree.h"
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
@@ -325,6 +326,73 @@ rtree_rect_equal_to_rect(const struct rtree_rect *rt1,
 	return true;
 }
 
+/*
+ * Two-dimensional versions of the comparators above. The tests
+ * of both axes are combined without short-circuiting, so that
+ * the compiler evaluates all four coordinate comparisons at once
+ * with packed SIMD compares instead of a chain of branches.
+ * The dimension argument is only kept for the comparator type.
+ */
+static bool
+rtree_rect_intersects_rect_2d(const struct rtree_rect *rt1,
+			      const struct rtree_rect *rt2,
+			      unsigned dimension)
+{
+	(void) dimension;
+	const coord_t *c1 = rt1->coords, *c2 = rt2->coords;
+	return (c1[0] <= c2[1]) & (c1[1] >= c2[0]) &
+	       (c1[2] <= c2[3]) & (c1[3] >= c2[2]);
+}
+
+static bool
+rtree_rect_in_rect_2d(const struct rtree_rect *rt1,
+		      const struct rtree_rect *rt2,
+		      unsigned dimension)
+{
+	(void) dimension;
+	const coord_t *c1 = rt1->coords, *c2 = rt2->coords;
+	return (c1[0] >= c2[0]) & (c1[1] <= c2[1]) &
+	       (c1[2] >= c2[2]) & (c1[3] <= c2[3]);
+}
+
+static bool
+rtree_rect_strict_in_rect_2d(const struct rtree_rect *rt1,
+			     const struct rtree_rect *rt2,
+			     unsigned dimension)
+{
+	(void) dimension;
+	const coord_t *c1 = rt1->coords, *c2 = rt2->coords;
+	return (c1[0] > c2[0]) & (c1[1] < c2[1]) &
+	       (c1[2] > c2[2]) & (c1[3] < c2[3]);
+}
+
+static bool
+rtree_rect_holds_rect_2d(const struct rtree_rect *rt1,
+			 const struct rtree_rect *rt2,
+			 unsigned dimension)
+{
+	return rtree_rect_in_rect_2d(rt2, rt1, dimension);
+}
+
+static bool
+rtree_rect_strict_holds_rect_2d(const struct rtree_rect *rt1,
+				const struct rtree_rect *rt2,
+				unsigned dimension)
+{
+	return rtree_rect_strict_in_rect_2d(rt2, rt1, dimension);
+}
+
+static bool
+rtree_rect_equal_to_rect_2d(const struct rtree_rect *rt1,
+			    const struct rtree_rect *rt2,
+			    unsigned dimension)
+{
+	(void) dimension;
+	const coord_t *c1 = rt1->coords, *c2 = rt2->coords;
+	return (c1[0] == c2[0]) & (c1[1] == c2[1]) &
+	       (c1[2] == c2[2]) & (c1[3] == c2[3]);
+}
+
 static bool
 rtree_always_true(const struct rtree_rect *rt1,
 		  const struct rtree_rect *rt2,
@@ -703,6 +771,29 @@ rtree_page_remove(struct rtree *tree, struct rtree_page *page,
 	return false;
 }
 
+static bool
+rtree_page_replace_record(struct rtree *tree, struct rtree_page *page,
+			  const struct rtree_rect *rect, record_t old_obj,
+			  record_t new_obj, int level)
+{
+	unsigned d = tree->dimension;
+	for (unsigned i = 0; i < page->n; i++) {
+		struct rtree_page_branch *b;
+		b = rtree_branch_get(tree, page, i);
+		if (level > 1) {
+			if (rtree_rect_intersects_rect(&b->rect, rect, d) &&
+			    rtree_page_replace_record(tree, b->data.page, rect,
+						      old_obj, new_obj,
+						      level - 1))
+				return true;
+		} else if (b->data.record == old_obj) {
+			b->data.record = new_obj;
+			return true;
+		}
+	}
+	return false;
+}
+
 static void
 rtree_page_purge(struct rtree *tree, struct rtree_page *page, int level)
 {
@@ -1056,6 +1147,245 @@ rtree_remove(struct rtree *tree, const struct rtree_rect *rect, record_t obj)
 	return true;
 }
 
+/*------------------------------------------------------------------------- */
+/* R-tree bulk load */
+/*------------------------------------------------------------------------- */
+
+struct rtree_bulk_key {
+	/* Doubled center of a branch along the current axis */
+	coord_t key;
+	/* Index of the branch */
+	uint32_t idx;
+};
+
+static int
+rtree_bulk_key_cmp(const void *a, const void *b)
+{
+	const struct rtree_bulk_key *k1 = (const struct rtree_bulk_key *)a;
+	const struct rtree_bulk_key *k2 = (const struct rtree_bulk_key *)b;
+	if (k1->key != k2->key)
+		return k1->key < k2->key ? -1 : 1;
+	return k1->idx < k2->idx ? -1 : k1->idx > k2->idx;
+}
+
+/*
+ * Sort-Tile-Recursive ordering: sort branches by the center along
+ * the axis, cut them into slices of whole pages and sort every
+ * slice along the next axis. Consecutive runs of @a fill branches
+ * in the resulting order cover compact tiles of the space.
+ */
+static void
+rtree_bulk_sort(const struct rtree *tree, const char *branches,
+		uint32_t *order, struct rtree_bulk_key *keys, size_t count,
+		unsigned fill, unsigned axis)
+{
+	for (size_t i = 0; i < count; i++) {
+		const struct rtree_page_branch *b =
+			(const struct rtree_page_branch *)
+			(branches + (size_t)order[i] * tree->page_branch_size);
+		keys[i].key = b->rect.coords[2 * axis] +
+			      b->rect.coords[2 * axis + 1];
+		keys[i].idx = order[i];
+	}
+	qsort(keys, count, sizeof(*keys), rtree_bulk_key_cmp);
+	for (size_t i = 0; i < count; i++)
+		order[i] = keys[i].idx;
+
+	unsigned axes_left = tree->dimension - axis;
+	if (axes_left == 1)
+		return;
+	/* slices = ceil(pages ^ (1 / axes_left)) */
+	size_t pages = (count + fill - 1) / fill;
+	size_t slices = 1;
+	while (true) {
+		size_t tiles = 1;
+		for (unsigned i = 0; i < axes_left && tiles < pages; i++)
+			tiles *= slices;
+		if (tiles >= pages)
+			break;
+		slices++;
+	}
+	size_t slice_size = (pages + slices - 1) / slices * fill;
+	for (size_t begin = 0; begin < count; begin += slice_size) {
+		size_t size = count - begin < slice_size ?
+			      count - begin : slice_size;
+		rtree_bulk_sort(tree, branches, order + begin, keys + begin,
+				size, fill, axis + 1);
+	}
+}
+
+/* Branch @a i of an array of branches of the tree */
+static struct rtree_page_branch *
+rtree_bulk_branch(const struct rtree *tree, char *branches, size_t i)
+{
+	return (struct rtree_page_branch *)
+		(branches + i * tree->page_branch_size);
+}
+
+/* Number of pages of all levels of a tree of @a count records */
+static size_t
+rtree_bulk_page_count(const struct rtree *tree, size_t count)
+{
+	size_t total = 0;
+	size_t n = count;
+	while (n > tree->page_max_fill) {
+		n = (n + tree->page_max_fill - 1) / tree->page_max_fill;
+		total += n;
+	}
+	return total + 1;
+}
+
+size_t
+rtree_bulk_load_extent_count(const struct rtree *tree, size_t count)
+{
+	if (count == 0)
+		return 0;
+	size_t extent_size = tree->mtab.extent_size;
+	size_t pages_in_extent = extent_size / tree->page_size;
+	size_t ids_in_extent = extent_size / sizeof(void *);
+	size_t leaves = (rtree_bulk_page_count(tree, count) +
+			 pages_in_extent - 1) / pages_in_extent;
+	/* Leaf extents of matras and two levels of their ids */
+	return leaves + (leaves + ids_in_extent - 1) / ids_in_extent + 1;
+}
+
+int
+rtree_bulk_load(struct rtree *tree, record_t *records, size_t count,
+		rtree_extract_rect_t extract_rect, void *ctx)
+{
+	assert(tree->root == NULL);
+	assert(count <= UINT32_MAX);
+	if (count == 0)
+		return 0;
+
+	unsigned d = tree->dimension;
+	unsigned max_fill = tree->page_max_fill;
+	size_t max_pages = (count + max_fill - 1) / max_fill;
+	size_t page_count = rtree_bulk_page_count(tree, count);
+	char *branches = (char *)malloc(count * tree->page_branch_size);
+	char *parents = (char *)malloc(max_pages * tree->page_branch_size);
+	uint32_t *order = (uint32_t *)malloc(count * sizeof(*order));
+	struct rtree_bulk_key *keys = (struct rtree_bulk_key *)
+		malloc(count * sizeof(*keys));
+	unsigned *sizes = (unsigned *)malloc(max_pages * sizeof(*sizes));
+	struct rtree_page **pages = (struct rtree_page **)
+		malloc(page_count * sizeof(*pages));
+	size_t next_page = 0;
+	int rc = -1;
+	if (branches == NULL || parents == NULL || order == NULL ||
+	    keys == NULL || sizes == NULL || pages == NULL)
+		goto out;
+	/*
+	 * Pages are allocated before the tree is changed, so that
+	 * it stays empty if the allocator fails. An allocator
+	 * which can't return NULL should reserve
+	 * rtree_bulk_load_extent_count() extents.
+	 */
+	for (next_page = 0; next_page < page_count; next_page++) {
+		pages[next_page] = rtree_page_alloc(tree);
+		if (pages[next_page] == NULL) {
+			while (next_page > 0)
+				rtree_page_free(tree, pages[--next_page]);
+			goto out;
+		}
+	}
+	next_page = 0;
+
+	struct rtree_rect rect;
+	for (size_t i = 0; i < count; i++) {
+		struct rtree_page_branch *b =
+			rtree_bulk_branch(tree, branches, i);
+		extract_rect(records[i], &rect, ctx);
+		b->data.record = records[i];
+		rtree_rect_copy(&b->rect, &rect, d);
+	}
+
+	/* Pack every level into pages, bottom-up */
+	size_t n = count;
+	unsigned height = 0;
+	while (true) {
+		height++;
+		if (n <= max_fill) {
+			struct rtree_page *root = pages[next_page++];
+			root->n = n;
+			for (size_t i = 0; i < n; i++) {
+				struct rtree_page_branch *to =
+					rtree_branch_get(tree, root, i);
+				rtree_branch_copy(to, rtree_bulk_branch(tree,
+						  branches, i), d);
+			}
+			tree->root = root;
+			tree->n_pages++;
+			break;
+		}
+		size_t level_pages = (n + max_fill - 1) / max_fill;
+		unsigned fill = (n + level_pages - 1) / level_pages;
+		for (size_t i = 0; i < n; i++)
+			order[i] = i;
+		rtree_bulk_sort(tree, branches, order, keys, n, fill, 0);
+		/*
+		 * Pages are filled in order, and the last one borrows
+		 * branches from its predecessors until it is filled
+		 * enough for rtree_remove().
+		 */
+		for (size_t p = 0; p < level_pages; p++)
+			sizes[p] = fill;
+		sizes[level_pages - 1] = n - (level_pages - 1) * fill;
+		size_t donor = level_pages - 1;
+		while (sizes[level_pages - 1] < tree->page_min_fill) {
+			donor = donor > 0 ? donor - 1 : level_pages - 2;
+			if (sizes[donor] <= tree->page_min_fill)
+				continue;
+			sizes[donor]--;
+			sizes[level_pages - 1]++;
+		}
+		size_t pos = 0;
+		for (size_t p = 0; p < level_pages; p++) {
+			struct rtree_page *page = pages[next_page++];
+			page->n = sizes[p];
+			for (unsigned i = 0; i < sizes[p]; i++) {
+				struct rtree_page_branch *to =
+					rtree_branch_get(tree, page, i);
+				rtree_branch_copy(to, rtree_bulk_branch(tree,
+						  branches, order[pos++]), d);
+			}
+			tree->n_pages++;
+			struct rtree_page_branch *parent =
+				rtree_bulk_branch(tree, parents, p);
+			parent->data.page = page;
+			rtree_page_cover(tree, page, &parent->rect);
+		}
+		assert(pos == n);
+		memcpy(branches, parents,
+		       level_pages * tree->page_branch_size);
+		n = level_pages;
+	}
+
+	assert(next_page == page_count);
+	tree->height = height;
+	tree->n_records = count;
+	tree->version++;
+	rc = 0;
+out:
+	free(branches);
+	free(parents);
+	free(order);
+	free(keys);
+	free(sizes);
+	free(pages);
+	return rc;
+}
+
+bool
+rtree_replace_record(struct rtree *tree, const struct rtree_rect *rect,
+		     record_t old_obj, record_t new_obj)
+{
+	if (tree->height == 0)
+		return false;
+	return rtree_page_replace_record(tree, tree->root, rect, old_obj,
+					 new_obj, tree->height);
+}
+
 bool
 rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 	     enum spatial_search_op op, struct rtree_iterator *itr)
@@ -1067,30 +1397,42 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 	rtree_rect_copy(&itr->rect, rect, tree->dimension);
 	itr->op = op;
 	assert(tree->height <= RTREE_MAX_HEIGHT);
+	bool is_2d = tree->dimension == 2;
 	switch (op) {
 	case SOP_ALL:
 		itr->intr_cmp = itr->leaf_cmp = rtree_always_true;
 		break;
 	case SOP_EQUALS:
-		itr->intr_cmp = rtree_rect_in_rect;
-		itr->leaf_cmp = rtree_rect_equal_to_rect;
+		itr->intr_cmp = is_2d ? rtree_rect_in_rect_2d :
+			rtree_rect_in_rect;
+		itr->leaf_cmp = is_2d ? rtree_rect_equal_to_rect_2d :
+			rtree_rect_equal_to_rect;
 		break;
 	case SOP_CONTAINS:
-		itr->intr_cmp = itr->leaf_cmp = rtree_rect_in_rect;
+		itr->intr_cmp = itr->leaf_cmp = is_2d ?
+			rtree_rect_in_rect_2d : rtree_rect_in_rect;
 		break;
 	case SOP_STRICT_CONTAINS:
-		itr->intr_cmp = itr->leaf_cmp = rtree_rect_strict_in_rect;
+		itr->intr_cmp = itr->leaf_cmp = is_2d ?
+			rtree_rect_strict_in_rect_2d :
+			rtree_rect_strict_in_rect;
 		break;
 	case SOP_OVERLAPS:
-		itr->intr_cmp = itr->leaf_cmp = rtree_rect_intersects_rect;
+		itr->intr_cmp = itr->leaf_cmp = is_2d ?
+			rtree_rect_intersects_rect_2d :
+			rtree_rect_intersects_rect;
 		break;
 	case SOP_BELONGS:
-		itr->intr_cmp = rtree_rect_intersects_rect;
-		itr->leaf_cmp = rtree_rect_holds_rect;
+		itr->intr_cmp = is_2d ? rtree_rect_intersects_rect_2d :
+			rtree_rect_intersects_rect;
+		itr->leaf_cmp = is_2d ? rtree_rect_holds_rect_2d :
+			rtree_rect_holds_rect;
 		break;
 	case SOP_STRICT_BELONGS:
-		itr->intr_cmp = rtree_rect_intersects_rect;
-		itr->leaf_cmp = rtree_rect_strict_holds_rect;
+		itr->intr_cmp = is_2d ? rtree_rect_intersects_rect_2d :
+			rtree_rect_intersects_rect;
+		itr->leaf_cmp = is_2d ? rtree_rect_strict_holds_rect_2d :
+			rtree_rect_strict_holds_rect;
 		break;
 	case SOP_NEIGHBOR:
 		if (tree->root) {
@@ -109,6 +109,10 @@ struct rtree_rect
 	coord_t coords[RTREE_MAX_DIMENSION * 2];
 };
 
+/* Type of function, retrieving a rectangle of a record */
+typedef void (*rtree_extract_rect_t)(record_t record, struct rtree_rect *rect,
+				     void *ctx);
+
 /* Type of function, comparing two rectangles */
 typedef bool (*rtree_comparator_t)(const struct rtree_rect *rt1,
 				   const struct rtree_rect *rt2,
@@ -275,6 +279,31 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 void
 rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 
+/**
+ * @brief Fill an empty tree with records at once.
+ * The records are packed into pages with Sort-Tile-Recursive
+ * algorithm, which is much faster than inserting them one by one
+ * and gives pages with less overlap.
+ * @return 0 on success, -1 on memory error
+ * @param tree - pointer to an empty tree
+ * @param records - records to insert
+ * @param count - number of records
+ * @param extract_rect - function returning a rectangle of a record
+ * @param ctx - argument passed to extract_rect
+ */
+int
+rtree_bulk_load(struct rtree *tree, record_t *records, size_t count,
+		rtree_extract_rect_t extract_rect, void *ctx);
+
+/**
+ * @brief Upper bound of the number of extents allocated by
+ * rtree_bulk_load() of @a count records into an empty tree.
+ * An extent allocator which throws rather than returning NULL
+ * should reserve them, since the tree can't be unwound.
+ */
+size_t
+rtree_bulk_load_extent_count(const struct rtree *tree, size_t count);
+
 /**
  * @brief Remove the record from a tree
  * @return true if the record deleted (false otherwise)
@@ -285,6 +314,20 @@ rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 bool
 rtree_remove(struct rtree *tree, const struct rtree_rect *rect, record_t obj);
 
+/**
+ * @brief Replace a record with another one of the same rectangle
+ * in place. The tree structure is not changed, so iterators
+ * remain valid and return the new record.
+ * @return true if the record is found (false otherwise)
+ * @param tree - pointer to a tree
+ * @param rect - rectangle of the record
+ * @param old_obj - record to replace
+ * @param new_obj - record to store instead
+ */
+bool
+rtree_replace_record(struct rtree *tree, const struct rtree_rect *rect,
+		     record_t old_obj, record_t new_obj);
+
 /**
  * @brief Size of memory used by tree
  * @param tree - pointer to a tree
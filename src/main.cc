@@ -53,6 +53,7 @@
 #include <cbus.h>
 #include <coeio.h>
 #include <crc32.h>
+#include "mp_scan.h"
 #include "memory.h"
 #include <say.h>
 #include <rmean.h>
@@ -610,6 +611,7 @@ main(int argc, char **argv)
 	random_init();
 
 	crc32_init();
+	mp_scan_init();
 	memory_init();
 
 	main_argc = argc;
@@ -29,7 +29,18 @@
  * SUCH DAMAGE.
  */
 #include "memory.h"
+#include "trivia/util.h"
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(TARGET_OS_LINUX)
+#include <sys/syscall.h>
+#endif
 #include "small/quota.h"
+#include "say.h"
 
 struct slab_arena runtime;
 
@@ -58,3 +69,86 @@ memory_free()
 	slab_arena_destroy(&runtime);
 #endif
 }
+
+#if !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+/** Advise a range to be backed with transparent huge pages. */
+static void
+memory_advise_huge_pages(uintptr_t begin, uintptr_t end)
+{
+#if defined(MADV_HUGEPAGE)
+	if (end > begin)
+		madvise((void *) begin, end - begin, MADV_HUGEPAGE);
+#else
+	(void) begin;
+	(void) end;
+#endif
+}
+
+int
+memory_use_huge_pages(void *addr, size_t size, size_t page_size)
+{
+	assert((page_size & (page_size - 1)) == 0);
+	uintptr_t start = (uintptr_t) addr;
+	uintptr_t begin = (start + page_size - 1) & ~(page_size - 1);
+	uintptr_t end = (start + size) & ~(page_size - 1);
+	if (end <= begin) {
+		memory_advise_huge_pages(start, start + size);
+		errno = EINVAL;
+		return -1;
+	}
+#if defined(MAP_HUGETLB)
+	/* The page size is encoded as its log2, like MAP_HUGE_2MB. */
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+	int page_shift = __builtin_ctzll(page_size);
+	if (mmap((void *) begin, end - begin, PROT_READ | PROT_WRITE,
+		 flags | MAP_HUGETLB | (page_shift << MAP_HUGE_SHIFT),
+		 -1, 0) != MAP_FAILED) {
+		memory_advise_huge_pages(start, begin);
+		memory_advise_huge_pages(end, start + size);
+		return 0;
+	}
+	/*
+	 * A failed fixed mapping may leave a hole in place of
+	 * the old one, so map the range back.
+	 */
+	int saved_errno = errno;
+	if (mmap((void *) begin, end - begin, PROT_READ | PROT_WRITE,
+		 flags, -1, 0) == MAP_FAILED)
+		panic_syserror("failed to restore a mapping");
+	errno = saved_errno;
+#else
+	errno = ENOTSUP;
+#endif
+	memory_advise_huge_pages(start, start + size);
+	return -1;
+}
+
+int
+memory_bind_numa_node(void *addr, size_t size, int node)
+{
+#if defined(TARGET_OS_LINUX) && defined(SYS_mbind)
+	/* Values from linux/mempolicy.h. */
+	enum { MEMORY_MPOL_BIND = 2, MEMORY_NUMA_NODE_MAX = 1024 };
+	enum { BITS = sizeof(unsigned long) * CHAR_BIT };
+	if (node < 0 || node >= MEMORY_NUMA_NODE_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	unsigned long mask[MEMORY_NUMA_NODE_MAX / BITS] = { 0 };
+	mask[node / BITS] = 1UL << (node % BITS);
+	/* The kernel takes one bit less than passed in maxnode. */
+	if (syscall(SYS_mbind, addr, size, MEMORY_MPOL_BIND, mask,
+		    MEMORY_NUMA_NODE_MAX + 1, 0) != 0)
+		return -1;
+	return 0;
+#else
+	(void) addr;
+	(void) size;
+	(void) node;
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
@@ -50,6 +50,34 @@ memory_init();
 
 void
 memory_free();
+
+/**
+ * Back a mapped but not yet touched region with explicit huge
+ * pages of the given size (2 MB or 1 GB). The huge page aligned
+ * part of the region is remapped in place, so any data in it is
+ * lost. If the system has no spare huge pages, the region is
+ * mapped back with regular pages. The rest of the region, and
+ * the whole region on failure, is advised to be backed with
+ * transparent huge pages.
+ *
+ * @retval  0 explicit huge pages are used.
+ * @retval -1 transparent huge pages are used or the system
+ *            does not support huge pages, errno is set.
+ */
+int
+memory_use_huge_pages(void *addr, size_t size, size_t page_size);
+
+/**
+ * Bind a mapped but not yet touched region to a NUMA node:
+ * its pages are allocated on the node when faulted in.
+ *
+ * @retval  0 success.
+ * @retval -1 the node does not exist or the system does not
+ *            support NUMA, errno is set.
+ */
+int
+memory_bind_numa_node(void *addr, size_t size, int node);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "mp_scan.h"
+#include <msgpuck.h>
+#include <cpu_feature.h>
+
+#if defined(ENABLE_MP_SCAN_SIMD) && defined (__x86_64__)
+#include <immintrin.h>
+#endif
+
+mp_check_func mp_check_fast = NULL;
+
+#if defined(ENABLE_MP_SCAN_SIMD) && defined (__x86_64__)
+
+static inline uint32_t
+mp_scan_load_be(const char **data, int size)
+{
+	const uint8_t *p = (const uint8_t *) *data;
+	uint32_t v = 0;
+	for (int i = 0; i < size; i++)
+		v = (v << 8) | p[i];
+	*data += size;
+	return v;
+}
+
+/**
+ * Check and skip the header of one MessagePack value, as well
+ * as the payload of a string, binary or extension. The number of
+ * items of an array or a map is added to @a k. The semantics,
+ * including the 'int' counter, follow mp_check() byte by byte.
+ *
+ * @retval 0 success
+ * @retval 1 the value is truncated
+ */
+static inline int
+mp_scan_header(const char **data, const char *end, int *k)
+{
+	uint8_t c = (uint8_t) *(*data)++;
+	uint32_t len;
+	int size;
+	if (c <= 0x7f || c >= 0xe0)
+		return 0; /* fixint */
+	if (c <= 0x8f) {
+		*k += 2 * (c & 0x0f); /* fixmap */
+		return 0;
+	}
+	if (c <= 0x9f) {
+		*k += c & 0x0f; /* fixarray */
+		return 0;
+	}
+	if (c <= 0xbf) {
+		len = c & 0x1f; /* fixstr */
+		goto payload;
+	}
+	switch (c) {
+	case 0xc0: /* nil */
+	case 0xc1: /* never used */
+	case 0xc2: /* false */
+	case 0xc3: /* true */
+		return 0;
+	case 0xcc: case 0xd0: /* uint 8, int 8 */
+		len = 1;
+		goto payload;
+	case 0xcd: case 0xd1: /* uint 16, int 16 */
+		len = 2;
+		goto payload;
+	case 0xca: case 0xce: case 0xd2: /* float, uint 32, int 32 */
+		len = 4;
+		goto payload;
+	case 0xcb: case 0xcf: case 0xd3: /* double, uint 64, int 64 */
+		len = 8;
+		goto payload;
+	case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+		len = (1 << (c - 0xd4)) + 1; /* fixext: type + data */
+		goto payload;
+	case 0xc4: case 0xd9: /* bin 8, str 8 */
+		size = 1;
+		break;
+	case 0xc5: case 0xda: /* bin 16, str 16 */
+		size = 2;
+		break;
+	case 0xc6: case 0xdb: /* bin 32, str 32 */
+		size = 4;
+		break;
+	case 0xc7: case 0xc8: case 0xc9: /* ext 8, 16, 32 */
+		size = 1 << (c - 0xc7);
+		if (end - *data < size + 1)
+			return 1;
+		len = mp_scan_load_be(data, size);
+		++*data; /* type */
+		goto payload;
+	case 0xdc: /* array 16 */
+		if (end - *data < 2)
+			return 1;
+		*k += mp_scan_load_be(data, 2);
+		return 0;
+	case 0xdd: /* array 32 */
+		if (end - *data < 4)
+			return 1;
+		*k += mp_scan_load_be(data, 4);
+		return 0;
+	case 0xde: /* map 16 */
+		if (end - *data < 2)
+			return 1;
+		*k += 2 * mp_scan_load_be(data, 2);
+		return 0;
+	case 0xdf: /* map 32 */
+		if (end - *data < 4)
+			return 1;
+		*k += 2 * mp_scan_load_be(data, 4);
+		return 0;
+	default:
+		unreachable();
+		return 1;
+	}
+	/* Length-prefixed string or binary. */
+	if (end - *data < size)
+		return 1;
+	len = mp_scan_load_be(data, size);
+payload:
+	if ((size_t) (end - *data) < len)
+		return 1;
+	*data += len;
+	return 0;
+}
+
+/*
+ * A byte is a whole value if it is a positive or a negative
+ * fixint, nil, false or true. As signed chars fixints are
+ * exactly the bytes greater than -33 (0xdf).
+ */
+
+/** The number of whole-value bytes at the start of 16 bytes. */
+static inline __attribute__((target("sse2"))) uint32_t
+mp_scan_run_sse2(const char *data)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *) data);
+	__m128i single = _mm_cmpgt_epi8(v, _mm_set1_epi8(-33));
+	single = _mm_or_si128(single,
+			      _mm_cmpeq_epi8(v, _mm_set1_epi8((char) 0xc0)));
+	single = _mm_or_si128(single,
+			      _mm_cmpeq_epi8(v, _mm_set1_epi8((char) 0xc2)));
+	single = _mm_or_si128(single,
+			      _mm_cmpeq_epi8(v, _mm_set1_epi8((char) 0xc3)));
+	uint32_t mask = ~(uint32_t) _mm_movemask_epi8(single);
+	/* Bit 16 is always set, so the run is at most 16. */
+	return __builtin_ctz(mask);
+}
+
+/** The number of whole-value bytes at the start of 32 bytes. */
+static inline __attribute__((target("avx2"))) uint32_t
+mp_scan_run_avx2(const char *data)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i *) data);
+	__m256i single = _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-33));
+	single = _mm256_or_si256(single,
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8((char) 0xc0)));
+	single = _mm256_or_si256(single,
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8((char) 0xc2)));
+	single = _mm256_or_si256(single,
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8((char) 0xc3)));
+	uint64_t mask = ~(uint64_t)(uint32_t) _mm256_movemask_epi8(single);
+	return __builtin_ctzll(mask);
+}
+
+/**
+ * mp_check() which consumes up to WIDTH whole-value bytes per
+ * step with RUN() and falls back to mp_scan_header() otherwise.
+ */
+#define MP_CHECK_VECTORIZED(data, end, WIDTH, RUN) do {			\
+	int k;								\
+	for (k = 1; k > 0; k--) {					\
+		if (unlikely(*(data) >= (end)))				\
+			return 1;					\
+		if ((end) - *(data) >= (WIDTH)) {			\
+			uint32_t run = RUN(*(data));			\
+			if (run > 0) {					\
+				if (run > (uint32_t) k)			\
+					run = k;			\
+				*(data) += run;				\
+				/* The loop decrements one more. */	\
+				k -= run - 1;				\
+				continue;				\
+			}						\
+		}							\
+		if (mp_scan_header((data), (end), &k) != 0)		\
+			return 1;					\
+	}								\
+	if (unlikely(*(data) > (end)))					\
+		return 1;						\
+	return 0;							\
+} while (0)
+
+__attribute__((target("sse2"))) int
+mp_check_sse2(const char **data, const char *end)
+{
+	MP_CHECK_VECTORIZED(data, end, 16, mp_scan_run_sse2);
+}
+
+__attribute__((target("avx2"))) int
+mp_check_avx2(const char **data, const char *end)
+{
+	MP_CHECK_VECTORIZED(data, end, 32, mp_scan_run_avx2);
+}
+
+#undef MP_CHECK_VECTORIZED
+
+#else /* !(defined(ENABLE_MP_SCAN_SIMD) && defined (__x86_64__)) */
+
+static int
+mp_check_scalar(const char **data, const char *end)
+{
+	return mp_check(data, end);
+}
+
+#endif /* defined(ENABLE_MP_SCAN_SIMD) && defined (__x86_64__) */
+
+void
+mp_scan_init()
+{
+#if defined(ENABLE_MP_SCAN_SIMD) && defined (__x86_64__)
+	mp_check_fast = avx2_enabled_cpu() ? &mp_check_avx2 : &mp_check_sse2;
+#else
+	mp_check_fast = &mp_check_scalar;
+#endif
+}
@@ -51,6 +51,11 @@
  * showing fiber call stack.
  */
 #cmakedefine ENABLE_BACKTRACE 1
+/*
+ * Defined if memtx tree indexes store 32-bit tuple handles
+ * instead of pointers.
+ */
+#cmakedefine ENABLE_MEMTX_COMPACT_HANDLES 1
 /*
  * Set if the system has bfd.h header and GNU bfd library.
  */
@@ -169,6 +174,9 @@
 #cmakedefine HAVE_CLOCK_GETTIME 1
 #cmakedefine HAVE_CLOCK_GETTIME_DECL 1
 
+/** __get_cpuid() - x86, used to pick an mp_check_fast() version */
+#cmakedefine ENABLE_MP_SCAN_SIMD 1
+
 /** pthread_np.h - non-portable stuff */
 #cmakedefine HAVE_PTHREAD_NP_H 1
 /** pthread_setname_np(pthread_self(), "") - Linux */
@@ -4,7 +4,7 @@ local tap = require('tap')
 local test = tap.test('cfg')
 local socket = require('socket')
 local fio = require('fio')
-test:plan(62)
+test:plan(71)
 
 --------------------------------------------------------------------------------
 -- Invalid values
@@ -25,6 +25,15 @@ invalid('memtx_min_tuple_size', 1000000000)
 invalid('replication', '//guest@localhost:3301')
 invalid('wal_mode', 'invalid')
 invalid('rows_per_wal', -1)
+invalid('replication_apply_lanes', 0)
+invalid('replication_compression', -1)
+invalid('replication_relay_threads', 0)
+invalid('replication_synchro_quorum', 0)
+invalid('replication_synchro_timeout', 0)
+invalid('memtx_defrag_threshold', 2)
+invalid('memtx_evict_threshold', -0.5)
+invalid('memtx_huge_page_size', 4096)
+invalid('memtx_numa_node', -1)
 invalid('listen', '//!')
 invalid('log', ':')
 invalid('log', 'syslog:xxx=')
@@ -0,0 +1,69 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- A checkpoint writes the spaces which change most first and
+-- frees tuples of a written space without waiting for its end.
+--
+cold = box.schema.space.create('cold')
+_ = cold:create_index('pk')
+hot = box.schema.space.create('hot')
+_ = hot:create_index('pk')
+pad = string.rep('x', 1000)
+for i = 1, 3000 do cold:insert{i, pad} end
+for i = 1, 100 do hot:insert{i, pad} end
+for i = 1, 100 do hot:replace{i, pad} end
+-- Tuples of the format before alter are kept with the space.
+_ = cold:create_index('sk', {parts = {2, 'string'}, unique = false})
+
+-- The snapshot of the cold space takes about 3 seconds.
+box.cfg{snap_io_rate_limit = 1}
+ch = fiber.channel(1)
+_ = fiber.create(function() box.snapshot() ch:put(true) end)
+test_run:cmd("setopt delimiter ';'")
+n = 0;
+while box.slab.checkpoint_info().released_size == 0 and n < 100 do
+    n = n + 1
+    hot:delete{n}
+    collectgarbage('collect')
+    fiber.sleep(0.01)
+end;
+test_run:cmd("setopt delimiter ''");
+ch:is_empty()
+box.slab.checkpoint_info().released_size > 0
+
+-- The hot space is written, its tuples are freed at once.
+info = box.slab.checkpoint_info()
+for i = 1, 100 do hot:delete{i} end
+_ = collectgarbage('collect')
+box.slab.checkpoint_info().released_size > info.released_size
+box.slab.checkpoint_info().garbage_size == info.garbage_size
+
+-- The cold space is not written yet, its tuples are kept.
+for i = 1, 100 do cold:delete{i} end
+_ = collectgarbage('collect')
+box.slab.checkpoint_info().garbage_size > info.garbage_size
+ch:is_empty()
+
+ch:get()
+box.slab.checkpoint_info().garbage_size
+box.slab.checkpoint_info().garbage_size_max > 0
+
+box.cfg{snap_io_rate_limit = 0}
+
+--
+-- The snapshot has the tuples freed while it was written
+-- intact, the deletes are replayed from WAL.
+--
+test_run:cmd('restart server default')
+cold = box.space.cold
+hot = box.space.hot
+cold:count()
+hot:count()
+pad = string.rep('x', 1000)
+bad = 0
+for _, t in cold:pairs() do if t[2] ~= pad then bad = bad + 1 end end
+bad
+cold.index.sk:count(pad)
+cold:drop()
+hot:drop()
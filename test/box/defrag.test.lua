@@ -0,0 +1,85 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- Online defragmentation of the memtx tuple arena.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+_ = s:create_index('bs', {type = 'bitset', parts = {3, 'unsigned'}, unique = false})
+_ = s:create_index('rt', {type = 'rtree', parts = {4, 'array'}, unique = false})
+pad = string.rep('x', 100)
+for i = 1, 20000 do s:insert{i, i % 100, i % 7, {i, i}, pad} end
+-- Leave every tenth tuple in every slab.
+for i = 1, 20000 do if i % 10 ~= 0 then s:delete{i} end end
+-- Writes waiting for WAL don't hold the defragmenter off.
+w = box.schema.space.create('writes')
+_ = w:create_index('pk')
+stop = false
+writers_done = fiber.channel(10)
+test_run:cmd("setopt delimiter ';'")
+function writer(id)
+    local i = 0
+    while not stop do
+        w:replace{id, i}
+        i = i + 1
+    end
+    writers_done:put(true)
+end;
+test_run:cmd("setopt delimiter ''");
+for i = 1, 10 do fiber.create(writer, i) end
+_ = collectgarbage('collect')
+items_size = box.slab.info().items_size
+moved_count = box.slab.defrag_info().moved_count
+
+box.cfg{memtx_defrag_threshold = 0.5}
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 300 do
+    if box.slab.info().items_size < items_size and
+       box.slab.defrag_info().moved_count > moved_count then
+        break
+    end
+    fiber.sleep(0.1)
+end;
+test_run:cmd("setopt delimiter ''");
+box.slab.info().items_size < items_size
+box.slab.defrag_info().moved_count > moved_count
+stop = true
+for i = 1, 10 do writers_done:get() end
+w:drop()
+
+-- All indexes refer to the moved tuples.
+s:count()
+s.index.sk:count()
+s.index.bs:count()
+s.index.rt:count()
+test_run:cmd("setopt delimiter ';'")
+function check()
+    local errors = 0
+    for _, t in s:pairs() do
+        if t[1] % 10 ~= 0 or t[5] ~= pad or
+           #s.index.rt:select(t[4]) ~= 1 or
+           s.index.rt:select(t[4])[1] ~= t then
+            errors = errors + 1
+        end
+    end
+    for _, t in s.index.sk:pairs(5) do
+        if t[2] ~= 5 or s:get(t[1]) ~= t then
+            errors = errors + 1
+        end
+    end
+    for _, t in s.index.bs:pairs(3, {iterator = 'bits_all_set'}) do
+        if bit.band(t[3], 3) ~= 3 or s:get(t[1]) ~= t then
+            errors = errors + 1
+        end
+    end
+    return errors
+end;
+test_run:cmd("setopt delimiter ''");
+check()
+
+box.cfg{memtx_defrag_threshold = 0}
+box.cfg{memtx_defrag_threshold = 2}
+box.cfg.memtx_defrag_threshold
+s:drop()
@@ -0,0 +1,88 @@
+--
+-- A multikey TREE index has an entry for every distinct
+-- element of an array field.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+s:create_index('tags', {parts = {2, 'string'}, multikey = true, unique = true})
+s:create_index('tags', {type = 'hash', parts = {2, 'string'}, multikey = true})
+function sorted(t) table.sort(t, function(a, b) return a[1] < b[1] end) return t end
+s:insert{1, {'a', 'b'}}
+s:insert{2, {'b', 'c', 'b'}}
+s:insert{3, {}}
+tags = s:create_index('tags', {parts = {2, 'string'}, multikey = true})
+sorted(tags:select{'b'})
+sorted(tags:select{'a'})
+tags:select{'d'}
+tags:count()
+s:insert{4, {'d', 'a'}}
+sorted(tags:select{'a'})
+#tags:select({'b'}, {iterator = 'GE'})
+#tags:select({'b'}, {iterator = 'LT'})
+s:replace{1, {'c'}}
+sorted(tags:select{'a'})
+sorted(tags:select{'c'})
+s:delete{2}
+tags:select{'b'}
+sorted(tags:select{'c'})
+-- Elements must be of the key part type.
+s:insert{5, {'e', 5}}
+s:insert{5, 'e'}
+s:get{5}
+tags:count()
+s:drop()
+
+-- The array element may be followed by ordinary key parts.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+sk = s:create_index('sk', {parts = {2, 'unsigned', 3, 'string'}, multikey = true})
+s:insert{1, {10, 20}, 'x'}
+s:insert{2, {20, 30}, 'y'}
+s:insert{3, {20}, 'x'}
+sorted(sk:select{20})
+sorted(sk:select{20, 'x'})
+sorted(sk:select({20, 'x'}, {iterator = 'GT'}))
+s:drop()
+
+-- The indexed value or array may be at a path inside a field.
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+function ids(t) local r = {} for _, v in ipairs(t) do table.insert(r, v[1]) end table.sort(r) return r end
+s:create_index('city', {parts = {2, 'string'}, path = 'address..city'})
+s:create_index('city', {parts = {2, 'string'}, path = 'address.city', unique = true})
+city = s:create_index('city', {parts = {2, 'string'}, path = 'address.city'})
+tags = s:create_index('tags', {parts = {2, 'string'}, path = 'tags', multikey = true})
+x = s:create_index('x', {parts = {3, 'unsigned'}, path = '[2]'})
+_ = s:insert{1, {address = {city = 'Paris'}, tags = {'a', 'b'}}, {5, 10}}
+_ = s:insert{2, {address = {city = 'Rome'}, tags = {'b'}}, {6, 20}}
+_ = s:insert{3, {address = {city = 'Paris'}, tags = {}}, {7, 10}}
+ids(city:select{'Paris'})
+ids(tags:select{'b'})
+ids(x:select{10})
+ids(x:select({10}, {iterator = 'GT'}))
+-- A value must be at the path and of the key part type.
+s:insert{4, {address = {}, tags = {}}, {8, 30}}
+s:insert{4, {address = {city = 'Oslo'}}, {8, 30}}
+s:insert{4, {address = {city = 'Oslo'}, tags = {}}, {8}}
+s:insert{4, {address = {city = 4}, tags = {}}, {8, 30}}
+_ = s:insert{4, {address = {city = 'Oslo'}, tags = {}}, {8, 30}}
+ids(city:select{'Oslo'})
+_ = s:replace{1, {address = {city = 'Rome'}, tags = {'c'}}, {5, 10}}
+ids(city:select{'Paris'})
+ids(city:select{'Rome'})
+ids(tags:select{'b'})
+_ = s:delete{2}
+ids(tags:select{'b'})
+ids(x:select{10})
+s:drop()
+
+-- Primary and vinyl indexes can not be multikey or have a path.
+s = box.schema.space.create('test')
+s:create_index('pk', {multikey = true, unique = true})
+s:create_index('pk', {path = 'a', unique = true})
+s:drop()
+s = box.schema.space.create('test', {engine = 'vinyl'})
+_ = s:create_index('pk')
+s:create_index('sk', {parts = {2, 'unsigned'}, multikey = true})
+s:create_index('sk', {parts = {2, 'unsigned'}, path = 'a'})
+s:drop()
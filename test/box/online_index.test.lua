@@ -0,0 +1,57 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- A secondary index is built on a populated memtx space in
+-- batches, and the space is read and written meanwhile.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+for i = 1, 20000 do s:insert{i, i} end
+ch = fiber.channel(1)
+test_run:cmd("setopt delimiter ';'")
+function create_index(name)
+    local ok, err = pcall(s.create_index, s, name,
+                          {parts = {2, 'unsigned'}})
+    ch:put(ok and 'done' or tostring(err))
+end;
+-- The build yields after the first batch.
+_ = fiber.create(create_index, 'sk')
+progress = s.index.pk:info().build
+-- Tuple 1 is in the built part, and so is {3, 3}.
+ok, err = pcall(s.replace, s, {1, 3})
+for i = 1, 20000, 100 do s:replace{i, i + 100000} end
+for i = 2, 20000, 100 do s:delete{i} end
+for i = 20001, 20100 do s:insert{i, i} end;
+test_run:cmd("setopt delimiter ''");
+progress.index
+progress.processed > 0 and progress.processed < progress.total
+progress.total
+ok
+err
+ch:get()
+s.index.pk:info().build
+s:count()
+s.index.sk:count()
+test_run:cmd("setopt delimiter ';'")
+function check()
+    local errors = 0
+    for _, t in s:pairs() do
+        if s.index.sk:get(t[2]) ~= t then
+            errors = errors + 1
+        end
+    end
+    return errors
+end;
+test_run:cmd("setopt delimiter ''");
+check()
+
+-- A duplicate in the part yet to be scanned fails the build.
+test_run:cmd("setopt delimiter ';'")
+_ = fiber.create(create_index, 'sk2')
+s:replace{20000, 5};
+test_run:cmd("setopt delimiter ''");
+ch:get()
+s.index.sk2 == nil
+s.index.pk:info().build
+s:drop()
@@ -0,0 +1,79 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+errinj = box.error.injection
+
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 200000, 1000 do
+    box.begin()
+    for j = i, i + 999 do s:insert{j, j} end
+    box.commit()
+end;
+ch = fiber.channel(1)
+function create_index(name)
+    local ok, err = pcall(s.create_index, s, name,
+                          {parts = {2, 'unsigned'}})
+    ch:put(ok and 'done' or tostring(err))
+end;
+function is_passed(key)
+    local build = s.index.pk:info().build
+    return build == nil or build.processed > key
+end;
+function check()
+    local errors = 0
+    for _, t in s:pairs() do
+        if s.index.sk:get(t[2]) ~= t then
+            errors = errors + 1
+        end
+    end
+    return errors
+end;
+test_run:cmd("setopt delimiter ''");
+
+--
+-- A write to the built part of the index which fails to be
+-- written to WAL is undone in the index.
+--
+_ = fiber.create(create_index, 'sk')
+errinj.set('ERRINJ_WAL_IO', true)
+ok = pcall(s.replace, s, {1, 300001})
+errinj.set('ERRINJ_WAL_IO', false)
+ok
+
+--
+-- So is a write which the scan passes while it waits for WAL.
+--
+errinj.set('ERRINJ_WAL_DELAY', true)
+errinj.set('ERRINJ_WAL_WRITE', true)
+wal_ch = fiber.channel(1)
+_ = fiber.create(function() wal_ch:put((pcall(s.replace, s, {100000, 300002}))) end)
+while not is_passed(100000) do fiber.sleep(0) end
+errinj.set('ERRINJ_WAL_DELAY', false)
+wal_ch:get()
+errinj.set('ERRINJ_WAL_WRITE', false)
+ch:get()
+s.index.sk:get{300001} == nil
+s.index.sk:get{300002} == nil
+s.index.sk:count() == s:count()
+check()
+
+--
+-- A write made during the build fails after the alter is
+-- queued behind it. The alter is rolled back first and
+-- deletes the index, which the rollback of the write must
+-- leave alone.
+--
+s.index.sk:drop()
+_ = fiber.create(create_index, 'sk')
+errinj.set('ERRINJ_WAL_DELAY', true)
+errinj.set('ERRINJ_WAL_WRITE', true)
+_ = fiber.create(function() wal_ch:put((pcall(s.replace, s, {1, 300003}))) end)
+while s.index.pk:info().build ~= nil do fiber.sleep(0) end
+errinj.set('ERRINJ_WAL_DELAY', false)
+wal_ch:get()
+ch:get()
+errinj.set('ERRINJ_WAL_WRITE', false)
+s.index.sk == nil
+s:get{1}
+s:drop()
@@ -0,0 +1,37 @@
+net = require('net.box')
+
+--
+-- DML requests are checked against a copy of the schema in the
+-- network thread. The copy may be stale, so the check is only
+-- advisory: tx validates every request the copy does not vouch
+-- for at the current schema version.
+--
+s = box.schema.space.create('test')
+_ = s:create_index('pk')
+box.schema.user.grant('guest', 'read,write', 'space', 'test')
+c = net.connect(box.cfg.listen)
+
+-- Rejected in the network thread, tx reports the error.
+c.space.test:insert{'a'}
+c.space.test:delete{'a'}
+c.space.test:insert{1}
+c.space.test:delete{1}
+
+-- The copy in the network thread is refreshed only on the
+-- next DML request, so the first one after DDL is checked
+-- against the old schema. A key rejected by the old schema
+-- is valid in the new one.
+s.index.pk:alter({parts = {1, 'string'}})
+c:reload_schema()
+c.space.test:delete{'a'} == nil
+c.space.test:insert{'a'}
+c.space.test:delete{'a'}
+
+-- A key accepted by the old schema is revalidated by tx.
+s.index.pk:alter({parts = {1, 'unsigned'}})
+c:reload_schema()
+c.space.test:delete{'a'}
+s:select()
+
+c:close()
+s:drop()
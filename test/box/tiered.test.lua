@@ -0,0 +1,153 @@
+test_run = require('test_run').new()
+fiber = require('fiber')
+
+--
+-- Bodies of cold tuples of a tiered space are moved to disk,
+-- only their indexed fields stay in memory.
+--
+box.schema.space.create('test', {engine = 'vinyl', tiered = true})
+s = box.schema.space.create('test', {tiered = true})
+_ = s:create_index('pk')
+_ = s:create_index('sk', {parts = {2, 'unsigned'}, unique = false})
+pad = string.rep('x', 1000)
+for i = 1, 1000 do s:insert{i, i % 10, pad} end
+bsize = s:bsize()
+
+-- The first pass of the clock clears access bits, the second
+-- one evicts the tuples which have not been read since.
+box.cfg{memtx_evict_threshold = 0}
+test_run:cmd("setopt delimiter ';'")
+function wait_evicted(count)
+    local n = 0
+    while box.slab.evict_info().evicted_count < count and n < 1000 do
+        n = n + 1
+        fiber.sleep(0.01)
+    end
+    return box.slab.evict_info().evicted_count >= count
+end;
+test_run:cmd("setopt delimiter ''");
+wait_evicted(1000)
+box.cfg{memtx_evict_threshold = 1}
+info = box.slab.evict_info()
+info.evicted_size >= 1000 * #pad
+info.file_size >= info.evicted_size
+s:bsize() == bsize
+
+-- Evicted tuples are loaded back on access.
+s:get{1}[3] == pad
+box.slab.evict_info().loaded_count - info.loaded_count
+t = s.index.sk:select{5}
+#t
+test_run:cmd("setopt delimiter ';'")
+is_loaded = true;
+for _, tuple in ipairs(t) do
+    is_loaded = is_loaded and tuple[3] == pad
+end;
+for _, tuple in s:pairs({10}, {iterator = 'GE', limit = 10}) do
+    is_loaded = is_loaded and tuple[3] == pad
+end;
+test_run:cmd("setopt delimiter ''");
+is_loaded
+s.index.pk:max()[3] == pad
+s.index.pk:min()[3] == pad
+
+-- Writes see whole tuples.
+s:update({2}, {{'=', 3, 'updated'}})
+s:delete{3}[3] == pad
+s:replace{4, 4, 'replaced'}
+s:upsert({5, 5, pad}, {{'=', 3, 'upserted'}})
+s:get{5}
+bsize - s:bsize()
+
+-- A checkpoint writes whole tuples.
+box.snapshot()
+test_run:cmd('restart server default')
+test_run = require('test_run').new()
+fiber = require('fiber')
+s = box.space.test
+pad = string.rep('x', 1000)
+s:count()
+s:get{6}[3] == pad
+s:get{2}
+
+-- A new index is built from whole tuples. Bodies of evicted
+-- tuples are loaded only if their stubs lack its fields.
+box.cfg{memtx_evict_threshold = 0}
+n = 0
+while box.slab.evict_info().evicted_count < 900 and n < 1000 do n = n + 1 fiber.sleep(0.01) end
+box.slab.evict_info().evicted_count >= 900
+box.cfg{memtx_evict_threshold = 1}
+loaded = box.slab.evict_info().loaded_count
+_ = s:create_index('ik', {parts = {2, 'unsigned', 1, 'unsigned'}})
+box.slab.evict_info().loaded_count == loaded
+s.index.ik:count() == s:count()
+s.index.ik:drop()
+_ = s:create_index('tk', {parts = {3, 'string'}, unique = false})
+box.slab.evict_info().loaded_count - loaded >= 900
+s.index.tk:count(pad)
+
+-- A select which yields on loads returns the tuples found by
+-- the scan, whatever happens to the space meanwhile.
+ev = box.slab.evict_info().evicted_count
+box.cfg{memtx_evict_threshold = 0}
+n = 0
+while box.slab.evict_info().evicted_count < ev + 900 and n < 1000 do n = n + 1 fiber.sleep(0.01) end
+box.slab.evict_info().evicted_count >= ev + 900
+box.cfg{memtx_evict_threshold = 1}
+ch = fiber.channel(1)
+_ = fiber.create(function() ch:put({pcall(s.index.sk.select, s.index.sk, {5})}) end)
+_ = s:replace{15, 5, pad}
+s.index.tk:drop()
+res = ch:get()
+res[1]
+#res[2]
+n = 0
+for _, t in ipairs(res[2]) do if t[3] == pad then n = n + 1 end end
+n
+
+-- Evicted tuples deleted while a checkpoint writes them are
+-- written whole.
+box.cfg{snap_io_rate_limit = 1}
+_ = fiber.create(function() box.snapshot() ch:put(true) end)
+for i = 100, 199 do s:delete{i} end
+ch:get()
+box.cfg{snap_io_rate_limit = 0}
+test_run:cmd('restart server default')
+s = box.space.test
+pad = string.rep('x', 1000)
+s:count()
+bad = 0
+for _, t in s:pairs() do if t[3] ~= pad then bad = bad + 1 end end
+bad
+
+-- When most of the spill file is garbage, bodies are written to
+-- the other one, and the rest are copied there, so that the
+-- first file is removed.
+fio = require('fio')
+fiber = require('fiber')
+file0 = fio.pathjoin(box.cfg.memtx_dir, 'memtx.0.spill')
+file1 = fio.pathjoin(box.cfg.memtx_dir, 'memtx.1.spill')
+box.cfg{memtx_evict_threshold = 0}
+n = 0
+while box.slab.evict_info().evicted_count < 899 and n < 1000 do n = n + 1 fiber.sleep(0.01) end
+box.cfg{memtx_evict_threshold = 1}
+info = box.slab.evict_info()
+info.evicted_count
+info.garbage_size
+fio.stat(file0).size == info.file_size
+for i = 200, 799 do s:get{i} end
+box.slab.evict_info().garbage_size > info.file_size / 2
+box.cfg{memtx_evict_threshold = 0}
+n = 0
+while fio.stat(file0) ~= nil and n < 1000 do n = n + 1 fiber.sleep(0.01) end
+box.cfg{memtx_evict_threshold = 1}
+-- Let the clock finish the pass, so that no write is in progress.
+pc = box.slab.evict_info().pass_count
+n = 0
+while box.slab.evict_info().pass_count == pc and n < 1000 do n = n + 1 fiber.sleep(0.01) end
+fio.stat(file0)
+fio.stat(file1).size == box.slab.evict_info().file_size
+bad = 0
+for _, t in s:pairs() do if t[3] ~= pad then bad = bad + 1 end end
+bad
+s:drop()
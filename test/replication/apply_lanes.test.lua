@@ -0,0 +1,70 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+for i = 1, 1000 do s:insert{i, 0} end
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+
+--
+-- Apply lanes are started when the applier subscribes.
+--
+test_run:cmd("switch replica")
+box.cfg{replication_apply_lanes = 4}
+replication = box.cfg.replication
+box.cfg{replication = ''}
+box.cfg{replication = replication}
+box.cfg.replication_apply_lanes
+test_run:cmd("switch default")
+
+--
+-- Rows of one transaction arrive in a batch, which is looked
+-- up by the lanes and applied in order. Rows of a batch change
+-- the same keys more than once.
+--
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 50 do
+    box.begin()
+    for j = 1, 50 do
+        local k = (i * 37 + j * 11) % 100 + 1
+        if j % 3 == 0 then
+            s:delete{k}
+        elseif j % 3 == 1 then
+            s:replace{k, i * j}
+        else
+            s:upsert({k, 0}, {{'+', 2, 1}})
+        end
+    end
+    box.commit()
+end;
+function checksum()
+    local h = 0
+    for _, t in box.space.test:pairs() do
+        h = (h * 31 + t[1] * 17 + t[2]) % 1000003
+    end
+    return h
+end;
+test_run:cmd("setopt delimiter ''");
+_ = test_run:wait_lsn('replica', 'default')
+test_run:cmd("switch replica")
+test_run:cmd("setopt delimiter ';'")
+function checksum()
+    local h = 0
+    for _, t in box.space.test:pairs() do
+        h = (h * 31 + t[1] * 17 + t[2]) % 1000003
+    end
+    return h
+end;
+test_run:cmd("setopt delimiter ''");
+box.info.replication[1].upstream.status
+test_run:cmd("switch default")
+test_run:eval('replica', 'return box.space.test:count()')[1] == s:count()
+test_run:eval('replica', 'return checksum()')[1] == checksum()
+
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
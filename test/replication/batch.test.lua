@@ -0,0 +1,68 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+
+--
+-- Rows which reach the replica together are applied in
+-- batches. Catch up with rows written while it was down.
+--
+test_run:cmd("stop server replica")
+test_run:cmd("setopt delimiter ';'")
+for i = 0, 99 do
+    box.begin()
+    for j = 1, 100 do s:insert{i * 100 + j} end
+    box.commit()
+end;
+test_run:cmd("setopt delimiter ''");
+test_run:cmd("start server replica")
+_ = test_run:wait_lsn('replica', 'default')
+test_run:cmd("switch replica")
+fiber = require('fiber')
+box.space.test:count()
+box.space.test:min()
+box.space.test:max()
+box.info.replication[1].upstream.status
+
+--
+-- A conflict in the middle of a batch: the rows before the
+-- conflicting one are applied, and the applier stops at it.
+--
+_ = box.space.test:insert{10050, 'replica'}
+test_run:cmd("switch default")
+test_run:cmd("setopt delimiter ';'")
+box.begin()
+for i = 10001, 10100 do s:insert{i} end
+box.commit();
+test_run:cmd("setopt delimiter ''");
+test_run:cmd("switch replica")
+while box.info.replication[1].upstream.status ~= 'stopped' do fiber.sleep(0.01) end
+box.info.replication[1].upstream.message
+box.space.test:count()
+box.space.test:get{10049}
+box.space.test:get{10050}
+box.space.test:get{10051} == nil
+
+--
+-- When replication is resumed, the conflicting row is skipped
+-- and the rows after it are received again.
+--
+replication = box.cfg.replication
+box.cfg{replication = ''}
+box.cfg{replication = replication}
+while box.space.test:count() < 10100 do fiber.sleep(0.01) end
+box.space.test:count()
+box.space.test:get{10050}
+box.space.test:get{10100}
+box.info.replication[1].upstream.status
+
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,55 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+
+--
+-- Compression is asked for in SUBSCRIBE.
+--
+test_run:cmd("switch replica")
+box.cfg{replication_compression = 3}
+replication = box.cfg.replication
+box.cfg{replication = ''}
+box.cfg{replication = replication}
+box.info.replication[1].upstream.compression == nil
+test_run:cmd("switch default")
+
+--
+-- Rows are sent in blocks, both when enough rows are
+-- accumulated and when recovery has nothing more to send.
+--
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 1000 do s:insert{i, string.rep('x', 1000)} end;
+box.begin()
+for i = 1, 1000 do s:update(i, {{'=', 2, string.rep('y', 10)}}) end
+box.commit();
+test_run:cmd("setopt delimiter ''");
+_ = s:insert{1001, 'tail'}
+_ = test_run:wait_lsn('replica', 'default')
+test_run:cmd("switch replica")
+box.space.test:count()
+box.space.test:get{1}
+box.space.test:get{1000}
+box.space.test:get{1001}
+box.info.replication[1].upstream.status
+box.info.replication[1].upstream.compression.ratio > 1
+box.info.replication[1].upstream.compression.bytes_saved > 0
+
+--
+-- The master reports the rows it has sent to the replica only
+-- when their block is written to the socket.
+--
+test_run:cmd("switch default")
+fiber = require('fiber')
+while box.info.replication[2].downstream.vclock[1] ~= box.info.vclock[1] do fiber.sleep(0.01) end
+box.info.replication[2].downstream.vclock[1] == box.info.vclock[1]
+
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
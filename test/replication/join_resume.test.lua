@@ -0,0 +1,60 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+fiber = require('fiber')
+digest = require('digest')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+for i = 1, 2000 do s:insert{i, digest.urandom(200)} end
+box.snapshot()
+
+--
+-- The replica loses the connection after 500 initial rows
+-- (see replica_join_break.lua) and resumes JOIN from the same
+-- checkpoint, which stays pinned while newer checkpoints are
+-- made and older ones are collected. JOIN is compressed and
+-- rate limited.
+--
+checkpoint_count = box.cfg.checkpoint_count
+box.cfg{checkpoint_count = 1, replication_join_rate_limit = 0.2}
+test_run:cmd("setopt delimiter ';'")
+done = false;
+ch = fiber.channel(1);
+_ = fiber.create(function()
+    local i = 2001
+    while not done do
+        s:insert{i, digest.urandom(200)}
+        box.snapshot()
+        i = i + 1
+        fiber.sleep(0.1)
+    end
+    ch:put(true)
+end);
+test_run:cmd("setopt delimiter ''");
+t = fiber.time()
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica_join_break.lua'")
+test_run:cmd("start server replica")
+-- 400KB at 200KB per second.
+fiber.time() - t >= 1
+done = true
+ch:get()
+test_run:grep_log('default', 'resuming join after 500 rows') ~= nil
+_ = test_run:wait_lsn('replica', 'default')
+
+--
+-- The replica has got every row once.
+--
+test_run:cmd("switch replica")
+box.info.replication[1].upstream.status
+test_run:cmd("switch default")
+test_run:eval('replica', 'return box.space.test:count()')[1] == s:count()
+checksum = "local h = require('digest').crc32.new() for _, t in box.space.test:pairs() do h:update(t[2]) end return h:result()"
+test_run:eval('replica', checksum)[1] == loadstring(checksum)()
+
+box.cfg{checkpoint_count = checkpoint_count, replication_join_rate_limit = 0}
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
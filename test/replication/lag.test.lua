@@ -0,0 +1,33 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+
+--
+-- Rows written after the checkpoint are sent in the final
+-- stage of JOIN, which collects no lag.
+--
+for i = 1, 10 do s:insert{i} end
+box.snapshot()
+for i = 11, 20 do s:insert{i} end
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+for i = 21, 30 do s:insert{i} end
+_ = test_run:wait_lsn('replica', 'default')
+test_run:cmd("switch replica")
+box.space.test:count()
+stages = box.info.replication[1].upstream.stages
+stages.receive.p99 >= stages.receive.p50
+stages.apply.p99 >= stages.apply.p50
+test_run:cmd("switch default")
+stages = box.info.replication[2].downstream.stages
+stages.read.p99 >= stages.read.p50
+stages.send.p99 >= stages.send.p50
+
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
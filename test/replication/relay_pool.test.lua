@@ -0,0 +1,57 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+replica_set = require('fast_replica')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+
+--
+-- There are more replicas than relay pool threads, so some
+-- threads serve more than one relay.
+--
+box.cfg.replication_relay_threads < 3
+replica_set.join(test_run, 3)
+for i = 1, 100 do s:insert{i, 'x'} end
+test_run:cmd("setopt delimiter ';'")
+function check_replicas(count)
+    for i = 1, 3 do
+        local name = 'replica'..i
+        test_run:wait_lsn(name, 'default')
+        local res = test_run:eval(name, 'return box.space.test:count()')
+        if res[1] ~= count then
+            return name..': '..tostring(res[1])
+        end
+    end
+    return true
+end;
+test_run:cmd("setopt delimiter ''");
+check_replicas(100)
+
+--
+-- Replicas which catch up from the same xlog files share the
+-- blocks decompressed by their relay thread.
+--
+test_run:cmd("stop server replica1")
+test_run:cmd("stop server replica2")
+test_run:cmd("stop server replica3")
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 10 do
+    box.begin()
+    for j = 1, 100 do
+        s:replace{i * 100 + j, string.rep('y', 100)}
+    end
+    box.commit()
+end;
+test_run:cmd("setopt delimiter ''");
+test_run:cmd("start server replica1")
+test_run:cmd("start server replica2")
+test_run:cmd("start server replica3")
+check_replicas(1100)
+test_run:eval('replica3', 'return box.space.test:get{1100}[2]')[1] == string.rep('y', 100)
+test_run:eval('replica3', 'return box.info.replication[1].upstream.status')
+
+replica_set.drop_all(test_run)
+s:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,15 @@
+#!/usr/bin/env tarantool
+
+-- Lose the connection to the master after 500 initial JOIN rows.
+box.error.injection.set('ERRINJ_APPLIER_JOIN_BREAK', 500)
+
+box.cfg({
+    listen              = os.getenv("LISTEN"),
+    replication         = os.getenv("MASTER"),
+    replication_compression = 3,
+    memtx_memory        = 107374182,
+})
+
+box.error.injection.set('ERRINJ_APPLIER_JOIN_BREAK', -1)
+
+require('console').listen(os.getenv('ADMIN'))
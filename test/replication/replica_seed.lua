@@ -0,0 +1,15 @@
+#!/usr/bin/env tarantool
+
+local fio = require('fio')
+
+-- Servers of a suite run in sibling directories, the master
+-- copies its snapshot to their parent (see seed.test.lua).
+box.cfg({
+    listen              = os.getenv("LISTEN"),
+    replication         = os.getenv("MASTER"),
+    replication_seed_snapshot = fio.pathjoin(fio.dirname(fio.cwd()),
+                                             'seed.snap'),
+    memtx_memory        = 107374182,
+})
+
+require('console').listen(os.getenv('ADMIN'))
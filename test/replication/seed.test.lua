@@ -0,0 +1,61 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+fio = require('fio')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+for i = 1, 1000 do s:insert{i, i} end
+box.snapshot()
+
+--
+-- Copy the snapshot where replica_seed.lua looks for it. The
+-- backup keeps the checkpoint pinned until the replica joins.
+--
+test_run:cmd("setopt delimiter ';'")
+function copy(from, to)
+    local src = fio.open(from, {'O_RDONLY'})
+    local data = src:read(fio.stat(from).size)
+    src:close()
+    local dst = fio.open(to, {'O_WRONLY', 'O_CREAT', 'O_TRUNC'},
+                         tonumber('0644', 8))
+    dst:write(data)
+    dst:close()
+end;
+test_run:cmd("setopt delimiter ''");
+seed = fio.pathjoin(fio.dirname(fio.cwd()), 'seed.snap')
+for _, f in ipairs(box.backup.start()) do if f:match('%.snap$') then copy(f, seed) end end
+fio.stat(seed) ~= nil
+
+-- Rows written after the checkpoint come in the final stage.
+for i = 1001, 1100 do s:insert{i, i} end
+
+--
+-- The replica loads the snapshot and joins from the master
+-- after its rows.
+--
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica_seed.lua'")
+test_run:cmd("start server replica")
+test_run:grep_log('replica', 'resuming join from the master') ~= nil
+test_run:grep_log('default', 'resuming join after') ~= nil
+box.backup.stop()
+
+--
+-- Then it subscribes and catches up with the master.
+--
+for i = 1101, 1200 do s:insert{i, i} end
+_ = test_run:wait_lsn('replica', 'default')
+test_run:cmd("switch replica")
+box.info.replication[1].upstream.status
+box.space.test:count()
+box.space.test:get{1}
+box.space.test:get{1100}
+box.space.test:get{1200}
+test_run:cmd("switch default")
+
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+fio.unlink(seed)
+s:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -0,0 +1,92 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+fiber = require('fiber')
+log = require('log')
+
+box.schema.user.grant('guest', 'replication')
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+test_run:cmd("switch default")
+
+--
+-- A synchronous space can't be temporary.
+--
+box.schema.space.create('test', {engine = engine, is_sync = true, temporary = true})
+
+async = box.schema.space.create('async', {engine = engine})
+_ = async:create_index('pk')
+sync = box.schema.space.create('sync', {engine = engine, is_sync = true})
+_ = sync:create_index('pk')
+
+--
+-- A commit to a synchronous space returns when the quorum
+-- has written it.
+--
+box.cfg{replication_synchro_quorum = 2}
+sync:insert{1}
+test_run:cmd("switch replica")
+box.space.sync:get{1}
+test_run:cmd("switch default")
+
+--
+-- Every commit to a synchronous space returns when the
+-- replica has the row.
+--
+test_run:cmd("setopt delimiter ';'")
+function check_sync(count)
+    for i = 1, count do
+        sync:replace{i}
+        local expr = 'return box.space.sync:get{'..i..'} ~= nil'
+        if i % 100 == 0 and not test_run:eval('replica', expr)[1] then
+            return i
+        end
+    end
+    return true
+end;
+test_run:cmd("setopt delimiter ''");
+check_sync(1000)
+
+--
+-- Commit latency with and without waiting for the replica.
+-- Timings go to the log, not to the result file.
+--
+test_run:cmd("setopt delimiter ';'")
+function bench(space, count)
+    local start = fiber.time()
+    for i = 1, count do
+        space:replace{i}
+    end
+    return (fiber.time() - start) / count
+end;
+test_run:cmd("setopt delimiter ''");
+async_latency = bench(async, 1000)
+sync_latency = bench(sync, 1000)
+log.info('commit latency: async %.6fs, sync %.6fs', async_latency, sync_latency)
+sync:count()
+test_run:cmd("switch replica")
+box.space.sync:count()
+test_run:cmd("switch default")
+
+--
+-- If the quorum is not reached in time, the commit fails,
+-- but the transaction stays committed locally.
+--
+test_run:cmd("stop server replica")
+box.cfg{replication_synchro_timeout = 0.1}
+sync:insert{1001}
+sync:get{1001}
+-- Other spaces don't wait.
+async:insert{1001}
+
+--
+-- The quorum of this instance alone never waits.
+--
+box.cfg{replication_synchro_quorum = 1}
+sync:insert{1002}
+
+box.cfg{replication_synchro_timeout = 5}
+async:drop()
+sync:drop()
+test_run:cmd("cleanup server replica")
+box.schema.user.revoke('guest', 'replication')
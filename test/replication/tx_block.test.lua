@@ -0,0 +1,76 @@
+env = require('test_run')
+test_run = env.new()
+engine = test_run:get_cfg('engine')
+fiber = require('fiber')
+
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('test', {engine = engine})
+_ = s:create_index('pk')
+test_run:cmd("create server replica with rpl_master=default, script='replication/replica.lua'")
+test_run:cmd("start server replica")
+
+--
+-- Only a replica which takes a compressed stream is sent
+-- xlog blocks as is.
+--
+test_run:cmd("switch replica")
+box.cfg{replication_compression = 3}
+replication = box.cfg.replication
+box.cfg{replication = ''}
+box.cfg{replication = replication}
+test_run:cmd("switch default")
+
+--
+-- Rows of the replica get to the xlog files of the master.
+--
+replica_uri = test_run:eval('replica', 'return box.cfg.listen')[1]
+box.cfg{replication = replica_uri}
+upstream = function() return box.info.replication[2].upstream end
+while upstream() == nil or upstream().status ~= 'follow' do fiber.sleep(0.01) end
+test_run:cmd("switch replica")
+for i = 1, 10 do box.space.test:insert{10000 + i, 'replica'} end
+test_run:cmd("switch default")
+_ = test_run:wait_lsn('default', 'replica')
+s:count()
+box.cfg{replication = ''}
+
+--
+-- The replica catches up from xlog files: the master restarts,
+-- so the rows are not in its WAL tail in memory. Blocks of
+-- the master's rows are sent whole, blocks with rows the
+-- replica has are filtered row by row.
+--
+test_run:cmd("switch replica")
+box.cfg{replication = ''}
+test_run:cmd("switch default")
+test_run:cmd("setopt delimiter ';'")
+for i = 1, 20 do
+    box.begin()
+    for j = 1, 50 do
+        s:insert{i * 50 + j, string.rep('x', 100)}
+    end
+    box.commit()
+end;
+test_run:cmd("setopt delimiter ''");
+s:insert{1, 'single'}
+test_run:cmd('restart server default')
+fiber = require('fiber')
+s = box.space.test
+s:count()
+test_run:cmd("switch replica")
+box.cfg{replication = replication}
+test_run:cmd("switch default")
+_ = test_run:wait_lsn('replica', 'default')
+test_run:cmd("switch replica")
+box.space.test:count()
+box.space.test:get{1}
+box.space.test:get{1050}[2] == string.rep('x', 100)
+box.space.test:get{10010}
+box.info.replication[1].upstream.status
+box.info.replication[1].upstream.compression.ratio > 1
+test_run:cmd("switch default")
+
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
@@ -195,12 +195,55 @@ void test_get_set()
 	footer();
 }
 
+static
+void test_sparse_pages()
+{
+	header();
+
+	struct bitset bm;
+	bitset_create(&bm, realloc);
+	struct bitset_info info;
+
+	/* A few bits are kept in a sparse page */
+	for (size_t pos = 0; pos < 64; pos += 8)
+		fail_if(bitset_set(&bm, pos) < 0);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 1);
+	fail_unless(info.array_pages == 1);
+	fail_unless(info.total_size < info.page_total_size);
+
+	/* A dense page is converted to a bitmap */
+	size_t page_bit = info.page_data_size * CHAR_BIT;
+	for (size_t pos = 0; pos < page_bit; pos++)
+		fail_if(bitset_set(&bm, pos) < 0);
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 1);
+	fail_unless(info.array_pages == 0);
+	fail_unless(bitset_cardinality(&bm) == page_bit);
+
+	/* And back to a sparse page when most bits are cleared */
+	for (size_t pos = 0; pos < page_bit; pos++) {
+		if (pos % 256 != 0)
+			fail_if(bitset_clear(&bm, pos) < 0);
+	}
+	bitset_info(&bm, &info);
+	fail_unless(info.pages == 1);
+	fail_unless(info.array_pages == 1);
+	for (size_t pos = 0; pos < page_bit; pos++)
+		fail_unless(bitset_test(&bm, pos) == (pos % 256 == 0));
+
+	bitset_destroy(&bm);
+
+	footer();
+}
+
 int main(int argc, char *argv[])
 {
 	setbuf(stdout, NULL);
 	srand(time(NULL));
 	test_cardinality();
 	test_get_set();
+	test_sparse_pages();
 
 	return 0;
 }
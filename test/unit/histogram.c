@@ -171,6 +171,42 @@ test_percentile(void)
 	footer();
 }
 
+static void
+test_copy(void)
+{
+	header();
+
+	size_t n_buckets;
+	int64_t *buckets = gen_buckets(&n_buckets);
+
+	size_t data_len;
+	int64_t *data = gen_rand_data(&data_len);
+
+	struct histogram *src = histogram_new(buckets, n_buckets);
+	struct histogram *dst = histogram_new(buckets, n_buckets);
+	for (size_t i = 0; i < data_len; i++)
+		histogram_collect(src, data[i]);
+	histogram_copy(dst, src);
+	/* The source must not be affected by the copy. */
+	histogram_collect(src, buckets[0]);
+
+	fail_if(dst->total != data_len);
+	fail_if(src->total != data_len + 1);
+	histogram_discard(src, buckets[0]);
+
+	for (int pct = 5; pct < 100; pct += 5) {
+		fail_if(histogram_percentile(dst, pct) !=
+			histogram_percentile(src, pct));
+	}
+
+	histogram_delete(src);
+	histogram_delete(dst);
+	free(data);
+	free(buckets);
+
+	footer();
+}
+
 int
 main()
 {
@@ -178,4 +214,5 @@ main()
 	test_counts();
 	test_discard();
 	test_percentile();
+	test_copy();
 }
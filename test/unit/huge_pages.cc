@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "unit.h"
+#include "memory.h"
+
+enum {
+	HUGE_PAGE_SIZE = 2 * 1024 * 1024,
+	REGION_SIZE = 256 * 1024 * 1024,
+	/* A memtx tuple of a few short fields. */
+	TUPLE_SIZE = 64,
+	TUPLE_COUNT = 2 * 1000 * 1000,
+	LOOKUP_COUNT = 2 * 1000 * 1000,
+};
+
+struct bench_tuple {
+	uint64_t key;
+	char data[TUPLE_SIZE - sizeof(uint64_t)];
+};
+
+static int
+bench_tuple_compare(const struct bench_tuple *a, const struct bench_tuple *b)
+{
+	return a->key < b->key ? -1 : a->key > b->key;
+}
+
+static int
+bench_tuple_compare_key(const struct bench_tuple *a, uint64_t key)
+{
+	return a->key < key ? -1 : a->key > key;
+}
+
+/* The same settings as the memtx tree has. */
+#define BPS_TREE_NAME bench_tree
+#define BPS_TREE_BLOCK_SIZE 512
+#define BPS_TREE_EXTENT_SIZE 16 * 1024
+#define BPS_TREE_COMPARE(a, b, arg) bench_tuple_compare(a, b)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) bench_tuple_compare_key(a, b)
+#define bps_tree_elem_t struct bench_tuple *
+#define bps_tree_key_t uint64_t
+#define bps_tree_arg_t int
+#include "salad/bps_tree.h"
+
+/**
+ * Tuples and tree extents are allocated from one mapped
+ * region, like from the memtx arena.
+ */
+struct bench_region {
+	char *base;
+	size_t used;
+};
+
+static void *
+extent_alloc(void *ctx)
+{
+	struct bench_region *region = (struct bench_region *) ctx;
+	fail_if(region->used + BPS_TREE_EXTENT_SIZE > REGION_SIZE);
+	void *extent = region->base + region->used;
+	region->used += BPS_TREE_EXTENT_SIZE;
+	return extent;
+}
+
+static void
+extent_free(void *ctx, void *extent)
+{
+	(void) ctx;
+	(void) extent;
+}
+
+/**
+ * Fill a tree with tuples placed in the region in random order
+ * and measure random lookups. Return false if a key is missing.
+ */
+static bool
+bench_lookup(bool use_huge_pages, unsigned seed)
+{
+	struct bench_region region;
+	region.base = (char *) mmap(NULL, REGION_SIZE, PROT_READ | PROT_WRITE,
+				    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	fail_if(region.base == MAP_FAILED);
+	region.used = TUPLE_COUNT * sizeof(struct bench_tuple);
+	const char *mode = "regular pages";
+	if (use_huge_pages) {
+		mode = memory_use_huge_pages(region.base, REGION_SIZE,
+					     HUGE_PAGE_SIZE) == 0 ?
+		       "explicit huge pages" : "transparent huge pages";
+	}
+
+	srand(seed);
+	struct bench_tuple *tuples = (struct bench_tuple *) region.base;
+	struct bench_tuple **sorted = (struct bench_tuple **)
+		malloc(TUPLE_COUNT * sizeof(*sorted));
+	fail_if(sorted == NULL);
+	for (uint32_t i = 0; i < TUPLE_COUNT; i++)
+		sorted[i] = &tuples[i];
+	for (uint32_t i = TUPLE_COUNT - 1; i > 0; i--) {
+		uint32_t j = rand() % (i + 1);
+		struct bench_tuple *tmp = sorted[i];
+		sorted[i] = sorted[j];
+		sorted[j] = tmp;
+	}
+	for (uint32_t i = 0; i < TUPLE_COUNT; i++)
+		sorted[i]->key = i;
+
+	struct bench_tree tree;
+	bench_tree_create(&tree, 0, extent_alloc, extent_free, &region);
+	fail_if(bench_tree_build(&tree, sorted, TUPLE_COUNT) != 0);
+	free(sorted);
+
+	bool is_ok = true;
+	clock_t start = clock();
+	for (uint32_t i = 0; i < LOOKUP_COUNT; i++) {
+		uint64_t key = rand() % TUPLE_COUNT;
+		struct bench_tuple **found = bench_tree_find(&tree, key);
+		is_ok = is_ok && found != NULL && (*found)->key == key;
+	}
+	double elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+	diag("%-22s %d lookups in %d tuples: %.0f ns per lookup", mode,
+	     LOOKUP_COUNT, TUPLE_COUNT, elapsed * 1e9 / LOOKUP_COUNT);
+
+	bench_tree_destroy(&tree);
+	munmap(region.base, REGION_SIZE);
+	return is_ok;
+}
+
+static void
+test_invalid()
+{
+	char *base = (char *) mmap(NULL, HUGE_PAGE_SIZE,
+				   PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	fail_if(base == MAP_FAILED);
+	/* Not a single huge page fits an unaligned region. */
+	errno = 0;
+	int rc = memory_use_huge_pages(base + 4096, HUGE_PAGE_SIZE - 4096,
+				       HUGE_PAGE_SIZE);
+	ok(rc == -1 && errno == EINVAL, "region smaller than a huge page");
+	memset(base, 1, HUGE_PAGE_SIZE);
+	ok(base[HUGE_PAGE_SIZE - 1] == 1, "region is usable");
+	errno = 0;
+	rc = memory_bind_numa_node(base, HUGE_PAGE_SIZE, -1);
+	ok(rc == -1 && errno != 0, "negative NUMA node");
+	munmap(base, HUGE_PAGE_SIZE);
+}
+
+int
+main()
+{
+	plan(5);
+	test_invalid();
+	/*
+	 * Timings are not a part of the result file, they are
+	 * printed to stderr.
+	 */
+	unsigned seed = time(NULL);
+	ok(bench_lookup(false, seed), "lookups with regular pages");
+	ok(bench_lookup(true, seed), "lookups with huge pages");
+	return check_plan();
+}
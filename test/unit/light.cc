@@ -318,6 +318,108 @@ iterator_freeze_check()
 	footer();
 }
 
+static double
+now_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/*
+ * Grow a table to a few million records and delete them back,
+ * checking that every insertion and deletion resizes the table
+ * by at most one step, and that the memory is given back.
+ * Insertion latencies are printed to stderr and are not a part
+ * of the result: only the absence of per-size spikes matters.
+ */
+static void
+resize_test()
+{
+	header();
+
+	const uint32_t record_count = 1 << 21;
+	const uint32_t step = light_core::GROW_INCREMENT;
+	struct light_core ht;
+	light_create(&ht, light_extent_size,
+		     my_light_alloc, my_light_free, &extents_count, 0);
+
+	double max_time = 0, sum_time = 0;
+	uint32_t decade_start = 0;
+	for (uint32_t i = 0; i < record_count; i++) {
+		hash_value_t val = i;
+		uint32_t old_size = ht.table_size;
+		double start = now_us();
+		light_insert(&ht, hash(val * 2654435761u), val);
+		double time = now_us() - start;
+		if (ht.table_size - old_size > step)
+			fail("insert resized by more than one step", "true");
+		sum_time += time;
+		if (time > max_time)
+			max_time = time;
+		if (i + 1 == decade_start * 16 || i + 1 == record_count) {
+			fprintf(stderr, "# %u..%u records: insert max %.2f us, "
+				"avg %.3f us\n", decade_start, i + 1,
+				max_time, sum_time / (i + 1 - decade_start));
+			decade_start = i + 1;
+			max_time = sum_time = 0;
+		} else if (decade_start == 0 && i + 1 == 1024) {
+			decade_start = i + 1;
+			max_time = sum_time = 0;
+		}
+	}
+	if (ht.count != record_count || light_selfcheck(&ht))
+		fail("insert failed", "true");
+	size_t full_extents = extents_count;
+
+	/* A read view pins the table size. */
+	struct light_iterator iterator;
+	light_iterator_begin(&ht, &iterator);
+	light_iterator_freeze(&ht, &iterator);
+	uint32_t frozen_size = ht.table_size;
+	for (uint32_t i = 0; i < record_count / 2 + 1; i++) {
+		hash_value_t val = i;
+		light_delete_value(&ht, hash(val * 2654435761u), val);
+	}
+	if (ht.table_size != frozen_size)
+		fail("table shrunk under a read view", "true");
+	light_iterator_destroy(&ht, &iterator);
+
+	double start = now_us();
+	for (uint32_t i = record_count / 2 + 1; i < record_count; i++) {
+		hash_value_t val = i;
+		hash_t h = hash(val * 2654435761u);
+		uint32_t old_size = ht.table_size;
+		light_delete(&ht, light_find(&ht, h, val));
+		if (old_size - ht.table_size > step)
+			fail("delete resized by more than one step", "true");
+		if (ht.count >= 2 * step && ht.table_size > 2 * ht.count + step)
+			fail("table did not follow the deletions", "true");
+		/* Selfcheck is quadratic in the number of empty slots. */
+		if (ht.table_size <= 4096 && (ht.count & (ht.count - 1)) == 0
+		    && light_selfcheck(&ht))
+			fail("internal test failed!", "true");
+	}
+	fprintf(stderr, "# delete of %u records: %.3f s\n",
+		record_count / 2, (now_us() - start) / 1e6);
+	if (ht.count != 0 || ht.table_size != step || light_selfcheck(&ht))
+		fail("delete failed", "true");
+	if (extents_count * 16 > full_extents)
+		fail("memory was not freed", "true");
+
+	/* The shrunk table is still usable. */
+	for (hash_value_t val = 0; val < 1000; val++)
+		light_insert(&ht, hash(val * 2654435761u), val);
+	for (hash_value_t val = 0; val < 1000; val++)
+		if (light_find(&ht, hash(val * 2654435761u), val) == light_end)
+			fail("find after shrink failed", "true");
+	if (light_selfcheck(&ht))
+		fail("internal test failed!", "true");
+	light_destroy(&ht);
+
+	footer();
+}
+
 int
 main(int, const char**)
 {
@@ -326,6 +428,7 @@ main(int, const char**)
 	collision_test();
 	iterator_test();
 	iterator_freeze_check();
+	resize_test();
 	if (extents_count != 0)
 		fail("memory leak!", "true");
 }
@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <msgpuck.h>
+#include "unit.h"
+#include "mp_scan.h"
+#include "cpu_feature.h"
+
+enum {
+	BUF_SIZE = 2 * 1024 * 1024,
+	FUZZ_ITERATIONS = 20000,
+	BENCH_FIELD_COUNT = 4000,
+	BENCH_ITERATIONS = 20000,
+};
+
+/** Implementations checked against mp_check(). */
+static struct {
+	const char *name;
+	mp_check_func check;
+} impls[3];
+static int impl_count;
+
+static void
+impls_create()
+{
+	impls[impl_count].name = "mp_check_fast";
+	impls[impl_count++].check = mp_check_fast;
+#if defined(ENABLE_MP_SCAN_SIMD) && defined (__x86_64__)
+	impls[impl_count].name = "sse2";
+	impls[impl_count++].check = mp_check_sse2;
+	if (avx2_enabled_cpu()) {
+		impls[impl_count].name = "avx2";
+		impls[impl_count++].check = mp_check_avx2;
+	}
+#endif
+}
+
+/**
+ * Check that all implementations give the same result as
+ * mp_check() and stop at the same position on success.
+ */
+static bool
+check_equivalent(const char *data, const char *end)
+{
+	const char *expected_pos = data;
+	int expected = mp_check(&expected_pos, end);
+	for (int i = 0; i < impl_count; i++) {
+		const char *pos = data;
+		int rc = impls[i].check(&pos, end);
+		if (rc != expected || (rc == 0 && pos != expected_pos)) {
+			diag("%s: got %d at %d, expected %d at %d",
+			     impls[i].name, rc, (int) (pos - data), expected,
+			     (int) (expected_pos - data));
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Encode a random value, mostly single-byte ones. */
+static char *
+value_encode(char *pos, int depth)
+{
+	static const char str[] = "abcdefghijklmnopqrstuvwxyz0123456789abcd";
+	int r = rand() % 100;
+	if (depth < 2 && r < 10) {
+		uint32_t size = rand() % 20;
+		if (rand() % 2 == 0) {
+			pos = mp_encode_array(pos, size);
+		} else {
+			size -= size % 2;
+			pos = mp_encode_map(pos, size / 2);
+		}
+		for (uint32_t i = 0; i < size; i++)
+			pos = value_encode(pos, depth + 1);
+		return pos;
+	}
+	if (r < 60) {
+		switch (rand() % 4) {
+		case 0:
+			return mp_encode_uint(pos, rand() % 128);
+		case 1:
+			return mp_encode_int(pos, -1 - rand() % 32);
+		case 2:
+			return mp_encode_nil(pos);
+		default:
+			return mp_encode_bool(pos, rand() % 2);
+		}
+	}
+	if (r < 75)
+		return mp_encode_uint(pos, rand());
+	if (r < 80)
+		return mp_encode_int(pos, -rand());
+	if (r < 90)
+		return mp_encode_str(pos, str, rand() % (sizeof(str) - 1));
+	if (r < 95)
+		return mp_encode_bin(pos, str, rand() % (sizeof(str) - 1));
+	return mp_encode_double(pos, rand() / 3.0);
+}
+
+static char *
+tuple_encode(char *pos)
+{
+	uint32_t field_count = rand() % 100;
+	pos = mp_encode_array(pos, field_count);
+	for (uint32_t i = 0; i < field_count; i++)
+		pos = value_encode(pos, 0);
+	return pos;
+}
+
+static void
+test_valid()
+{
+	static char buf[BUF_SIZE];
+	bool is_ok = true;
+	for (int i = 0; i < FUZZ_ITERATIONS && is_ok; i++) {
+		char *end = tuple_encode(buf);
+		is_ok = check_equivalent(buf, end);
+	}
+	ok(is_ok, "valid documents");
+}
+
+static void
+test_corrupted()
+{
+	static char buf[BUF_SIZE];
+	bool is_ok = true;
+	for (int i = 0; i < FUZZ_ITERATIONS && is_ok; i++) {
+		char *end = tuple_encode(buf);
+		int mutation_count = rand() % 4;
+		for (int j = 0; j < mutation_count; j++)
+			buf[rand() % (end - buf)] = rand();
+		if (rand() % 3 == 0)
+			end = buf + rand() % (end - buf + 1);
+		is_ok = check_equivalent(buf, end);
+	}
+	ok(is_ok, "corrupted and truncated documents");
+}
+
+static void
+test_block_borders()
+{
+	/*
+	 * Runs of single-byte values broken by a longer value at
+	 * every offset within a vector, truncated at every length.
+	 */
+	char buf[256];
+	bool is_ok = true;
+	for (int offset = 0; offset < 64 && is_ok; offset++) {
+		char *pos = mp_encode_array(buf, 100);
+		for (int i = 0; i < 100; i++) {
+			if (i == offset)
+				pos = mp_encode_str(pos, "abc", 3);
+			else
+				pos = mp_encode_uint(pos, i);
+		}
+		for (char *end = buf; end <= pos && is_ok; end++)
+			is_ok = check_equivalent(buf, end);
+	}
+	ok(is_ok, "runs across vector borders");
+}
+
+static void
+bench()
+{
+	static char buf[BUF_SIZE];
+	char *end = mp_encode_array(buf, BENCH_FIELD_COUNT);
+	for (int i = 0; i < BENCH_FIELD_COUNT; i++)
+		end = mp_encode_uint(end, i % 4 == 0 ? i : i % 100);
+	double elapsed[2];
+	for (int k = 0; k < 2; k++) {
+		clock_t start = clock();
+		int rc = 0;
+		for (int i = 0; i < BENCH_ITERATIONS; i++) {
+			const char *pos = buf;
+			rc |= k == 0 ? mp_check(&pos, end) :
+				       mp_check_fast(&pos, end);
+		}
+		fail_if(rc != 0);
+		elapsed[k] = (double) (clock() - start) / CLOCKS_PER_SEC;
+	}
+	double mb = (double) (end - buf) * BENCH_ITERATIONS / 1e6;
+	diag("%d-field tuple: mp_check %.0f MB/s, mp_check_fast %.0f MB/s",
+	     BENCH_FIELD_COUNT, mb / elapsed[0], mb / elapsed[1]);
+}
+
+int
+main()
+{
+	plan(3);
+	srand(time(NULL));
+	mp_scan_init();
+	impls_create();
+
+	test_valid();
+	test_corrupted();
+	test_block_borders();
+	/*
+	 * Throughput is not a part of the result file, it is
+	 * printed to stderr.
+	 */
+	bench();
+
+	return check_plan();
+}
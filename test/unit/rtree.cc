@@ -8,6 +8,8 @@
 #include "salad/rtree.h"
 
 static int page_count = 0;
+/* extent_alloc() fails when page_count reaches the limit */
+static int page_limit = -1;
 
 const uint32_t extent_size = 1024 * 8;
 
@@ -16,6 +18,8 @@ extent_alloc(void *ctx)
 {
 	int *p_page_count = (int *)ctx;
 	assert(p_page_count == &page_count);
+	if (*p_page_count == page_limit)
+		return NULL;
 	++*p_page_count;
 	return malloc(extent_size);
 }
@@ -210,6 +214,63 @@ simple_check()
 	footer();
 }
 
+static void
+replace_record_check()
+{
+	struct rtree_rect rect;
+	struct rtree_iterator iterator;
+	rtree_iterator_init(&iterator);
+	const size_t rounds = 2000;
+
+	header();
+
+	struct rtree tree;
+	rtree_init(&tree, 2, extent_size,
+		   extent_alloc, extent_free, &page_count,
+		   RTREE_EUCLID);
+	for (size_t i = 1; i <= rounds; i++) {
+		rtree_set2d(&rect, i, i, i + 0.5, i + 0.5);
+		rtree_insert(&tree, &rect, (record_t)i);
+	}
+	/* An iterator opened before the records are replaced. */
+	rtree_set2d(&rect, 0, 0, rounds + 1, rounds + 1);
+	if (!rtree_search(&tree, &rect, SOP_BELONGS, &iterator)) {
+		fail("element in tree", "false");
+	}
+	for (size_t i = 1; i <= rounds; i++) {
+		rtree_set2d(&rect, i, i, i + 0.5, i + 0.5);
+		if (!rtree_replace_record(&tree, &rect, (record_t)i,
+					  (record_t)(i + rounds))) {
+			fail("replace element in tree", "false");
+		}
+	}
+	rtree_set2d(&rect, 1, 1, 1.5, 1.5);
+	if (rtree_replace_record(&tree, &rect, (record_t)1, (record_t)1)) {
+		fail("replace a missing element", "true");
+	}
+	size_t count = 0;
+	record_t rec;
+	while ((rec = rtree_iterator_next(&iterator)) != NULL) {
+		if ((size_t)rec <= rounds) {
+			fail("old element found", "true");
+		}
+		count++;
+	}
+	if (count != rounds) {
+		fail("iterator is valid after replace", "false");
+	}
+	if (rtree_number_of_records(&tree) != rounds) {
+		fail("Tree count mismatch", "true");
+	}
+
+	rtree_purge(&tree);
+	rtree_destroy(&tree);
+
+	rtree_iterator_destroy(&iterator);
+
+	footer();
+}
+
 static void
 rtree_test_build(struct rtree *tree, struct rtree_rect *arr, int count)
 {
@@ -276,12 +337,72 @@ neighbor_test()
 	footer();
 }
 
+static void
+bulk_load_extract_rect(record_t record, struct rtree_rect *rect, void *ctx)
+{
+	(void)ctx;
+	size_t i = (size_t)record;
+	rtree_set2d(rect, i, i, i + 0.5, i + 0.5);
+}
+
+static void
+bulk_load_oom_check()
+{
+	header();
+
+	const size_t count = 10000;
+	record_t *records = (record_t *)malloc(count * sizeof(*records));
+	for (size_t i = 0; i < count; i++)
+		records[i] = (record_t)(i + 1);
+
+	struct rtree tree;
+	rtree_init(&tree, 2, extent_size,
+		   extent_alloc, extent_free, &page_count,
+		   RTREE_EUCLID);
+	size_t extents = rtree_bulk_load_extent_count(&tree, count);
+	/* Every failure leaves the tree empty, the next try goes on */
+	for (page_limit = page_count; ; page_limit++) {
+		if (rtree_bulk_load(&tree, records, count,
+				    bulk_load_extract_rect, NULL) == 0)
+			break;
+		if (rtree_number_of_records(&tree) != 0 ||
+		    rtree_used_size(&tree) != 0) {
+			fail("tree is empty after a failure", "false");
+		}
+	}
+	page_limit = -1;
+	if ((size_t)page_count > extents) {
+		fail("extent count is an upper bound", "false");
+	}
+	if (rtree_number_of_records(&tree) != count) {
+		fail("Tree count mismatch", "true");
+	}
+	struct rtree_rect rect;
+	struct rtree_iterator iterator;
+	rtree_iterator_init(&iterator);
+	rtree_set2d(&rect, 0, 0, count + 1, count + 1);
+	size_t found = 0;
+	if (rtree_search(&tree, &rect, SOP_BELONGS, &iterator)) {
+		while (rtree_iterator_next(&iterator) != NULL)
+			found++;
+	}
+	if (found != count) {
+		fail("all records are found", "false");
+	}
+	rtree_iterator_destroy(&iterator);
+	rtree_destroy(&tree);
+	free(records);
+
+	footer();
+}
 
 int
 main(void)
 {
 	simple_check();
+	replace_record_check();
 	neighbor_test();
+	bulk_load_oom_check();
 	if (page_count != 0) {
 		fail("memory leak!", "true");
 	}
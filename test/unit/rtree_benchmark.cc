@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#include "unit.h"
+#include "salad/rtree.h"
+
+/*
+ * A C counterpart of test/wal_off/rtree_benchmark.test.lua:
+ * the same workload run directly against lib/salad rtree,
+ * comparing a tree filled by insertions with a bulk loaded one.
+ * Timings are printed to stderr and are not a part of the result.
+ */
+
+enum {
+	N_RECORDS = 10000,
+	N_ITERATIONS = 10000,
+	N_NEIGHBORS = 10,
+};
+
+static const uint32_t extent_size = 1024 * 16;
+
+static void *
+extent_alloc(void *ctx)
+{
+	(void) ctx;
+	return malloc(extent_size);
+}
+
+static void
+extent_free(void *ctx, void *extent)
+{
+	(void) ctx;
+	free(extent);
+}
+
+static struct rtree_rect *rects;
+
+static void
+extract_rect(record_t record, struct rtree_rect *rect, void *ctx)
+{
+	(void) ctx;
+	*rect = rects[(uintptr_t) record - 1];
+}
+
+static double
+elapsed(clock_t start)
+{
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void
+random_point(struct rtree_rect *rect, unsigned dimension)
+{
+	for (unsigned i = 0; i < dimension; i++) {
+		rect->coords[2 * i] = rect->coords[2 * i + 1] =
+			180.0 * rand() / RAND_MAX;
+	}
+}
+
+static void
+fill_by_insert(struct rtree *tree, unsigned dimension)
+{
+	rtree_init(tree, dimension, extent_size, extent_alloc, extent_free,
+		   NULL, RTREE_EUCLID);
+	clock_t start = clock();
+	for (uintptr_t i = 1; i <= N_RECORDS; i++)
+		rtree_insert(tree, &rects[i - 1], (record_t) i);
+	diag("%uD insert of %d records: %.3f s", dimension, N_RECORDS,
+	     elapsed(start));
+}
+
+static void
+fill_by_bulk_load(struct rtree *tree, unsigned dimension)
+{
+	rtree_init(tree, dimension, extent_size, extent_alloc, extent_free,
+		   NULL, RTREE_EUCLID);
+	record_t *records = (record_t *) malloc(N_RECORDS * sizeof(*records));
+	fail_if(records == NULL);
+	for (uintptr_t i = 1; i <= N_RECORDS; i++)
+		records[i - 1] = (record_t) i;
+	clock_t start = clock();
+	fail_if(rtree_bulk_load(tree, records, N_RECORDS,
+				extract_rect, NULL) != 0);
+	diag("%uD bulk load of %d records: %.3f s", dimension, N_RECORDS,
+	     elapsed(start));
+	free(records);
+}
+
+/**
+ * Run belongs and neighbor searches against both trees and
+ * return false if any of them gives different results.
+ */
+static bool
+compare_searches(struct rtree *inserted, struct rtree *loaded,
+		 unsigned dimension)
+{
+	struct rtree_iterator it1, it2;
+	rtree_iterator_init(&it1);
+	rtree_iterator_init(&it2);
+	double width = 180 / pow(N_RECORDS, 1.0 / dimension);
+	bool is_ok = true;
+	double time1 = 0, time2 = 0;
+	for (int i = 0; i < N_ITERATIONS; i++) {
+		struct rtree_rect rect;
+		for (unsigned d = 0; d < dimension; d++) {
+			rect.coords[2 * d] = (180 - width) * rand() / RAND_MAX;
+			rect.coords[2 * d + 1] = rect.coords[2 * d] + width;
+		}
+		/* Tree orders differ, compare the sums of records. */
+		uintptr_t sum1 = 0, sum2 = 0;
+		record_t rec;
+		clock_t start = clock();
+		rtree_search(inserted, &rect, SOP_BELONGS, &it1);
+		while ((rec = rtree_iterator_next(&it1)) != NULL)
+			sum1 += (uintptr_t) rec;
+		time1 += elapsed(start);
+		start = clock();
+		rtree_search(loaded, &rect, SOP_BELONGS, &it2);
+		while ((rec = rtree_iterator_next(&it2)) != NULL)
+			sum2 += (uintptr_t) rec;
+		time2 += elapsed(start);
+		is_ok = is_ok && sum1 == sum2;
+	}
+	diag("%uD %d belongs searches: %.3f s inserted, %.3f s bulk loaded",
+	     dimension, N_ITERATIONS, time1, time2);
+
+	/*
+	 * Like the Lua benchmark, skip neighbor searches in 8D:
+	 * with uniformly spread points they visit most of the tree.
+	 */
+	time1 = time2 = 0;
+	for (int i = 0; i < N_ITERATIONS && dimension == 2; i++) {
+		struct rtree_rect point;
+		random_point(&point, dimension);
+		clock_t start = clock();
+		rtree_search(inserted, &point, SOP_NEIGHBOR, &it1);
+		uintptr_t sum1 = 0, sum2 = 0;
+		for (int k = 0; k < N_NEIGHBORS; k++)
+			sum1 += (uintptr_t) rtree_iterator_next(&it1);
+		time1 += elapsed(start);
+		start = clock();
+		rtree_search(loaded, &point, SOP_NEIGHBOR, &it2);
+		for (int k = 0; k < N_NEIGHBORS; k++)
+			sum2 += (uintptr_t) rtree_iterator_next(&it2);
+		time2 += elapsed(start);
+		is_ok = is_ok && sum1 == sum2;
+	}
+	if (dimension == 2) {
+		diag("%uD %d nearest %d neighbors searches: %.3f s inserted, "
+		     "%.3f s bulk loaded", dimension, N_ITERATIONS,
+		     N_NEIGHBORS, time1, time2);
+	}
+
+	rtree_iterator_destroy(&it1);
+	rtree_iterator_destroy(&it2);
+	return is_ok;
+}
+
+/** Delete all records and check that the tree is empty. */
+static bool
+remove_all(struct rtree *tree)
+{
+	bool is_ok = true;
+	clock_t start = clock();
+	for (uintptr_t i = 1; i <= N_RECORDS; i++)
+		is_ok = is_ok && rtree_remove(tree, &rects[i - 1],
+					      (record_t) i);
+	diag("%uD delete of %d records: %.3f s", tree->dimension,
+	     N_RECORDS, elapsed(start));
+	return is_ok && rtree_number_of_records(tree) == 0;
+}
+
+static void
+bench(unsigned dimension)
+{
+	for (int i = 0; i < N_RECORDS; i++)
+		random_point(&rects[i], dimension);
+
+	struct rtree inserted, loaded;
+	fill_by_insert(&inserted, dimension);
+	fill_by_bulk_load(&loaded, dimension);
+	ok(rtree_number_of_records(&loaded) == N_RECORDS,
+	   "%uD bulk load count", dimension);
+	ok(rtree_used_size(&loaded) <= rtree_used_size(&inserted),
+	   "%uD bulk loaded tree is not bigger", dimension);
+	ok(compare_searches(&inserted, &loaded, dimension),
+	   "%uD search results match", dimension);
+	ok(remove_all(&loaded), "%uD delete from bulk loaded tree",
+	   dimension);
+	rtree_destroy(&inserted);
+	rtree_destroy(&loaded);
+}
+
+int
+main()
+{
+	plan(8);
+	srand(time(NULL));
+	rects = (struct rtree_rect *) malloc(N_RECORDS * sizeof(*rects));
+	fail_if(rects == NULL);
+	bench(2);
+	bench(8);
+	free(rects);
+	return check_plan();
+}
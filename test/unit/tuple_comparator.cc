@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "unit.h"
+#include "box/tuple.h"
+#include "box/tuple_compare.h"
+
+/*
+ * The test links tuple_compare.cc and tuple_format.c alone,
+ * without the rest of the box library.
+ */
+struct tuple_format_vtab memtx_tuple_format_vtab = { NULL };
+
+const char *field_type_strs[] = {
+	/* [FIELD_TYPE_ANY]      = */ "any",
+	/* [FIELD_TYPE_UNSIGNED] = */ "unsigned",
+	/* [FIELD_TYPE_STRING]   = */ "string",
+	/* [FIELD_TYPE_ARRAY]    = */ "array",
+	/* [FIELD_TYPE_NUMBER]   = */ "number",
+	/* [FIELD_TYPE_INTEGER]  = */ "integer",
+	/* [FIELD_TYPE_SCALAR]   = */ "scalar",
+};
+
+const uint32_t key_mp_type[] = {
+	/* [FIELD_TYPE_ANY]      =  */ UINT32_MAX,
+	/* [FIELD_TYPE_UNSIGNED] =  */ 1U << MP_UINT,
+	/* [FIELD_TYPE_STRING]   =  */ 1U << MP_STR,
+	/* [FIELD_TYPE_ARRAY]    =  */ 1U << MP_ARRAY,
+	/* [FIELD_TYPE_NUMBER]   =  */ (1U << MP_UINT) | (1U << MP_INT) |
+		(1U << MP_FLOAT) | (1U << MP_DOUBLE),
+	/* [FIELD_TYPE_INTEGER]  =  */ (1U << MP_UINT) | (1U << MP_INT),
+	/* [FIELD_TYPE_SCALAR]   =  */ (1U << MP_UINT) | (1U << MP_INT) |
+		(1U << MP_FLOAT) | (1U << MP_DOUBLE) | (1U << MP_STR) |
+		(1U << MP_BIN) | (1U << MP_BOOL) | (1U << MP_NIL),
+};
+
+enum {
+	PART_COUNT_MAX = 3,
+	TUPLE_COUNT = 64,
+	CHECK_ITERATIONS = 10000,
+	BENCH_ITERATIONS = 2000000,
+};
+
+/** Key parts of a key shape, terminated by FIELD_TYPE_ANY. */
+struct shape {
+	const char *name;
+	enum field_type types[PART_COUNT_MAX + 1];
+};
+
+static const struct shape shapes[] = {
+	{ "unsigned", { FIELD_TYPE_UNSIGNED } },
+	{ "string", { FIELD_TYPE_STRING } },
+	{ "integer", { FIELD_TYPE_INTEGER } },
+	{ "number", { FIELD_TYPE_NUMBER } },
+	{ "scalar", { FIELD_TYPE_SCALAR } },
+	{ "integer, string", { FIELD_TYPE_INTEGER, FIELD_TYPE_STRING } },
+	{ "number, unsigned", { FIELD_TYPE_NUMBER, FIELD_TYPE_UNSIGNED } },
+	{ "scalar, scalar", { FIELD_TYPE_SCALAR, FIELD_TYPE_SCALAR } },
+	{ "unsigned, integer, number", { FIELD_TYPE_UNSIGNED,
+	  FIELD_TYPE_INTEGER, FIELD_TYPE_NUMBER } },
+};
+
+/** Encode a random value of the type, with frequent duplicates. */
+static char *
+field_encode(char *pos, enum field_type type)
+{
+	static const char *strs[] = { "", "a", "ab", "b", "ba" };
+	int v = rand() % 5;
+	switch (type) {
+	case FIELD_TYPE_UNSIGNED:
+		return mp_encode_uint(pos, v);
+	case FIELD_TYPE_STRING:
+		return mp_encode_str(pos, strs[v], strlen(strs[v]));
+	case FIELD_TYPE_INTEGER:
+		v -= 2;
+		return v < 0 ? mp_encode_int(pos, v) : mp_encode_uint(pos, v);
+	case FIELD_TYPE_NUMBER:
+		if (rand() % 2 == 0)
+			return mp_encode_double(pos, (v - 2) / 2.0);
+		return field_encode(pos, FIELD_TYPE_INTEGER);
+	case FIELD_TYPE_SCALAR:
+		switch (rand() % 3) {
+		case 0:
+			return mp_encode_bool(pos, v % 2);
+		case 1:
+			return field_encode(pos, FIELD_TYPE_NUMBER);
+		default:
+			return field_encode(pos, FIELD_TYPE_STRING);
+		}
+	default:
+		unreachable();
+		return pos;
+	}
+}
+
+struct test_data {
+	struct key_def *key_def;
+	struct tuple_format *format;
+	struct tuple *tuples[TUPLE_COUNT];
+	/** Keys of the tuples with MessagePack array header. */
+	char *keys[TUPLE_COUNT];
+};
+
+static struct tuple *
+test_tuple_new(struct tuple_format *format, const char *data,
+	       const char *data_end)
+{
+	size_t bsize = data_end - data;
+	size_t data_offset = sizeof(struct tuple) + format->field_map_size;
+	struct tuple *tuple = (struct tuple *) malloc(data_offset + bsize);
+	tuple->refs = 1;
+	tuple->format_id = tuple_format_id(format);
+	tuple->bsize = bsize;
+	tuple->data_offset = data_offset;
+	memcpy((char *) tuple + data_offset, data, bsize);
+	fail_if(tuple_init_field_map(format, (uint32_t *) tuple_data(tuple),
+				     tuple_data(tuple)) != 0);
+	return tuple;
+}
+
+static void
+test_data_create(struct test_data *test, const struct shape *shape)
+{
+	uint32_t part_count = 0;
+	while (part_count < PART_COUNT_MAX &&
+	       shape->types[part_count] != FIELD_TYPE_ANY)
+		part_count++;
+	test->key_def = (struct key_def *) calloc(1, key_def_sizeof(part_count));
+	test->key_def->part_count = part_count;
+	for (uint32_t i = 0; i < part_count; i++) {
+		test->key_def->parts[i].fieldno = i;
+		test->key_def->parts[i].type = shape->types[i];
+	}
+	test->key_def->tuple_compare = tuple_compare_create(test->key_def);
+	test->key_def->tuple_compare_with_key =
+		tuple_compare_with_key_create(test->key_def);
+	test->format = tuple_format_new(&memtx_tuple_format_vtab,
+					&test->key_def, 1, 0);
+	fail_if(test->format == NULL);
+	tuple_format_ref(test->format, 1);
+
+	char buf[128];
+	for (uint32_t i = 0; i < TUPLE_COUNT; i++) {
+		char *pos = mp_encode_array(buf, part_count + 1);
+		const char *key = pos;
+		for (uint32_t j = 0; j < part_count; j++)
+			pos = field_encode(pos, shape->types[j]);
+		size_t key_size = pos - key;
+		pos = mp_encode_uint(pos, i);
+		test->tuples[i] = test_tuple_new(test->format, buf, pos);
+		test->keys[i] = (char *) malloc(key_size + 5);
+		char *key_pos = mp_encode_array(test->keys[i], part_count);
+		memcpy(key_pos, key, key_size);
+	}
+}
+
+static void
+test_data_destroy(struct test_data *test)
+{
+	for (uint32_t i = 0; i < TUPLE_COUNT; i++) {
+		free(test->tuples[i]);
+		free(test->keys[i]);
+	}
+	tuple_format_ref(test->format, -1);
+	free(test->key_def);
+}
+
+static int
+sign(int r)
+{
+	return r < 0 ? -1 : r > 0;
+}
+
+static void
+test_shape(const struct shape *shape)
+{
+	struct test_data test;
+	test_data_create(&test, shape);
+	struct key_def *key_def = test.key_def;
+	bool cmp_ok = true, cmp_wk_ok = true;
+	for (uint32_t i = 0; i < CHECK_ITERATIONS; i++) {
+		uint32_t a = rand() % TUPLE_COUNT;
+		uint32_t b = rand() % TUPLE_COUNT;
+		/* key_compare() is the generic per-part switch. */
+		int expected = sign(key_compare(test.keys[a], test.keys[b],
+						key_def));
+		int r = tuple_compare(test.tuples[a], test.tuples[b], key_def);
+		cmp_ok = cmp_ok && sign(r) == expected;
+		const char *key = test.keys[b];
+		uint32_t part_count = mp_decode_array(&key);
+		r = tuple_compare_with_key(test.tuples[a], key, part_count,
+					   key_def);
+		cmp_wk_ok = cmp_wk_ok && sign(r) == expected;
+	}
+	ok(cmp_ok, "%s: tuple_compare", shape->name);
+	ok(cmp_wk_ok, "%s: tuple_compare_with_key", shape->name);
+	test_data_destroy(&test);
+}
+
+static void
+bench_shape(const struct shape *shape)
+{
+	struct test_data test;
+	test_data_create(&test, shape);
+	struct key_def *key_def = test.key_def;
+	int sum = 0;
+	clock_t start = clock();
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		sum += tuple_compare(test.tuples[i % TUPLE_COUNT],
+				     test.tuples[(i / TUPLE_COUNT) % TUPLE_COUNT],
+				     key_def);
+	}
+	double cmp_time = (double) (clock() - start) / CLOCKS_PER_SEC;
+	start = clock();
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		const char *key = test.keys[(i / TUPLE_COUNT) % TUPLE_COUNT];
+		uint32_t part_count = mp_decode_array(&key);
+		sum += tuple_compare_with_key(test.tuples[i % TUPLE_COUNT],
+					      key, part_count, key_def);
+	}
+	double cmp_wk_time = (double) (clock() - start) / CLOCKS_PER_SEC;
+	diag("%-26s tuple_compare %6.1f M/s, with key %6.1f M/s (%d)",
+	     shape->name, BENCH_ITERATIONS / cmp_time / 1e6,
+	     BENCH_ITERATIONS / cmp_wk_time / 1e6, sum);
+	test_data_destroy(&test);
+}
+
+int
+main()
+{
+	uint32_t shape_count = sizeof(shapes) / sizeof(shapes[0]);
+	plan(shape_count * 2);
+	srand(time(NULL));
+
+	for (uint32_t i = 0; i < shape_count; i++)
+		test_shape(&shapes[i]);
+	/*
+	 * Throughput is not a part of the result file, it is
+	 * printed to stderr.
+	 */
+	for (uint32_t i = 0; i < shape_count; i++)
+		bench_shape(&shapes[i]);
+
+	return check_plan();
+}
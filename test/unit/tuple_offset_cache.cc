@@ -0,0 +1,273 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "unit.h"
+#include "box/tuple_format.h"
+
+/*
+ * The test links tuple_format.c alone, without the rest of
+ * the box library.
+ */
+struct tuple_format_vtab memtx_tuple_format_vtab = { NULL };
+
+const char *field_type_strs[] = {
+	/* [FIELD_TYPE_ANY]      = */ "any",
+	/* [FIELD_TYPE_UNSIGNED] = */ "unsigned",
+	/* [FIELD_TYPE_STRING]   = */ "string",
+	/* [FIELD_TYPE_ARRAY]    = */ "array",
+	/* [FIELD_TYPE_NUMBER]   = */ "number",
+	/* [FIELD_TYPE_INTEGER]  = */ "integer",
+	/* [FIELD_TYPE_SCALAR]   = */ "scalar",
+};
+
+const uint32_t key_mp_type[] = {
+	/* [FIELD_TYPE_ANY]      =  */ UINT32_MAX,
+	/* [FIELD_TYPE_UNSIGNED] =  */ 1U << MP_UINT,
+	/* [FIELD_TYPE_STRING]   =  */ 1U << MP_STR,
+	/* [FIELD_TYPE_ARRAY]    =  */ 1U << MP_ARRAY,
+	/* [FIELD_TYPE_NUMBER]   =  */ (1U << MP_UINT) | (1U << MP_INT) |
+		(1U << MP_FLOAT) | (1U << MP_DOUBLE),
+	/* [FIELD_TYPE_INTEGER]  =  */ (1U << MP_UINT) | (1U << MP_INT),
+	/* [FIELD_TYPE_SCALAR]   =  */ (1U << MP_UINT) | (1U << MP_INT) |
+		(1U << MP_FLOAT) | (1U << MP_DOUBLE) | (1U << MP_STR) |
+		(1U << MP_BIN) | (1U << MP_BOOL) | (1U << MP_NIL),
+};
+
+enum {
+	FIELD_COUNT = 100,
+	INDEXED_FIELD = 4,
+	BENCH_FIELD = 80,
+	BENCH_ITERATIONS = 1000000,
+};
+
+static char data[FIELD_COUNT * 16];
+static const char *data_end;
+/** Field positions found by a plain scan. */
+static const char *expected[FIELD_COUNT];
+
+static void
+tuple_data_create()
+{
+	char *pos = mp_encode_array(data, FIELD_COUNT);
+	for (uint32_t i = 0; i < FIELD_COUNT; i++) {
+		if (i % 3 == 0)
+			pos = mp_encode_str(pos, "field", i % 6);
+		else
+			pos = mp_encode_uint(pos, i * 1000);
+	}
+	data_end = pos;
+	const char *field = data;
+	mp_decode_array(&field);
+	for (uint32_t i = 0; i < FIELD_COUNT; i++) {
+		expected[i] = field;
+		mp_next(&field);
+	}
+}
+
+/**
+ * A tuple of a format: the field map followed by a copy of
+ * MessagePack data.
+ */
+struct test_tuple {
+	char *meta;
+	uint32_t *field_map;
+	const char *data;
+};
+
+static struct tuple_format *
+test_format_new(uint32_t stride, uint32_t field_count_max,
+		bool fixed_layout = false)
+{
+	struct key_def *key_def = (struct key_def *)
+		calloc(1, key_def_sizeof(1));
+	key_def->part_count = 1;
+	key_def->parts[0].fieldno = INDEXED_FIELD;
+	key_def->parts[0].type = FIELD_TYPE_UNSIGNED;
+	struct tuple_format *format =
+		tuple_format_new(&memtx_tuple_format_vtab, &key_def, 1, 0);
+	free(key_def);
+	fail_if(format == NULL);
+	fail_if(fixed_layout && tuple_format_set_fixed_layout(format) != 0);
+	fail_if(tuple_format_set_offset_stride(format, stride,
+					       field_count_max) != 0);
+	return format;
+}
+
+static void
+test_tuple_create(struct test_tuple *tuple, struct tuple_format *format)
+{
+	size_t bsize = data_end - data;
+	tuple->meta = (char *) malloc(format->field_map_size + bsize);
+	/* Garbage must not be taken for a checkpoint. */
+	memset(tuple->meta, 0xff, format->field_map_size);
+	tuple->field_map = (uint32_t *) (tuple->meta + format->field_map_size);
+	memcpy(tuple->field_map, data, bsize);
+	tuple->data = (const char *) tuple->field_map;
+	fail_if(tuple_init_field_map(format, tuple->field_map,
+				     tuple->data) != 0);
+}
+
+static void
+test_tuple_destroy(struct test_tuple *tuple)
+{
+	free(tuple->meta);
+}
+
+static bool
+test_field(struct tuple_format *format, struct test_tuple *tuple,
+	   uint32_t field_no)
+{
+	const char *field = tuple_field_raw(format, tuple->data,
+					    tuple->field_map, field_no);
+	if (field_no >= FIELD_COUNT)
+		return field == NULL;
+	return field - tuple->data == expected[field_no] - data;
+}
+
+static void
+test_access(uint32_t stride, uint32_t field_count_max)
+{
+	struct tuple_format *format = test_format_new(stride,
+						      field_count_max);
+	struct test_tuple tuple;
+
+	/* Sequential access. */
+	test_tuple_create(&tuple, format);
+	bool is_ok = true;
+	for (uint32_t i = 0; i <= FIELD_COUNT; i++)
+		is_ok = is_ok && test_field(format, &tuple, i);
+	ok(is_ok, "stride %u, max %u: sequential access", stride,
+	   field_count_max);
+	test_tuple_destroy(&tuple);
+
+	/* Backward access: the deepest field is the first. */
+	test_tuple_create(&tuple, format);
+	is_ok = true;
+	for (int i = FIELD_COUNT; i >= 0; i--)
+		is_ok = is_ok && test_field(format, &tuple, i);
+	ok(is_ok, "stride %u, max %u: backward access", stride,
+	   field_count_max);
+	test_tuple_destroy(&tuple);
+
+	/* Random access. */
+	test_tuple_create(&tuple, format);
+	is_ok = true;
+	for (uint32_t i = 0; i < FIELD_COUNT * 10; i++)
+		is_ok = is_ok && test_field(format, &tuple,
+					    rand() % (FIELD_COUNT + 1));
+	ok(is_ok, "stride %u, max %u: random access", stride,
+	   field_count_max);
+	test_tuple_destroy(&tuple);
+
+	tuple_format_ref(format, 1);
+	tuple_format_ref(format, -1);
+}
+
+static double
+bench_access(uint32_t stride)
+{
+	struct tuple_format *format = test_format_new(stride, 0);
+	struct test_tuple tuple;
+	test_tuple_create(&tuple, format);
+	clock_t start = clock();
+	uintptr_t sum = 0;
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		sum += (uintptr_t) tuple_field_raw(format, tuple.data,
+						   tuple.field_map,
+						   BENCH_FIELD);
+	}
+	double elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+	fail_if(sum == 0);
+	test_tuple_destroy(&tuple);
+	tuple_format_ref(format, 1);
+	tuple_format_ref(format, -1);
+	return elapsed;
+}
+
+static void
+test_field_map_size()
+{
+	struct tuple_format *format = test_format_new(0, 0);
+	uint16_t base_size = format->field_map_size;
+	is(format->offset_checkpoint_count, 0, "no checkpoints by default");
+
+	tuple_format_set_offset_stride(format, 1, 0);
+	is(format->field_map_size,
+	   base_size + TUPLE_OFFSET_CHECKPOINT_MAX * sizeof(uint32_t),
+	   "the number of checkpoints is limited");
+
+	tuple_format_set_offset_stride(format, 10, FIELD_COUNT);
+	is(format->offset_checkpoint_count, (FIELD_COUNT - 1) / 10,
+	   "the number of checkpoints depends on the field count");
+
+	tuple_format_set_offset_stride(format, FIELD_COUNT, FIELD_COUNT);
+	is(format->offset_stride, 0, "the cache is useless for narrow tuples");
+	is(format->field_map_size, base_size, "field map size is restored");
+
+	tuple_format_ref(format, 1);
+	tuple_format_ref(format, -1);
+}
+
+static void
+test_fixed_layout()
+{
+	struct tuple_format *format = test_format_new(0, 0);
+	uint16_t base_size = format->field_map_size;
+	tuple_format_ref(format, 1);
+	tuple_format_ref(format, -1);
+
+	format = test_format_new(4, FIELD_COUNT, true);
+	is(format->native_field_count, 1, "one native field");
+	is(format->field_map_size, base_size + sizeof(uint64_t) +
+	   format->offset_checkpoint_count * sizeof(uint32_t),
+	   "native slots precede checkpoints");
+	struct test_tuple tuple;
+	test_tuple_create(&tuple, format);
+	is(tuple_field_u64_raw(format, tuple.data, tuple.field_map,
+			       INDEXED_FIELD), INDEXED_FIELD * 1000,
+	   "native value");
+	is(tuple_field_u64_raw(format, tuple.data, tuple.field_map,
+			       INDEXED_FIELD + 1), (INDEXED_FIELD + 1) * 1000,
+	   "not indexed field is decoded");
+	bool is_ok = true;
+	for (int i = FIELD_COUNT; i >= 0; i--)
+		is_ok = is_ok && test_field(format, &tuple, i);
+	ok(is_ok, "offsets are not affected by native slots");
+	test_tuple_destroy(&tuple);
+	tuple_format_ref(format, 1);
+	tuple_format_ref(format, -1);
+}
+
+int
+main()
+{
+	plan(25);
+	srand(time(NULL));
+	tuple_data_create();
+
+	test_field_map_size();
+
+	test_access(0, 0);
+	test_access(1, 0);
+	test_access(1, FIELD_COUNT);
+	test_access(7, 0);
+	test_access(16, FIELD_COUNT);
+
+	test_fixed_layout();
+
+	/*
+	 * Timings are not a part of the result file, they are
+	 * printed to stderr.
+	 */
+	double scan = bench_access(0);
+	double cached = bench_access(1);
+	double sparse = bench_access(8);
+	diag("field %d of %d, %d lookups: scan %.3fs, stride 1 %.3fs, "
+	     "stride 8 %.3fs", BENCH_FIELD + 1, FIELD_COUNT, BENCH_ITERATIONS,
+	     scan, cached, sparse);
+
+	return check_plan();
+}
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "box/wal_tail.h"
+#include "small/ibuf.h"
+#include "memory.h"
+#include "fiber.h"
+#include "unit.h"
+
+enum {
+	TAIL_SIZE = 1024,
+	ROW_SIZE = 40,
+	ROW_COUNT = 100,
+};
+
+/** Append a row which data is its LSN repeated. */
+static void
+append_row(struct wal_tail *tail, uint32_t replica_id, int64_t lsn,
+	   size_t size)
+{
+	char data[TAIL_SIZE * 2];
+	memset(data, (char) lsn, size);
+	struct iovec iov[2];
+	iov[0].iov_base = data;
+	iov[0].iov_len = size / 2;
+	iov[1].iov_base = data + size / 2;
+	iov[1].iov_len = size - size / 2;
+	wal_tail_append(tail, replica_id, lsn, iov, 2);
+}
+
+/**
+ * Read all rows following the cursor, check their contents
+ * and return the number of rows read or -1.
+ */
+static int
+read_rows(struct wal_tail *tail, struct wal_tail_cursor *cursor,
+	  int64_t *last_lsn)
+{
+	struct ibuf buf;
+	ibuf_create(&buf, cord_slab_cache(), 1024);
+	int count = 0;
+	while (true) {
+		ibuf_reset(&buf);
+		if (wal_tail_read(tail, cursor, &buf, 100) != 0) {
+			count = -1;
+			break;
+		}
+		if (ibuf_used(&buf) == 0)
+			break;
+		const char *pos = buf.rpos;
+		while (pos < buf.wpos) {
+			struct wal_tail_row row;
+			memcpy(&row, pos, sizeof(row));
+			pos += sizeof(row);
+			for (uint32_t i = 0; i < row.size; i++) {
+				if (pos[i] != (char) row.lsn)
+					fail("row data", "corrupted");
+			}
+			pos += row.size;
+			*last_lsn = row.lsn;
+			count++;
+		}
+	}
+	ibuf_destroy(&buf);
+	return count;
+}
+
+static void
+test_read()
+{
+	struct vclock vclock;
+	vclock_create(&vclock);
+	vclock_follow(&vclock, 1, 10);
+	struct wal_tail tail;
+	fail_if(wal_tail_create(&tail, TAIL_SIZE, &vclock) != 0);
+
+	struct wal_tail_cursor cursor;
+	is(wal_tail_cursor_create(&tail, &cursor, &vclock), 0,
+	   "cursor at the tail vclock");
+	int64_t last_lsn = 0;
+	is(read_rows(&tail, &cursor, &last_lsn), 0, "empty tail");
+
+	for (int64_t lsn = 11; lsn <= 15; lsn++)
+		append_row(&tail, 1, lsn, ROW_SIZE);
+	is(read_rows(&tail, &cursor, &last_lsn), 5, "all rows are read");
+	is(last_lsn, 15, "in order");
+	append_row(&tail, 1, 16, ROW_SIZE);
+	is(read_rows(&tail, &cursor, &last_lsn), 1, "a new row is read");
+
+	struct vclock behind;
+	vclock_create(&behind);
+	vclock_follow(&behind, 1, 9);
+	isnt(wal_tail_cursor_create(&tail, &cursor, &behind), 0,
+	     "cursor behind the tail vclock");
+	struct vclock concurrent;
+	vclock_copy(&concurrent, &vclock);
+	vclock_follow(&concurrent, 2, 5);
+	is(wal_tail_cursor_create(&tail, &cursor, &concurrent), 0,
+	   "cursor ahead of the tail vclock");
+	wal_tail_destroy(&tail);
+}
+
+static void
+test_evict()
+{
+	struct vclock vclock;
+	vclock_create(&vclock);
+	struct wal_tail tail;
+	fail_if(wal_tail_create(&tail, TAIL_SIZE, &vclock) != 0);
+
+	struct wal_tail_cursor slow, fast;
+	fail_if(wal_tail_cursor_create(&tail, &slow, &vclock) != 0);
+	fail_if(wal_tail_cursor_create(&tail, &fast, &vclock) != 0);
+	int64_t last_lsn = 0;
+	/* Even LSNs belong to replica 1, odd ones to replica 2. */
+	for (int64_t lsn = 1; lsn <= ROW_COUNT; lsn++) {
+		append_row(&tail, 1 + lsn % 2, lsn, ROW_SIZE);
+		fail_if(read_rows(&tail, &fast, &last_lsn) != 1);
+	}
+	is(read_rows(&tail, &slow, &last_lsn), -1,
+	   "rows following a slow reader are evicted");
+	is(last_lsn, ROW_COUNT, "a fast reader keeps up across the ring end");
+
+	/* The tail vclock follows evicted rows. */
+	struct vclock reader;
+	vclock_create(&reader);
+	vclock_follow(&reader, 1, ROW_COUNT);
+	vclock_follow(&reader, 2, ROW_COUNT - 1);
+	is(wal_tail_cursor_create(&tail, &slow, &reader), 0,
+	   "reader at the WAL vclock");
+	int count = read_rows(&tail, &slow, &last_lsn);
+	ok(count > 0 && count < ROW_COUNT && last_lsn == ROW_COUNT,
+	   "the tail keeps the most recent rows");
+
+	append_row(&tail, 1, ROW_COUNT + 2, TAIL_SIZE);
+	is(read_rows(&tail, &fast, &last_lsn), -1, "a big row is not kept");
+	append_row(&tail, 1, ROW_COUNT + 4, ROW_SIZE);
+	vclock_follow(&reader, 1, ROW_COUNT + 2);
+	is(wal_tail_cursor_create(&tail, &slow, &reader), 0,
+	   "reader after the big row");
+	is(read_rows(&tail, &slow, &last_lsn), 1, "rows after the big row");
+	wal_tail_destroy(&tail);
+}
+
+int
+main()
+{
+	memory_init();
+	fiber_init(fiber_c_invoke);
+	plan(14);
+
+	test_read();
+	test_evict();
+
+	int rc = check_plan();
+	fiber_free();
+	memory_free();
+	return rc;
+}
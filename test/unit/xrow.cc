@@ -32,6 +32,9 @@ extern "C" {
 #include "unit.h"
 } /* extern "C" */
 #include "trivia/util.h"
+#include "memory.h"
+#include "fiber.h"
+#include "exception.h"
 #include "box/xrow.h"
 #include "box/iproto_constants.h"
 #include "tt_uuid.h"
@@ -180,16 +183,95 @@ test_greeting()
 	return check_plan();
 }
 
+/**
+ * Encode a TX_BLOCK packet, pass it through the wire format and
+ * decode it back.
+ */
+static int
+tx_block_round_trip(const char *block, uint32_t size, uint32_t len,
+		    const char **out_block, uint32_t *out_size,
+		    uint32_t *out_len)
+{
+	struct xrow_header row;
+	xrow_encode_tx_block(&row, block, size, len);
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_header_encode(&row, iov, 0);
+	if (iovcnt < 0)
+		return -1;
+	size_t packet_size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		packet_size += iov[i].iov_len;
+	char *packet = (char *) region_alloc(&fiber()->gc, packet_size);
+	char *pos = packet;
+	for (int i = 0; i < iovcnt; i++) {
+		memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+	const char *data = packet;
+	if (xrow_header_decode(&row, &data, packet + packet_size) != 0)
+		return -1;
+	if (row.type != IPROTO_TX_BLOCK)
+		return -1;
+	try {
+		xrow_decode_tx_block(&row, out_block, out_size, out_len);
+	} catch (Exception *) {
+		return -1;
+	}
+	return 0;
+}
+
+int
+test_tx_block()
+{
+	plan(8);
+
+	char block[1000];
+	for (size_t i = 0; i < sizeof(block); i++)
+		block[i] = rand();
+	const char *out_block;
+	uint32_t out_size, out_len;
+
+	int rc = tx_block_round_trip(block, sizeof(block), 12345,
+				     &out_block, &out_size, &out_len);
+	is(rc, 0, "round trip");
+	is(out_size, sizeof(block), "roundtrip.size");
+	is(out_len, 12345, "roundtrip.len");
+	is(memcmp(out_block, block, sizeof(block)), 0, "roundtrip.block");
+
+	rc = tx_block_round_trip(block, sizeof(block), IPROTO_TX_LEN_MAX,
+				 &out_block, &out_size, &out_len);
+	is(rc, 0, "max len");
+	is(out_len, IPROTO_TX_LEN_MAX, "max len.len");
+
+	/* The rows are unpacked into a buffer of len bytes. */
+	rc = tx_block_round_trip(block, sizeof(block), IPROTO_TX_LEN_MAX + 1,
+				 &out_block, &out_size, &out_len);
+	isnt(rc, 0, "too large len");
+
+	rc = tx_block_round_trip(block, sizeof(block), 0,
+				 &out_block, &out_size, &out_len);
+	isnt(rc, 0, "zero len");
+
+	fiber_gc();
+	return check_plan();
+}
+
 int
 main(void)
 {
-	plan(1);
+	memory_init();
+	fiber_init(fiber_cxx_invoke);
+
+	plan(2);
 
 	random_init();
 
 	test_greeting();
+	test_tx_block();
 
 	random_free();
+	fiber_free();
+	memory_free();
 
 	return check_plan();
 }